@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "BpPluginTest.h"
+#include "BpPluginTestPassQueue.h"
 #include "Interfaces/IPluginManager.h"
 #define LOCTEXT_NAMESPACE "FBpPluginTestModule"
 
@@ -8,13 +9,15 @@ void FBpPluginTestModule::StartupModule()
 {
 	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("BpPluginTest"))->GetBaseDir(), TEXT("Shaders"));
 	AddShaderSourceDirectoryMapping(TEXT("/Plugin/BpPluginTest"), PluginShaderDir);
+
+	FBpPluginTestPassQueue::Get().Initialize();
 }
 
 void FBpPluginTestModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
-	
+	FBpPluginTestPassQueue::Get().Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
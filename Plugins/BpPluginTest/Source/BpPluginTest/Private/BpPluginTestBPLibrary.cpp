@@ -1,6 +1,8 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "BpPluginTestBPLibrary.h"
+#include "BpPluginTestShaders.h"
+#include "BpPluginTestPassQueue.h"
 
 #include "Engine/TextureRenderTarget2D.h"
 #include "Engine/World.h"
@@ -27,17 +29,8 @@ static const uint32 kGridSubdivisionY = 16;
 #define LOCTEXT_NAMESPACE "BpPluginTest"
 DECLARE_STATS_GROUP(TEXT("ExampleComputeShader"), STATGROUP_ExampleComputeShader, STATCAT_Advanced);
 DECLARE_CYCLE_STAT(TEXT("ExampleComputeShader Execute"), STAT_ExampleComputeShader_Execute, STATGROUP_ExampleComputeShader);
-//! 把下列代码放入.h文件中会报“重定义”的错误
+//! FMyUniformStructData和FMyRDGGlobalShaderCS的声明在BpPluginTestShaders.h中，IMPLEMENT只能放在这一个cpp里，否则会报“重定义”的错误
 //! UniformBuffer的声明方法每个引擎的版本都在变，其实如果发现声明方法变了我们可以去看引擎自己是怎么写的就好了
-BEGIN_GLOBAL_SHADER_PARAMETER_STRUCT(FMyUniformStructData, )
-SHADER_PARAMETER(FVector4f, Color1)
-SHADER_PARAMETER(FVector4f, Color2)
-SHADER_PARAMETER(FVector4f, Color3)
-SHADER_PARAMETER(FVector4f, Color4)
-SHADER_PARAMETER(uint32, ColorIndex)
-SHADER_PARAMETER(float, GlobalTime)
-SHADER_PARAMETER(float, WaveLenthScale)
-END_GLOBAL_SHADER_PARAMETER_STRUCT()
 // 在Shader中直接使用FMyUniform  
 IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(FMyUniformStructData, "FMyUniform");
 
@@ -77,7 +70,7 @@ public:
 
     template<typename TShaderRHIParamRef>
     void SetParameters(
-        FRHICommandListImmediate& RHICmdList,
+        FRHICommandList& RHICmdList,
         const TShaderRHIParamRef ShaderRHI,
         const FLinearColor& MyColor,
         // 添加贴图
@@ -181,25 +174,6 @@ public:
 //    LAYOUT_FIELD(FShaderResourceParameter, OutTexture);
 //};
 
-// 注意，计算着色器直接继承FGlobalShader
-class FMyRDGGlobalShaderCS: public FGlobalShader
-{
-public:
-    DECLARE_GLOBAL_SHADER(FMyRDGGlobalShaderCS);
-    SHADER_USE_PARAMETER_STRUCT(FMyRDGGlobalShaderCS, FGlobalShader);
-
-    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
-        SHADER_PARAMETER_STRUCT_REF(FMyUniformStructData, FMyUniform)
-        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTexture)
-        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutNormalTexture)
-        END_SHADER_PARAMETER_STRUCT()
-
-        static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
-    {
-        return RHISupportsComputeShaders(Parameters.Platform);
-    }
-};
-
 IMPLEMENT_SHADER_TYPE(, FMyGlobalShaderVS, TEXT("/Plugin/BpPluginTest/Private/MyShader.usf"), TEXT("MainVS"), SF_Vertex)
 IMPLEMENT_SHADER_TYPE(, FMyGlobalShaderPS, TEXT("/Plugin/BpPluginTest/Private/MyShader.usf"), TEXT("MainPS"), SF_Pixel)
 // 计算着色器的实现
@@ -209,8 +183,13 @@ IMPLEMENT_SHADER_TYPE(, FMyRDGGlobalShaderCS, TEXT("/Plugin/BpPluginTest/Private
 
 
 // 顶点、像素着色器流程
-static void UseGlobalShaderDraw_RenderThread(
-    FRHICommandListImmediate& RHICmdList,
+// 绘制Pass的参数，RDG根据绑定的RenderTarget自动开始RenderPass并处理状态转换
+BEGIN_SHADER_PARAMETER_STRUCT(FMyDrawPassParameters, )
+    RENDER_TARGET_BINDING_SLOTS()
+END_SHADER_PARAMETER_STRUCT()
+
+static void AddGlobalShaderDrawPass(
+    FRDGBuilder& GraphBuilder,
     FTexture2DRHIRef RenderTargetRHI,
     ERHIFeatureLevel::Type FeatureLevel,
     const FName& TextureRenderTargetName,
@@ -223,79 +202,55 @@ static void UseGlobalShaderDraw_RenderThread(
 {
     check(IsInRenderingThread());
 
-#if WANTS_DRAW_MESH_EVENTS
-    FString EventName;
-    TextureRenderTargetName.ToString(EventName);
-    SCOPED_DRAW_EVENTF(RHICmdList, SceneCapture, TEXT("DrawTestShaderRenderTarget_RenderThread %s"), *EventName);
-#else
-    SCOPED_DRAW_EVENT(RHICmdList, DrawTestShaderRenderTarget_RenderThread);
-#endif
+    FRDGTextureRef RDGRenderTarget = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(RenderTargetRHI, TEXT("DrawTestShaderRenderTarget")));
 
-    //FRHITexture2D* RenderTargetTexture = OutTextureRenderTargetResource->GetRenderTargetTexture();
+    FMyDrawPassParameters* PassParameters = GraphBuilder.AllocParameters<FMyDrawPassParameters>();
+    PassParameters->RenderTargets[0] = FRenderTargetBinding(RDGRenderTarget, ERenderTargetLoadAction::ENoAction);
 
-    RHICmdList.Transition(FRHITransitionInfo(RenderTargetRHI, ERHIAccess::SRVMask, ERHIAccess::RTV));
+    // 获取着色器。
+    FGlobalShaderMap* GlobalShaderMap = GetGlobalShaderMap(FeatureLevel);
+    TShaderMapRef< FMyGlobalShaderVS > VertexShader(GlobalShaderMap);
+    TShaderMapRef< FMyGlobalShaderPS > PixelShader(GlobalShaderMap);
 
-    FRHIRenderPassInfo RPInfo(RenderTargetRHI, ERenderTargetActions::DontLoad_Store);
-    RHICmdList.BeginRenderPass(RPInfo, TEXT("DrawTestShader"));
-    {
-        // 获取着色器。
-        FGlobalShaderMap* GlobalShaderMap = GetGlobalShaderMap(FeatureLevel);
-        TShaderMapRef< FMyGlobalShaderVS > VertexShader(GlobalShaderMap);
-        TShaderMapRef< FMyGlobalShaderPS > PixelShader(GlobalShaderMap);
-
-        // FVertexDeclarationElementList Elements;
-        // const auto Stride = sizeof(FTextureVertex);
-        // Elements.Add(FVertexElement(0, STRUCT_OFFSET(FTextureVertex, Position), VET_Float4, 0, Stride));
-        // Elements.Add(FVertexElement(0, STRUCT_OFFSET(FTextureVertex, UV), VET_Float2, 1, Stride));
-        // FVertexDeclarationRHIRef VertexDeclarationRHI = RHICreateVertexDeclaration(Elements);
-        FTextureVertexDeclaration VertexDeclaration;
-        VertexDeclaration.InitRHI();
-
-
-        // 设置图像管线状态。
-        FGraphicsPipelineStateInitializer GraphicsPSOInit;
-        RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
-        GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-        GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
-        GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
-        GraphicsPSOInit.PrimitiveType = PT_TriangleList;
-        //GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GetVertexDeclarationFVector4();
-        GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = VertexDeclaration.VertexDeclarationRHI;
-        GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
-        GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
-        SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
-
-        // 更新着色器的统一参数。
-        FMyUniformStructData UniformData;
-        UniformData.Color1 = MyParameter.Color1;
-        UniformData.Color2 = MyParameter.Color2;
-        UniformData.Color3 = MyParameter.Color3;
-        UniformData.Color4 = MyParameter.Color4;
-        UniformData.ColorIndex = MyParameter.ColorIndex;
-        UniformData.GlobalTime = MyParameter.GlobalTime;
-        // 新添加的变量在这里设置
-        //SetUniformBufferParameterImmediate(RHICmdList, PixelShader.GetPixelShader(), PixelShader->GetUniformBufferParameter<FMyUniformStructData>(), UniformData);
-        SetUniformBufferParameterImmediate(RHICmdList, PixelShader.GetPixelShader(), PixelShader->GetUniformBufferParameter<FMyUniformStructData>(), UniformData);
-        PixelShader->SetParameters(RHICmdList, PixelShader.GetPixelShader(), MyColor, MyTexture);
-
-        RHICmdList.SetStreamSource(0, GRectangleVertexBuffer.VertexBufferRHI, 0);
-        RHICmdList.DrawIndexedPrimitive(
-            GRectangleIndexBuffer.IndexBufferRHI,
-            /*BaseVertexIndex=*/ 0,
-            /*MinIndex=*/ 0,
-            /*NumVertices=*/ 4,
-            /*StartIndex=*/ 0,
-            /*NumPrimitives=*/ 2,
-            /*NumInstances=*/ 1);
+    // 更新着色器的统一参数。
+    FMyUniformStructData UniformData = MakeMyUniformStructData(MyParameter);
 
-    }
-    RHICmdList.EndRenderPass();
+    GraphBuilder.AddPass(
+        RDG_EVENT_NAME("DrawTestShader %s", *TextureRenderTargetName.ToString()),
+        PassParameters,
+        ERDGPassFlags::Raster,
+        [VertexShader, PixelShader, UniformData, MyColor, MyTexture](FRHICommandList& RHICmdList) {
+            // 设置图像管线状态。
+            FGraphicsPipelineStateInitializer GraphicsPSOInit;
+            RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+            GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+            GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+            GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+            GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+            GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GTextureVertexDeclaration.VertexDeclarationRHI;
+            GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+            GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+            SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+
+            SetUniformBufferParameterImmediate(RHICmdList, PixelShader.GetPixelShader(), PixelShader->GetUniformBufferParameter<FMyUniformStructData>(), UniformData);
+            PixelShader->SetParameters(RHICmdList, PixelShader.GetPixelShader(), MyColor, MyTexture);
+
+            RHICmdList.SetStreamSource(0, GRectangleVertexBuffer.VertexBufferRHI, 0);
+            RHICmdList.DrawIndexedPrimitive(
+                GRectangleIndexBuffer.IndexBufferRHI,
+                /*BaseVertexIndex=*/ 0,
+                /*MinIndex=*/ 0,
+                /*NumVertices=*/ 4,
+                /*StartIndex=*/ 0,
+                /*NumPrimitives=*/ 2,
+                /*NumInstances=*/ 1);
+        });
 
-    //RHICmdList.Transition(FRHITransitionInfo(RenderTargetTexture, ERHIAccess::RTV, ERHIAccess::SRVMask));
+    GraphBuilder.SetTextureAccessFinal(RDGRenderTarget, ERHIAccess::SRVMask);
 }
 
-void UseRDGComput_RenderThread(
-    FRHICommandListImmediate& RHICmdList,
+static void AddRDGComputePass(
+    FRDGBuilder& GraphBuilder,
     FTexture2DRHIRef  RenderTargetRHI,
     FTexture2DRHIRef  OutputNormalRHI,
     ERHIFeatureLevel::Type FeatureLevel,
@@ -304,31 +259,18 @@ void UseRDGComput_RenderThread(
 {
     check(IsInRenderingThread());
 
-    //Create RenderTargetDesc
-    const FRDGTextureDesc& RenderTargetDesc = FRDGTextureDesc::Create2D(RenderTargetRHI->GetSizeXY(), RenderTargetRHI->GetFormat(), FClearValueBinding::Black, TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV);
-    const FRDGTextureDesc& OutputNormalRTDesc = FRDGTextureDesc::Create2D(OutputNormalRHI->GetSizeXY(), OutputNormalRHI->GetFormat(), FClearValueBinding::Black, TexCreate_RenderTargetable | TexCreate_ShaderResource | TexCreate_UAV);
-
-    TRefCountPtr<IPooledRenderTarget> PooledRenderTarget;
-    TRefCountPtr<IPooledRenderTarget> PooledRenderTarget2;
-
-    //RDG Begin
-    FRDGBuilder GraphBuilder(RHICmdList);
-    FRDGTextureRef RDGRenderTarget = GraphBuilder.CreateTexture(RenderTargetDesc, TEXT("RDGRenderTarget"));
-    FRDGTextureRef NormalRDGRenderTarget = GraphBuilder.CreateTexture(OutputNormalRTDesc, TEXT("NormalRDGRenderTarget"));
+    //Register the render target assets with RDG and let the compute shader write to them directly,
+    //no transient textures and no CopyTexture afterwards. The render targets need bCanCreateUAV, see UseRDGCompute
+    FRDGTextureRef RDGRenderTarget = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(RenderTargetRHI, TEXT("RDGRenderTarget")));
+    FRDGTextureRef NormalRDGRenderTarget = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(OutputNormalRHI, TEXT("NormalRDGRenderTarget")));
 
     //Setup Parameters
-    FMyUniformStructData StructParameters;
-    StructParameters.Color1 = MyParameter.Color1;
-    StructParameters.Color2 = MyParameter.Color2;
-    StructParameters.Color3 = MyParameter.Color3;
-    StructParameters.Color4 = MyParameter.Color4;
-    StructParameters.ColorIndex = MyParameter.ColorIndex;
-    StructParameters.GlobalTime= MyParameter.GlobalTime;
-    StructParameters.WaveLenthScale = MyParameter.WaveLenthScale;
+    FMyUniformStructData StructParameters = MakeMyUniformStructData(MyParameter);
 
     FMyRDGGlobalShaderCS::FParameters* Parameters = GraphBuilder.AllocParameters<FMyRDGGlobalShaderCS::FParameters>();
     FRDGTextureUAVDesc UAVDesc(RDGRenderTarget);
     Parameters->FMyUniform = TUniformBufferRef<FMyUniformStructData>::CreateUniformBufferImmediate(StructParameters, UniformBuffer_SingleFrame);
+    Parameters->OceanTime = MyParameter.GlobalTime;
     Parameters->OutTexture = GraphBuilder.CreateUAV(UAVDesc);
 
 
@@ -357,14 +299,9 @@ void UseRDGComput_RenderThread(
             FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *Parameters, ThreadGroupCount);
         });
 
-    GraphBuilder.QueueTextureExtraction(RDGRenderTarget, &PooledRenderTarget);
-    GraphBuilder.QueueTextureExtraction(NormalRDGRenderTarget, &PooledRenderTarget2);
-    GraphBuilder.Execute();
-
-    //Copy Result To RenderTarget Asset
-    RHICmdList.CopyTexture(PooledRenderTarget->GetRenderTargetItem().ShaderResourceTexture, RenderTargetRHI->GetTexture2D(), FRHICopyTextureInfo());
-    RHICmdList.CopyTexture(PooledRenderTarget2->GetRenderTargetItem().ShaderResourceTexture, OutputNormalRHI->GetTexture2D(), FRHICopyTextureInfo());
-    
+    //Materials sample the render targets after this, leave them readable
+    GraphBuilder.SetTextureAccessFinal(RDGRenderTarget, ERHIAccess::SRVMask);
+    GraphBuilder.SetTextureAccessFinal(NormalRDGRenderTarget, ERHIAccess::SRVMask);
 }
 
 // 计算着色器流程，//!未使用RDG，编译可以通过但编辑器无法运行，崩溃
@@ -409,6 +346,18 @@ void UseRDGComput_RenderThread(
 //        MyParameter);
 //}
 
+void EnableRenderTargetUAV(UTextureRenderTarget2D* RenderTarget)
+{
+    check(IsInGameThread());
+
+    // 计算着色器直接写入RenderTarget，需要创建UAV，只在第一次调用时重建资源
+    if (RenderTarget && !RenderTarget->bCanCreateUAV)
+    {
+        RenderTarget->bCanCreateUAV = true;
+        RenderTarget->UpdateResourceImmediate(false);
+    }
+}
+
 UBpPluginTestBPLibrary::UBpPluginTestBPLibrary(const FObjectInitializer& ObjectInitializer)
     : Super(ObjectInitializer)
 {
@@ -437,11 +386,12 @@ void UBpPluginTestBPLibrary::UseGlobalShaderDraw(
     UWorld* World = WorldContextObject->GetWorld();
     ERHIFeatureLevel::Type FeatureLevel = World->Scene->GetFeatureLevel();
 
-    ENQUEUE_RENDER_COMMAND(CaptureCommand)(
-        [MyColor, MyTextureRHI, MyParameter, TextureRenderTargetResource, TextureRenderTargetName, FeatureLevel](FRHICommandListImmediate& RHICmdList)
+    // 不再每次调用单独提交渲染命令，Actor Tick结束后统一构建到同一个FRDGBuilder中
+    FBpPluginTestPassQueue::Get().Enqueue(
+        [MyColor, MyTextureRHI, MyParameter, TextureRenderTargetResource, TextureRenderTargetName, FeatureLevel](FRDGBuilder& GraphBuilder)
         {
-            UseGlobalShaderDraw_RenderThread(
-                RHICmdList,
+            AddGlobalShaderDrawPass(
+                GraphBuilder,
                 TextureRenderTargetResource,
                 FeatureLevel,
                 TextureRenderTargetName,
@@ -487,6 +437,15 @@ void UBpPluginTestBPLibrary::UseRDGCompute(
 {
     check(IsInGameThread());
 
+    if (!OutputRenderTarget || !OutputNormal)
+    {
+        FMessageLog("Blueprint").Warning(LOCTEXT("UseRDGCompute_OutputTargetRequired", "UseRDGCompute: Output and normal render targets are required."));
+        return;
+    }
+
+    EnableRenderTargetUAV(OutputRenderTarget);
+    EnableRenderTargetUAV(OutputNormal);
+
     FTexture2DRHIRef RenderTargetRHI = OutputRenderTarget->GameThread_GetRenderTargetResource()->GetRenderTargetTexture();
     FTexture2DRHIRef OutputNormalRHI = OutputNormal->GameThread_GetRenderTargetResource()->GetRenderTargetTexture();
     const FName TextureRenderTargetName = OutputRenderTarget->GetFName();
@@ -494,10 +453,10 @@ void UBpPluginTestBPLibrary::UseRDGCompute(
     UWorld* World = WorldContextObject->GetWorld();
     ERHIFeatureLevel::Type FeatureLevel = World->Scene->GetFeatureLevel();
 
-    ENQUEUE_RENDER_COMMAND(CaptureCommand)(
-        [RenderTargetRHI, OutputNormalRHI,MyParameter, FeatureLevel, TextureRenderTargetName](FRHICommandListImmediate& RHICmdList) {
-            UseRDGComput_RenderThread(
-                RHICmdList,
+    FBpPluginTestPassQueue::Get().Enqueue(
+        [RenderTargetRHI, OutputNormalRHI,MyParameter, FeatureLevel, TextureRenderTargetName](FRDGBuilder& GraphBuilder) {
+            AddRDGComputePass(
+                GraphBuilder,
                 RenderTargetRHI,
                 OutputNormalRHI,
                 FeatureLevel,
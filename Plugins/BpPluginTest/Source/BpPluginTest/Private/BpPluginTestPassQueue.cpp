@@ -0,0 +1,71 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "BpPluginTestPassQueue.h"
+
+#include "Engine/World.h"
+#include "Misc/CoreDelegates.h"
+#include "RenderGraphBuilder.h"
+#include "RenderingThread.h"
+
+FBpPluginTestPassQueue& FBpPluginTestPassQueue::Get()
+{
+    static FBpPluginTestPassQueue Queue;
+    return Queue;
+}
+
+void FBpPluginTestPassQueue::Initialize()
+{
+    if (!PostActorTickHandle.IsValid())
+    {
+        PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddRaw(this, &FBpPluginTestPassQueue::OnWorldPostActorTick);
+    }
+    if (!EndFrameHandle.IsValid())
+    {
+        EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FBpPluginTestPassQueue::Submit);
+    }
+}
+
+void FBpPluginTestPassQueue::Shutdown()
+{
+    FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+    PostActorTickHandle.Reset();
+    FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+    EndFrameHandle.Reset();
+
+    // The requests left may own render thread state (UOceanDisplacementComponent queues its delete), run them before unloading
+    Submit();
+    FlushRenderingCommands();
+}
+
+void FBpPluginTestPassQueue::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+    Submit();
+}
+
+void FBpPluginTestPassQueue::Enqueue(FAddPasses&& AddPasses)
+{
+    check(IsInGameThread());
+    PendingRequests.Add(MoveTemp(AddPasses));
+}
+
+void FBpPluginTestPassQueue::Submit()
+{
+    check(IsInGameThread());
+    if (PendingRequests.Num() == 0)
+    {
+        return;
+    }
+
+    ENQUEUE_RENDER_COMMAND(BpPluginTestPasses)(
+        [Requests = MoveTemp(PendingRequests)](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("BpPluginTest"));
+            for (FAddPasses& AddPasses : Requests)
+            {
+                AddPasses(GraphBuilder);
+            }
+            GraphBuilder.Execute();
+        });
+
+    PendingRequests.Reset();
+}
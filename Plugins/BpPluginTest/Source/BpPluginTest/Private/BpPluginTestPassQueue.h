@@ -0,0 +1,43 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Templates/Function.h"
+
+class FRDGBuilder;
+class UWorld;
+
+// Render graph passes requested on the game thread during a frame (UseGlobalShaderDraw, UseRDGCompute, UOceanDisplacementComponent),
+// sent to the render thread in one render command once the actors of a world ticked, before the world's scene render is enqueued,
+// and built into a single FRDGBuilder there.
+// One graph per frame instead of one per request, so RDG batches the barriers between passes and can alias transient textures.
+// A render target written by several requests is registered once, RegisterExternalTexture returns the texture already in the graph.
+class FBpPluginTestPassQueue
+{
+public:
+    // Adds the passes of one request to GraphBuilder, runs on the render thread in the order the requests were enqueued
+    using FAddPasses = TUniqueFunction<void(FRDGBuilder& GraphBuilder)>;
+
+    static FBpPluginTestPassQueue& Get();
+
+    // Hooks Submit after the actor tick of every world, and to the end of the frame for requests made after that
+    // (they render the next frame). Called by the module, Shutdown submits the requests left and waits for them
+    void Initialize();
+    void Shutdown();
+
+    // Game thread only
+    void Enqueue(FAddPasses&& AddPasses);
+
+    // Sends the pending requests to the render thread, game thread only. Called once the actors ticked,
+    // call it earlier when the results are needed before that
+    void Submit();
+
+private:
+    void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+    TArray<FAddPasses> PendingRequests;
+    FDelegateHandle PostActorTickHandle;
+    FDelegateHandle EndFrameHandle;
+};
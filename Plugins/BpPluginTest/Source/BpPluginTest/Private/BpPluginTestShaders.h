@@ -0,0 +1,64 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GlobalShader.h"
+#include "ShaderParameterStruct.h"
+#include "RenderGraphResources.h"
+#include "BpPluginTestBPLibrary.h"
+
+class UTextureRenderTarget2D;
+
+// Shaders shared by UBpPluginTestBPLibrary and UOceanDisplacementComponent.
+// IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT / IMPLEMENT_SHADER_TYPE stay in BpPluginTestBPLibrary.cpp, only one cpp may have them.
+
+BEGIN_GLOBAL_SHADER_PARAMETER_STRUCT(FMyUniformStructData, )
+SHADER_PARAMETER(FVector4f, Color1)
+SHADER_PARAMETER(FVector4f, Color2)
+SHADER_PARAMETER(FVector4f, Color3)
+SHADER_PARAMETER(FVector4f, Color4)
+SHADER_PARAMETER(uint32, ColorIndex)
+SHADER_PARAMETER(float, GlobalTime)
+SHADER_PARAMETER(float, WaveLenthScale)
+END_GLOBAL_SHADER_PARAMETER_STRUCT()
+
+inline FMyUniformStructData MakeMyUniformStructData(const FMyShaderStructData& MyParameter)
+{
+    FMyUniformStructData StructParameters;
+    StructParameters.Color1 = MyParameter.Color1;
+    StructParameters.Color2 = MyParameter.Color2;
+    StructParameters.Color3 = MyParameter.Color3;
+    StructParameters.Color4 = MyParameter.Color4;
+    StructParameters.ColorIndex = MyParameter.ColorIndex;
+    StructParameters.GlobalTime = MyParameter.GlobalTime;
+    StructParameters.WaveLenthScale = MyParameter.WaveLenthScale;
+    return StructParameters;
+}
+
+// Ocean.usf, writes displacement and normal of a sum of Gerstner waves
+class FMyRDGGlobalShaderCS: public FGlobalShader
+{
+public:
+    DECLARE_GLOBAL_SHADER(FMyRDGGlobalShaderCS);
+    SHADER_USE_PARAMETER_STRUCT(FMyRDGGlobalShaderCS, FGlobalShader);
+
+    static constexpr uint32 ThreadGroupSize = 32;
+
+    BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+        SHADER_PARAMETER_STRUCT_REF(FMyUniformStructData, FMyUniform)
+        // Wave time in seconds. Outside of FMyUniform so the uniform buffer only changes with the wave parameters
+        SHADER_PARAMETER(float, OceanTime)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutTexture)
+        SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutNormalTexture)
+        END_SHADER_PARAMETER_STRUCT()
+
+        static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+    {
+        return RHISupportsComputeShaders(Parameters.Platform);
+    }
+};
+
+// The compute shader writes to the render targets through UAVs, which they can only make with bCanCreateUAV.
+// Rebuilds the render target resource the first time, game thread only
+void EnableRenderTargetUAV(UTextureRenderTarget2D* RenderTarget);
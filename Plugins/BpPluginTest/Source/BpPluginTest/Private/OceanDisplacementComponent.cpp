@@ -0,0 +1,234 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "OceanDisplacementComponent.h"
+#include "BpPluginTestShaders.h"
+#include "BpPluginTestPassQueue.h"
+
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "RenderGraphUtils.h"
+#include "RenderTargetPool.h"
+#include "SceneInterface.h"
+
+// Render thread side of UOceanDisplacementComponent, kept across frames
+class FOceanDisplacementRenderState
+{
+public:
+	explicit FOceanDisplacementRenderState(ERHIFeatureLevel::Type InFeatureLevel)
+		: FeatureLevel(InFeatureLevel)
+	{
+	}
+
+	void AddPasses(
+		FRDGBuilder& GraphBuilder,
+		FRHITexture* DisplacementRHI,
+		FRHITexture* NormalRHI,
+		float Time,
+		const TOptional<FMyUniformStructData>& UniformData)
+	{
+		check(IsInRenderingThread());
+
+		// Same buffer every frame, rewritten only when the wave parameters changed
+		if (UniformData.IsSet())
+		{
+			if (UniformBuffer.IsValid())
+			{
+				UniformBuffer.UpdateUniformBufferImmediate(UniformData.GetValue());
+			}
+			else
+			{
+				UniformBuffer = TUniformBufferRef<FMyUniformStructData>::CreateUniformBufferImmediate(UniformData.GetValue(), UniformBuffer_MultiFrame);
+			}
+		}
+
+		if (!UniformBuffer.IsValid())
+		{
+			return;
+		}
+
+		CacheExternalTarget(DisplacementRHI, DisplacementTexture, DisplacementTarget, TEXT("OceanDisplacement"));
+		CacheExternalTarget(NormalRHI, NormalTexture, NormalTarget, TEXT("OceanNormal"));
+
+		if (!ComputeShader.IsValid())
+		{
+			ComputeShader = TShaderMapRef<FMyRDGGlobalShaderCS>(GetGlobalShaderMap(FeatureLevel));
+		}
+
+		FRDGTextureRef RDGDisplacement = GraphBuilder.RegisterExternalTexture(DisplacementTarget);
+		FRDGTextureRef RDGNormal = GraphBuilder.RegisterExternalTexture(NormalTarget);
+
+		FMyRDGGlobalShaderCS::FParameters* Parameters = GraphBuilder.AllocParameters<FMyRDGGlobalShaderCS::FParameters>();
+		Parameters->FMyUniform = UniformBuffer;
+		Parameters->OceanTime = Time;
+		Parameters->OutTexture = GraphBuilder.CreateUAV(RDGDisplacement);
+		Parameters->OutNormalTexture = GraphBuilder.CreateUAV(RDGNormal);
+
+		FComputeShaderUtils::AddPass(
+			GraphBuilder,
+			RDG_EVENT_NAME("OceanDisplacement"),
+			ComputeShader,
+			Parameters,
+			FComputeShaderUtils::GetGroupCount(DisplacementRHI->GetSizeXY(), FMyRDGGlobalShaderCS::ThreadGroupSize));
+
+		// Materials sample the render targets after this, leave them readable
+		GraphBuilder.SetTextureAccessFinal(RDGDisplacement, ERHIAccess::SRVMask);
+		GraphBuilder.SetTextureAccessFinal(RDGNormal, ERHIAccess::SRVMask);
+	}
+
+private:
+	// Render targets get a new RHI texture when resized or rebuilt, they are only wrapped for RDG again then
+	static void CacheExternalTarget(FRHITexture* TextureRHI, FTextureRHIRef& CachedTexture, TRefCountPtr<IPooledRenderTarget>& PooledTarget, const TCHAR* Name)
+	{
+		if (CachedTexture != TextureRHI)
+		{
+			CachedTexture = TextureRHI;
+			PooledTarget = CreateRenderTarget(TextureRHI, Name);
+		}
+	}
+
+	ERHIFeatureLevel::Type FeatureLevel;
+	TShaderRef<FMyRDGGlobalShaderCS> ComputeShader;
+	TUniformBufferRef<FMyUniformStructData> UniformBuffer;
+
+	FTextureRHIRef DisplacementTexture;
+	FTextureRHIRef NormalTexture;
+	TRefCountPtr<IPooledRenderTarget> DisplacementTarget;
+	TRefCountPtr<IPooledRenderTarget> NormalTarget;
+};
+
+UOceanDisplacementComponent::UOceanDisplacementComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+}
+
+void UOceanDisplacementComponent::SetRenderTargets(UTextureRenderTarget2D* InDisplacementTarget, UTextureRenderTarget2D* InNormalTarget)
+{
+	DisplacementTarget = InDisplacementTarget;
+	NormalTarget = InNormalTarget;
+	EnableRenderTargetUAV(DisplacementTarget);
+	EnableRenderTargetUAV(NormalTarget);
+}
+
+void UOceanDisplacementComponent::SetWaveParameters(const FMyShaderStructData& InWaveParameters)
+{
+	WaveParameters = InWaveParameters;
+	bWaveParametersDirty = true;
+}
+
+void UOceanDisplacementComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	EnableRenderTargetUAV(DisplacementTarget);
+	EnableRenderTargetUAV(NormalTarget);
+	CreateRenderState();
+}
+
+void UOceanDisplacementComponent::OnUnregister()
+{
+	ReleaseRenderState();
+
+	Super::OnUnregister();
+}
+
+void UOceanDisplacementComponent::CreateRenderState()
+{
+	if (RenderState || !FApp::CanEverRender())
+	{
+		return;
+	}
+
+	const UWorld* World = GetWorld();
+	const ERHIFeatureLevel::Type FeatureLevel = (World && World->Scene) ? World->Scene->GetFeatureLevel() : GMaxRHIFeatureLevel;
+	RenderState = new FOceanDisplacementRenderState(FeatureLevel);
+	bWaveParametersDirty = true;
+}
+
+void UOceanDisplacementComponent::ReleaseRenderState()
+{
+	if (!RenderState)
+	{
+		return;
+	}
+
+	// Queued behind the requests still using it, their passes only capture what they need from it
+	FOceanDisplacementRenderState* State = RenderState;
+	FBpPluginTestPassQueue::Get().Enqueue(
+		[State](FRDGBuilder& GraphBuilder)
+		{
+			delete State;
+		});
+	RenderState = nullptr;
+}
+
+void UOceanDisplacementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!RenderState || !DisplacementTarget || !NormalTarget)
+	{
+		return;
+	}
+
+	// Held by the request, the requests only reach the render thread once the actors ticked and the render target
+	// resources may be released before that
+	FTextureRenderTargetResource* DisplacementResource = DisplacementTarget->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* NormalResource = NormalTarget->GameThread_GetRenderTargetResource();
+	FTextureRHIRef DisplacementRHI = DisplacementResource ? DisplacementResource->GetRenderTargetTexture() : nullptr;
+	FTextureRHIRef NormalRHI = NormalResource ? NormalResource->GetRenderTargetTexture() : nullptr;
+	if (!DisplacementRHI || !NormalRHI)
+	{
+		return;
+	}
+
+	// One dispatch sized by the displacement target writes both targets, a smaller normal target would be written out of bounds
+	// and a larger one only partly
+	if (DisplacementRHI->GetSizeXY() != NormalRHI->GetSizeXY())
+	{
+		if (!bTargetSizeMismatch)
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s: DisplacementTarget (%s) and NormalTarget (%s) must be the same size, the ocean is not updated"),
+				*GetPathName(), *DisplacementRHI->GetSizeXY().ToString(), *NormalRHI->GetSizeXY().ToString());
+			bTargetSizeMismatch = true;
+		}
+		return;
+	}
+	bTargetSizeMismatch = false;
+
+	TOptional<FMyUniformStructData> UniformData;
+	if (bWaveParametersDirty)
+	{
+		UniformData = MakeMyUniformStructData(WaveParameters);
+		bWaveParametersDirty = false;
+	}
+
+	const float Time = GetWorld()->GetTimeSeconds() * TimeScale;
+	FOceanDisplacementRenderState* State = RenderState;
+	FBpPluginTestPassQueue::Get().Enqueue(
+		[State, DisplacementRHI, NormalRHI, Time, UniformData](FRDGBuilder& GraphBuilder)
+		{
+			State->AddPasses(GraphBuilder, DisplacementRHI, NormalRHI, Time, UniformData);
+		});
+}
+
+#if WITH_EDITOR
+void UOceanDisplacementComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FName PropertyName = PropertyChangedEvent.GetMemberPropertyName();
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UOceanDisplacementComponent, WaveParameters))
+	{
+		bWaveParametersDirty = true;
+	}
+	else if ((PropertyName == GET_MEMBER_NAME_CHECKED(UOceanDisplacementComponent, DisplacementTarget))
+		|| (PropertyName == GET_MEMBER_NAME_CHECKED(UOceanDisplacementComponent, NormalTarget)))
+	{
+		EnableRenderTargetUAV(DisplacementTarget);
+		EnableRenderTargetUAV(NormalTarget);
+	}
+}
+#endif
@@ -0,0 +1,67 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "BpPluginTestBPLibrary.h"
+#include "OceanDisplacementComponent.generated.h"
+
+class UTextureRenderTarget2D;
+class FOceanDisplacementRenderState;
+
+/*
+*	Writes the ocean displacement and normal render targets every frame from native tick, same shader as UseRDGCompute.
+*	The render thread state (compute shader, uniform buffer, the render targets registered for RDG) is kept across frames,
+*	the uniform buffer is only updated when WaveParameters change. Each tick queues one request with the wave time on
+*	FBpPluginTestPassQueue, built into the frame's shared render graph.
+*	Both render targets are written by one dispatch and must be the same size.
+*/
+UCLASS(ClassGroup = Rendering, meta = (BlueprintSpawnableComponent))
+class BPPLUGINTEST_API UOceanDisplacementComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UOceanDisplacementComponent(const FObjectInitializer& ObjectInitializer);
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean")
+		UTextureRenderTarget2D* DisplacementTarget = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean")
+		UTextureRenderTarget2D* NormalTarget = nullptr;
+
+	// GlobalTime is ignored, the waves follow the world time scaled by TimeScale
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean")
+		FMyShaderStructData WaveParameters;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ocean")
+		float TimeScale = 1.0f;
+
+	UFUNCTION(BlueprintCallable, Category = "Ocean")
+		void SetRenderTargets(UTextureRenderTarget2D* InDisplacementTarget, UTextureRenderTarget2D* InNormalTarget);
+
+	UFUNCTION(BlueprintCallable, Category = "Ocean")
+		void SetWaveParameters(const FMyShaderStructData& InWaveParameters);
+
+	//~ Begin UActorComponent Interface
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~ End UActorComponent Interface
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	void CreateRenderState();
+	void ReleaseRenderState();
+
+	// Owned by the render thread once created, deleted there through the pass queue by ReleaseRenderState
+	FOceanDisplacementRenderState* RenderState = nullptr;
+	// WaveParameters changed since the last queued request
+	bool bWaveParametersDirty = true;
+	// The render targets differed in size at the last tick, the error is only logged once until they match again
+	bool bTargetSizeMismatch = false;
+};
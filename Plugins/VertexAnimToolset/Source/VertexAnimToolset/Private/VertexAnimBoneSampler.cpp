@@ -0,0 +1,296 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimBoneSampler.h"
+
+#include "VertexAnimProfile.h"
+
+#include "Animation/AnimationAsset.h"
+#include "Animation/Skeleton.h"
+
+// Bones are sampled in fixed size chunks so the interpolation loops run over contiguous scratch arrays
+static constexpr int32 BoneSampleChunk = 32;
+
+static FFloat16Color TexelFromEncodedData(const TArray <uint16>& Data, const int32 TexelIndex)
+{
+	FFloat16Color Texel;
+	Texel.R.Encoded = Data[TexelIndex * 4 + 0];
+	Texel.G.Encoded = Data[TexelIndex * 4 + 1];
+	Texel.B.Encoded = Data[TexelIndex * 4 + 2];
+	Texel.A.Encoded = Data[TexelIndex * 4 + 3];
+	return Texel;
+}
+
+FQuat4f FVertexAnimBoneSampler::DecodeQuat(const FFloat16Color& Texel)
+{
+	const float R = Texel.R.GetFloat();
+	const float G = Texel.G.GetFloat();
+	const float B = Texel.B.GetFloat();
+	const float A = Texel.A.GetFloat();
+
+	// EncodeData_Quat clamps R and G to at least 0.001 before applying the sign bits,
+	// so a 0 in R can only be the (0, 0, 0, 1) texel written for quats without small components.
+	if (R == 0.f)
+	{
+		return FQuat4f::Identity;
+	}
+
+	const bool Bit0 = R > 0.f;
+	const bool Bit1 = G > 0.f;
+	const int32 BigComp = (Bit0 ? 2 : 0) + (Bit1 ? 1 : 0);
+
+	const float MaxDim = (A + 1.f) * 0.5f;
+	const float X = ((FMath::Abs(R) * 2.f) - 1.f) * MaxDim;
+	const float Y = ((FMath::Abs(G) * 2.f) - 1.f) * MaxDim;
+	const float Z = B * MaxDim;
+	const float Big = FMath::Sqrt(FMath::Max(0.f, 1.f - (X * X) - (Y * Y) - (Z * Z)));
+
+	float Comps[4];
+	const float Small[3] = { X, Y, Z };
+	for (int32 c = 0, s = 0; c < 4; c++)
+	{
+		Comps[c] = (c == BigComp) ? Big : Small[s++];
+	}
+
+	FQuat4f Q(Comps[0], Comps[1], Comps[2], Comps[3]);
+	Q.Normalize();
+	return Q;
+}
+
+FVector3f FVertexAnimBoneSampler::DecodeVectorHDR(const FFloat16Color& Texel, const float MaxValue)
+{
+	const float Mag = ((Texel.A.GetFloat() + 1.f) * 0.5f) * MaxValue;
+	return FVector3f(Texel.R.GetFloat(), Texel.G.GetFloat(), Texel.B.GetFloat()) * Mag;
+}
+
+FTransform FVertexAnimBoneSampler::MirrorTransform(const FTransform& Transform, const EAxis::Type Axis)
+{
+	const int32 Comp = FMath::Clamp((int32)Axis - (int32)EAxis::X, 0, 2);
+
+	FVector Translation = Transform.GetTranslation();
+	Translation[Comp] *= -1.0;
+
+	// The rotation keeps its component along the axis, the other two flip
+	FQuat Rotation = Transform.GetRotation();
+	Rotation.X *= (Comp == 0) ? 1.0 : -1.0;
+	Rotation.Y *= (Comp == 1) ? 1.0 : -1.0;
+	Rotation.Z *= (Comp == 2) ? 1.0 : -1.0;
+
+	return FTransform(Rotation, Translation, Transform.GetScale3D());
+}
+
+void FVertexAnimBoneSampler::CalcClipFrames(const float Time, const float FrameRate, const int32 NumFrames, int32& OutFrame0, int32& OutFrame1, float& OutAlpha)
+{
+	float Frame = FMath::Fmod(Time * FrameRate, (float)NumFrames);
+	if (Frame < 0.f) Frame += NumFrames;
+
+	OutFrame0 = FMath::Min(FMath::FloorToInt(Frame), NumFrames - 1);
+	OutFrame1 = (OutFrame0 + 1) % NumFrames;
+	OutAlpha = Frame - OutFrame0;
+}
+
+void FVertexAnimBoneSampler::Reset()
+{
+	NumBones = 0;
+	NumRows = 0;
+	Clips.Empty();
+	PosX.Empty(); PosY.Empty(); PosZ.Empty();
+	RotX.Empty(); RotY.Empty(); RotZ.Empty(); RotW.Empty();
+	BoneNames.Empty();
+	MirrorBones.Empty();
+}
+
+bool FVertexAnimBoneSampler::Initialize(const UVertexAnimProfile* InProfile)
+{
+	Reset();
+
+	if (!InProfile || !InProfile->Anims_Bone.Num()) return false;
+
+	const TArray <uint16>& PosData = InProfile->BonePosTextureData;
+	const TArray <uint16>& RotData = InProfile->BoneRotTextureData;
+	const int32 Width = InProfile->OverrideSize_Bone.X;
+	const int32 NumTexels = RotData.Num() / 4;
+
+	if ((Width <= 0) || (NumTexels == 0) || (PosData.Num() != RotData.Num()) || (NumTexels % Width))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no CPU bone data, bake it with CPUBoneSampling on"), *InProfile->GetName());
+		return false;
+	}
+
+	const int32 InNumRows = NumTexels / Width;
+
+	for (int32 i = 0; i < InProfile->Anims_Bone.Num(); i++)
+	{
+		const FVASequenceData& Anim = InProfile->Anims_Bone[i];
+		if ((Anim.NumFrames < 1) || (Anim.AnimStart_Generated + Anim.NumFrames > InNumRows))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s CPU bone data does not match Anims_Bone, rebake the profile"), *InProfile->GetName());
+			Clips.Empty();
+			return false;
+		}
+
+		FClip& Clip = Clips.AddDefaulted_GetRef();
+		Clip.StartRow = Anim.AnimStart_Generated;
+		Clip.NumFrames = Anim.NumFrames;
+		Clip.FrameRate = Anim.Speed_Generated * Anim.NumFrames;
+	}
+
+	NumBones = Width;
+	NumRows = InNumRows;
+
+	// Mirror bones outside the texture would read past the row, they keep their own transforms
+	MirrorBones = InProfile->MirrorBones;
+	for (int32 b = 0; b < MirrorBones.Num(); b++)
+	{
+		if ((MirrorBones[b] < 0) || (MirrorBones[b] >= NumBones)) MirrorBones[b] = b;
+	}
+	MirrorAxis = InProfile->MirrorAxis;
+
+	PosX.SetNumUninitialized(NumTexels); PosY.SetNumUninitialized(NumTexels); PosZ.SetNumUninitialized(NumTexels);
+	RotX.SetNumUninitialized(NumTexels); RotY.SetNumUninitialized(NumTexels); RotZ.SetNumUninitialized(NumTexels); RotW.SetNumUninitialized(NumTexels);
+
+	for (int32 i = 0; i < NumTexels; i++)
+	{
+		const FVector3f Pos = DecodeVectorHDR(TexelFromEncodedData(PosData, i), InProfile->MaxValuePosition_Bone);
+		const FQuat4f Rot = DecodeQuat(TexelFromEncodedData(RotData, i));
+
+		PosX[i] = Pos.X; PosY[i] = Pos.Y; PosZ[i] = Pos.Z;
+		RotX[i] = Rot.X; RotY[i] = Rot.Y; RotZ[i] = Rot.Z; RotW[i] = Rot.W;
+	}
+
+	if (InProfile->Anims_Bone[0].SequenceRef)
+	{
+		if (const USkeleton* Skeleton = InProfile->Anims_Bone[0].SequenceRef->GetSkeleton())
+		{
+			// Column names, through the profile's remap table when the bones were compacted
+			const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+			const TArray <int32>& ActiveBones = InProfile->ActiveBones;
+			BoneNames.SetNum(ActiveBones.Num() ? ActiveBones.Num() : RefSkeleton.GetNum());
+			for (int32 b = 0; b < BoneNames.Num(); b++)
+			{
+				const int32 SkeletonBone = ActiveBones.Num() ? ActiveBones[b] : b;
+				BoneNames[b] = (SkeletonBone < RefSkeleton.GetNum()) ? RefSkeleton.GetBoneName(SkeletonBone) : NAME_None;
+			}
+		}
+	}
+
+	return true;
+}
+
+float FVertexAnimBoneSampler::GetClipLength(const int32 ClipIndex) const
+{
+	return (Clips.IsValidIndex(ClipIndex) && (Clips[ClipIndex].FrameRate > 0.f)) ? Clips[ClipIndex].NumFrames / Clips[ClipIndex].FrameRate : 0.f;
+}
+
+bool FVertexAnimBoneSampler::GetClip(const int32 ClipIndex, int32& OutStartRow, int32& OutNumFrames, float& OutFrameRate) const
+{
+	if (!Clips.IsValidIndex(ClipIndex)) return false;
+
+	OutStartRow = Clips[ClipIndex].StartRow;
+	OutNumFrames = Clips[ClipIndex].NumFrames;
+	OutFrameRate = Clips[ClipIndex].FrameRate;
+	return true;
+}
+
+int32 FVertexAnimBoneSampler::FindBoneIndex(const FName BoneName) const
+{
+	const int32 Index = BoneNames.IndexOfByKey(BoneName);
+	return (Index < NumBones) ? Index : INDEX_NONE;
+}
+
+void FVertexAnimBoneSampler::SampleBoneTransforms(
+	const int32 ClipIndex, const float Time, TArrayView<const int32> BoneIndices, TArrayView<FTransform> OutTransforms,
+	const bool bMirrored) const
+{
+	check(BoneIndices.Num() == OutTransforms.Num());
+
+	if (!IsValid() || !Clips.IsValidIndex(ClipIndex))
+	{
+		for (FTransform& Out : OutTransforms) Out = FTransform::Identity;
+		return;
+	}
+
+	const FClip& Clip = Clips[ClipIndex];
+	const bool bMirror = bMirrored && CanMirror();
+
+	int32 Frame0, Frame1;
+	float Alpha;
+	CalcClipFrames(Time, Clip.FrameRate, Clip.NumFrames, Frame0, Frame1, Alpha);
+
+	const int32 RowStart0 = (Clip.StartRow + Frame0) * NumBones;
+	const int32 RowStart1 = (Clip.StartRow + Frame1) * NumBones;
+
+	float PX[BoneSampleChunk], PY[BoneSampleChunk], PZ[BoneSampleChunk];
+	float QX[BoneSampleChunk], QY[BoneSampleChunk], QZ[BoneSampleChunk], QW[BoneSampleChunk];
+	float Sign[BoneSampleChunk];
+	int32 Bones[BoneSampleChunk];
+
+	for (int32 ChunkStart = 0; ChunkStart < BoneIndices.Num(); ChunkStart += BoneSampleChunk)
+	{
+		const int32 ChunkNum = FMath::Min(BoneSampleChunk, BoneIndices.Num() - ChunkStart);
+
+		// Gather, invalid bones read column 0 and are overwritten below. Mirrored, every bone reads its mirror bone.
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const int32 Bone = BoneIndices[ChunkStart + i];
+			Bones[i] = ((Bone >= 0) && (Bone < NumBones)) ? Bone : 0;
+			if (bMirror && MirrorBones.IsValidIndex(Bones[i])) Bones[i] = MirrorBones[Bones[i]];
+		}
+
+		// Positions, plain lerp
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const int32 A = RowStart0 + Bones[i];
+			const int32 B = RowStart1 + Bones[i];
+			PX[i] = PosX[A] + (PosX[B] - PosX[A]) * Alpha;
+			PY[i] = PosY[A] + (PosY[B] - PosY[A]) * Alpha;
+			PZ[i] = PosZ[A] + (PosZ[B] - PosZ[A]) * Alpha;
+		}
+
+		// Rotations, shortest path nlerp
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const int32 A = RowStart0 + Bones[i];
+			const int32 B = RowStart1 + Bones[i];
+			const float Dot = RotX[A] * RotX[B] + RotY[A] * RotY[B] + RotZ[A] * RotZ[B] + RotW[A] * RotW[B];
+			Sign[i] = Dot >= 0.f ? 1.f : -1.f;
+		}
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const int32 A = RowStart0 + Bones[i];
+			const int32 B = RowStart1 + Bones[i];
+			const float WA = 1.f - Alpha;
+			const float WB = Alpha * Sign[i];
+			QX[i] = RotX[A] * WA + RotX[B] * WB;
+			QY[i] = RotY[A] * WA + RotY[B] * WB;
+			QZ[i] = RotZ[A] * WA + RotZ[B] * WB;
+			QW[i] = RotW[A] * WA + RotW[B] * WB;
+		}
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const float InvSize = FMath::InvSqrt(FMath::Max(SMALL_NUMBER,
+				QX[i] * QX[i] + QY[i] * QY[i] + QZ[i] * QZ[i] + QW[i] * QW[i]));
+			QX[i] *= InvSize; QY[i] *= InvSize; QZ[i] *= InvSize; QW[i] *= InvSize;
+		}
+
+		// Component space = ref pose (row 0) followed by the ref to local transform of the frame.
+		// Mirrored, the bone keeps its own ref pose and only the ref to local read from its mirror bone is reflected, as the material does.
+		for (int32 i = 0; i < ChunkNum; i++)
+		{
+			const int32 Bone = BoneIndices[ChunkStart + i];
+			if ((Bone < 0) || (Bone >= NumBones))
+			{
+				OutTransforms[ChunkStart + i] = FTransform::Identity;
+				continue;
+			}
+
+			const FTransform RefPose(
+				FQuat(RotX[Bone], RotY[Bone], RotZ[Bone], RotW[Bone]),
+				FVector(PosX[Bone], PosY[Bone], PosZ[Bone]));
+			const FTransform RefToLocal(
+				FQuat(QX[i], QY[i], QZ[i], QW[i]),
+				FVector(PX[i], PY[i], PZ[i]));
+
+			OutTransforms[ChunkStart + i] = RefPose * (bMirror ? MirrorTransform(RefToLocal, MirrorAxis) : RefToLocal);
+		}
+	}
+}
@@ -0,0 +1,313 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimCollision.h"
+
+#include "Async/ParallelFor.h"
+
+#include "VertexAnimProfile.h"
+#include "VertexAnimBoneSampler.h"
+
+// Agents per ParallelFor task, every task collects its own hits so they come out in agent order
+static constexpr int32 QueryChunkSize = 1024;
+
+static const FVACollisionClip* FindCollisionClip(const UVertexAnimProfile* Profile, const bool bBoneClips, const int32 ClipIndex)
+{
+	const TArray <FVACollisionClip>& Clips = bBoneClips ? Profile->CollisionClips_Bone : Profile->CollisionClips_Vert;
+	if (!Clips.IsValidIndex(ClipIndex)) return nullptr;
+
+	const FVACollisionClip& Clip = Clips[ClipIndex];
+	const int32 NumCapsules = Profile->CollisionCapsules.Num();
+	if ((NumCapsules == 0) || (Clip.NumFrames < 1) || (Clip.Length <= 0.f)
+		|| ((Clip.FirstFrame + Clip.NumFrames) * NumCapsules * 2 > Profile->CapsuleFrames.Num())) return nullptr;
+
+	return &Clip;
+}
+
+// Capsule segments of one agent as start and start to end, SoA padded to a multiple of 4 with zero length segments
+struct FVATCapsuleBatch
+{
+	int32 NumCapsules = 0;
+	TArray <float> SX, SY, SZ;
+	TArray <float> DX, DY, DZ;
+	// Squared hit distance per capsule, query dependent
+	TArray <float> ReachSq;
+
+	void Init(const int32 InNumCapsules)
+	{
+		NumCapsules = InNumCapsules;
+		const int32 NumPadded = Align(NumCapsules, 4);
+		SX.SetNumZeroed(NumPadded); SY.SetNumZeroed(NumPadded); SZ.SetNumZeroed(NumPadded);
+		DX.SetNumZeroed(NumPadded); DY.SetNumZeroed(NumPadded); DZ.SetNumZeroed(NumPadded);
+		ReachSq.SetNumZeroed(NumPadded);
+	}
+
+	void Pose(const UVertexAnimProfile* Profile, const FVACollisionClip& Clip, const float Time)
+	{
+		int32 Frame0, Frame1;
+		float Alpha;
+		FVertexAnimBoneSampler::CalcClipFrames(Time, Clip.NumFrames / Clip.Length, Clip.NumFrames, Frame0, Frame1, Alpha);
+
+		const FVector3f* A = &Profile->CapsuleFrames[(Clip.FirstFrame + Frame0) * NumCapsules * 2];
+		const FVector3f* B = &Profile->CapsuleFrames[(Clip.FirstFrame + Frame1) * NumCapsules * 2];
+		for (int32 c = 0; c < NumCapsules; c++)
+		{
+			const FVector3f Start = FMath::Lerp(A[c * 2], B[c * 2], Alpha);
+			const FVector3f Dir = FMath::Lerp(A[c * 2 + 1], B[c * 2 + 1], Alpha) - Start;
+			SX[c] = Start.X; SY[c] = Start.Y; SZ[c] = Start.Z;
+			DX[c] = Dir.X; DY[c] = Dir.Y; DZ[c] = Dir.Z;
+		}
+	}
+};
+
+static FORCEINLINE VectorRegister4Float VectorDot3SoA(
+	const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ,
+	const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ)
+{
+	return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+}
+
+static FORCEINLINE VectorRegister4Float VectorClamp01(const VectorRegister4Float& V)
+{
+	return VectorMin(VectorMax(V, VectorZeroFloat()), VectorOneFloat());
+}
+
+// Lanes of a batch of 4 capsules starting at c0 that are real capsules
+static FORCEINLINE int32 ValidLanes(const FVATCapsuleBatch& Batch, const int32 c0)
+{
+	return (1 << FMath::Min(Batch.NumCapsules - c0, 4)) - 1;
+}
+
+// Capsule whose segment the segment P + D * s (s in [0, 1]) comes within ReachSq of at the lowest s, INDEX_NONE if none.
+// Closest points of two segments from Ericson, Real-Time Collision Detection 5.1.9, branchless over 4 capsules.
+static int32 RayCapsules(const FVATCapsuleBatch& Batch, const FVector3f& P, const FVector3f& D, float& OutS, float& OutDistSq)
+{
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float Eps = VectorSetFloat1(SMALL_NUMBER);
+	const VectorRegister4Float PX = VectorSetFloat1(P.X), PY = VectorSetFloat1(P.Y), PZ = VectorSetFloat1(P.Z);
+	const VectorRegister4Float D1X = VectorSetFloat1(D.X), D1Y = VectorSetFloat1(D.Y), D1Z = VectorSetFloat1(D.Z);
+	const VectorRegister4Float A = VectorSetFloat1(FMath::Max(D.SizeSquared(), SMALL_NUMBER));
+
+	alignas(16) float S[4];
+	alignas(16) float DistSq[4];
+
+	int32 Best = INDEX_NONE;
+	for (int32 c0 = 0; c0 < Batch.NumCapsules; c0 += 4)
+	{
+		const VectorRegister4Float D2X = VectorLoad(&Batch.DX[c0]), D2Y = VectorLoad(&Batch.DY[c0]), D2Z = VectorLoad(&Batch.DZ[c0]);
+		const VectorRegister4Float RX = VectorSubtract(PX, VectorLoad(&Batch.SX[c0]));
+		const VectorRegister4Float RY = VectorSubtract(PY, VectorLoad(&Batch.SY[c0]));
+		const VectorRegister4Float RZ = VectorSubtract(PZ, VectorLoad(&Batch.SZ[c0]));
+
+		const VectorRegister4Float E = VectorMax(VectorDot3SoA(D2X, D2Y, D2Z, D2X, D2Y, D2Z), Eps);
+		const VectorRegister4Float F = VectorDot3SoA(D2X, D2Y, D2Z, RX, RY, RZ);
+		const VectorRegister4Float C = VectorDot3SoA(D1X, D1Y, D1Z, RX, RY, RZ);
+		const VectorRegister4Float B = VectorDot3SoA(D1X, D1Y, D1Z, D2X, D2Y, D2Z);
+		const VectorRegister4Float Denom = VectorSubtract(VectorMultiply(A, E), VectorMultiply(B, B));
+
+		// Closest point of the lines on the ray, 0 for parallel segments
+		const VectorRegister4Float S0 = VectorSelect(
+			VectorCompareGT(Denom, Eps),
+			VectorClamp01(VectorDivide(VectorSubtract(VectorMultiply(B, F), VectorMultiply(C, E)), VectorMax(Denom, Eps))),
+			Zero);
+		// On the capsule segment, and back onto the ray when it had to be clamped
+		const VectorRegister4Float T = VectorDivide(VectorMultiplyAdd(B, S0, F), E);
+		const VectorRegister4Float TC = VectorClamp01(T);
+		const VectorRegister4Float S1 = VectorClamp01(VectorDivide(VectorSubtract(VectorMultiply(B, TC), C), A));
+		const VectorRegister4Float SV = VectorSelect(VectorCompareNE(T, TC), S1, S0);
+
+		// R + D1 * S - D2 * T
+		const VectorRegister4Float XX = VectorSubtract(VectorMultiplyAdd(D1X, SV, RX), VectorMultiply(D2X, TC));
+		const VectorRegister4Float XY = VectorSubtract(VectorMultiplyAdd(D1Y, SV, RY), VectorMultiply(D2Y, TC));
+		const VectorRegister4Float XZ = VectorSubtract(VectorMultiplyAdd(D1Z, SV, RZ), VectorMultiply(D2Z, TC));
+		const VectorRegister4Float Dist = VectorDot3SoA(XX, XY, XZ, XX, XY, XZ);
+
+		const int32 Mask = VectorMaskBits(VectorCompareLE(Dist, VectorLoad(&Batch.ReachSq[c0]))) & ValidLanes(Batch, c0);
+		if (!Mask) continue;
+
+		VectorStore(SV, S);
+		VectorStore(Dist, DistSq);
+		for (int32 l = 0; l < 4; l++)
+		{
+			if ((Mask & (1 << l)) && ((Best == INDEX_NONE) || (S[l] < OutS)))
+			{
+				Best = c0 + l;
+				OutS = S[l];
+				OutDistSq = DistSq[l];
+			}
+		}
+	}
+	return Best;
+}
+
+// Every capsule whose segment comes within ReachSq of P
+static void PointCapsules(const FVATCapsuleBatch& Batch, const FVector3f& P, TArray <int32, TInlineAllocator<16>>& OutCapsules)
+{
+	const VectorRegister4Float Eps = VectorSetFloat1(SMALL_NUMBER);
+	const VectorRegister4Float PX = VectorSetFloat1(P.X), PY = VectorSetFloat1(P.Y), PZ = VectorSetFloat1(P.Z);
+
+	for (int32 c0 = 0; c0 < Batch.NumCapsules; c0 += 4)
+	{
+		const VectorRegister4Float DX = VectorLoad(&Batch.DX[c0]), DY = VectorLoad(&Batch.DY[c0]), DZ = VectorLoad(&Batch.DZ[c0]);
+		const VectorRegister4Float RX = VectorSubtract(PX, VectorLoad(&Batch.SX[c0]));
+		const VectorRegister4Float RY = VectorSubtract(PY, VectorLoad(&Batch.SY[c0]));
+		const VectorRegister4Float RZ = VectorSubtract(PZ, VectorLoad(&Batch.SZ[c0]));
+
+		const VectorRegister4Float E = VectorMax(VectorDot3SoA(DX, DY, DZ, DX, DY, DZ), Eps);
+		const VectorRegister4Float T = VectorClamp01(VectorDivide(VectorDot3SoA(RX, RY, RZ, DX, DY, DZ), E));
+
+		const VectorRegister4Float XX = VectorSubtract(RX, VectorMultiply(DX, T));
+		const VectorRegister4Float XY = VectorSubtract(RY, VectorMultiply(DY, T));
+		const VectorRegister4Float XZ = VectorSubtract(RZ, VectorMultiply(DZ, T));
+		const VectorRegister4Float Dist = VectorDot3SoA(XX, XY, XZ, XX, XY, XZ);
+
+		const int32 Mask = VectorMaskBits(VectorCompareLE(Dist, VectorLoad(&Batch.ReachSq[c0]))) & ValidLanes(Batch, c0);
+		for (int32 l = 0; l < 4; l++)
+		{
+			if (Mask & (1 << l)) OutCapsules.Add(c0 + l);
+		}
+	}
+}
+
+bool FVertexAnimCollision::SampleCapsules(
+	const UVertexAnimProfile* Profile, const bool bBoneClips, const int32 ClipIndex, const float Time,
+	TArray <FVector3f>& OutStarts, TArray <FVector3f>& OutEnds)
+{
+	OutStarts.Reset();
+	OutEnds.Reset();
+
+	const FVACollisionClip* Clip = FindCollisionClip(Profile, bBoneClips, ClipIndex);
+	if (!Clip) return false;
+
+	FVATCapsuleBatch Batch;
+	Batch.Init(Profile->CollisionCapsules.Num());
+	Batch.Pose(Profile, *Clip, Time);
+
+	for (int32 c = 0; c < Batch.NumCapsules; c++)
+	{
+		const FVector3f Start(Batch.SX[c], Batch.SY[c], Batch.SZ[c]);
+		OutStarts.Add(Start);
+		OutEnds.Add(Start + FVector3f(Batch.DX[c], Batch.DY[c], Batch.DZ[c]));
+	}
+	return true;
+}
+
+void FVertexAnimCollision::RaycastAgents(
+	const UVertexAnimProfile* Profile, const bool bBoneClips,
+	TArrayView<const FTransform> AgentTransforms, TArrayView<const int32> ClipIndices, TArrayView<const float> Times,
+	const FVector& Start, const FVector& End, TArray <FVertexAnimCollisionHit>& OutHits)
+{
+	check((AgentTransforms.Num() == ClipIndices.Num()) && (AgentTransforms.Num() == Times.Num()));
+
+	const int32 NumCapsules = Profile->CollisionCapsules.Num();
+	if (!NumCapsules || FVector::PointsAreSame(Start, End)) return;
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(AgentTransforms.Num(), QueryChunkSize);
+	TArray <TArray <FVertexAnimCollisionHit>> ChunkHits;
+	ChunkHits.SetNum(NumChunks);
+
+	ParallelFor(NumChunks, [&](const int32 Chunk)
+	{
+		FVATCapsuleBatch Batch;
+		Batch.Init(NumCapsules);
+		for (int32 c = 0; c < NumCapsules; c++)
+		{
+			Batch.ReachSq[c] = FMath::Square(Profile->CollisionCapsules[c].Radius);
+		}
+
+		const int32 Last = FMath::Min((Chunk + 1) * QueryChunkSize, AgentTransforms.Num());
+		for (int32 i = Chunk * QueryChunkSize; i < Last; i++)
+		{
+			const FVACollisionClip* Clip = FindCollisionClip(Profile, bBoneClips, ClipIndices[i]);
+			if (!Clip) continue;
+
+			// Broadphase, the clip's bounds over all its frames
+			const FTransform& AgentTransform = AgentTransforms[i];
+			const FBox Bounds = FBox(FVector(Clip->BoundsMin), FVector(Clip->BoundsMax)).TransformBy(AgentTransform);
+			if (!FMath::LineBoxIntersection(Bounds, Start, End, End - Start)) continue;
+
+			const float Scale = (float)AgentTransform.GetMaximumAxisScale();
+			if (Scale <= 0.f) continue;
+
+			const FVector3f P = FVector3f(AgentTransform.InverseTransformPosition(Start));
+			const FVector3f D = FVector3f(AgentTransform.InverseTransformPosition(End)) - P;
+
+			Batch.Pose(Profile, *Clip, Times[i]);
+			float S = 0.f;
+			float DistSq = 0.f;
+			const int32 Capsule = RayCapsules(Batch, P, D, S, DistSq);
+			if (Capsule == INDEX_NONE) continue;
+
+			FVertexAnimCollisionHit& Hit = ChunkHits[Chunk].AddDefaulted_GetRef();
+			Hit.Agent = i;
+			Hit.Capsule = Capsule;
+			Hit.Distance = FMath::Max(S * D.Size() - FMath::Sqrt(FMath::Max(Batch.ReachSq[Capsule] - DistSq, 0.f)), 0.f) * Scale;
+		}
+	}, (NumChunks > 1) ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	const int32 FirstHit = OutHits.Num();
+	for (const TArray <FVertexAnimCollisionHit>& Hits : ChunkHits)
+	{
+		OutHits.Append(Hits);
+	}
+	MakeArrayView(OutHits).Slice(FirstHit, OutHits.Num() - FirstHit).Sort(
+		[](const FVertexAnimCollisionHit& A, const FVertexAnimCollisionHit& B) { return A.Distance < B.Distance; });
+}
+
+void FVertexAnimCollision::SphereOverlapAgents(
+	const UVertexAnimProfile* Profile, const bool bBoneClips,
+	TArrayView<const FTransform> AgentTransforms, TArrayView<const int32> ClipIndices, TArrayView<const float> Times,
+	const FVector& Center, const float Radius, TArray <FVertexAnimCollisionHit>& OutHits)
+{
+	check((AgentTransforms.Num() == ClipIndices.Num()) && (AgentTransforms.Num() == Times.Num()));
+
+	const int32 NumCapsules = Profile->CollisionCapsules.Num();
+	if (!NumCapsules || (Radius < 0.f)) return;
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(AgentTransforms.Num(), QueryChunkSize);
+	TArray <TArray <FVertexAnimCollisionHit>> ChunkHits;
+	ChunkHits.SetNum(NumChunks);
+
+	ParallelFor(NumChunks, [&](const int32 Chunk)
+	{
+		FVATCapsuleBatch Batch;
+		Batch.Init(NumCapsules);
+		TArray <int32, TInlineAllocator<16>> Capsules;
+
+		const int32 Last = FMath::Min((Chunk + 1) * QueryChunkSize, AgentTransforms.Num());
+		for (int32 i = Chunk * QueryChunkSize; i < Last; i++)
+		{
+			const FVACollisionClip* Clip = FindCollisionClip(Profile, bBoneClips, ClipIndices[i]);
+			if (!Clip) continue;
+
+			const FTransform& AgentTransform = AgentTransforms[i];
+			const FBox Bounds = FBox(FVector(Clip->BoundsMin), FVector(Clip->BoundsMax)).TransformBy(AgentTransform);
+			if (!FMath::SphereAABBIntersection(Center, (FVector::FReal)FMath::Square(Radius), Bounds)) continue;
+
+			const float Scale = (float)AgentTransform.GetMaximumAxisScale();
+			if (Scale <= 0.f) continue;
+
+			// Sphere radius in the agent's component space
+			const float LocalRadius = Radius / Scale;
+			for (int32 c = 0; c < NumCapsules; c++)
+			{
+				Batch.ReachSq[c] = FMath::Square(Profile->CollisionCapsules[c].Radius + LocalRadius);
+			}
+
+			Batch.Pose(Profile, *Clip, Times[i]);
+			Capsules.Reset();
+			PointCapsules(Batch, FVector3f(AgentTransform.InverseTransformPosition(Center)), Capsules);
+
+			for (const int32 Capsule : Capsules)
+			{
+				FVertexAnimCollisionHit& Hit = ChunkHits[Chunk].AddDefaulted_GetRef();
+				Hit.Agent = i;
+				Hit.Capsule = Capsule;
+			}
+		}
+	}, (NumChunks > 1) ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	for (const TArray <FVertexAnimCollisionHit>& Hits : ChunkHits)
+	{
+		OutHits.Append(Hits);
+	}
+}
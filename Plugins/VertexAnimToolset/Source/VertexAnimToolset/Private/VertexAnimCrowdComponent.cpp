@@ -0,0 +1,548 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimCrowdComponent.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+#include "VertexAnimProfile.h"
+#include "VertexAnimEvents.h"
+#include "VertexAnimCollision.h"
+
+CSV_DEFINE_CATEGORY(VATCrowd, true);
+
+UVertexAnimCrowdComponent::UVertexAnimCrowdComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+	NumCustomDataFloats = VATCrowd_NumCustomData;
+
+	UpdateTiers.Add({ 3000.f, 2 });
+	UpdateTiers.Add({ 6000.f, 4 });
+}
+
+void UVertexAnimCrowdComponent::SetProfile(UVertexAnimProfile* InProfile, const bool bInBoneClips)
+{
+	Profile = InProfile;
+	BoneClips = bInBoneClips;
+
+	if (Profile && Profile->StaticMesh && (GetStaticMesh() != Profile->StaticMesh))
+	{
+		SetStaticMesh(Profile->StaticMesh);
+	}
+
+	RefreshClips();
+
+	// Clip data of every agent changes with the profile
+	const double Now = GetNow();
+	for (int32 i = 0; i < ClipIndices.Num(); i++)
+	{
+		RebaseAgent(i, Now, CalcAnimTime(i, Now), true);
+	}
+}
+
+void UVertexAnimCrowdComponent::RefreshClips()
+{
+	Clips.Reset();
+	if (!Profile) return;
+
+	const TArray <FVASequenceData>& Anims = BoneClips ? Profile->Anims_Bone : Profile->Anims_Vert;
+	Clips.Reserve(Anims.Num());
+	for (const FVASequenceData& Anim : Anims)
+	{
+		FCrowdClip& Clip = Clips.AddDefaulted_GetRef();
+		Clip.AnimStart = Anim.AnimStart_Generated;
+		Clip.NumFrames = FMath::Max(Anim.NumFrames, 1);
+		Clip.FrameRate = Anim.Speed_Generated * Anim.NumFrames;
+		Clip.EndTime = (Clip.FrameRate > 0.f) ? (Clip.NumFrames - 1.f) / Clip.FrameRate : 0.f;
+	}
+}
+
+void UVertexAnimCrowdComponent::SyncAgents()
+{
+	const int32 NumInstances = GetInstanceCount();
+	const int32 OldNum = ClipIndices.Num();
+	if (OldNum == NumInstances) return;
+
+	ClipIndices.SetNum(NumInstances);
+	TimeBases.SetNum(NumInstances);
+	BaseAnimTimes.SetNum(NumInstances);
+	PlayRates.SetNum(NumInstances);
+	BlendWeights.SetNum(NumInstances);
+	AgentFlags.SetNum(NumInstances);
+	FadeRates.SetNum(NumInstances);
+	PrevClipIndices.SetNum(NumInstances);
+	PrevBaseAnimTimes.SetNum(NumInstances);
+	PrevPlayRates.SetNum(NumInstances);
+	AnimTimes.SetNum(NumInstances);
+	PrevAnimTimes.SetNum(NumInstances);
+	Weights.SetNum(NumInstances);
+	AgentTiers.SetNumZeroed(NumInstances);
+	DirtyFlags.SetNumZeroed(NumInstances);
+
+	const double Now = GetNow();
+	for (int32 i = OldNum; i < NumInstances; i++)
+	{
+		ClipIndices[i] = 0;
+		TimeBases[i] = Now;
+		BaseAnimTimes[i] = 0.f;
+		PlayRates[i] = 1.f;
+		BlendWeights[i] = 1.f;
+		AgentFlags[i] = AgentFlag_Loop;
+		FadeRates[i] = 0.f;
+		PrevClipIndices[i] = INDEX_NONE;
+		PrevBaseAnimTimes[i] = 0.f;
+		PrevPlayRates[i] = 0.f;
+		AnimTimes[i] = 0.f;
+		PrevAnimTimes[i] = 0.f;
+		Weights[i] = 1.f;
+		MarkAgentDirty(i);
+	}
+}
+
+void UVertexAnimCrowdComponent::RemoveAgentState(const int32 Agent)
+{
+	if (!ClipIndices.IsValidIndex(Agent)) return;
+
+	// Same order as the instances, which are removed with RemoveAt
+	ClipIndices.RemoveAt(Agent, 1, false);
+	TimeBases.RemoveAt(Agent, 1, false);
+	BaseAnimTimes.RemoveAt(Agent, 1, false);
+	PlayRates.RemoveAt(Agent, 1, false);
+	BlendWeights.RemoveAt(Agent, 1, false);
+	AgentFlags.RemoveAt(Agent, 1, false);
+	FadeRates.RemoveAt(Agent, 1, false);
+	PrevClipIndices.RemoveAt(Agent, 1, false);
+	PrevBaseAnimTimes.RemoveAt(Agent, 1, false);
+	PrevPlayRates.RemoveAt(Agent, 1, false);
+	AnimTimes.RemoveAt(Agent, 1, false);
+	PrevAnimTimes.RemoveAt(Agent, 1, false);
+	Weights.RemoveAt(Agent, 1, false);
+	AgentTiers.RemoveAt(Agent, 1, false);
+	DirtyFlags.RemoveAt(Agent, 1, false);
+}
+
+double UVertexAnimCrowdComponent::GetNow() const
+{
+	// Matches the material's Time node
+	const UWorld* World = GetWorld();
+	return World ? World->GetTimeSeconds() : 0.0;
+}
+
+float UVertexAnimCrowdComponent::CalcAnimTime(const int32 Agent, const double Now) const
+{
+	if (AgentFlags[Agent] & AgentFlag_Finished) return BaseAnimTimes[Agent];
+	return BaseAnimTimes[Agent] + (float)(Now - TimeBases[Agent]) * PlayRates[Agent];
+}
+
+float UVertexAnimCrowdComponent::CalcPrevAnimTime(const int32 Agent, const double Now) const
+{
+	return PrevBaseAnimTimes[Agent] + (float)(Now - TimeBases[Agent]) * PrevPlayRates[Agent];
+}
+
+float UVertexAnimCrowdComponent::CalcWeight(const int32 Agent, const double Now) const
+{
+	return FMath::Clamp(BlendWeights[Agent] + (float)(Now - TimeBases[Agent]) * FadeRates[Agent], 0.f, 1.f);
+}
+
+void UVertexAnimCrowdComponent::RebaseAgent(const int32 Agent, const double Now, const float AnimTime, const bool bClipChanged)
+{
+	// The previous clip and the fade share the time base
+	if (PrevClipIndices[Agent] != INDEX_NONE)
+	{
+		PrevBaseAnimTimes[Agent] = CalcPrevAnimTime(Agent, Now);
+		BlendWeights[Agent] = CalcWeight(Agent, Now);
+	}
+
+	TimeBases[Agent] = Now;
+	BaseAnimTimes[Agent] = AnimTime;
+	AnimTimes[Agent] = AnimTime;
+	// The anim time before belongs to another clip, no events were crossed in this one yet
+	if (bClipChanged)
+	{
+		PrevAnimTimes[Agent] = AnimTime;
+	}
+	MarkAgentDirty(Agent);
+}
+
+int32 UVertexAnimCrowdComponent::AddAgent(const FTransform& Transform, const int32 Clip, const float PlayRate, const bool bLoop, const float StartAnimTime)
+{
+	SyncAgents();
+	const int32 Agent = AddInstance(Transform);
+	SyncAgents();
+	SetAgentClip(Agent, Clip, PlayRate, bLoop, StartAnimTime);
+	return Agent;
+}
+
+void UVertexAnimCrowdComponent::SetAgentClip(const int32 Agent, const int32 Clip, const float PlayRate, const bool bLoop, const float StartAnimTime)
+{
+	SetAgentsClip(MakeArrayView(&Agent, 1), Clip, PlayRate, bLoop, StartAnimTime);
+}
+
+void UVertexAnimCrowdComponent::CrossFadeAgent(const int32 Agent, const int32 Clip, const float FadeDuration, const float PlayRate, const bool bLoop, const float StartAnimTime)
+{
+	SetAgentsClip(MakeArrayView(&Agent, 1), Clip, PlayRate, bLoop, StartAnimTime, FadeDuration);
+}
+
+void UVertexAnimCrowdComponent::SetAgentsClip(
+	TArrayView<const int32> Agents, const int32 Clip, const float PlayRate, const bool bLoop, const float StartAnimTime,
+	const float FadeDuration)
+{
+	SyncAgents();
+	if (!Clips.IsValidIndex(Clip))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: clip %d out of range of %s"), *GetName(), Clip, Profile ? *Profile->GetName() : TEXT("no profile"));
+	}
+
+	const double Now = GetNow();
+	for (const int32 Agent : Agents)
+	{
+		if (!ClipIndices.IsValidIndex(Agent)) continue;
+
+		if (FadeDuration > 0.f)
+		{
+			// The current clip becomes the one fading out, at its anim time now
+			PrevBaseAnimTimes[Agent] = CalcAnimTime(Agent, Now);
+			PrevPlayRates[Agent] = (AgentFlags[Agent] & AgentFlag_Finished) ? 0.f : PlayRates[Agent];
+			PrevClipIndices[Agent] = ClipIndices[Agent];
+			BlendWeights[Agent] = 0.f;
+			FadeRates[Agent] = 1.f / FadeDuration;
+		}
+		else
+		{
+			PrevClipIndices[Agent] = INDEX_NONE;
+			BlendWeights[Agent] = 1.f;
+			FadeRates[Agent] = 0.f;
+		}
+		Weights[Agent] = BlendWeights[Agent];
+		TimeBases[Agent] = Now;
+
+		ClipIndices[Agent] = Clip;
+		PlayRates[Agent] = PlayRate;
+		AgentFlags[Agent] = bLoop ? AgentFlag_Loop : 0;
+		RebaseAgent(Agent, Now, StartAnimTime, true);
+	}
+}
+
+void UVertexAnimCrowdComponent::SetAgentPlayRate(const int32 Agent, const float PlayRate)
+{
+	SyncAgents();
+	if (!ClipIndices.IsValidIndex(Agent)) return;
+
+	const double Now = GetNow();
+	const float AnimTime = CalcAnimTime(Agent, Now);
+	PlayRates[Agent] = PlayRate;
+	AgentFlags[Agent] &= ~AgentFlag_Finished;
+	RebaseAgent(Agent, Now, AnimTime);
+}
+
+void UVertexAnimCrowdComponent::SetAgentBlendWeight(const int32 Agent, const float BlendWeight)
+{
+	SyncAgents();
+	if (!ClipIndices.IsValidIndex(Agent)) return;
+
+	const double Now = GetNow();
+	RebaseAgent(Agent, Now, CalcAnimTime(Agent, Now));
+	BlendWeights[Agent] = BlendWeight;
+	FadeRates[Agent] = 0.f;
+	Weights[Agent] = BlendWeight;
+}
+
+void UVertexAnimCrowdComponent::UpdateAgents(const double Now)
+{
+	CSV_SCOPED_TIMING_STAT(VATCrowd, UpdateAgents);
+
+	SyncAgents();
+	UpdateFrame++;
+	LastDirtyAgents = 0;
+	LastUploadBytes = 0;
+
+	const int32 NumAgents = ClipIndices.Num();
+	if (!NumAgents) return;
+
+	// Views of the last rendered frame, none under -nullrhi or on servers, where every agent updates every frame
+	const UWorld* World = GetWorld();
+	const TArray <FVector> ViewLocations = (UpdateTiers.Num() && World) ? World->ViewLocationsRenderedLastFrame : TArray <FVector>();
+	const FTransform ComponentTransform = GetComponentTransform();
+
+	const int32 ChunkSize = FMath::Max(UpdateChunkSize, 64);
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumAgents, ChunkSize);
+	// First and one past the last dirty agent of every chunk
+	TArray <FIntPoint> DirtyRanges;
+	DirtyRanges.Init(FIntPoint(INDEX_NONE, INDEX_NONE), NumChunks);
+
+	ParallelFor(NumChunks, [&](const int32 Chunk)
+	{
+		const int32 First = Chunk * ChunkSize;
+		const int32 Last = FMath::Min(First + ChunkSize, NumAgents);
+		FIntPoint& Range = DirtyRanges[Chunk];
+		for (int32 i = First; i < Last; i++)
+		{
+			if (UpdateAgent(i, Now, ViewLocations, ComponentTransform))
+			{
+				if (Range.X == INDEX_NONE) Range.X = i;
+				Range.Y = i + 1;
+			}
+		}
+	}, (NumChunks > 1) ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	FlushCustomData(DirtyRanges);
+}
+
+int32 UVertexAnimCrowdComponent::CalcUpdateTier(const FVector& Location, TArrayView<const FVector> ViewLocations) const
+{
+	double DistSq = TNumericLimits<double>::Max();
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		DistSq = FMath::Min(DistSq, FVector::DistSquared(Location, ViewLocation));
+	}
+
+	int32 Tier = 0;
+	for (int32 t = 0; t < UpdateTiers.Num(); t++)
+	{
+		if (DistSq < FMath::Square((double)UpdateTiers[t].MinDistance)) break;
+		Tier = t + 1;
+	}
+	return FMath::Min(Tier, 255);
+}
+
+bool UVertexAnimCrowdComponent::UpdateAgent(const int32 i, const double Now, TArrayView<const FVector> ViewLocations, const FTransform& ComponentTransform)
+{
+	PrevAnimTimes[i] = AnimTimes[i];
+
+	// Far agents skip the frames between their updates, the material keeps playing them from the custom data
+	const bool bPendingEvent = (PrevClipIndices[i] != INDEX_NONE) || !(AgentFlags[i] & (AgentFlag_Loop | AgentFlag_Finished));
+	if (!bPendingEvent && UpdateTiers.IsValidIndex(AgentTiers[i] - 1))
+	{
+		const uint32 Interval = FMath::Max(UpdateTiers[AgentTiers[i] - 1].FrameInterval, 1);
+		// Staggered, every frame updates about the same share of the tier
+		if ((UpdateFrame + (uint32)i) % Interval)
+		{
+			return DirtyFlags[i] != 0;
+		}
+	}
+
+	AgentTiers[i] = ViewLocations.Num()
+		? CalcUpdateTier(ComponentTransform.TransformPosition(FVector(PerInstanceSMData[i].Transform.GetOrigin())), ViewLocations)
+		: 0;
+
+	float AnimTime = CalcAnimTime(i, Now);
+
+	if (!(AgentFlags[i] & (AgentFlag_Loop | AgentFlag_Finished)) && Clips.IsValidIndex(ClipIndices[i]))
+	{
+		// Hold the first / last frame once a non looping clip is played through, the material stops with a 0 play rate
+		const float EndTime = Clips[ClipIndices[i]].EndTime;
+		if ((AnimTime >= EndTime) || (AnimTime <= 0.f && PlayRates[i] < 0.f))
+		{
+			AnimTime = FMath::Clamp(AnimTime, 0.f, EndTime);
+			AgentFlags[i] |= AgentFlag_Finished;
+			RebaseAgent(i, Now, AnimTime);
+		}
+	}
+
+	AnimTimes[i] = AnimTime;
+
+	if (PrevClipIndices[i] != INDEX_NONE)
+	{
+		// Fade timers, the material fades on its own, the fade only needs ending once done
+		Weights[i] = CalcWeight(i, Now);
+		if ((Weights[i] >= 1.f) && (FadeRates[i] > 0.f))
+		{
+			PrevClipIndices[i] = INDEX_NONE;
+			BlendWeights[i] = 1.f;
+			FadeRates[i] = 0.f;
+			MarkAgentDirty(i);
+		}
+	}
+
+	return DirtyFlags[i] != 0;
+}
+
+void UVertexAnimCrowdComponent::FlushCustomData(TArrayView<const FIntPoint> DirtyRanges)
+{
+	if (NumCustomDataFloats != VATCrowd_NumCustomData)
+	{
+		SetNumCustomDataFloats(VATCrowd_NumCustomData);
+	}
+
+	int32 NumDirty = 0;
+	float Data[VATCrowd_NumCustomData];
+	for (const FIntPoint& Range : DirtyRanges)
+	{
+		for (int32 i = Range.X; i < Range.Y; i++)
+		{
+			if (!DirtyFlags[i]) continue;
+			DirtyFlags[i] = 0;
+			NumDirty++;
+
+			const FCrowdClip Clip = Clips.IsValidIndex(ClipIndices[i]) ? Clips[ClipIndices[i]] : FCrowdClip();
+			const bool bFading = PrevClipIndices[i] != INDEX_NONE;
+			const FCrowdClip PrevClip = Clips.IsValidIndex(PrevClipIndices[i]) ? Clips[PrevClipIndices[i]] : Clip;
+			const bool bFinished = (AgentFlags[i] & AgentFlag_Finished) != 0;
+
+			Data[VATCrowd_AnimStart] = Clip.AnimStart;
+			Data[VATCrowd_NumFrames] = Clip.NumFrames;
+			Data[VATCrowd_FrameRate] = Clip.FrameRate;
+			Data[VATCrowd_TimeBase] = (float)TimeBases[i];
+			Data[VATCrowd_BaseAnimTime] = BaseAnimTimes[i];
+			Data[VATCrowd_PlayRate] = bFinished ? 0.f : PlayRates[i];
+			Data[VATCrowd_BlendWeight] = BlendWeights[i];
+			Data[VATCrowd_FadeRate] = FadeRates[i];
+			Data[VATCrowd_PrevAnimStart] = PrevClip.AnimStart;
+			Data[VATCrowd_PrevNumFrames] = PrevClip.NumFrames;
+			Data[VATCrowd_PrevFrameRate] = PrevClip.FrameRate;
+			// Without a fade the previous clip mirrors the current one, so a held BlendWeight below 1 changes nothing
+			Data[VATCrowd_PrevBaseAnimTime] = bFading ? PrevBaseAnimTimes[i] : Data[VATCrowd_BaseAnimTime];
+			Data[VATCrowd_PrevPlayRate] = bFading ? PrevPlayRates[i] : Data[VATCrowd_PlayRate];
+
+			SetCustomData(i, MakeArrayView(Data, VATCrowd_NumCustomData), false);
+		}
+	}
+
+	// Rebuilds the whole per instance buffer of the proxy, transforms included, once any agent changed
+	if (NumDirty)
+	{
+		MarkRenderInstancesDirty();
+		LastUploadBytes = (SIZE_T)PerInstanceSMData.Num() * (sizeof(FInstancedStaticMeshInstanceData) + NumCustomDataFloats * sizeof(float));
+	}
+
+	LastDirtyAgents = NumDirty;
+	CSV_CUSTOM_STAT(VATCrowd, Agents, ClipIndices.Num(), ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(VATCrowd, DirtyAgents, NumDirty, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(VATCrowd, UploadBytes, (int32)GetLastUploadBytes(), ECsvCustomStatOp::Accumulate);
+}
+
+void UVertexAnimCrowdComponent::QueryAgentEvents(TArray <FVertexAnimEventHit>& OutHits) const
+{
+	if (!Profile) return;
+
+	FVertexAnimEvents::QueryEvents(Profile, BoneClips, ClipIndices, PrevAnimTimes, AnimTimes, OutHits);
+}
+
+void UVertexAnimCrowdComponent::GetAgentWorldTransforms(TArray <FTransform>& OutTransforms) const
+{
+	const FTransform ComponentTransform = GetComponentTransform();
+	const int32 NumAgents = FMath::Min(ClipIndices.Num(), PerInstanceSMData.Num());
+
+	OutTransforms.SetNumUninitialized(NumAgents);
+	for (int32 i = 0; i < NumAgents; i++)
+	{
+		OutTransforms[i] = FTransform(PerInstanceSMData[i].Transform) * ComponentTransform;
+	}
+}
+
+void UVertexAnimCrowdComponent::RaycastAgents(const FVector& Start, const FVector& End, TArray <FVertexAnimCollisionHit>& OutHits) const
+{
+	if (!Profile) return;
+
+	TArray <FTransform> Transforms;
+	GetAgentWorldTransforms(Transforms);
+	FVertexAnimCollision::RaycastAgents(
+		Profile, BoneClips, Transforms, MakeArrayView(ClipIndices.GetData(), Transforms.Num()), MakeArrayView(AnimTimes.GetData(), Transforms.Num()),
+		Start, End, OutHits);
+}
+
+void UVertexAnimCrowdComponent::SphereOverlapAgents(const FVector& Center, const float Radius, TArray <FVertexAnimCollisionHit>& OutHits) const
+{
+	if (!Profile) return;
+
+	TArray <FTransform> Transforms;
+	GetAgentWorldTransforms(Transforms);
+	FVertexAnimCollision::SphereOverlapAgents(
+		Profile, BoneClips, Transforms, MakeArrayView(ClipIndices.GetData(), Transforms.Num()), MakeArrayView(AnimTimes.GetData(), Transforms.Num()),
+		Center, Radius, OutHits);
+}
+
+void UVertexAnimCrowdComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (Profile && Profile->StaticMesh && !GetStaticMesh())
+	{
+		SetStaticMesh(Profile->StaticMesh);
+	}
+	RefreshClips();
+	SyncAgents();
+}
+
+void UVertexAnimCrowdComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	UpdateAgents(GetNow());
+}
+
+bool UVertexAnimCrowdComponent::RemoveInstance(int32 InstanceIndex)
+{
+	SyncAgents();
+	if (!Super::RemoveInstance(InstanceIndex)) return false;
+
+	RemoveAgentState(InstanceIndex);
+	return true;
+}
+
+bool UVertexAnimCrowdComponent::RemoveInstances(const TArray<int32>& InstancesToRemove)
+{
+	SyncAgents();
+	if (!Super::RemoveInstances(InstancesToRemove)) return false;
+
+	// Highest first so the indices left to remove stay valid
+	TArray <int32> Sorted = InstancesToRemove;
+	Sorted.Sort(TGreater<int32>());
+	for (const int32 Agent : Sorted)
+	{
+		RemoveAgentState(Agent);
+	}
+	return true;
+}
+
+void UVertexAnimCrowdComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(
+		Clips.GetAllocatedSize() +
+		ClipIndices.GetAllocatedSize() + TimeBases.GetAllocatedSize() + BaseAnimTimes.GetAllocatedSize() +
+		PlayRates.GetAllocatedSize() + BlendWeights.GetAllocatedSize() + AgentFlags.GetAllocatedSize() +
+		FadeRates.GetAllocatedSize() + PrevClipIndices.GetAllocatedSize() + PrevBaseAnimTimes.GetAllocatedSize() +
+		PrevPlayRates.GetAllocatedSize() + AnimTimes.GetAllocatedSize() + PrevAnimTimes.GetAllocatedSize() +
+		Weights.GetAllocatedSize() + AgentTiers.GetAllocatedSize() + DirtyFlags.GetAllocatedSize());
+}
+
+void UVertexAnimCrowdComponent::ClearInstances()
+{
+	Super::ClearInstances();
+
+	ClipIndices.Empty();
+	TimeBases.Empty();
+	BaseAnimTimes.Empty();
+	PlayRates.Empty();
+	BlendWeights.Empty();
+	AgentFlags.Empty();
+	FadeRates.Empty();
+	PrevClipIndices.Empty();
+	PrevBaseAnimTimes.Empty();
+	PrevPlayRates.Empty();
+	AnimTimes.Empty();
+	PrevAnimTimes.Empty();
+	Weights.Empty();
+	AgentTiers.Empty();
+	DirtyFlags.Empty();
+}
+
+#if WITH_EDITOR
+void UVertexAnimCrowdComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	const FName PropertyName = PropertyChangedEvent.GetPropertyName();
+	if ((PropertyName == GET_MEMBER_NAME_CHECKED(UVertexAnimCrowdComponent, Profile))
+		|| (PropertyName == GET_MEMBER_NAME_CHECKED(UVertexAnimCrowdComponent, BoneClips)))
+	{
+		SetProfile(Profile, BoneClips);
+	}
+
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif
@@ -0,0 +1,105 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimEvents.h"
+
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+
+#include "VertexAnimProfile.h"
+
+// Agents per ParallelFor task, every task collects its own hits so they come out in agent order
+static constexpr int32 QueryChunkSize = 4096;
+
+static void AddHits(const int32 Agent, const int32 FirstEvent, const int32 Begin, const int32 End, const bool bReverse, TArray <FVertexAnimEventHit>& OutHits)
+{
+	for (int32 j = 0; j < End - Begin; j++)
+	{
+		FVertexAnimEventHit& Hit = OutHits.AddDefaulted_GetRef();
+		Hit.Agent = Agent;
+		Hit.Event = FirstEvent + (bReverse ? (End - 1 - j) : (Begin + j));
+	}
+}
+
+// Events in (Start, End], Start < End within [0, Length]
+static void AddForward(const int32 Agent, const int32 FirstEvent, TArrayView<const FVAAnimEvent> Events, const float Start, const float End, TArray <FVertexAnimEventHit>& OutHits)
+{
+	const int32 Begin = (Start < 0.f) ? 0 : Algo::UpperBoundBy(Events, Start, &FVAAnimEvent::Time);
+	AddHits(Agent, FirstEvent, Begin, Algo::UpperBoundBy(Events, End, &FVAAnimEvent::Time), false, OutHits);
+}
+
+// Events in [Start, End), Start < End within [0, Length], last first
+static void AddReverse(const int32 Agent, const int32 FirstEvent, TArrayView<const FVAAnimEvent> Events, const float Start, const float End, TArray <FVertexAnimEventHit>& OutHits)
+{
+	AddHits(Agent, FirstEvent, Algo::LowerBoundBy(Events, Start, &FVAAnimEvent::Time), Algo::LowerBoundBy(Events, End, &FVAAnimEvent::Time), true, OutHits);
+}
+
+TArrayView<const FVAAnimEvent> FVertexAnimEvents::GetClipEvents(const UVertexAnimProfile* Profile, const bool bBoneClips, const int32 ClipIndex)
+{
+	const TArray <FVAEventClip>& Clips = bBoneClips ? Profile->EventClips_Bone : Profile->EventClips_Vert;
+	if (!Clips.IsValidIndex(ClipIndex)) return TArrayView<const FVAAnimEvent>();
+
+	const FVAEventClip& Clip = Clips[ClipIndex];
+	if ((Clip.NumEvents <= 0) || (Clip.FirstEvent + Clip.NumEvents > Profile->AnimEvents.Num())) return TArrayView<const FVAAnimEvent>();
+
+	return MakeArrayView(Profile->AnimEvents).Slice(Clip.FirstEvent, Clip.NumEvents);
+}
+
+void FVertexAnimEvents::QueryEvents(
+	const UVertexAnimProfile* Profile, const bool bBoneClips,
+	TArrayView<const int32> ClipIndices, TArrayView<const float> PrevTimes, TArrayView<const float> Times,
+	TArray <FVertexAnimEventHit>& OutHits)
+{
+	check((ClipIndices.Num() == PrevTimes.Num()) && (ClipIndices.Num() == Times.Num()));
+
+	const TArray <FVAEventClip>& Clips = bBoneClips ? Profile->EventClips_Bone : Profile->EventClips_Vert;
+	if (!Profile->AnimEvents.Num() || !Clips.Num()) return;
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(ClipIndices.Num(), QueryChunkSize);
+	TArray <TArray <FVertexAnimEventHit>> ChunkHits;
+	ChunkHits.SetNum(NumChunks);
+
+	ParallelFor(NumChunks, [&](const int32 Chunk)
+	{
+		TArray <FVertexAnimEventHit>& Hits = ChunkHits[Chunk];
+		const int32 Last = FMath::Min((Chunk + 1) * QueryChunkSize, ClipIndices.Num());
+
+		for (int32 i = Chunk * QueryChunkSize; i < Last; i++)
+		{
+			const float Delta = Times[i] - PrevTimes[i];
+			if (Delta == 0.f) continue;
+
+			const TArrayView<const FVAAnimEvent> Events = GetClipEvents(Profile, bBoneClips, ClipIndices[i]);
+			const float Length = Clips.IsValidIndex(ClipIndices[i]) ? Clips[ClipIndices[i]].Length : 0.f;
+			if (!Events.Num() || (Length <= 0.f)) continue;
+
+			const int32 FirstEvent = Clips[ClipIndices[i]].FirstEvent;
+
+			if (FMath::Abs(Delta) >= Length)
+			{
+				AddHits(i, FirstEvent, 0, Events.Num(), Delta < 0.f, Hits);
+				continue;
+			}
+
+			// Window in clip time, wrapping at most once
+			const float Start = PrevTimes[i] - FMath::FloorToFloat(PrevTimes[i] / Length) * Length;
+			const float End = Start + Delta;
+
+			if (Delta > 0.f)
+			{
+				AddForward(i, FirstEvent, Events, Start, FMath::Min(End, Length), Hits);
+				// Past the loop point events at 0 count too
+				if (End > Length) AddForward(i, FirstEvent, Events, -1.f, End - Length, Hits);
+			}
+			else
+			{
+				AddReverse(i, FirstEvent, Events, FMath::Max(End, 0.f), Start, Hits);
+				if (End < 0.f) AddReverse(i, FirstEvent, Events, End + Length, Length, Hits);
+			}
+		}
+	}, (NumChunks > 1) ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	for (const TArray <FVertexAnimEventHit>& Hits : ChunkHits)
+	{
+		OutHits.Append(Hits);
+	}
+}
@@ -67,3 +67,11 @@ int32 UVertexAnimProfile::CalcStartHeightOfAnim_Bone(const int32 AnimIndex) cons
 
 	return Out + 1;
 }
+
+FIntPoint UVertexAnimProfile::CalcVertTexel(
+	const EVATVertLayout Layout, const int32 Width, const int32 RowsPerFrame, const int32 NumFrames, const int32 TexelInFrame, const int32 Frame)
+{
+	const int32 RowInFrame = TexelInFrame / Width;
+	const int32 Row = (Layout == EVATVertLayout::FrameInterleaved) ? (RowInFrame * NumFrames + Frame) : (Frame * RowsPerFrame + RowInFrame);
+	return FIntPoint(TexelInFrame % Width, Row);
+}
@@ -0,0 +1,105 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimRootMotion.h"
+
+#include "VertexAnimProfile.h"
+
+// Agents wrapping more loops than this in one update (hitches, huge play rates) only get this many loops of motion
+static constexpr int32 MaxLoopsPerDelta = 16;
+
+FVector4f FVertexAnimRootMotion::Compose(const FVector4f& A, const FVector4f& B)
+{
+	float S, C;
+	FMath::SinCos(&S, &C, A.W);
+	return FVector4f(
+		A.X + (C * B.X) - (S * B.Y),
+		A.Y + (S * B.X) + (C * B.Y),
+		A.Z + B.Z,
+		A.W + B.W);
+}
+
+FVector4f FVertexAnimRootMotion::Inverse(const FVector4f& A)
+{
+	float S, C;
+	FMath::SinCos(&S, &C, -A.W);
+	return FVector4f(
+		-((C * A.X) - (S * A.Y)),
+		-((S * A.X) + (C * A.Y)),
+		-A.Z,
+		-A.W);
+}
+
+FVector4f FVertexAnimRootMotion::Mirror(const FVector4f& A, const EAxis::Type Axis)
+{
+	FVector4f Out = A;
+	Out[FMath::Clamp((int32)Axis - (int32)EAxis::X, 0, 2)] *= -1.f;
+	if (Axis != EAxis::Z) Out.W *= -1.f;
+	return Out;
+}
+
+FVector4f FVertexAnimRootMotion::SampleClip(const UVertexAnimProfile* Profile, const FVARootMotionClip& Clip, const float Time)
+{
+	if ((Clip.NumFrames < 1) || (Clip.Length <= 0.f)) return FVector4f(0.f, 0.f, 0.f, 0.f);
+
+	const float Frame = FMath::Clamp(Time / Clip.Length, 0.f, 1.f) * Clip.NumFrames;
+	const int32 Frame0 = FMath::Min(FMath::FloorToInt(Frame), Clip.NumFrames - 1);
+	const float Alpha = Frame - Frame0;
+
+	const FVector4f& A = Profile->RootMotionFrames[Clip.FirstFrame + Frame0];
+	const FVector4f& B = Profile->RootMotionFrames[Clip.FirstFrame + Frame0 + 1];
+	return A + (B - A) * Alpha;
+}
+
+void FVertexAnimRootMotion::EvaluateDeltas(
+	const UVertexAnimProfile* Profile, const bool bBoneClips,
+	TArrayView<const int32> ClipIndices, TArrayView<const float> PrevTimes, TArrayView<const float> Times,
+	TArrayView<FVector4f> OutDeltas)
+{
+	check((ClipIndices.Num() == PrevTimes.Num()) && (ClipIndices.Num() == Times.Num()) && (ClipIndices.Num() == OutDeltas.Num()));
+
+	const TArray <FVARootMotionClip>& Clips = bBoneClips ? Profile->RootMotionClips_Bone : Profile->RootMotionClips_Vert;
+
+	for (int32 i = 0; i < ClipIndices.Num(); i++)
+	{
+		if (!Clips.IsValidIndex(ClipIndices[i]) || (Clips[ClipIndices[i]].Length <= 0.f))
+		{
+			OutDeltas[i] = FVector4f(0.f, 0.f, 0.f, 0.f);
+			continue;
+		}
+
+		const FVARootMotionClip& Clip = Clips[ClipIndices[i]];
+
+		const float LoopsA = FMath::FloorToFloat(PrevTimes[i] / Clip.Length);
+		const float LoopsB = FMath::FloorToFloat(Times[i] / Clip.Length);
+		const FVector4f RootA = SampleClip(Profile, Clip, PrevTimes[i] - LoopsA * Clip.Length);
+		const FVector4f RootB = SampleClip(Profile, Clip, Times[i] - LoopsB * Clip.Length);
+
+		// Back to the start of A's loop, through the loops in between, then on to B
+		FVector4f Delta = Inverse(RootA);
+
+		const int32 Loops = FMath::Clamp((int32)(LoopsB - LoopsA), -MaxLoopsPerDelta, MaxLoopsPerDelta);
+		if (Loops)
+		{
+			const FVector4f LoopMotion = Profile->RootMotionFrames[Clip.FirstFrame + Clip.NumFrames];
+			const FVector4f Step = (Loops > 0) ? LoopMotion : Inverse(LoopMotion);
+			for (int32 l = 0; l < FMath::Abs(Loops); l++)
+			{
+				Delta = Compose(Delta, Step);
+			}
+		}
+
+		OutDeltas[i] = Compose(Delta, RootB);
+	}
+}
+
+void FVertexAnimRootMotion::ApplyDeltas(TArrayView<const FVector4f> Deltas, TArrayView<FVector3f> InOutPositions, TArrayView<float> InOutYaws)
+{
+	check((Deltas.Num() == InOutPositions.Num()) && (Deltas.Num() == InOutYaws.Num()));
+
+	for (int32 i = 0; i < Deltas.Num(); i++)
+	{
+		const FVector4f Moved = Compose(FVector4f(InOutPositions[i], InOutYaws[i]), Deltas[i]);
+		InOutPositions[i] = FVector3f(Moved.X, Moved.Y, Moved.Z);
+		InOutYaws[i] = FMath::UnwindRadians(Moved.W);
+	}
+}
@@ -12,6 +12,8 @@
 void FVertexAnimToolsetModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("VertexAnimToolset"))->GetBaseDir(), TEXT("Shaders"));
+	AddShaderSourceDirectoryMapping(TEXT("/Plugin/VertexAnimToolset"), PluginShaderDir);
 }
 
 void FVertexAnimToolsetModule::ShutdownModule()
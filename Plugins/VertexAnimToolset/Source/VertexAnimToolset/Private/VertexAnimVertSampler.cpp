@@ -0,0 +1,173 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VertexAnimVertSampler.h"
+
+#include "VertexAnimProfile.h"
+#include "VertexAnimBoneSampler.h"
+
+static FFloat16Color TexelFromEncodedData(const TArray <uint16>& Data, const int32 TexelIndex)
+{
+	FFloat16Color Texel;
+	Texel.R.Encoded = Data[TexelIndex * 4 + 0];
+	Texel.G.Encoded = Data[TexelIndex * 4 + 1];
+	Texel.B.Encoded = Data[TexelIndex * 4 + 2];
+	Texel.A.Encoded = Data[TexelIndex * 4 + 3];
+	return Texel;
+}
+
+FVector3f FVertexAnimVertSampler::DecodeVectorLDR(const FFloat16Color& Texel, const float MaxValue)
+{
+	const float Mag = Texel.A.GetFloat() * MaxValue;
+	return FVector3f(
+		(Texel.R.GetFloat() * 2.f) - 1.f,
+		(Texel.G.GetFloat() * 2.f) - 1.f,
+		(Texel.B.GetFloat() * 2.f) - 1.f) * Mag;
+}
+
+void FVertexAnimVertSampler::Reset()
+{
+	NumVerts = 0;
+	NumFrames = 0;
+	Clips.Empty();
+	RestPosX.Empty(); RestPosY.Empty(); RestPosZ.Empty();
+	RestNormalX.Empty(); RestNormalY.Empty(); RestNormalZ.Empty();
+	OffsetX.Empty(); OffsetY.Empty(); OffsetZ.Empty();
+	NormalX.Empty(); NormalY.Empty(); NormalZ.Empty();
+}
+
+bool FVertexAnimVertSampler::Initialize(const UVertexAnimProfile* InProfile)
+{
+	Reset();
+
+	if (!InProfile || !InProfile->Anims_Vert.Num()) return false;
+
+	const TArray <uint16>& OffsetData = InProfile->OffsetsTextureData;
+	const TArray <uint16>& NormalData = InProfile->NormalsTextureData;
+	const int32 FrameSize = InProfile->OverrideSize_Vert.X * InProfile->RowsPerFrame_Vert;
+	const int32 NumTexels = OffsetData.Num() / 4;
+	const int32 InNumVerts = InProfile->RestPositions_Vert.Num();
+
+	if ((FrameSize <= 0) || (NumTexels == 0) || (OffsetData.Num() != NormalData.Num()) || (NumTexels % FrameSize)
+		|| (InNumVerts == 0) || (InNumVerts > FrameSize) || (InProfile->RestNormals_Vert.Num() != InNumVerts))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no CPU vert data, bake it with CPUVertSampling on"), *InProfile->GetName());
+		return false;
+	}
+
+	const int32 InNumFrames = NumTexels / FrameSize;
+
+	for (int32 i = 0; i < InProfile->Anims_Vert.Num(); i++)
+	{
+		const FVASequenceData& Anim = InProfile->Anims_Vert[i];
+		const int32 StartFrame = Anim.AnimStart_Generated / InProfile->RowsPerFrame_Vert;
+		if ((Anim.NumFrames < 1) || (StartFrame + Anim.NumFrames > InNumFrames))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s CPU vert data does not match Anims_Vert, rebake the profile"), *InProfile->GetName());
+			Clips.Empty();
+			return false;
+		}
+
+		FClip& Clip = Clips.AddDefaulted_GetRef();
+		Clip.StartFrame = StartFrame;
+		Clip.NumFrames = Anim.NumFrames;
+		Clip.FrameRate = Anim.Speed_Generated * Anim.NumFrames;
+	}
+
+	NumVerts = InNumVerts;
+	NumFrames = InNumFrames;
+
+	RestPosX.SetNumUninitialized(NumVerts); RestPosY.SetNumUninitialized(NumVerts); RestPosZ.SetNumUninitialized(NumVerts);
+	RestNormalX.SetNumUninitialized(NumVerts); RestNormalY.SetNumUninitialized(NumVerts); RestNormalZ.SetNumUninitialized(NumVerts);
+	for (int32 v = 0; v < NumVerts; v++)
+	{
+		const FVector3f& Pos = InProfile->RestPositions_Vert[v];
+		const FVector3f& Normal = InProfile->RestNormals_Vert[v];
+		RestPosX[v] = Pos.X; RestPosY[v] = Pos.Y; RestPosZ[v] = Pos.Z;
+		RestNormalX[v] = Normal.X; RestNormalY[v] = Normal.Y; RestNormalZ[v] = Normal.Z;
+	}
+
+	// Only the verts of LOD0's rows are kept, the rest of every frame belongs to other LODs or is padding
+	const int32 NumSamples = NumFrames * NumVerts;
+	OffsetX.SetNumUninitialized(NumSamples); OffsetY.SetNumUninitialized(NumSamples); OffsetZ.SetNumUninitialized(NumSamples);
+	NormalX.SetNumUninitialized(NumSamples); NormalY.SetNumUninitialized(NumSamples); NormalZ.SetNumUninitialized(NumSamples);
+
+	for (int32 f = 0; f < NumFrames; f++)
+	{
+		for (int32 v = 0; v < NumVerts; v++)
+		{
+			const int32 Texel = f * FrameSize + v;
+			const int32 i = f * NumVerts + v;
+
+			const FVector3f Offset = FVertexAnimBoneSampler::DecodeVectorHDR(TexelFromEncodedData(OffsetData, Texel), InProfile->MaxValueOffset_Vert);
+			// Normals are baked with a fixed max value of 2
+			const FVector3f Normal = DecodeVectorLDR(TexelFromEncodedData(NormalData, Texel), 2.f);
+
+			OffsetX[i] = Offset.X; OffsetY[i] = Offset.Y; OffsetZ[i] = Offset.Z;
+			NormalX[i] = Normal.X; NormalY[i] = Normal.Y; NormalZ[i] = Normal.Z;
+		}
+	}
+
+	return true;
+}
+
+float FVertexAnimVertSampler::GetClipLength(const int32 ClipIndex) const
+{
+	return (Clips.IsValidIndex(ClipIndex) && (Clips[ClipIndex].FrameRate > 0.f)) ? Clips[ClipIndex].NumFrames / Clips[ClipIndex].FrameRate : 0.f;
+}
+
+bool FVertexAnimVertSampler::GetClip(const int32 ClipIndex, int32& OutStartFrame, int32& OutNumFrames, float& OutFrameRate) const
+{
+	if (!Clips.IsValidIndex(ClipIndex)) return false;
+
+	OutStartFrame = Clips[ClipIndex].StartFrame;
+	OutNumFrames = Clips[ClipIndex].NumFrames;
+	OutFrameRate = Clips[ClipIndex].FrameRate;
+	return true;
+}
+
+void FVertexAnimVertSampler::SampleVerts(
+	const int32 ClipIndex, const float Time, TArrayView<const int32> VertIndices,
+	TArrayView<FVector3f> OutPositions, TArrayView<FVector3f> OutNormals) const
+{
+	check((VertIndices.Num() == OutPositions.Num()) && (VertIndices.Num() == OutNormals.Num()));
+
+	if (!IsValid() || !Clips.IsValidIndex(ClipIndex))
+	{
+		for (FVector3f& Out : OutPositions) Out = FVector3f::ZeroVector;
+		for (FVector3f& Out : OutNormals) Out = FVector3f::UpVector;
+		return;
+	}
+
+	const FClip& Clip = Clips[ClipIndex];
+
+	int32 Frame0, Frame1;
+	float Alpha;
+	FVertexAnimBoneSampler::CalcClipFrames(Time, Clip.FrameRate, Clip.NumFrames, Frame0, Frame1, Alpha);
+
+	const int32 FrameStart0 = (Clip.StartFrame + Frame0) * NumVerts;
+	const int32 FrameStart1 = (Clip.StartFrame + Frame1) * NumVerts;
+
+	for (int32 i = 0; i < VertIndices.Num(); i++)
+	{
+		const int32 Vert = VertIndices[i];
+		if ((Vert < 0) || (Vert >= NumVerts))
+		{
+			OutPositions[i] = FVector3f::ZeroVector;
+			OutNormals[i] = FVector3f::UpVector;
+			continue;
+		}
+
+		const int32 A = FrameStart0 + Vert;
+		const int32 B = FrameStart1 + Vert;
+
+		OutPositions[i] = FVector3f(
+			RestPosX[Vert] + OffsetX[A] + (OffsetX[B] - OffsetX[A]) * Alpha,
+			RestPosY[Vert] + OffsetY[A] + (OffsetY[B] - OffsetY[A]) * Alpha,
+			RestPosZ[Vert] + OffsetZ[A] + (OffsetZ[B] - OffsetZ[A]) * Alpha);
+
+		OutNormals[i] = FVector3f(
+			RestNormalX[Vert] + NormalX[A] + (NormalX[B] - NormalX[A]) * Alpha,
+			RestNormalY[Vert] + NormalY[A] + (NormalY[B] - NormalY[A]) * Alpha,
+			RestNormalZ[Vert] + NormalZ[A] + (NormalZ[B] - NormalZ[A]) * Alpha).GetSafeNormal(SMALL_NUMBER, FVector3f::UpVector);
+	}
+}
@@ -0,0 +1,84 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVertexAnimProfile;
+
+// CPU side sampler for baked Bone Anim data, so gameplay can query sockets, hit points or foot IK
+// of VAT instances without keeping a hidden skeletal mesh around.
+// The profile needs to be baked with CPUBoneSampling on, the texels are decoded once on Initialize
+// the same way the material decodes them, and kept as SoA float arrays laid out [Row * NumBones + Bone].
+class VERTEXANIMTOOLSET_API FVertexAnimBoneSampler
+{
+public:
+
+	bool Initialize(const UVertexAnimProfile* InProfile);
+	void Reset();
+
+	bool IsValid() const { return NumRows > 0; }
+	int32 GetNumBones() const { return NumBones; }
+	int32 GetNumClips() const { return Clips.Num(); }
+	// Seconds, 0 for invalid clips
+	float GetClipLength(const int32 ClipIndex) const;
+
+	// Profile was baked with BakeMirrorMaps, clips can be sampled mirrored
+	bool CanMirror() const { return MirrorBones.Num() > 0; }
+
+	// Bone index (texture column) of a bone of the profile's skeleton, INDEX_NONE if not found or compacted away (CompactBones)
+	int32 FindBoneIndex(const FName BoneName) const;
+
+	/**
+	 * Component space transforms of a batch of bones, interpolated between the two baked frames around Time.
+	 * @param	ClipIndex		Index into the profile's Anims_Bone
+	 * @param	Time			Time in seconds, wraps around the clip length like the material does
+	 * @param	BoneIndices		Bone indices as returned by FindBoneIndex
+	 * @param	OutTransforms	Must have the same size as BoneIndices
+	 * @param	bMirrored		Sample the clip mirrored across the profile's MirrorAxis: every bone gets its own ref pose followed by its mirror bone's ref to local transform, reflected
+	 */
+	void SampleBoneTransforms(
+		const int32 ClipIndex, const float Time, TArrayView<const int32> BoneIndices, TArrayView<FTransform> OutTransforms,
+		const bool bMirrored = false) const;
+
+	// M * T * M for the reflection M across the plane Axis is the normal of, what mirrored playback applies to the ref to local transforms
+	static FTransform MirrorTransform(const FTransform& Transform, const EAxis::Type Axis);
+
+	// First row, frame count and frames per second of a clip, false for invalid clips
+	bool GetClip(const int32 ClipIndex, int32& OutStartRow, int32& OutNumFrames, float& OutFrameRate) const;
+
+	// The two baked frames around Time and the lerp between them, wrapping around the clip like the material does.
+	// Shared by the vert sampler, VATClipFrames in VertexAnimDecode.ush is the GPU version.
+	static void CalcClipFrames(const float Time, const float FrameRate, const int32 NumFrames, int32& OutFrame0, int32& OutFrame1, float& OutAlpha);
+
+	// Inverse of EncodeData_Quat
+	static FQuat4f DecodeQuat(const FFloat16Color& Texel);
+	// Inverse of EncodeData_Vec with HDR on
+	static FVector3f DecodeVectorHDR(const FFloat16Color& Texel, const float MaxValue);
+
+private:
+
+	struct FClip
+	{
+		int32 StartRow = 0;
+		int32 NumFrames = 0;
+		// baked frames per second of anim time
+		float FrameRate = 0.f;
+	};
+
+	int32 NumBones = 0;
+	int32 NumRows = 0;
+
+	TArray <FClip> Clips;
+
+	// Row 0 is the ref pose in component space, every other row holds the ref to local (skinning) transforms of a frame.
+	TArray <float> PosX, PosY, PosZ;
+	TArray <float> RotX, RotY, RotZ, RotW;
+
+	// Skeleton bone name of every column
+	TArray <FName> BoneNames;
+
+	// Profile's MirrorBones and MirrorAxis, empty without BakeMirrorMaps
+	TArray <int32> MirrorBones;
+	TEnumAsByte<EAxis::Type> MirrorAxis = EAxis::X;
+};
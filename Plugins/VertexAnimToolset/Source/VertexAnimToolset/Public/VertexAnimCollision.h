@@ -0,0 +1,51 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVertexAnimProfile;
+
+struct FVertexAnimCollisionHit
+{
+	int32 Agent = INDEX_NONE;
+	// Index into the profile's CollisionCapsules
+	int32 Capsule = INDEX_NONE;
+	// World distance from the ray start to the hit, 0 for sphere overlaps
+	float Distance = 0.f;
+};
+
+// CPU queries against the collision capsules baked with BakeCollisionCapsules on, so hits on VAT agents can resolve to limbs
+// without spawning skeletal meshes. Every agent's clip bounds are tested first (broadphase), then the capsules of the agents
+// they let through, posed at the agent's anim time and tested 4 at a time with SIMD (narrow phase).
+// Agent transforms are expected to be uniformly scaled.
+class VERTEXANIMTOOLSET_API FVertexAnimCollision
+{
+public:
+
+	/**
+	 * Ray from Start to End against a batch of agents, the closest capsule hit per agent, sorted closest first.
+	 * Distance is where the ray enters the capsule around its closest approach to the capsule's segment.
+	 * @param	bBoneClips			Index into CollisionClips_Bone instead of CollisionClips_Vert
+	 * @param	AgentTransforms		World transform per agent
+	 * @param	ClipIndices			Clip per agent
+	 * @param	Times				Anim time per agent, wraps around the clip length like the material does
+	 * @param	OutHits				Appended to, Agent is the index into AgentTransforms
+	 */
+	static void RaycastAgents(
+		const UVertexAnimProfile* Profile, const bool bBoneClips,
+		TArrayView<const FTransform> AgentTransforms, TArrayView<const int32> ClipIndices, TArrayView<const float> Times,
+		const FVector& Start, const FVector& End, TArray <FVertexAnimCollisionHit>& OutHits);
+
+	// Every capsule of a batch of agents overlapping a sphere, in agent order. Same parameters as RaycastAgents
+	static void SphereOverlapAgents(
+		const UVertexAnimProfile* Profile, const bool bBoneClips,
+		TArrayView<const FTransform> AgentTransforms, TArrayView<const int32> ClipIndices, TArrayView<const float> Times,
+		const FVector& Center, const float Radius, TArray <FVertexAnimCollisionHit>& OutHits);
+
+	// Component space segments of every capsule of a clip at Time, interpolated between the two baked frames around it.
+	// False for clips without capsules
+	static bool SampleCapsules(
+		const UVertexAnimProfile* Profile, const bool bBoneClips, const int32 ClipIndex, const float Time,
+		TArray <FVector3f>& OutStarts, TArray <FVector3f>& OutEnds);
+};
@@ -0,0 +1,236 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+#include "VertexAnimCrowdComponent.generated.h"
+
+class UVertexAnimProfile;
+struct FVertexAnimEventHit;
+struct FVertexAnimCollisionHit;
+
+// Per instance custom data floats written by UVertexAnimCrowdComponent, read them in the material with PerInstanceCustomData
+enum EVATCrowdCustomData : int32
+{
+	// AnimStart_Generated of the clip, first row of its first frame
+	VATCrowd_AnimStart = 0,
+	VATCrowd_NumFrames,
+	// Baked frames per second of anim time
+	VATCrowd_FrameRate,
+	// World time in seconds the instance's anim time was last rebased at, and its anim time then
+	VATCrowd_TimeBase,
+	VATCrowd_BaseAnimTime,
+	// 0 once a non looping clip has reached its last frame
+	VATCrowd_PlayRate,
+	// Weight of the current clip at TimeBase, and its change per second while cross fading from the previous clip:
+	//   Weight = saturate(BlendWeight + (Time - TimeBase) * FadeRate)
+	VATCrowd_BlendWeight,
+	VATCrowd_FadeRate,
+	// Clip faded out while cross fading, sharing TimeBase with the current clip. Its anim time wraps like a looping clip
+	VATCrowd_PrevAnimStart,
+	VATCrowd_PrevNumFrames,
+	VATCrowd_PrevFrameRate,
+	VATCrowd_PrevBaseAnimTime,
+	VATCrowd_PrevPlayRate,
+	VATCrowd_NumCustomData
+};
+
+// Agents at least MinDistance away from every view only update every FrameInterval frames, their update catching up the time in between
+USTRUCT(BlueprintType)
+struct VERTEXANIMTOOLSET_API FVATCrowdUpdateTier
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = VertexAnim, meta = (ClampMin = "0"))
+		float MinDistance = 0.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = VertexAnim, meta = (ClampMin = "1"))
+		int32 FrameInterval = 1;
+};
+
+/**
+ * Instanced static mesh playing the clips of a baked VAT profile on every instance (agent), without any per agent actor or tick.
+ * Agent i is instance i. The animation state lives in SoA arrays, advanced for all agents in one batched pass on tick,
+ * and only the agents whose state changed get their custom data rewritten (see EVATCrowdCustomData).
+ *
+ * The material gets the anim time of an instance with VATCrowdAnimTime in VertexAnimDecode.ush:
+ *   AnimTime = BaseAnimTime + (Time - TimeBase) * PlayRate
+ * so nothing has to be uploaded while agents keep playing their clip.
+ *
+ * Clip changes can cross fade: the previous clip keeps playing while its weight fades out, the material samples both clips
+ * and lerps them (VATCrowdVertCrossFade). Fades run on the GPU from the custom data, the tick only ends the finished ones.
+ *
+ * The update runs in ParallelFor chunks of UpdateChunkSize agents. Far agents are time sliced by UpdateTiers, staggered over the
+ * frames of their interval, and only the custom data of the agents that changed is rewritten on the game thread.
+ * There is no partial upload: frames where no agent changed send nothing to the render thread, any change re-sends
+ * the per instance data of the whole component (see GetLastUploadBytes).
+ */
+UCLASS(ClassGroup = Rendering, meta = (BlueprintSpawnableComponent))
+class VERTEXANIMTOOLSET_API UVertexAnimCrowdComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+public:
+
+	UVertexAnimCrowdComponent(const FObjectInitializer& ObjectInitializer);
+
+	// Its StaticMesh becomes the component's mesh
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnim)
+		UVertexAnimProfile* Profile = NULL;
+	// Play the clips of Anims_Bone instead of Anims_Vert
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnim)
+		bool BoneClips = false;
+	// Sorted by MinDistance, agents closer than the first tier update every frame.
+	// Non looping and cross fading agents always update every frame so clips hold and fades end on time.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = VertexAnim)
+		TArray <FVATCrowdUpdateTier> UpdateTiers;
+	// Agents per ParallelFor task of the update
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = VertexAnim, meta = (ClampMin = "64"))
+		int32 UpdateChunkSize = 1024;
+
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		void SetProfile(UVertexAnimProfile* InProfile, const bool bInBoneClips);
+
+	// Adds an instance playing Clip from StartAnimTime, returns the agent (instance) index
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		int32 AddAgent(const FTransform& Transform, const int32 Clip, const float PlayRate = 1.f, const bool bLoop = true, const float StartAnimTime = 0.f);
+	// Swaps the clip of an agent, restarting it at StartAnimTime
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		void SetAgentClip(const int32 Agent, const int32 Clip, const float PlayRate = 1.f, const bool bLoop = true, const float StartAnimTime = 0.f);
+	// Same as SetAgentClip, fading the current clip out over FadeDuration seconds instead of popping.
+	// Cross fading again before the fade is done drops the clip that was fading out.
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		void CrossFadeAgent(const int32 Agent, const int32 Clip, const float FadeDuration, const float PlayRate = 1.f, const bool bLoop = true, const float StartAnimTime = 0.f);
+	// Keeps the current anim time, negative rates play backwards
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		void SetAgentPlayRate(const int32 Agent, const float PlayRate);
+	// Weight of the current clip against the previous one, 1 by default. Holds a running cross fade at that weight
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		void SetAgentBlendWeight(const int32 Agent, const float BlendWeight);
+	UFUNCTION(BlueprintCallable, Category = "VertexAnim|Crowd")
+		bool RemoveAgent(const int32 Agent) { return RemoveInstance(Agent); }
+
+	// Same as SetAgentClip / CrossFadeAgent on a batch of agents, no fade for a FadeDuration of 0
+	void SetAgentsClip(
+		TArrayView<const int32> Agents, const int32 Clip, const float PlayRate = 1.f, const bool bLoop = true, const float StartAnimTime = 0.f,
+		const float FadeDuration = 0.f);
+
+	UFUNCTION(BlueprintPure, Category = "VertexAnim|Crowd")
+		int32 GetNumAgents() const { return ClipIndices.Num(); }
+	UFUNCTION(BlueprintPure, Category = "VertexAnim|Crowd")
+		int32 GetAgentClip(const int32 Agent) const { return ClipIndices.IsValidIndex(Agent) ? ClipIndices[Agent] : INDEX_NONE; }
+	// Anim time in seconds as of the last update, unwrapped (keeps growing over loops) like FVertexAnimRootMotion expects
+	UFUNCTION(BlueprintPure, Category = "VertexAnim|Crowd")
+		float GetAgentAnimTime(const int32 Agent) const { return AnimTimes.IsValidIndex(Agent) ? AnimTimes[Agent] : 0.f; }
+	// Weight of the current clip as of the last update, below 1 while cross fading
+	UFUNCTION(BlueprintPure, Category = "VertexAnim|Crowd")
+		float GetAgentBlendWeight(const int32 Agent) const { return Weights.IsValidIndex(Agent) ? Weights[Agent] : 1.f; }
+	UFUNCTION(BlueprintPure, Category = "VertexAnim|Crowd")
+		bool IsAgentFading(const int32 Agent) const { return PrevClipIndices.IsValidIndex(Agent) && (PrevClipIndices[Agent] != INDEX_NONE); }
+
+	// Clip and anim time of every agent as of the last update, for batched queries like FVertexAnimRootMotion::EvaluateDeltas
+	TArrayView<const int32> GetAgentClips() const { return ClipIndices; }
+	TArrayView<const float> GetAgentAnimTimes() const { return AnimTimes; }
+	// Anim time of every agent before the last update, equal to GetAgentAnimTimes for agents their tier skipped.
+	// EvaluateDeltas from these to GetAgentAnimTimes every frame gives every agent its full root motion
+	TArrayView<const float> GetAgentPrevAnimTimes() const { return PrevAnimTimes; }
+	// Baked anim events every agent crossed in the last update, see FVertexAnimEvents::QueryEvents. Agent is the agent index
+	void QueryAgentEvents(TArray <FVertexAnimEventHit>& OutHits) const;
+	// Baked collision capsules of the agents a world space ray hits, closest first, or a sphere overlaps, see FVertexAnimCollision.
+	// Agents are posed at their anim time as of the last update
+	void RaycastAgents(const FVector& Start, const FVector& End, TArray <FVertexAnimCollisionHit>& OutHits) const;
+	void SphereOverlapAgents(const FVector& Center, const float Radius, TArray <FVertexAnimCollisionHit>& OutHits) const;
+
+	// The batched pass run on tick: advances the anim time and blend weight of every agent to the world time Now,
+	// holds finished non looping clips, ends finished cross fades and rewrites the custom data of the agents that changed
+	void UpdateAgents(const double Now);
+	// Agents whose custom data the last UpdateAgents changed, and the bytes of per instance data it sent to the render thread.
+	// Any change re-sends the data of every instance, 0 bytes when no agent changed.
+	// Also recorded by the CSV profiler, category VATCrowd
+	int32 GetLastDirtyAgents() const { return LastDirtyAgents; }
+	SIZE_T GetLastUploadBytes() const { return LastUploadBytes; }
+
+	//~ Begin UActorComponent Interface
+	virtual void OnRegister() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~ End UActorComponent Interface
+
+	//~ Begin UObject Interface
+	// Adds the agent state arrays to the instance data
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+	//~ End UObject Interface
+
+	//~ Begin UInstancedStaticMeshComponent Interface
+	virtual bool RemoveInstance(int32 InstanceIndex) override;
+	virtual bool RemoveInstances(const TArray<int32>& InstancesToRemove) override;
+	virtual void ClearInstances() override;
+	//~ End UInstancedStaticMeshComponent Interface
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+
+	struct FCrowdClip
+	{
+		float AnimStart = 0.f;
+		float NumFrames = 0.f;
+		float FrameRate = 0.f;
+		// Anim time of the last frame, where non looping clips hold
+		float EndTime = 0.f;
+	};
+
+	enum EAgentFlags : uint8
+	{
+		AgentFlag_Loop = 1 << 0,
+		AgentFlag_Finished = 1 << 1,
+	};
+
+	void RefreshClips();
+	// Agents added through the base instance API get the defaults, clip 0 looping
+	void SyncAgents();
+	void RemoveAgentState(const int32 Agent);
+	// Anim time of an agent at Now, from its base
+	float CalcAnimTime(const int32 Agent, const double Now) const;
+	float CalcPrevAnimTime(const int32 Agent, const double Now) const;
+	float CalcWeight(const int32 Agent, const double Now) const;
+	// Restarts the anim time base of an agent at Now, the previous clip and the fade carry on from where they are.
+	// bClipChanged also restarts the event window of QueryAgentEvents at AnimTime
+	void RebaseAgent(const int32 Agent, const double Now, const float AnimTime, const bool bClipChanged = false);
+	// Thread safe for distinct agents, the update picks the dirty ranges up chunk by chunk
+	void MarkAgentDirty(const int32 Agent) { DirtyFlags[Agent] = 1; }
+	// Update of one agent in the parallel pass, true if its custom data is dirty
+	bool UpdateAgent(const int32 Agent, const double Now, TArrayView<const FVector> ViewLocations, const FTransform& ComponentTransform);
+	int32 CalcUpdateTier(const FVector& Location, TArrayView<const FVector> ViewLocations) const;
+	void FlushCustomData(TArrayView<const FIntPoint> DirtyRanges);
+	double GetNow() const;
+	void GetAgentWorldTransforms(TArray <FTransform>& OutTransforms) const;
+
+	TArray <FCrowdClip> Clips;
+
+	// Agent state, indexed like the instances
+	TArray <int32> ClipIndices;
+	TArray <double> TimeBases;
+	TArray <float> BaseAnimTimes;
+	TArray <float> PlayRates;
+	TArray <float> BlendWeights;
+	TArray <uint8> AgentFlags;
+	// Cross fade state, PrevClipIndices is INDEX_NONE when not fading
+	TArray <float> FadeRates;
+	TArray <int32> PrevClipIndices;
+	TArray <float> PrevBaseAnimTimes;
+	TArray <float> PrevPlayRates;
+	// Output of the last UpdateAgents
+	TArray <float> AnimTimes;
+	TArray <float> PrevAnimTimes;
+	TArray <float> Weights;
+	// Index into UpdateTiers + 1, 0 for agents updating every frame
+	TArray <uint8> AgentTiers;
+
+	TArray <uint8> DirtyFlags;
+	// Counts UpdateAgents calls, staggers the tiers
+	uint32 UpdateFrame = 0;
+	int32 LastDirtyAgents = 0;
+	SIZE_T LastUploadBytes = 0;
+};
@@ -0,0 +1,40 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVertexAnimProfile;
+struct FVAAnimEvent;
+
+// An event crossed by an agent, Event indexes the profile's AnimEvents
+struct FVertexAnimEventHit
+{
+	int32 Agent = INDEX_NONE;
+	int32 Event = INDEX_NONE;
+};
+
+// CPU query of the AnimNotifies baked with BakeAnimEvents on, so crowds of VAT agents can trigger footsteps, hits or FX
+// without evaluating any sequence. Times are the same unwrapped anim times as FVertexAnimRootMotion's.
+class VERTEXANIMTOOLSET_API FVertexAnimEvents
+{
+public:
+
+	/**
+	 * Every event a batch of agents crossed between two anim times, in agent order and in play order per agent.
+	 * An event counts when its time is in (PrevTime, Time], or in [Time, PrevTime) for reverse playback.
+	 * A window spanning a whole loop or more reports every event of the clip once.
+	 * @param	bBoneClips		Index into EventClips_Bone instead of EventClips_Vert
+	 * @param	ClipIndices		Clip per agent
+	 * @param	PrevTimes		Anim time per agent at the previous update
+	 * @param	Times			Anim time per agent now
+	 * @param	OutHits			Appended to, Agent is the index into ClipIndices
+	 */
+	static void QueryEvents(
+		const UVertexAnimProfile* Profile, const bool bBoneClips,
+		TArrayView<const int32> ClipIndices, TArrayView<const float> PrevTimes, TArrayView<const float> Times,
+		TArray <FVertexAnimEventHit>& OutHits);
+
+	// Events of a clip sorted by time, empty for invalid clips
+	static TArrayView<const FVAAnimEvent> GetClipEvents(const UVertexAnimProfile* Profile, const bool bBoneClips, const int32 ClipIndex);
+};
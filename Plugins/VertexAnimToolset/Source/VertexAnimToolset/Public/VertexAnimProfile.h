@@ -8,6 +8,7 @@
 
 class UTexture2D;
 class UStaticMesh;
+class USkeletalMesh;
 
 // Struct Holding helper data specific to an Animation Sequence needed for the baking process
 USTRUCT(BlueprintType)
@@ -28,6 +29,119 @@ public:
 		float Speed_Generated = 1.f;
 };
 
+// Texel format of the baked textures
+UENUM()
+enum class EVATTexelFormat : uint8
+{
+	// Half float RGBA, normalized against one max value for the whole profile
+	Float16,
+	// No longer offered, UE 5.1 has no 4 channel 16 bit normalized platform format and the textures came out 8 bit.
+	// Kept so saved profiles still load, they bake as Float16
+	UNorm16 UMETA(Hidden),
+	// 8 bit normalized RGBA (4 bytes per texel), normalized against the profile's range table
+	UNorm8,
+};
+
+// Row layout of the vert textures
+UENUM()
+enum class EVATVertLayout : uint8
+{
+	// Every frame is RowsPerFrame_Vert consecutive rows, the two frames a vert interpolates between are RowsPerFrame_Vert rows apart
+	FrameRows,
+	// Row R of a frame goes to texture row R * (number of frames) + frame, so the frames of a row of verts are neighbouring rows
+	// and share texture cache tiles. Materials step FrameRowStep_Vert rows per frame, see VATVertFrameV in VertexAnimDecode.ush
+	FrameInterleaved,
+};
+
+// Bounds baked values are normalized against in the UNorm texel formats, value = Min + Texel * Extent
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVAValueRange
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		FVector3f Min = FVector3f::ZeroVector;
+	UPROPERTY()
+		FVector3f Extent = FVector3f::ZeroVector;
+};
+
+// Root motion of one baked clip, RootMotionFrames[FirstFrame, FirstFrame + NumFrames] of the profile.
+// One entry per baked frame plus one for the end of the clip, so loops can be chained.
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVARootMotionClip
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		int32 FirstFrame = 0;
+	UPROPERTY()
+		int32 NumFrames = 0;
+	UPROPERTY()
+		float Length = 0.f;
+};
+
+// One AnimNotify of a baked clip's source sequence
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVAAnimEvent
+{
+	GENERATED_BODY()
+public:
+	// Seconds into the clip
+	UPROPERTY()
+		float Time = 0.f;
+	// Notify states only, 0 for notifies
+	UPROPERTY()
+		float Duration = 0.f;
+	// Notify name, or the notify (state) class's notify name
+	UPROPERTY()
+		FName Name;
+};
+
+// Events of one baked clip, AnimEvents[FirstEvent, FirstEvent + NumEvents) of the profile, sorted by Time
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVAEventClip
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		int32 FirstEvent = 0;
+	UPROPERTY()
+		int32 NumEvents = 0;
+	UPROPERTY()
+		float Length = 0.f;
+};
+
+// Capsule fitted to the ref pose verts skinned to one bone, posed per frame by CapsuleFrames
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVACollisionCapsule
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		FName Bone;
+	UPROPERTY()
+		float Radius = 0.f;
+};
+
+// Capsule poses of one baked clip, frames [FirstFrame, FirstFrame + NumFrames) of the profile's CapsuleFrames
+USTRUCT()
+struct VERTEXANIMTOOLSET_API FVACollisionClip
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		int32 FirstFrame = 0;
+	UPROPERTY()
+		int32 NumFrames = 0;
+	UPROPERTY()
+		float Length = 0.f;
+	// Component space bounds of every capsule over every frame of the clip, radius included
+	UPROPERTY()
+		FVector3f BoundsMin = FVector3f::ZeroVector;
+	UPROPERTY()
+		FVector3f BoundsMax = FVector3f::ZeroVector;
+};
+
 // Data asset holding all the helper data needed for the baking process
 UCLASS(BlueprintType)
 class VERTEXANIMTOOLSET_API UVertexAnimProfile : public UDataAsset
@@ -39,23 +153,84 @@ public:
 		bool AutoSize = true;
 	UPROPERTY(EditAnywhere, Category = AnimProfile)
 	int32 MaxWidth = 2048;
+	// Merge skinned and static meshes attached to the preview mesh into the VAT mesh, sharing one set of textures
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool MergeAttachedMeshes = true;
+	// Store the root bone motion of every clip as curves on the profile, evaluated with FVertexAnimRootMotion
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool ExtractRootMotion = false;
+	// Store the AnimNotify times of every clip as an event table on the profile, queried with FVertexAnimEvents
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool BakeAnimEvents = false;
+	// Fit a capsule to the ref pose verts of every bone and store the capsules' poses per baked frame, queried with FVertexAnimCollision
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool BakeCollisionCapsules = false;
+	// Verts count for a bone's capsule when skinned to it at least this much
+	UPROPERTY(EditAnywhere, Category = AnimProfile, meta = (ClampMin = "0", ClampMax = "1", EditCondition = "BakeCollisionCapsules"))
+		float CapsuleMinWeight = 0.5f;
+	// Bones with fewer verts get no capsule
+	UPROPERTY(EditAnywhere, Category = AnimProfile, meta = (ClampMin = "1", EditCondition = "BakeCollisionCapsules"))
+		int32 CapsuleMinVerts = 16;
+	// Let clips share rows of identical frames (repeated clips, shared holds, loops starting where another clip ends) to shrink the textures
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool DeduplicateFrames = false;
+	// Max difference per component for frames to count as identical, in the baked units (cm offsets, normal deltas, quaternions)
+	UPROPERTY(EditAnywhere, Category = AnimProfile, meta = (ClampMin = "0", EditCondition = "DeduplicateFrames"))
+		float DeduplicateTolerance = 0.f;
+	// Bake vertex and bone mirror maps so any clip can be played mirrored at runtime, for meshes symmetric across MirrorAxis.
+	// Mirrored left / right versions of clips can then be dropped from the profile.
+	UPROPERTY(EditAnywhere, Category = AnimProfile)
+		bool BakeMirrorMaps = false;
+	UPROPERTY(EditAnywhere, Category = AnimProfile, meta = (EditCondition = "BakeMirrorMaps"))
+		TEnumAsByte<EAxis::Type> MirrorAxis = EAxis::X;
+	// Max distance in cm between a vert (or bone) reflected across MirrorAxis and its mirror
+	UPROPERTY(EditAnywhere, Category = AnimProfile, meta = (ClampMin = "0", EditCondition = "BakeMirrorMaps"))
+		float MirrorTolerance = 0.1f;
 	
 	UPROPERTY(EditAnywhere, Category = VertAnim)
 		bool UVMergeDuplicateVerts = true;
+	// Bake a separate, smaller block of rows for every LOD from that LOD's own skinned verts,
+	// instead of mapping all LODs onto LOD0's rows. The blocks sit inside every frame, so low LODs fetch from fewer rows.
+	UPROPERTY(EditAnywhere, Category = VertAnim)
+		bool PerLODRows_Vert = false;
 	UPROPERTY(EditAnywhere, Category = VertAnim)
 	FIntPoint OverrideSize_Vert = FIntPoint(0, 0);
 	UPROPERTY(EditAnywhere, Category = VertAnim)
 	TArray <FVASequenceData> Anims_Vert;
+	UPROPERTY(EditAnywhere, Category = VertAnim)
+		EVATVertLayout Layout_Vert = EVATVertLayout::FrameRows;
+	// UNorm formats normalize the offsets per clip, see ValueRanges_Vert and RangesTexture
+	UPROPERTY(EditAnywhere, Category = VertAnim)
+		EVATTexelFormat TexelFormat_Vert = EVATTexelFormat::Float16;
+	// Keep a copy of the baked vert texels and LOD0's rest pose on the profile so the vert anim can be sampled on the CPU
+	// (FVertexAnimVertSampler, the Vertex Anim Profile Niagara data interface). The CPU copy stays half float.
+	UPROPERTY(EditAnywhere, Category = VertAnim)
+		bool CPUVertSampling = false;
 
 	UPROPERTY(EditAnywhere, Category = BoneAnim)
 		bool FullBoneSkinning = false;
+	// Only give texture columns to the bones the mesh is skinned to or attached to, their parents and their mirror bones,
+	// instead of one column per bone of the skeleton. ActiveBones maps the columns back to the skeleton.
+	UPROPERTY(EditAnywhere, Category = BoneAnim)
+		bool CompactBones = true;
+	// Keep a copy of the baked bone texels on the profile so gameplay can sample bone transforms on the CPU (FVertexAnimBoneSampler)
+	UPROPERTY(EditAnywhere, Category = BoneAnim)
+		bool CPUBoneSampling = false;
 	UPROPERTY(EditAnywhere, Category = BoneAnim)
 	FIntPoint OverrideSize_Bone = FIntPoint(0, 0);
 	UPROPERTY(EditAnywhere, Category = BoneAnim)
 	TArray <FVASequenceData> Anims_Bone;
+	// UNorm formats normalize the positions per clip and bone, see ValueRanges_Bone and RangesTexture. The CPU copy stays half float.
+	UPROPERTY(EditAnywhere, Category = BoneAnim)
+		EVATTexelFormat TexelFormat_Bone = EVATTexelFormat::Float16;
 
 	UPROPERTY(EditAnywhere, Category = AnimProfileGenerated)
 		UStaticMesh* StaticMesh = NULL;
+#if WITH_EDITORONLY_DATA
+	// Skeletal mesh the profile was last baked from, lets the VATBake commandlet rebake without an editor preview
+	UPROPERTY(VisibleAnywhere, Category = AnimProfileGenerated)
+		TSoftObjectPtr<USkeletalMesh> SourceMesh;
+#endif
 
 	UPROPERTY(EditAnywhere, Category = Generated_VertAnim)
 	int32 UVChannel_VertAnim = -1;
@@ -67,8 +242,17 @@ public:
 
 	UPROPERTY(EditAnywhere, Category = Generated_VertAnim)
 	int32 RowsPerFrame_Vert= 0;
+	// Texture rows between two consecutive frames of a vert, RowsPerFrame_Vert with the FrameRows layout, 1 with FrameInterleaved
+	UPROPERTY(VisibleAnywhere, Category = Generated_VertAnim)
+	int32 FrameRowStep_Vert = 0;
 	UPROPERTY(EditAnywhere, Category = Generated_VertAnim)
 	float MaxValueOffset_Vert = 0;
+	// First row of every LOD's block inside a frame, only filled when PerLODRows_Vert is on
+	UPROPERTY(EditAnywhere, Category = Generated_VertAnim)
+	TArray <int32> LODRowOffset_Vert;
+	// Vert anim UVs of every vertex's mirror vertex, only with BakeMirrorMaps
+	UPROPERTY(EditAnywhere, Category = Generated_VertAnim)
+	int32 UVChannel_VertMirror = -1;
 
 	UPROPERTY(EditAnywhere, Category = Generated_BoneAnim)
 		int32 UVChannel_BoneAnim = -1;
@@ -81,6 +265,73 @@ public:
 
 	UPROPERTY(EditAnywhere, Category = Generated_BoneAnim)
 		float MaxValuePosition_Bone = 0;
+	// Skeleton bone of every texture column, empty when every skeleton bone has its own column (CompactBones off)
+	UPROPERTY(VisibleAnywhere, Category = Generated_BoneAnim)
+		TArray <int32> ActiveBones;
+	// Mirror column of every texture column, only with BakeMirrorMaps
+	UPROPERTY(EditAnywhere, Category = Generated_BoneAnim)
+		TArray <int32> MirrorBones;
+	// MirrorBones for the material, one row of float texels holding the mirror bone's U in R
+	UPROPERTY(EditAnywhere, Category = Generated_BoneAnim)
+		UTexture2D* BoneMirrorTexture = NULL;
+
+	// Half float RGBA texels of the used rows of OffsetsTexture / NormalsTexture, only filled when CPUVertSampling is on.
+	// Always in the FrameRows layout, whatever Layout_Vert is
+	UPROPERTY()
+		TArray <uint16> OffsetsTextureData;
+	UPROPERTY()
+		TArray <uint16> NormalsTextureData;
+	// Rest pose of the verts of LOD0's rows, vert i is texel i of every frame. Only filled when CPUVertSampling is on
+	UPROPERTY()
+		TArray <FVector3f> RestPositions_Vert;
+	UPROPERTY()
+		TArray <FVector3f> RestNormals_Vert;
+
+	// Half float RGBA texels of the used rows of BonePosTexture / BoneRotTexture, only filled when CPUBoneSampling is on
+	UPROPERTY()
+		TArray <uint16> BonePosTextureData;
+	UPROPERTY()
+		TArray <uint16> BoneRotTextureData;
+
+	// Range table of the UNorm texel formats, empty for Float16.
+	// Vert: one range per clip of Anims_Vert. Bone: [Block * OverrideSize_Bone.X + Bone], block 0 is the ref pose row, block 1 + i clip i.
+	// Clips sharing rows (DeduplicateFrames) share their ranges.
+	UPROPERTY(EditAnywhere, Category = Generated_Ranges)
+		TArray <FVAValueRange> ValueRanges_Vert;
+	UPROPERTY(EditAnywhere, Category = Generated_Ranges)
+		TArray <FVAValueRange> ValueRanges_Bone;
+	// The range table for the material, float RGBA. Row 0 Min and row 1 Extent of the vert clips (X = clip),
+	// then rows 2 + 2 * Block Min and 3 + 2 * Block Extent of the bone blocks (X = bone). Decode with VertexAnimDecode.ush
+	UPROPERTY(EditAnywhere, Category = Generated_Ranges)
+		UTexture2D* RangesTexture = NULL;
+
+	// Indexed like Anims_Vert / Anims_Bone, only filled when ExtractRootMotion is on
+	UPROPERTY()
+		TArray <FVARootMotionClip> RootMotionClips_Vert;
+	UPROPERTY()
+		TArray <FVARootMotionClip> RootMotionClips_Bone;
+	// Component space root translation (XYZ) and yaw in radians (W) relative to the clip's first frame, yaw is unwrapped
+	UPROPERTY()
+		TArray <FVector4f> RootMotionFrames;
+
+	// Indexed like Anims_Vert / Anims_Bone, only filled when BakeAnimEvents is on
+	UPROPERTY()
+		TArray <FVAEventClip> EventClips_Vert;
+	UPROPERTY()
+		TArray <FVAEventClip> EventClips_Bone;
+	UPROPERTY()
+		TArray <FVAAnimEvent> AnimEvents;
+
+	// Indexed like Anims_Vert / Anims_Bone, only filled when BakeCollisionCapsules is on
+	UPROPERTY()
+		TArray <FVACollisionClip> CollisionClips_Vert;
+	UPROPERTY()
+		TArray <FVACollisionClip> CollisionClips_Bone;
+	UPROPERTY()
+		TArray <FVACollisionCapsule> CollisionCapsules;
+	// Component space start and end of every capsule per baked frame, [((Frame * NumCapsules) + Capsule) * 2 + End]
+	UPROPERTY()
+		TArray <FVector3f> CapsuleFrames;
 
 	int32 CalcTotalNumOfFrames_Vert() const;
 	int32 CalcTotalRequiredHeight_Vert() const;
@@ -91,4 +342,8 @@ public:
 	int32 CalcStartHeightOfAnim_Vert(const int32 AnimIndex) const;
 	int32 CalcStartHeightOfAnim_Bone(const int32 AnimIndex) const;
 
+	// Texel of the vert textures holding texel TexelInFrame of stored frame Frame, for textures Width wide storing NumFrames frames in Layout
+	static FIntPoint CalcVertTexel(
+		const EVATVertLayout Layout, const int32 Width, const int32 RowsPerFrame, const int32 NumFrames, const int32 TexelInFrame, const int32 Frame);
+
 };
@@ -0,0 +1,44 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVertexAnimProfile;
+struct FVARootMotionClip;
+
+// CPU evaluation of the root motion baked with ExtractRootMotion on, so crowds of VAT agents
+// can move in sync with their baked clips without evaluating any skeletal animation.
+// Root motion is handled as translation plus yaw, packed as XYZ translation and W yaw in radians.
+class VERTEXANIMTOOLSET_API FVertexAnimRootMotion
+{
+public:
+
+	/**
+	 * Root motion of a batch of agents between two anim times, in each agent's local space at PrevTime.
+	 * Times are unwrapped clip times in seconds (they keep growing over loops), so full loops in between are accounted for.
+	 * @param	bBoneClips		Index into RootMotionClips_Bone instead of RootMotionClips_Vert
+	 * @param	ClipIndices		Clip per agent
+	 * @param	PrevTimes		Anim time per agent at the previous update
+	 * @param	Times			Anim time per agent now, may be lower than PrevTime for reverse playback
+	 * @param	OutDeltas		Must have the same size as ClipIndices
+	 */
+	static void EvaluateDeltas(
+		const UVertexAnimProfile* Profile, const bool bBoneClips,
+		TArrayView<const int32> ClipIndices, TArrayView<const float> PrevTimes, TArrayView<const float> Times,
+		TArrayView<FVector4f> OutDeltas);
+
+	// Moves agents by the deltas of EvaluateDeltas, Yaws in radians
+	static void ApplyDeltas(TArrayView<const FVector4f> Deltas, TArrayView<FVector3f> InOutPositions, TArrayView<float> InOutYaws);
+
+	// Root relative to the clip's first frame at a time within [0, Length]
+	static FVector4f SampleClip(const UVertexAnimProfile* Profile, const FVARootMotionClip& Clip, const float Time);
+
+	// Root motion of a clip played mirrored across the plane Axis is the normal of, for BakeMirrorMaps profiles.
+	// Mirrored across X or Y the yaw turns the other way, across Z only the height flips.
+	static FVector4f Mirror(const FVector4f& A, const EAxis::Type Axis);
+
+	// Root motion of A followed by B, B given in A's end space
+	static FVector4f Compose(const FVector4f& A, const FVector4f& B);
+	static FVector4f Inverse(const FVector4f& A);
+};
@@ -0,0 +1,62 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVertexAnimProfile;
+
+// CPU side sampler for baked Vert Anim data, the vert anim counterpart of FVertexAnimBoneSampler.
+// The profile needs to be baked with CPUVertSampling on. Only LOD0's rows are sampled: vert i is texel i of every frame,
+// its rest pose is RestPositions_Vert[i]. Texels are decoded once on Initialize into SoA float arrays laid out [Frame * NumVerts + Vert].
+class VERTEXANIMTOOLSET_API FVertexAnimVertSampler
+{
+public:
+
+	bool Initialize(const UVertexAnimProfile* InProfile);
+	void Reset();
+
+	bool IsValid() const { return NumFrames > 0; }
+	int32 GetNumVerts() const { return NumVerts; }
+	int32 GetNumClips() const { return Clips.Num(); }
+	// Seconds, 0 for invalid clips
+	float GetClipLength(const int32 ClipIndex) const;
+
+	/**
+	 * Component space positions and normals of a batch of verts, interpolated between the two baked frames around Time.
+	 * @param	ClipIndex		Index into the profile's Anims_Vert
+	 * @param	Time			Time in seconds, wraps around the clip length like the material does
+	 * @param	VertIndices		Texel index of the verts inside a frame, [0, GetNumVerts())
+	 * @param	OutPositions	Must have the same size as VertIndices
+	 * @param	OutNormals		Must have the same size as VertIndices
+	 */
+	void SampleVerts(
+		const int32 ClipIndex, const float Time, TArrayView<const int32> VertIndices,
+		TArrayView<FVector3f> OutPositions, TArrayView<FVector3f> OutNormals) const;
+
+	// First frame, frame count and frames per second of a clip, false for invalid clips
+	bool GetClip(const int32 ClipIndex, int32& OutStartFrame, int32& OutNumFrames, float& OutFrameRate) const;
+
+	// Inverse of EncodeData_Vec with HDR off
+	static FVector3f DecodeVectorLDR(const FFloat16Color& Texel, const float MaxValue);
+
+private:
+
+	struct FClip
+	{
+		int32 StartFrame = 0;
+		int32 NumFrames = 0;
+		// baked frames per second of anim time
+		float FrameRate = 0.f;
+	};
+
+	int32 NumVerts = 0;
+	int32 NumFrames = 0;
+
+	TArray <FClip> Clips;
+
+	TArray <float> RestPosX, RestPosY, RestPosZ;
+	TArray <float> RestNormalX, RestNormalY, RestNormalZ;
+	TArray <float> OffsetX, OffsetY, OffsetZ;
+	TArray <float> NormalX, NormalY, NormalZ;
+};
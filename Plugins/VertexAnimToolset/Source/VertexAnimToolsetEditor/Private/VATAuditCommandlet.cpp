@@ -0,0 +1,81 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATAuditCommandlet.h"
+
+#include "VATMemoryAudit.h"
+
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogVATAudit, Log, All);
+
+UVATAuditCommandlet::UVATAuditCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UVATAuditCommandlet::Main(const FString& Params)
+{
+	TArray <FString> Tokens;
+	TArray <FString> Switches;
+	TMap <FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	double ProfileBudgetMB, MapBudgetMB;
+	FVATMemoryAudit::GetBudgets(ProfileBudgetMB, MapBudgetMB);
+	if (const FString* Value = ParamVals.Find(TEXT("ProfileBudgetMB"))) ProfileBudgetMB = FCString::Atod(**Value);
+	if (const FString* Value = ParamVals.Find(TEXT("MapBudgetMB"))) MapBudgetMB = FCString::Atod(**Value);
+
+	const FString* Path = ParamVals.Find(TEXT("Path"));
+	const FString* MapPath = ParamVals.Find(TEXT("MapPath"));
+
+	TArray <FVATProfileAudit> Profiles;
+	FVATMemoryAudit::AuditProfiles(Path ? *Path : TEXT("/Game"), Profiles);
+
+	TArray <FVATMapAudit> Maps;
+	FVATMemoryAudit::AuditMaps(MapPath ? *MapPath : TEXT("/Game"), Profiles, Maps);
+
+	int32 NumOverBudget = 0;
+	int64 TotalBytes = 0;
+	for (const FVATProfileAudit& Profile : Profiles)
+	{
+		TotalBytes += Profile.TotalBytes();
+		UE_LOG(LogVATAudit, Display, TEXT("%s %.2fMB, %d verts, %d + %d clips, %.0f%% / %.0f%% unused vert / bone texels"), *Profile.Profile,
+			Profile.TotalBytes() / (1024.0 * 1024.0), Profile.NumVerts, Profile.NumClips_Vert, Profile.NumClips_Bone,
+			Profile.UnusedFraction_Vert * 100.f, Profile.UnusedFraction_Bone * 100.f);
+
+		if (FVATMemoryAudit::IsOverBudget(Profile.TotalBytes(), ProfileBudgetMB))
+		{
+			UE_LOG(LogVATAudit, Error, TEXT("%s is over the %.2fMB profile budget"), *Profile.Profile, ProfileBudgetMB);
+			NumOverBudget++;
+		}
+	}
+
+	for (const FVATMapAudit& Map : Maps)
+	{
+		UE_LOG(LogVATAudit, Display, TEXT("%s %.2fMB in %d profiles"), *Map.Map, Map.Bytes / (1024.0 * 1024.0), Map.Profiles.Num());
+
+		if (FVATMemoryAudit::IsOverBudget(Map.Bytes, MapBudgetMB))
+		{
+			UE_LOG(LogVATAudit, Error, TEXT("%s is over the %.2fMB map budget"), *Map.Map, MapBudgetMB);
+			NumOverBudget++;
+		}
+	}
+
+	const FString* ReportParam = ParamVals.Find(TEXT("Report"));
+	const FString ReportFile = ReportParam ? *ReportParam :
+		FPaths::ProjectSavedDir() / TEXT("VATAudit") / FString::Printf(TEXT("Report_%s.csv"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	const FString MapReportFile = FPaths::GetBaseFilename(ReportFile, false) + TEXT("_Maps.csv");
+
+	FFileHelper::SaveStringToFile(FVATMemoryAudit::ProfileCSV(Profiles, ProfileBudgetMB), *ReportFile);
+	FFileHelper::SaveStringToFile(FVATMemoryAudit::MapCSV(Maps, MapBudgetMB), *MapReportFile);
+
+	UE_LOG(LogVATAudit, Display, TEXT("Audited %d profiles (%.2fMB) and %d maps, %d over budget, report: %s"),
+		Profiles.Num(), TotalBytes / (1024.0 * 1024.0), Maps.Num(), NumOverBudget, *ReportFile);
+
+	return NumOverBudget ? 1 : 0;
+}
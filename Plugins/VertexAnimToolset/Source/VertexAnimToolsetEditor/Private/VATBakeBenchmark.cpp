@@ -0,0 +1,522 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+// VAT.Bench automation tests, time every stage of the bake on procedurally generated meshes and clips.
+// Run with: UnrealEditor-Cmd <Project> -nullrhi -unattended -ExecCmds="Automation RunTests VAT.Bench; Quit"
+// Each case appends its timings to Saved/Automation/VATBench/VATBench.csv
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "VATBakeStages.h"
+#include "VATSkinningKernel.h"
+#include "VertexAnimUtils.h"
+#include "VertexAnimProfile.h"
+
+#include "Animation/AnimSequence.h"
+#include "Animation/DebugSkelMeshComponent.h"
+#include "Animation/Skeleton.h"
+#include "Animation/AnimData/IAnimationDataController.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Materials/Material.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshLODImporterData.h"
+#include "ReferenceSkeleton.h"
+#include "IMeshBuilderModule.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "PreviewScene.h"
+#include "RenderingThread.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+#define LOCTEXT_NAMESPACE "VATBakeBenchmark"
+
+namespace VATBench
+{
+	static const FString PackagePath = TEXT("/Temp/VATBench/");
+
+	// Mesh is a tube of rings along Z, the bones a chain along the same axis
+	static constexpr int32 RingSegments = 32;
+	static constexpr float TubeHeight = 200.f;
+	static constexpr float TubeRadius = 20.f;
+
+	static constexpr int32 FrameRate = 30;
+	static constexpr float ClipLength = 1.f;
+	static constexpr int32 NumClips = 2;
+	static constexpr int32 NumFrames_Vert = 16;
+	static constexpr int32 NumFrames_Bone = 30;
+
+	struct FCase
+	{
+		int32 NumVerts;
+		int32 NumBones;
+	};
+
+	static const FCase Cases[] =
+	{
+		{ 1000, 30 }, { 1000, 150 },
+		{ 10000, 30 }, { 10000, 150 },
+		{ 100000, 30 }, { 100000, 150 },
+	};
+
+	static FString CaseName(const FCase& Case)
+	{
+		return FString::Printf(TEXT("%dk Verts %d Bones"), Case.NumVerts / 1000, Case.NumBones);
+	}
+
+	static FName BoneName(const int32 Bone)
+	{
+		return FName(*FString::Printf(TEXT("Bone_%03d"), Bone));
+	}
+
+	static float BoneSpacing(const int32 NumBones)
+	{
+		return TubeHeight / FMath::Max(1, NumBones - 1);
+	}
+
+	// Points of the tube, rounded up to full rings
+	static void TubePoints(const int32 NumVerts, TArray <FVector3f>& OutPoints)
+	{
+		const int32 NumRings = FMath::Max(2, FMath::DivideAndRoundUp(NumVerts, RingSegments));
+
+		OutPoints.Reset(NumRings * RingSegments);
+		for (int32 r = 0; r < NumRings; r++)
+		{
+			const float Z = TubeHeight * r / (NumRings - 1);
+			for (int32 s = 0; s < RingSegments; s++)
+			{
+				const float Angle = 2.f * PI * s / RingSegments;
+				OutPoints.Add(FVector3f(FMath::Cos(Angle) * TubeRadius, FMath::Sin(Angle) * TubeRadius, Z));
+			}
+		}
+	}
+
+	static USkeletalMesh* CreateSkeletalMesh(const FCase& Case, USkeleton*& OutSkeleton)
+	{
+		const FString Name = FString::Printf(TEXT("SK_VATBench_%d_%d"), Case.NumVerts, Case.NumBones);
+		USkeletalMesh* SkeletalMesh = NewObject<USkeletalMesh>(GetTransientPackage(), *Name, RF_Transient);
+		OutSkeleton = NewObject<USkeleton>(GetTransientPackage(), *(Name + TEXT("_Skeleton")), RF_Transient);
+
+		FSkeletalMeshImportData ImportData;
+
+		// Bone chain, each bone offset along Z from its parent
+		const float Spacing = BoneSpacing(Case.NumBones);
+		{
+			FReferenceSkeletonModifier RefSkeletonModifier(SkeletalMesh->GetRefSkeleton(), nullptr);
+			for (int32 b = 0; b < Case.NumBones; b++)
+			{
+				const FTransform3f BoneTM(FVector3f(0.f, 0.f, b ? Spacing : 0.f));
+				RefSkeletonModifier.Add(FMeshBoneInfo(BoneName(b), BoneName(b).ToString(), b - 1), FTransform(BoneTM));
+
+				SkeletalMeshImportData::FBone& Bone = ImportData.RefBonesBinary.AddDefaulted_GetRef();
+				Bone.Name = BoneName(b).ToString();
+				Bone.ParentIndex = b - 1;
+				Bone.NumChildren = (b < Case.NumBones - 1) ? 1 : 0;
+				Bone.BonePos.Transform = BoneTM;
+				Bone.BonePos.Length = Spacing;
+			}
+		}
+
+		TubePoints(Case.NumVerts, ImportData.Points);
+		const int32 NumRings = ImportData.Points.Num() / RingSegments;
+
+		for (int32 p = 0; p < ImportData.Points.Num(); p++)
+		{
+			ImportData.PointToRawMap.Add(p);
+
+			// Linear weights between the two bones around the point's height
+			const float BoneFloat = ImportData.Points[p].Z / Spacing;
+			const int32 Bone0 = FMath::Clamp(FMath::FloorToInt(BoneFloat), 0, Case.NumBones - 1);
+			const int32 Bone1 = FMath::Min(Bone0 + 1, Case.NumBones - 1);
+			const float Alpha = FMath::Clamp(BoneFloat - Bone0, 0.f, 1.f);
+
+			ImportData.Influences.Add({ 1.f - Alpha, p, Bone0 });
+			if ((Bone1 != Bone0) && (Alpha > 0.f)) ImportData.Influences.Add({ Alpha, p, Bone1 });
+		}
+
+		auto AddWedge = [&ImportData, NumRings](const int32 Ring, const int32 Segment) -> uint32
+		{
+			SkeletalMeshImportData::FVertex& Wedge = ImportData.Wedges.AddZeroed_GetRef();
+			Wedge.VertexIndex = Ring * RingSegments + (Segment % RingSegments);
+			Wedge.UVs[0] = FVector2f((float)Segment / RingSegments, (float)Ring / (NumRings - 1));
+			Wedge.Color = FColor::White;
+			return ImportData.Wedges.Num() - 1;
+		};
+
+		for (int32 r = 0; r < NumRings - 1; r++)
+		{
+			for (int32 s = 0; s < RingSegments; s++)
+			{
+				const uint32 W00 = AddWedge(r, s);
+				const uint32 W01 = AddWedge(r, s + 1);
+				const uint32 W10 = AddWedge(r + 1, s);
+				const uint32 W11 = AddWedge(r + 1, s + 1);
+
+				SkeletalMeshImportData::FTriangle& Tri0 = ImportData.Faces.AddZeroed_GetRef();
+				Tri0.WedgeIndex[0] = W00; Tri0.WedgeIndex[1] = W10; Tri0.WedgeIndex[2] = W01;
+				SkeletalMeshImportData::FTriangle& Tri1 = ImportData.Faces.AddZeroed_GetRef();
+				Tri1.WedgeIndex[0] = W01; Tri1.WedgeIndex[1] = W10; Tri1.WedgeIndex[2] = W11;
+			}
+		}
+
+		SkeletalMeshImportData::FMaterial& ImportMaterial = ImportData.Materials.AddDefaulted_GetRef();
+		ImportMaterial.Material = UMaterial::GetDefaultMaterial(MD_Surface);
+		ImportMaterial.MaterialImportName = TEXT("M_VATBench");
+
+		ImportData.NumTexCoords = 1;
+		ImportData.MaxMaterialIndex = 0;
+		ImportData.bHasNormals = false;
+		ImportData.bHasTangents = false;
+		ImportData.bHasVertexColors = false;
+
+		SkeletalMesh->PreEditChange(nullptr);
+		SkeletalMesh->GetMaterials().Add(FSkeletalMaterial(UMaterial::GetDefaultMaterial(MD_Surface)));
+		SkeletalMesh->GetImportedModel()->LODModels.Add(new FSkeletalMeshLODModel());
+		FSkeletalMeshLODInfo& LODInfo = SkeletalMesh->AddLODInfo();
+		LODInfo.BuildSettings.bRecomputeNormals = true;
+		LODInfo.BuildSettings.bRecomputeTangents = true;
+		SkeletalMesh->SetImportedBounds(FBoxSphereBounds(FBox(FVector(-TubeRadius, -TubeRadius, 0.f), FVector(TubeRadius, TubeRadius, TubeHeight))));
+		SkeletalMesh->SaveLODImportedData(0, ImportData);
+		SkeletalMesh->CalculateInvRefMatrices();
+
+		IMeshBuilderModule& MeshBuilderModule = IMeshBuilderModule::GetForRunningPlatform();
+		const FSkeletalMeshBuildParameters BuildParameters(SkeletalMesh, GetTargetPlatformManagerRef().GetRunningTargetPlatform(), 0, false);
+		if (!MeshBuilderModule.BuildSkeletalMesh(BuildParameters))
+		{
+			return nullptr;
+		}
+
+		OutSkeleton->MergeAllBonesToBoneTree(SkeletalMesh);
+		SkeletalMesh->SetSkeleton(OutSkeleton);
+		SkeletalMesh->PostEditChange();
+
+		return SkeletalMesh;
+	}
+
+	// Every bone swings around X, with a phase along the chain so the tube waves
+	static UAnimSequence* CreateSequence(USkeletalMesh* SkeletalMesh, USkeleton* Skeleton, const int32 NumBones, const int32 ClipIndex)
+	{
+		const FString Name = FString::Printf(TEXT("%s_Clip%d"), *SkeletalMesh->GetName(), ClipIndex);
+		UAnimSequence* Sequence = NewObject<UAnimSequence>(GetTransientPackage(), *Name, RF_Transient);
+		Sequence->SetSkeleton(Skeleton);
+		Sequence->SetPreviewMesh(SkeletalMesh);
+
+		const int32 NumKeys = FMath::RoundToInt(ClipLength * FrameRate) + 1;
+		const float Amplitude = (ClipIndex + 1) * 0.25f;
+		const float Spacing = BoneSpacing(NumBones);
+
+		IAnimationDataController& Controller = Sequence->GetController();
+		Controller.OpenBracket(LOCTEXT("CreateBenchSequence", "Create VAT Bench Sequence"), false);
+		Controller.SetFrameRate(FFrameRate(FrameRate, 1), false);
+		Controller.SetPlayLength(ClipLength, false);
+
+		TArray <FVector3f> PosKeys, ScaleKeys;
+		TArray <FQuat4f> RotKeys;
+		PosKeys.SetNum(NumKeys);
+		RotKeys.SetNum(NumKeys);
+		ScaleKeys.Init(FVector3f::OneVector, NumKeys);
+
+		for (int32 b = 0; b < NumBones; b++)
+		{
+			const FName Bone = BoneName(b);
+			for (int32 k = 0; k < NumKeys; k++)
+			{
+				const float Phase = 2.f * PI * ((float)k / (NumKeys - 1) + (float)b / NumBones);
+				PosKeys[k] = FVector3f(0.f, 0.f, b ? Spacing : 0.f);
+				RotKeys[k] = FQuat4f(FVector3f::ForwardVector, FMath::Sin(Phase) * Amplitude / FMath::Sqrt((float)NumBones));
+			}
+
+			Controller.AddBoneTrack(Bone, false);
+			Controller.SetBoneTrackKeys(Bone, PosKeys, RotKeys, ScaleKeys, false);
+		}
+
+		Controller.NotifyPopulated();
+		Controller.CloseBracket(false);
+
+		return Sequence;
+	}
+
+	// Ref pose verts, as MergedComponentVerts would return them
+	static void SyntheticSkinVerts(const int32 NumVerts, TArray <FFinalSkinVertex>& OutVerts)
+	{
+		TArray <FVector3f> Points;
+		TubePoints(NumVerts, Points);
+
+		OutVerts.SetNumZeroed(Points.Num());
+		for (int32 i = 0; i < Points.Num(); i++)
+		{
+			OutVerts[i].Position = Points[i];
+			OutVerts[i].TangentX = FVector3f(0.f, 0.f, 1.f);
+			OutVerts[i].TangentZ = FVector3f(Points[i].X, Points[i].Y, 0.f).GetSafeNormal();
+		}
+	}
+
+	static void ReleaseAsset(UObject* Asset)
+	{
+		if (!Asset) return;
+		Asset->ClearFlags(RF_Standalone | RF_Public);
+		Asset->MarkAsGarbage();
+	}
+
+	// Stage timings of one case, appended to the shared CSV
+	struct FTimings
+	{
+		TArray <TPair <FString, double>> Stages;
+
+		void Add(const FString& Stage, const double Seconds)
+		{
+			for (TPair <FString, double>& Existing : Stages)
+			{
+				if (Existing.Key == Stage)
+				{
+					Existing.Value += Seconds;
+					return;
+				}
+			}
+			Stages.Emplace(Stage, Seconds);
+		}
+
+		bool WriteCSV(const FCase& Case, const int32 NumMeshVerts) const
+		{
+			const FString CSVPath = FPaths::ProjectSavedDir() / TEXT("Automation/VATBench/VATBench.csv");
+
+			FString Out;
+			if (!IFileManager::Get().FileExists(*CSVPath))
+			{
+				Out += TEXT("Timestamp,BuildVersion,Case,Verts,Bones,Clips,FramesVert,FramesBone,Stage,Milliseconds\n");
+			}
+
+			const FString Timestamp = FDateTime::UtcNow().ToIso8601();
+			for (const TPair <FString, double>& Stage : Stages)
+			{
+				Out += FString::Printf(TEXT("%s,%s,%s,%d,%d,%d,%d,%d,%s,%.3f\n"),
+					*Timestamp, FApp::GetBuildVersion(), *CaseName(Case), NumMeshVerts, Case.NumBones,
+					NumClips, NumFrames_Vert, NumFrames_Bone, *Stage.Key, Stage.Value * 1000.0);
+			}
+
+			return FFileHelper::SaveStringToFile(Out, *CSVPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+				&IFileManager::Get(), FILEWRITE_Append);
+		}
+	};
+
+	struct FScopedStageTimer
+	{
+		FTimings& Timings;
+		FString Stage;
+		double StartTime;
+
+		FScopedStageTimer(FTimings& InTimings, const TCHAR* InStage)
+			: Timings(InTimings), Stage(InStage), StartTime(FPlatformTime::Seconds())
+		{}
+
+		~FScopedStageTimer()
+		{
+			Timings.Add(Stage, FPlatformTime::Seconds() - StartTime);
+		}
+	};
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FVATBakeBenchmark, "VAT.Bench.Bake",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FVATBakeBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (int32 i = 0; i < UE_ARRAY_COUNT(VATBench::Cases); i++)
+	{
+		OutBeautifiedNames.Add(VATBench::CaseName(VATBench::Cases[i]));
+		OutTestCommands.Add(FString::FromInt(i));
+	}
+}
+
+bool FVATBakeBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace VATBench;
+
+	const int32 CaseIndex = FCString::Atoi(*Parameters);
+	if ((CaseIndex < 0) || (CaseIndex >= UE_ARRAY_COUNT(Cases)))
+	{
+		AddError(FString::Printf(TEXT("Unknown VAT.Bench case %s"), *Parameters));
+		return false;
+	}
+	const FCase& Case = Cases[CaseIndex];
+
+	FTimings Timings;
+
+	// Setup, not timed
+	USkeleton* Skeleton = nullptr;
+	USkeletalMesh* SkeletalMesh = CreateSkeletalMesh(Case, Skeleton);
+	if (!SkeletalMesh)
+	{
+		AddError(TEXT("Failed to build the synthetic skeletal mesh"));
+		return false;
+	}
+
+	UVertexAnimProfile* Profile = NewObject<UVertexAnimProfile>(GetTransientPackage(), NAME_None, RF_Transient);
+	Profile->AutoSize = true;
+	Profile->FullBoneSkinning = true;
+	Profile->CPUBoneSampling = true;
+	for (int32 i = 0; i < NumClips; i++)
+	{
+		UAnimSequence* Sequence = CreateSequence(SkeletalMesh, Skeleton, Case.NumBones, i);
+
+		FVASequenceData& Vert = Profile->Anims_Vert.AddDefaulted_GetRef();
+		Vert.SequenceRef = Sequence;
+		Vert.NumFrames = NumFrames_Vert;
+
+		FVASequenceData& Bone = Profile->Anims_Bone.AddDefaulted_GetRef();
+		Bone.SequenceRef = Sequence;
+		Bone.NumFrames = NumFrames_Bone;
+	}
+
+	FPreviewScene PreviewScene(FPreviewScene::ConstructionValues().SetEditor(true));
+	UDebugSkelMeshComponent* PreviewComponent = NewObject<UDebugSkelMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+	PreviewComponent->SetSkeletalMesh(SkeletalMesh);
+	PreviewScene.AddComponent(PreviewComponent, FTransform::Identity);
+	PreviewComponent->GlobalAnimRateScale = 0.f;
+	FlushRenderingCommands();
+
+	// Generated assets live in /Temp, drop them on every exit so repeated or failed runs don't pile up
+	UStaticMesh* StaticMesh = nullptr;
+	TArray <UTexture2D*> Textures;
+	ON_SCOPE_EXIT
+	{
+		PreviewScene.RemoveComponent(PreviewComponent);
+		ReleaseAsset(StaticMesh);
+		for (UTexture2D* Texture : Textures) ReleaseAsset(Texture);
+	};
+
+	TArray <UMeshComponent*> Components;
+	Components.Add(PreviewComponent);
+
+	// MapSkinVerts on its own, SkinnedMeshVATData below runs it again on the real mesh
+	{
+		TArray <FFinalSkinVertex> SkinVerts;
+		SyntheticSkinVerts(Case.NumVerts, SkinVerts);
+
+		TArray <int32> UniqueSourceIDs;
+		TArray <FVector2D> UVs;
+		FScopedStageTimer Timer(Timings, TEXT("MapSkinVerts"));
+		VATBakeStages::MapSkinVerts(Profile, SkinVerts, UniqueSourceIDs, UVs);
+	}
+
+	TArray <TArray <int32>> UniqueSourceIDs;
+	TArray <TArray <FVector2D>> UVs_VertAnim;
+	TArray <TArray <FVector2D>> UVs_VertMirror;
+	TArray <TArray <FVector2D>> UVs_BoneAnim1;
+	TArray <TArray <FVector2D>> UVs_BoneAnim2;
+	TArray <TArray <FColor>> Colors_BoneAnim;
+	{
+		FScopedStageTimer Timer(Timings, TEXT("SkinnedMeshVATData"));
+		VATBakeStages::SkinnedMeshVATData(Components, Profile, UniqueSourceIDs, UVs_VertAnim, UVs_VertMirror, UVs_BoneAnim1, UVs_BoneAnim2, Colors_BoneAnim);
+	}
+
+	if ((Profile->CalcTotalRequiredHeight_Vert() > Profile->OverrideSize_Vert.Y) ||
+		(Profile->CalcTotalRequiredHeight_Bone() > Profile->OverrideSize_Bone.Y) ||
+		(Profile->OverrideSize_Vert.GetMax() > 4096) ||
+		(Profile->OverrideSize_Bone.GetMax() > 4096))
+	{
+		AddError(FString::Printf(TEXT("Case does not fit the texture limits, Vert %s Bone %s"),
+			*Profile->OverrideSize_Vert.ToString(), *Profile->OverrideSize_Bone.ToString()));
+		return false;
+	}
+
+	{
+		FScopedStageTimer Timer(Timings, TEXT("MeshBuild"));
+		StaticMesh = FVertexAnimUtils::ConvertMeshesToStaticMesh(
+			Components, FTransform::Identity, PackagePath + SkeletalMesh->GetName() + TEXT("_VAT"), false);
+
+		if (StaticMesh)
+		{
+			FVATMeshAttributes VATAttributes;
+			VATAttributes.AddUVChannel(Profile->UVChannel_VertAnim, UVs_VertAnim);
+			VATAttributes.AddUVChannel(Profile->UVChannel_BoneAnim, UVs_BoneAnim1);
+			VATAttributes.AddUVChannel(Profile->UVChannel_BoneAnim_Full, UVs_BoneAnim2);
+			VATAttributes.Colors = Colors_BoneAnim;
+			FVertexAnimUtils::VATAttributesToStaticMeshLODs(StaticMesh, VATAttributes);
+		}
+	}
+	TestNotNull(TEXT("Static mesh"), StaticMesh);
+
+	TArray <FVector4> VertPos, VertNormal, BonePos, BoneRot;
+	{
+		FScopedStageTimer Timer(Timings, TEXT("Sampling"));
+		TestTrue(TEXT("Sampling"), VATBakeStages::GatherAndBakeAllAnimVertData(Profile, PreviewComponent, Components, UniqueSourceIDs, VertPos, VertNormal, BonePos, BoneRot));
+	}
+
+	// The skinning kernel on its own, one clip worth of frames of the ref pose
+	{
+		FVATSkinBinding Binding;
+		{
+			FScopedStageTimer Timer(Timings, TEXT("SkinBinding"));
+			Binding.Initialize(SkeletalMesh, 0);
+		}
+		TestEqual(TEXT("Kernel verts"), Binding.NumVerts, (int32)SkeletalMesh->GetResourceForRendering()->LODRenderData[0].GetNumVertices());
+
+		TArray <TArray <FMatrix44f>> FrameRefToLocals;
+		FrameRefToLocals.SetNum(NumFrames_Vert);
+		PreviewComponent->CacheRefToLocalMatrices(FrameRefToLocals[0]);
+		for (int32 f = 1; f < NumFrames_Vert; f++) FrameRefToLocals[f] = FrameRefToLocals[0];
+
+		TArray <TArray <FFinalSkinVertex>> Frames;
+		FScopedStageTimer Timer(Timings, TEXT("SkinningKernel"));
+		FVATSkinningKernel::SkinFrames(Binding, FrameRefToLocals, Frames);
+	}
+
+	TestEqual(TEXT("Vert texels"), VertPos.Num(), Profile->OverrideSize_Vert.X * Profile->CalcTotalRequiredHeight_Vert());
+	TestEqual(TEXT("Bone texels"), BonePos.Num(), Profile->OverrideSize_Bone.X * (Profile->CalcTotalRequiredHeight_Bone() + 1));
+
+	auto EncodeAndSet = [&](const TCHAR* Suffix, const FIntPoint Size, TFunctionRef<void(TArray <FFloat16Color>&)> Encode)
+	{
+		TArray <FFloat16Color> Data;
+		Data.SetNumZeroed(Size.X * Size.Y);
+		Encode(Data);
+
+		FScopedStageTimer Timer(Timings, TEXT("SetTexture2"));
+		Textures.Add(VATBakeStages::SetTexture2(PreviewComponent->GetWorld(), PackagePath,
+			SkeletalMesh->GetName() + Suffix, nullptr, Size.X, Size.Y, Data, RF_Transient));
+	};
+
+	EncodeAndSet(TEXT("_Normals"), Profile->OverrideSize_Vert, [&](TArray <FFloat16Color>& Data)
+	{
+		FScopedStageTimer Timer(Timings, TEXT("EncodeData_Vec"));
+		VATBakeStages::EncodeData_Vec(VertNormal, 2.f, false, Data);
+	});
+	EncodeAndSet(TEXT("_Offsets"), Profile->OverrideSize_Vert, [&](TArray <FFloat16Color>& Data)
+	{
+		FScopedStageTimer Timer(Timings, TEXT("EncodeData_Vec"));
+		VATBakeStages::EncodeData_Vec(VertPos, Profile->MaxValueOffset_Vert, true, Data);
+	});
+	EncodeAndSet(TEXT("_BoneRot"), Profile->OverrideSize_Bone, [&](TArray <FFloat16Color>& Data)
+	{
+		FScopedStageTimer Timer(Timings, TEXT("EncodeData_Quat"));
+		VATBakeStages::EncodeData_Quat(true, BoneRot, Data);
+	});
+	EncodeAndSet(TEXT("_BonePos"), Profile->OverrideSize_Bone, [&](TArray <FFloat16Color>& Data)
+	{
+		FScopedStageTimer Timer(Timings, TEXT("EncodeData_Vec"));
+		VATBakeStages::EncodeData_Vec(BonePos, Profile->MaxValuePosition_Bone, true, Data);
+	});
+
+	for (const TPair <FString, double>& Stage : Timings.Stages)
+	{
+		AddInfo(FString::Printf(TEXT("%s: %s %.3f ms"), *CaseName(Case), *Stage.Key, Stage.Value * 1000.0));
+	}
+	TestTrue(TEXT("Write CSV"), Timings.WriteCSV(Case, SkeletalMesh->GetResourceForRendering()->LODRenderData[0].GetNumVertices()));
+
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,488 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATBakeCommandlet.h"
+
+#include "VATEditorUtils.h"
+#include "VATFrameSource.h"
+#include "VertexAnimProfile.h"
+
+#include "Animation/AnimationAsset.h"
+#include "Animation/DebugSkelMeshComponent.h"
+#include "Animation/Skeleton.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "FileHelpers.h"
+#include "GeometryCache.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "PreviewScene.h"
+#include "RenderingThread.h"
+#include "UObject/UnrealType.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogVATBake, Log, All);
+
+// One line per profile in the result files: Status \t ProfilePath \t Seconds \t Message
+static const TCHAR* ResultOK = TEXT("OK");
+static const TCHAR* ResultFailed = TEXT("FAILED");
+
+struct FVATBakeResult
+{
+	FString Profile;
+	bool bSucceeded = false;
+	int32 Attempts = 0;
+	double Seconds = 0.0;
+	FString Message;
+};
+
+static FString ResultLine(const bool bSucceeded, const FString& Profile, const double Seconds, const FString& Message)
+{
+	const FString CleanMessage = Message.Replace(TEXT("\t"), TEXT(" ")).Replace(TEXT("\n"), TEXT(" ")).Replace(TEXT("\r"), TEXT(""));
+	return FString::Printf(TEXT("%s\t%s\t%.3f\t%s\n"), bSucceeded ? ResultOK : ResultFailed, *Profile, Seconds, *CleanMessage);
+}
+
+static bool ParseResultLine(const FString& Line, FVATBakeResult& Out)
+{
+	TArray <FString> Fields;
+	Line.ParseIntoArray(Fields, TEXT("\t"), false);
+	if (Fields.Num() < 3) return false;
+
+	Out.bSucceeded = (Fields[0] == ResultOK);
+	Out.Profile = Fields[1];
+	Out.Seconds = FCString::Atod(*Fields[2]);
+	Out.Message = (Fields.Num() > 3) ? Fields[3] : FString();
+	return true;
+}
+
+// Mesh to bake from: the one the profile was last baked from, else the preview mesh of its first clip
+static USkeletalMesh* FindSourceMesh(UVertexAnimProfile* Profile)
+{
+	if (USkeletalMesh* SourceMesh = Profile->SourceMesh.LoadSynchronous())
+	{
+		return SourceMesh;
+	}
+
+	for (const TArray <FVASequenceData>* Anims : { &Profile->Anims_Vert, &Profile->Anims_Bone })
+	{
+		for (const FVASequenceData& Anim : *Anims)
+		{
+			if (!Anim.SequenceRef) continue;
+			if (USkeletalMesh* PreviewMesh = Anim.SequenceRef->GetPreviewMesh()) return PreviewMesh;
+			if (USkeleton* Skeleton = Anim.SequenceRef->GetSkeleton())
+			{
+				if (USkeletalMesh* PreviewMesh = Skeleton->GetPreviewMesh(true)) return PreviewMesh;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+// The profile and every asset it points to that the bake wrote: the static mesh and all the textures, SetTexture2 and
+// SetTextureRaw give each of them its own package
+static bool SaveBakedPackages(UVertexAnimProfile* Profile, FString& OutMessage)
+{
+	TArray <UPackage*> Packages;
+	Packages.Add(Profile->GetOutermost());
+	for (TFieldIterator<FObjectProperty> It(Profile->GetClass()); It; ++It)
+	{
+		const UObject* Asset = It->GetObjectPropertyValue_InContainer(Profile);
+		UPackage* Package = Asset ? Asset->GetOutermost() : nullptr;
+		if (Package && Package->IsDirty() && (Package != GetTransientPackage())) Packages.AddUnique(Package);
+	}
+
+	if (!UEditorLoadingAndSavingUtils::SavePackages(Packages, false))
+	{
+		OutMessage = TEXT("Failed to save packages");
+		return false;
+	}
+
+	return true;
+}
+
+static bool BakeProfileHeadless(const FString& ProfilePath, FString& OutMessage)
+{
+	UVertexAnimProfile* Profile = LoadObject<UVertexAnimProfile>(nullptr, *ProfilePath);
+	if (!Profile)
+	{
+		OutMessage = TEXT("Failed to load profile");
+		return false;
+	}
+
+	USkeletalMesh* SourceMesh = FindSourceMesh(Profile);
+	if (!SourceMesh)
+	{
+		OutMessage = TEXT("No source mesh, bake the profile once in the editor");
+		return false;
+	}
+
+	// Attachments only exist in an editor preview, headless bakes only see the source mesh
+	FPreviewScene PreviewScene(FPreviewScene::ConstructionValues().SetEditor(true));
+	UDebugSkelMeshComponent* PreviewComponent = NewObject<UDebugSkelMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+	PreviewComponent->SetSkeletalMesh(SourceMesh);
+	PreviewScene.AddComponent(PreviewComponent, FTransform::Identity);
+	FlushRenderingCommands();
+
+	FText Error;
+	const bool bBaked = FVATEditorUtils::BakeProfile(PreviewComponent, Profile, false, Error);
+
+	PreviewScene.RemoveComponent(PreviewComponent);
+
+	if (!bBaked)
+	{
+		OutMessage = Error.ToString();
+		return false;
+	}
+
+	return SaveBakedPackages(Profile, OutMessage);
+}
+
+// Vert anim bake of geometry caches, one clip per cache, into the profile and a static mesh at MeshPackageName
+// (next to the profile, named after the first cache, if empty)
+static bool BakeGeometryCachesHeadless(const FString& ProfilePath, const TArray <FString>& CachePaths, FString MeshPackageName, FString& OutMessage)
+{
+	UVertexAnimProfile* Profile = LoadObject<UVertexAnimProfile>(nullptr, *ProfilePath);
+	if (!Profile)
+	{
+		OutMessage = TEXT("Failed to load profile");
+		return false;
+	}
+
+	TArray <UGeometryCache*> Caches;
+	for (const FString& CachePath : CachePaths)
+	{
+		UGeometryCache* Cache = LoadObject<UGeometryCache>(nullptr, *CachePath);
+		if (!Cache)
+		{
+			OutMessage = FString::Printf(TEXT("Failed to load geometry cache %s"), *CachePath);
+			return false;
+		}
+		Caches.Add(Cache);
+	}
+	if (!Caches.Num())
+	{
+		OutMessage = TEXT("No geometry caches");
+		return false;
+	}
+
+	if (MeshPackageName.IsEmpty())
+	{
+		MeshPackageName = FPackageName::GetLongPackagePath(Profile->GetOutermost()->GetName()) / (Caches[0]->GetName() + TEXT("_VAT"));
+	}
+
+	FVATGeometryCacheFrameSource Source(Caches);
+	FText Error;
+	if (!FVATEditorUtils::BakeFrameSource(Source, Profile, MeshPackageName, Error))
+	{
+		OutMessage = Error.ToString();
+		return false;
+	}
+
+	return SaveBakedPackages(Profile, OutMessage);
+}
+
+UVATBakeCommandlet::UVATBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UVATBakeCommandlet::Main(const FString& Params)
+{
+	TArray <FString> Tokens;
+	TArray <FString> Switches;
+	TMap <FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	if (Switches.Contains(TEXT("Worker")))
+	{
+		return RunWorker(ParamVals);
+	}
+	if (ParamVals.Contains(TEXT("GeometryCaches")))
+	{
+		return RunGeometryCaches(ParamVals);
+	}
+	return RunCoordinator(ParamVals);
+}
+
+int32 UVATBakeCommandlet::RunGeometryCaches(const TMap<FString, FString>& ParamVals)
+{
+	const FString* Profile = ParamVals.Find(TEXT("Profiles"));
+	if (!Profile || Profile->Contains(TEXT("+")))
+	{
+		UE_LOG(LogVATBake, Error, TEXT("-GeometryCaches= bakes into one profile, give it with -Profiles="));
+		return 1;
+	}
+
+	TArray <FString> CachePaths;
+	ParamVals.FindChecked(TEXT("GeometryCaches")).ParseIntoArray(CachePaths, TEXT("+"), true);
+	const FString* MeshPackage = ParamVals.Find(TEXT("Mesh"));
+
+	const double StartTime = FPlatformTime::Seconds();
+	FString Message;
+	const bool bSucceeded = BakeGeometryCachesHeadless(*Profile, CachePaths, MeshPackage ? *MeshPackage : FString(), Message);
+
+	UE_LOG(LogVATBake, Display, TEXT("%s %s from %d geometry caches in %.1fs %s"),
+		bSucceeded ? ResultOK : ResultFailed, **Profile, CachePaths.Num(), FPlatformTime::Seconds() - StartTime, *Message);
+
+	return bSucceeded ? 0 : 1;
+}
+
+int32 UVATBakeCommandlet::RunWorker(const TMap<FString, FString>& ParamVals)
+{
+	const FString* ShardFile = ParamVals.Find(TEXT("Shard"));
+	const FString* ResultFile = ParamVals.Find(TEXT("Result"));
+	if (!ShardFile || !ResultFile)
+	{
+		UE_LOG(LogVATBake, Error, TEXT("Worker needs -Shard= and -Result="));
+		return 1;
+	}
+
+	TArray <FString> ProfilePaths;
+	if (!FFileHelper::LoadFileToStringArray(ProfilePaths, **ShardFile))
+	{
+		UE_LOG(LogVATBake, Error, TEXT("Failed to read shard %s"), **ShardFile);
+		return 1;
+	}
+
+	for (const FString& ProfilePath : ProfilePaths)
+	{
+		if (ProfilePath.IsEmpty()) continue;
+
+		const double StartTime = FPlatformTime::Seconds();
+		FString Message;
+		const bool bSucceeded = BakeProfileHeadless(ProfilePath, Message);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogVATBake, Display, TEXT("%s %s in %.1fs %s"), bSucceeded ? ResultOK : ResultFailed, *ProfilePath, Seconds, *Message);
+
+		// Written per profile, so the coordinator knows how far a crashed worker got
+		FFileHelper::SaveStringToFile(ResultLine(bSucceeded, ProfilePath, Seconds, Message), **ResultFile,
+			FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	return 0;
+}
+
+int32 UVATBakeCommandlet::RunCoordinator(const TMap<FString, FString>& ParamVals)
+{
+	auto IntParam = [&ParamVals](const TCHAR* Key, const int32 Default)
+	{
+		const FString* Value = ParamVals.Find(Key);
+		return Value ? FCString::Atoi(**Value) : Default;
+	};
+
+	const int32 NumWorkers = FMath::Max(0, IntParam(TEXT("Workers"), FMath::Max(1, FPlatformMisc::NumberOfCores() / 2)));
+	const int32 ShardSize = FMath::Max(1, IntParam(TEXT("ShardSize"), 4));
+	const int32 MaxRetries = FMath::Max(0, IntParam(TEXT("Retries"), 1));
+	const double ShardTimeout = IntParam(TEXT("ShardTimeout"), 0);
+
+	// Profiles to bake
+	TArray <FString> ProfilePaths;
+	if (const FString* Profiles = ParamVals.Find(TEXT("Profiles")))
+	{
+		Profiles->ParseIntoArray(ProfilePaths, TEXT("+"), true);
+	}
+	else
+	{
+		const FString* Path = ParamVals.Find(TEXT("Path"));
+
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		AssetRegistry.SearchAllAssets(true);
+
+		FARFilter Filter;
+		Filter.ClassPaths.Add(UVertexAnimProfile::StaticClass()->GetClassPathName());
+		Filter.PackagePaths.Add(FName(Path ? **Path : TEXT("/Game")));
+		Filter.bRecursivePaths = true;
+
+		TArray <FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		for (const FAssetData& Asset : Assets)
+		{
+			ProfilePaths.Add(Asset.ToSoftObjectPath().ToString());
+		}
+	}
+	ProfilePaths.Sort();
+
+	UE_LOG(LogVATBake, Display, TEXT("Baking %d profiles with %d workers"), ProfilePaths.Num(), NumWorkers);
+
+	TMap <FString, FVATBakeResult> Results;
+	for (const FString& ProfilePath : ProfilePaths)
+	{
+		Results.Add(ProfilePath).Profile = ProfilePath;
+	}
+
+	if (NumWorkers == 0)
+	{
+		for (const FString& ProfilePath : ProfilePaths)
+		{
+			FVATBakeResult& Result = Results[ProfilePath];
+			const double StartTime = FPlatformTime::Seconds();
+			Result.bSucceeded = BakeProfileHeadless(ProfilePath, Result.Message);
+			Result.Seconds = FPlatformTime::Seconds() - StartTime;
+			Result.Attempts = 1;
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+	}
+	else
+	{
+		const FString RunDir = FPaths::ConvertRelativePathToFull(
+			FPaths::ProjectSavedDir() / TEXT("VATBake") / FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+		IFileManager::Get().MakeDirectory(*RunDir, true);
+
+		struct FShard
+		{
+			TArray <FString> Profiles;
+			int32 Attempt = 0;
+		};
+
+		struct FWorker
+		{
+			FProcHandle Handle;
+			FShard Shard;
+			FString ResultFile;
+			double StartTime = 0.0;
+		};
+
+		// The queue, workers take the next shard when they finish so slow profiles don't hold up a whole static split
+		TArray <FShard> Pending;
+		for (int32 i = 0; i < ProfilePaths.Num(); i += ShardSize)
+		{
+			FShard& Shard = Pending.AddDefaulted_GetRef();
+			for (int32 j = i; j < FMath::Min(i + ShardSize, ProfilePaths.Num()); j++) Shard.Profiles.Add(ProfilePaths[j]);
+		}
+
+		const FString Executable = FPlatformProcess::ExecutablePath();
+		const FString ProjectFile = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+		int32 ShardCounter = 0;
+
+		TArray <FWorker> Workers;
+		while (Pending.Num() || Workers.Num())
+		{
+			// Fill free worker slots
+			while (Pending.Num() && (Workers.Num() < NumWorkers))
+			{
+				FWorker Worker;
+				Worker.Shard = Pending[0];
+				Pending.RemoveAt(0);
+
+				const FString ShardFile = RunDir / FString::Printf(TEXT("Shard_%04d.txt"), ShardCounter);
+				Worker.ResultFile = RunDir / FString::Printf(TEXT("Result_%04d.tsv"), ShardCounter);
+				ShardCounter++;
+				FFileHelper::SaveStringArrayToFile(Worker.Shard.Profiles, *ShardFile);
+
+				const FString Args = FString::Printf(
+					TEXT("\"%s\" -run=VATBake -Worker -Shard=\"%s\" -Result=\"%s\" -unattended -nosplash -nullrhi -nopause"),
+					*ProjectFile, *ShardFile, *Worker.ResultFile);
+
+				Worker.Handle = FPlatformProcess::CreateProc(*Executable, *Args, false, true, true, nullptr, 0, nullptr, nullptr);
+				Worker.StartTime = FPlatformTime::Seconds();
+				if (!Worker.Handle.IsValid())
+				{
+					UE_LOG(LogVATBake, Error, TEXT("Failed to launch a worker"));
+					Pending.Insert(Worker.Shard, 0);
+					break;
+				}
+				Workers.Add(MoveTemp(Worker));
+			}
+
+			if (!Workers.Num())
+			{
+				// Nothing could be launched, give up on what is left
+				for (const FShard& Shard : Pending)
+				{
+					for (const FString& ProfilePath : Shard.Profiles) Results[ProfilePath].Message = TEXT("No worker could be launched");
+				}
+				break;
+			}
+
+			FPlatformProcess::Sleep(0.5f);
+
+			for (int32 w = Workers.Num() - 1; w >= 0; w--)
+			{
+				FWorker& Worker = Workers[w];
+				if (FPlatformProcess::IsProcRunning(Worker.Handle))
+				{
+					if ((ShardTimeout <= 0.0) || (FPlatformTime::Seconds() - Worker.StartTime < ShardTimeout)) continue;
+					FPlatformProcess::TerminateProc(Worker.Handle, true);
+				}
+
+				int32 ReturnCode = -1;
+				FPlatformProcess::GetProcReturnCode(Worker.Handle, &ReturnCode);
+				FPlatformProcess::CloseProc(Worker.Handle);
+
+				TArray <FString> Lines;
+				FFileHelper::LoadFileToStringArray(Lines, *Worker.ResultFile);
+
+				TSet <FString> Reported;
+				FShard Retry;
+				Retry.Attempt = Worker.Shard.Attempt + 1;
+
+				for (const FString& Line : Lines)
+				{
+					FVATBakeResult Parsed;
+					if (!ParseResultLine(Line, Parsed) || !Results.Contains(Parsed.Profile)) continue;
+
+					FVATBakeResult& Result = Results[Parsed.Profile];
+					Result.bSucceeded = Parsed.bSucceeded;
+					Result.Seconds += Parsed.Seconds;
+					Result.Message = Parsed.Message;
+					Result.Attempts = Retry.Attempt;
+					Reported.Add(Parsed.Profile);
+
+					if (!Parsed.bSucceeded) Retry.Profiles.Add(Parsed.Profile);
+				}
+
+				// Profiles without a result line were not reached, the worker crashed or timed out
+				for (const FString& ProfilePath : Worker.Shard.Profiles)
+				{
+					if (Reported.Contains(ProfilePath)) continue;
+
+					FVATBakeResult& Result = Results[ProfilePath];
+					Result.bSucceeded = false;
+					Result.Attempts = Retry.Attempt;
+					Result.Message = FString::Printf(TEXT("Worker exited with code %d before baking it"), ReturnCode);
+					Retry.Profiles.Add(ProfilePath);
+				}
+
+				if (Retry.Profiles.Num() && (Worker.Shard.Attempt < MaxRetries))
+				{
+					UE_LOG(LogVATBake, Warning, TEXT("Retrying %d profiles (attempt %d)"), Retry.Profiles.Num(), Retry.Attempt + 1);
+					Pending.Add(Retry);
+				}
+
+				Workers.RemoveAt(w);
+			}
+		}
+	}
+
+	// Merged report
+	const FString* ReportParam = ParamVals.Find(TEXT("Report"));
+	const FString ReportFile = ReportParam ? *ReportParam :
+		FPaths::ProjectSavedDir() / TEXT("VATBake") / FString::Printf(TEXT("Report_%s.csv"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+
+	int32 NumFailed = 0;
+	FString Report = TEXT("Profile,Status,Attempts,Seconds,Message\n");
+	for (const FString& ProfilePath : ProfilePaths)
+	{
+		const FVATBakeResult& Result = Results[ProfilePath];
+		NumFailed += Result.bSucceeded ? 0 : 1;
+		Report += FString::Printf(TEXT("%s,%s,%d,%.3f,\"%s\"\n"), *Result.Profile, Result.bSucceeded ? ResultOK : ResultFailed,
+			Result.Attempts, Result.Seconds, *Result.Message.Replace(TEXT("\""), TEXT("'")));
+	}
+	FFileHelper::SaveStringToFile(Report, *ReportFile);
+
+	UE_LOG(LogVATBake, Display, TEXT("Baked %d of %d profiles, report: %s"), ProfilePaths.Num() - NumFailed, ProfilePaths.Num(), *ReportFile);
+
+	return NumFailed ? 1 : 0;
+}
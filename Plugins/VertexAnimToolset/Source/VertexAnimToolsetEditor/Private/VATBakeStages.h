@@ -0,0 +1,77 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GPUSkinPublicDefs.h"
+#include "SkeletalMeshTypes.h"
+#include "Engine/Texture.h"
+
+class UVertexAnimProfile;
+class UDebugSkelMeshComponent;
+class UMeshComponent;
+class UTexture2D;
+class FVATFrameSource;
+
+// The stages FVATEditorUtils::DoBakeProcess runs through, in order.
+// Declared here so the VAT.Bench automation tests and the frame sources can call them one by one.
+namespace VATBakeStages
+{
+	void MapSkinVerts(
+		UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
+		TArray <int32>& UniqueVertsSourceID, TArray <FVector2D>& OutUVSet_Vert);
+
+	void SkinnedMeshVATData(
+		const TArray <UMeshComponent*>& Components,
+		UVertexAnimProfile* InProfile,
+		TArray <TArray <int32>>& UniqueSourceIDs,
+		TArray <TArray <FVector2D>>& UVs_VertAnim,
+		TArray <TArray <FVector2D>>& UVs_VertMirror,
+		TArray <TArray <FVector2D>>& UVs_BoneAnim1,
+		TArray <TArray <FVector2D>>& UVs_BoneAnim2,
+		TArray <TArray <FColor>>& Colors_BoneAnim);
+
+	// Vertices of all baked components for one LOD in root space, with bCachedCPUSkin read from the CPU skinned components' cache
+	void MergedComponentVerts(
+		const TArray <UMeshComponent*>& Components, const int32 OverallLODIndex, const bool bCachedCPUSkin, TArray <FFinalSkinVertex>& OutVerts);
+
+	void ForceBakeLOD(UDebugSkelMeshComponent* PreviewComponent, const TArray <UMeshComponent*>& Components, const int32 OverallLODIndex);
+
+	// The vert anim sampling stage, any frame source. Returns false if a frame does not match the rest pose's vert count.
+	bool SampleVertAnimFrames(
+		UVertexAnimProfile* Profile,
+		FVATFrameSource& Source,
+		const TArray <TArray <int32>>& UniqueSourceIDs,
+		TArray <FVector4>& OutGridVertPos,
+		TArray <FVector4>& OutGridVertNormal,
+		float& OutMaxValueOffset);
+
+	// Returns false, with the components put back as they were, if the vert anim frames could not be sampled
+	bool GatherAndBakeAllAnimVertData(
+		UVertexAnimProfile* Profile,
+		UDebugSkelMeshComponent* PreviewComponent,
+		const TArray <UMeshComponent*>& Components,
+		const TArray <TArray <int32>>& UniqueSourceIDs,
+		TArray <FVector4>& OutGridVertPos,
+		TArray <FVector4>& OutGridVertNormal,
+		TArray <FVector4>& OutGridBonePos,
+		TArray <FVector4>& OutGridBoneRot);
+
+	void EncodeData_Vec(const TArray <FVector4>& VectorData, const float MaxValue, const bool HDR, TArray <FFloat16Color>& Data);
+
+	void EncodeData_Quat(const bool HD, const TArray <FVector4>& VectorData, TArray <FFloat16Color>& Data);
+
+	UTexture2D* SetTexture2(
+		UWorld* World, const FString PackagePath, const FString Name,
+		UTexture2D* Texture,
+		const int32 InSizeX, const int32 InSizeY,
+		const TArray <FFloat16Color>& Data,
+		EObjectFlags InObjectFlags);
+
+	UTexture2D* SetTextureRaw(
+		UWorld* World, const FString PackagePath, const FString Name,
+		UTexture2D* Texture,
+		const int32 InSizeX, const int32 InSizeY,
+		const void* RawData, const ETextureSourceFormat SourceFormat,
+		EObjectFlags InObjectFlags);
+}
@@ -0,0 +1,333 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+// VAT.Bake automation tests, small checks of the bake stages and the CPU samplers on hand made data.
+// Assets they bake go to /Temp/VATTests and are dropped at the end.
+// Run with: UnrealEditor-Cmd <Project> -nullrhi -unattended -ExecCmds="Automation RunTests VAT.Bake; Quit"
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "VATBakeStages.h"
+#include "VATEditorUtils.h"
+#include "VATFrameSource.h"
+#include "VertexAnimBoneSampler.h"
+#include "VertexAnimProfile.h"
+
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Misc/ScopeExit.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace VATBakeTests
+{
+	// Half float texels keep about 11 bits of the normalized values
+	static constexpr float PositionTolerance = 0.5f;
+	static constexpr float RotationTolerance = 0.01f;
+
+	// Same layout as the profile's CPU side data, raw half floats
+	static void StoreTexels(const TArray <FFloat16Color>& Data, TArray <uint16>& Out)
+	{
+		Out.SetNumUninitialized(Data.Num() * 4);
+		for (int32 i = 0; i < Data.Num(); i++)
+		{
+			Out[i * 4 + 0] = Data[i].R.Encoded;
+			Out[i * 4 + 1] = Data[i].G.Encoded;
+			Out[i * 4 + 2] = Data[i].B.Encoded;
+			Out[i * 4 + 3] = Data[i].A.Encoded;
+		}
+	}
+
+	// Encodes component space transforms laid out [Row * NumBones + Bone] into the profile's CPU bone data
+	static void SetBoneData(UVertexAnimProfile* Profile, const int32 NumBones, const TArray <FTransform>& Texels)
+	{
+		TArray <FVector4> Positions, Rotations;
+		float MaxValue = KINDA_SMALL_NUMBER;
+		for (const FTransform& Texel : Texels)
+		{
+			const FVector Position = Texel.GetTranslation();
+			const FQuat Rotation = Texel.GetRotation();
+			Positions.Add(FVector4(Position, 0.f));
+			Rotations.Add(FVector4(Rotation.X, Rotation.Y, Rotation.Z, Rotation.W));
+			MaxValue = FMath::Max(MaxValue, (float)Position.GetAbsMax());
+		}
+
+		Profile->OverrideSize_Bone = FIntPoint(NumBones, Texels.Num() / NumBones);
+		Profile->MaxValuePosition_Bone = MaxValue;
+
+		TArray <FFloat16Color> Data;
+		Data.SetNumZeroed(Texels.Num());
+		VATBakeStages::EncodeData_Vec(Positions, MaxValue, true, Data);
+		StoreTexels(Data, Profile->BonePosTextureData);
+		VATBakeStages::EncodeData_Quat(true, Rotations, Data);
+		StoreTexels(Data, Profile->BoneRotTextureData);
+	}
+
+	static void TestTransform(FAutomationTestBase& Test, const FString& What, const FTransform& Actual, const FTransform& Expected)
+	{
+		Test.TestTrue(What + TEXT(" position"), Actual.GetTranslation().Equals(Expected.GetTranslation(), PositionTolerance));
+		Test.TestTrue(What + TEXT(" rotation"), Actual.GetRotation().Equals(Expected.GetRotation(), RotationTolerance));
+	}
+
+	static const FString PackagePath = TEXT("/Temp/VATTests/");
+
+	static void ReleaseAsset(UObject* Asset)
+	{
+		if (!Asset) return;
+		Asset->ClearFlags(RF_Standalone | RF_Public);
+		Asset->MarkAsGarbage();
+	}
+
+	// Frames of clips made of the rest mesh only, the offset source replaces what they show
+	static TArray <TArray <UStaticMesh*>> RestMeshClips(UStaticMesh* RestMesh, const TArray <TArray <float>>& FrameOffsets)
+	{
+		TArray <TArray <UStaticMesh*>> ClipFrames;
+		for (const TArray <float>& ClipOffsets : FrameOffsets) ClipFrames.AddDefaulted_GetRef().Init(RestMesh, ClipOffsets.Num());
+		return ClipFrames;
+	}
+
+	// Flipbook of the rest mesh whose verts all move up by FrameOffsets[Clip][Frame], so every texel of a frame is known
+	class FOffsetFrameSource : public FVATStaticMeshFrameSource
+	{
+	public:
+		static constexpr float FramesPerSecond = 30.f;
+
+		FOffsetFrameSource(UStaticMesh* InRestMesh, const TArray <TArray <float>>& InFrameOffsets)
+			: FVATStaticMeshFrameSource(InRestMesh, RestMeshClips(InRestMesh, InFrameOffsets), FramesPerSecond)
+			, FrameOffsets(InFrameOffsets)
+		{
+		}
+
+		// Offsets that differ in every frame of every clip
+		static float FrameOffset(const int32 ClipIndex, const int32 Frame) { return (ClipIndex + 1) * 10.f + Frame; }
+
+		virtual bool GetFrameVerts(const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override
+		{
+			if (!GetRestVerts(LODIndex, OutVerts)) return false;
+
+			const float Offset = FrameOffsets[ClipIndex][FMath::RoundToInt(Time * FramesPerSecond)];
+			for (FFinalSkinVertex& Vert : OutVerts) Vert.Position.Z += Offset;
+			return true;
+		}
+
+	private:
+		TArray <TArray <float>> FrameOffsets;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVATBoneSamplerMirrorTest, "VAT.Bake.BoneSamplerMirror",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Mirrored sampling of a side bone pair (left and right of the mirror plane) and a center bone mirroring onto itself
+bool FVATBoneSamplerMirrorTest::RunTest(const FString& Parameters)
+{
+	using namespace VATBakeTests;
+
+	enum { Center, Left, Right, NumBones };
+	const EAxis::Type Axis = EAxis::X;
+
+	// Side bones are exact mirrors of each other in the ref pose, the center bone is tilted off the mirror plane
+	const FTransform RefLeft(FQuat(FVector(0.f, 0.f, 1.f), FMath::DegreesToRadians(30.f)), FVector(-20.f, 4.f, 120.f));
+	const FTransform RefPoses[NumBones] =
+	{
+		FTransform(FQuat(FVector(0.f, 1.f, 0.f), FMath::DegreesToRadians(20.f)), FVector(0.f, 0.f, 100.f)),
+		RefLeft,
+		FVertexAnimBoneSampler::MirrorTransform(RefLeft, Axis),
+	};
+	const FTransform RefToLocals[NumBones] =
+	{
+		FTransform(FQuat(FVector(1.f, 0.f, 0.f), FMath::DegreesToRadians(15.f)), FVector(2.f, -1.f, 3.f)),
+		FTransform(FQuat(FVector(1.f, 1.f, 0.f).GetSafeNormal(), FMath::DegreesToRadians(40.f)), FVector(5.f, 3.f, -2.f)),
+		FTransform(FQuat(FVector(0.f, 1.f, 1.f).GetSafeNormal(), FMath::DegreesToRadians(-25.f)), FVector(-1.f, 6.f, 4.f)),
+	};
+
+	UVertexAnimProfile* Profile = NewObject<UVertexAnimProfile>(GetTransientPackage(), NAME_None, RF_Transient);
+	Profile->BakeMirrorMaps = true;
+	Profile->MirrorAxis = Axis;
+	Profile->MirrorBones = { Center, Right, Left };
+
+	// Row 0 the ref pose, row 1 the only frame of the clip
+	FVASequenceData& Anim = Profile->Anims_Bone.AddDefaulted_GetRef();
+	Anim.NumFrames = 1;
+	Anim.AnimStart_Generated = 1;
+	Anim.Speed_Generated = 1.f;
+
+	TArray <FTransform> Texels;
+	Texels.Append(RefPoses, NumBones);
+	Texels.Append(RefToLocals, NumBones);
+	SetBoneData(Profile, NumBones, Texels);
+
+	FVertexAnimBoneSampler Sampler;
+	if (!TestTrue(TEXT("Sampler initialized"), Sampler.Initialize(Profile) && Sampler.CanMirror()))
+	{
+		return false;
+	}
+
+	const TArray <int32> Bones = { Center, Left, Right };
+	TArray <FTransform> Plain, Mirrored;
+	Plain.SetNum(NumBones);
+	Mirrored.SetNum(NumBones);
+	Sampler.SampleBoneTransforms(0, 0.f, Bones, Plain, false);
+	Sampler.SampleBoneTransforms(0, 0.f, Bones, Mirrored, true);
+
+	const TCHAR* Names[NumBones] = { TEXT("Center"), TEXT("Left"), TEXT("Right") };
+	const int32 MirrorOf[NumBones] = { Center, Right, Left };
+	for (int32 b = 0; b < NumBones; b++)
+	{
+		TestTransform(*this, FString::Printf(TEXT("%s plain"), Names[b]), Plain[b], RefPoses[b] * RefToLocals[b]);
+
+		// What the material does: the bone's own ref pose, then its mirror bone's ref to local reflected
+		TestTransform(*this, FString::Printf(TEXT("%s mirrored"), Names[b]), Mirrored[b],
+			RefPoses[b] * FVertexAnimBoneSampler::MirrorTransform(RefToLocals[MirrorOf[b]], Axis));
+	}
+
+	// With a symmetric ref pose each side bone ends up where its mirror bone was, reflected
+	TestTransform(*this, TEXT("Right mirrored onto Left"), Mirrored[Right], FVertexAnimBoneSampler::MirrorTransform(Plain[Left], Axis));
+	TestTransform(*this, TEXT("Left mirrored onto Right"), Mirrored[Left], FVertexAnimBoneSampler::MirrorTransform(Plain[Right], Axis));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVATFrameSourceBakeTest, "VAT.Bake.FrameSource",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// FVATEditorUtils::BakeFrameSource on two short clips, every vert's texel in every frame row of the offsets texture
+bool FVATFrameSourceBakeTest::RunTest(const FString& Parameters)
+{
+	using namespace VATBakeTests;
+
+	UStaticMesh* RestMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Plane.Plane"));
+	if (!TestNotNull(TEXT("Rest mesh"), RestMesh))
+	{
+		return false;
+	}
+
+	const int32 ClipNumFrames[] = { 4, 3 };
+	TArray <TArray <float>> FrameOffsets;
+	for (int32 c = 0; c < (int32)UE_ARRAY_COUNT(ClipNumFrames); c++)
+	{
+		TArray <float>& ClipOffsets = FrameOffsets.AddDefaulted_GetRef();
+		for (int32 f = 0; f < ClipNumFrames[c]; f++) ClipOffsets.Add(FOffsetFrameSource::FrameOffset(c, f));
+	}
+	FOffsetFrameSource Source(RestMesh, FrameOffsets);
+
+	UPackage* Package = CreatePackage(*(PackagePath + TEXT("VAP_FrameSource")));
+	UVertexAnimProfile* Profile = NewObject<UVertexAnimProfile>(Package, TEXT("VAP_FrameSource"), RF_Transient);
+	Profile->AutoSize = true;
+	Profile->CPUVertSampling = true;
+	Profile->DeduplicateFrames = false;
+	Profile->TexelFormat_Vert = EVATTexelFormat::Float16;
+
+	FText Error;
+	const bool bBaked = FVATEditorUtils::BakeFrameSource(Source, Profile, PackagePath + TEXT("SM_FrameSource_VAT"), Error);
+
+	// Generated assets live in /Temp, drop them so repeated runs don't pile up
+	ON_SCOPE_EXIT
+	{
+		ReleaseAsset(Profile->StaticMesh);
+		ReleaseAsset(Profile->OffsetsTexture);
+		ReleaseAsset(Profile->NormalsTexture);
+		ReleaseAsset(Profile->RangesTexture);
+	};
+
+	if (!TestTrue(FString::Printf(TEXT("Baked %s"), *Error.ToString()), bBaked))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Clips"), Profile->Anims_Vert.Num(), (int32)UE_ARRAY_COUNT(ClipNumFrames));
+	TestEqual(TEXT("Max offset"), Profile->MaxValueOffset_Vert, FOffsetFrameSource::FrameOffset(1, ClipNumFrames[1] - 1), 0.01f);
+
+	UTexture2D* Offsets = Profile->OffsetsTexture;
+	if (!TestNotNull(TEXT("Offsets texture"), Offsets) || !TestNotNull(TEXT("Static mesh"), Profile->StaticMesh))
+	{
+		return false;
+	}
+
+	const int32 Width = Profile->OverrideSize_Vert.X;
+	const int32 NumUniqueVerts = Profile->RestPositions_Vert.Num();
+	TestTrue(TEXT("Unique verts fit a frame"), (NumUniqueVerts > 0) && (NumUniqueVerts <= Width * Profile->RowsPerFrame_Vert));
+	TestEqual(TEXT("Offsets width"), (int32)Offsets->Source.GetSizeX(), Width);
+	TestEqual(TEXT("Offsets height"), (int32)Offsets->Source.GetSizeY(), Profile->OverrideSize_Vert.Y);
+	if (!TestTrue(TEXT("Offsets are half floats"), Offsets->Source.GetFormat() == TSF_RGBA16F))
+	{
+		return false;
+	}
+
+	const int32 TotalFrames = Profile->CalcTotalNumOfFrames_Vert();
+	const FFloat16Color* Texels = (const FFloat16Color*)Offsets->Source.LockMip(0);
+	for (int32 c = 0; c < Profile->Anims_Vert.Num(); c++)
+	{
+		TestEqual(FString::Printf(TEXT("Clip %d frames"), c), Profile->Anims_Vert[c].NumFrames, ClipNumFrames[c]);
+
+		for (int32 f = 0; f < Profile->Anims_Vert[c].NumFrames; f++)
+		{
+			const int32 Frame = Profile->Anims_Vert[c].AnimStart_Generated / Profile->RowsPerFrame_Vert + f;
+			const FVector3f Expected(0.f, 0.f, FOffsetFrameSource::FrameOffset(c, f));
+
+			int32 NumWrong = 0;
+			for (int32 k = 0; k < NumUniqueVerts; k++)
+			{
+				const FIntPoint Texel = UVertexAnimProfile::CalcVertTexel(Profile->Layout_Vert, Width, Profile->RowsPerFrame_Vert, TotalFrames, k, Frame);
+				const FVector3f Offset = FVertexAnimBoneSampler::DecodeVectorHDR(Texels[Texel.Y * Width + Texel.X], Profile->MaxValueOffset_Vert);
+				if (!Offset.Equals(Expected, 0.05f)) NumWrong++;
+			}
+			TestEqual(FString::Printf(TEXT("Clip %d frame %d wrong texels"), c, f), NumWrong, 0);
+		}
+	}
+	Offsets->Source.UnlockMip(0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVATDeduplicateStraddleTest, "VAT.Bake.DeduplicateStraddle",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Frame de-duplication of two one frame clips within DeduplicateTolerance of each other, on either side of a boundary
+// of the 2 * DeduplicateTolerance grid, and of a third clip just out of tolerance
+bool FVATDeduplicateStraddleTest::RunTest(const FString& Parameters)
+{
+	using namespace VATBakeTests;
+
+	UStaticMesh* RestMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Plane.Plane"));
+	if (!TestNotNull(TEXT("Rest mesh"), RestMesh))
+	{
+		return false;
+	}
+
+	// 0.02 apart, either side of the 1.05 boundary of a 2 * Tolerance grid over the offset
+	const float Tolerance = 0.05f;
+	FOffsetFrameSource Source(RestMesh, { { 1.04f }, { 1.06f }, { 1.12f } });
+
+	UPackage* Package = CreatePackage(*(PackagePath + TEXT("VAP_DeduplicateStraddle")));
+	UVertexAnimProfile* Profile = NewObject<UVertexAnimProfile>(Package, TEXT("VAP_DeduplicateStraddle"), RF_Transient);
+	Profile->AutoSize = true;
+	Profile->DeduplicateFrames = true;
+	Profile->DeduplicateTolerance = Tolerance;
+	Profile->TexelFormat_Vert = EVATTexelFormat::Float16;
+
+	FText Error;
+	const bool bBaked = FVATEditorUtils::BakeFrameSource(Source, Profile, PackagePath + TEXT("SM_DeduplicateStraddle_VAT"), Error);
+
+	ON_SCOPE_EXIT
+	{
+		ReleaseAsset(Profile->StaticMesh);
+		ReleaseAsset(Profile->OffsetsTexture);
+		ReleaseAsset(Profile->NormalsTexture);
+		ReleaseAsset(Profile->RangesTexture);
+	};
+
+	if (!TestTrue(FString::Printf(TEXT("Baked %s"), *Error.ToString()), bBaked) || !TestEqual(TEXT("Clips"), Profile->Anims_Vert.Num(), 3))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Straddling frames share a row"), Profile->Anims_Vert[1].AnimStart_Generated, Profile->Anims_Vert[0].AnimStart_Generated);
+	TestNotEqual(TEXT("Frame out of tolerance keeps its row"), Profile->Anims_Vert[2].AnimStart_Generated, Profile->Anims_Vert[0].AnimStart_Generated);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,358 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+// VAT.Bench.Crowd automation tests, play 1k / 10k / 50k agents of a baked profile on a UVertexAnimCrowdComponent
+// in a transient test map and step it a fixed number of frames at a fixed delta time.
+// CPU cost only:	UnrealEditor-Cmd <Project> -nullrhi -unattended -ExecCmds="Automation RunTests VAT.Bench.Crowd; Quit"
+// With rendering:	UnrealEditor <Project> -unattended -ExecCmds="Automation RunTests VAT.Bench.Crowd; Quit"
+// -VATCrowdProfile=<Object path> picks the profile, the mannequin one by default.
+// Every case runs under a CSV profiler capture (Saved/Profiling/CSV) with the VATCrowd and VATCrowdBench stats next to the engine's
+// frame, thread and memory stats, and appends its summary to Saved/Automation/VATBench/VATCrowdBench.csv
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "VertexAnimCrowdComponent.h"
+#include "VertexAnimProfile.h"
+
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Tests/AutomationCommon.h"
+#include "DynamicRHI.h"
+#include "RenderCore.h"
+#include "RenderingThread.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "UObject/UObjectGlobals.h"
+
+CSV_DEFINE_CATEGORY(VATCrowdBench, true);
+
+namespace VATCrowdBench
+{
+	static const TCHAR* DefaultProfile = TEXT("/Game/Developers/Github_Rexocrates/VertexAnimMannequin/MannequinVAP.MannequinVAP");
+
+	static const int32 Cases[] = { 1000, 10000, 50000 };
+
+	// Fixed steps so every run plays the same anim times
+	static constexpr float DeltaTime = 1.f / 30.f;
+	static constexpr int32 NumWarmupFrames = 30;
+	static constexpr int32 NumFrames = 300;
+
+	// Agents are laid out on a square grid, the view looks over it from a corner so the update tiers see near and far agents
+	static constexpr float AgentSpacing = 200.f;
+	// Share of the agents cross fading to another clip every frame, what keeps the custom data rewrites and uploads busy
+	static constexpr float CrossFadeShare = 0.01f;
+	static constexpr float CrossFadeDuration = 0.25f;
+	static constexpr int32 RandomSeed = 0x5A7C;
+
+	static constexpr int32 CaptureSizeX = 1280;
+	static constexpr int32 CaptureSizeY = 720;
+
+	static FString CaseName(const int32 NumAgents)
+	{
+		return FString::Printf(TEXT("%dk Agents"), NumAgents / 1000);
+	}
+
+	static double Percentile(TArray <double> Values, const float Alpha)
+	{
+		if (!Values.Num()) return 0.0;
+		Values.Sort();
+		return Values[FMath::Clamp(FMath::CeilToInt(Alpha * Values.Num()) - 1, 0, Values.Num() - 1)];
+	}
+
+	static double Mean(const TArray <double>& Values)
+	{
+		double Sum = 0.0;
+		for (const double Value : Values) Sum += Value;
+		return Values.Num() ? Sum / Values.Num() : 0.0;
+	}
+
+	// State of one case, stepped a frame per engine tick by FVATCrowdBenchFrame so the CSV profiler sees real frames
+	struct FRun
+	{
+		FAutomationTestBase* Test = nullptr;
+		int32 NumAgents = 0;
+		UVertexAnimProfile* Profile = NULL;
+		bool bBoneClips = false;
+
+		UWorld* World = NULL;
+		UVertexAnimCrowdComponent* Crowd = NULL;
+		USceneCaptureComponent2D* Capture = NULL;
+		FVector ViewLocation = FVector::ZeroVector;
+		FRandomStream Random;
+
+		int32 Frame = 0;
+		bool bCsvCapture = false;
+		uint64 StartUsedPhysical = 0;
+
+		// Per measured frame
+		TArray <double> GameThreadMs;
+		TArray <double> RenderThreadMs;
+		TArray <double> UploadBytes;
+
+		bool Setup()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("VATCrowdBench"));
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+
+			AActor* Actor = World->SpawnActor<AActor>();
+			Crowd = NewObject<UVertexAnimCrowdComponent>(Actor);
+			Actor->SetRootComponent(Crowd);
+			Crowd->SetProfile(Profile, bBoneClips);
+			Crowd->RegisterComponent();
+
+			const int32 NumClips = bBoneClips ? Profile->Anims_Bone.Num() : Profile->Anims_Vert.Num();
+			const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)NumAgents));
+			Random.Initialize(RandomSeed);
+			for (int32 i = 0; i < NumAgents; i++)
+			{
+				const FVector Location((i % GridSize) * AgentSpacing, (i / GridSize) * AgentSpacing, 0.f);
+				const FRotator Rotation(0.f, Random.FRandRange(0.f, 360.f), 0.f);
+				Crowd->AddAgent(FTransform(Rotation, Location), i % NumClips, Random.FRandRange(0.8f, 1.2f), true, Random.FRandRange(0.f, 1.f));
+			}
+
+			const float GridExtent = GridSize * AgentSpacing;
+			ViewLocation = FVector(-0.1f * GridExtent, -0.1f * GridExtent, 0.1f * GridExtent + 500.f);
+
+			// Without an RHI nothing renders, the update still sees the same view so the tiers match between both runs
+			if (FApp::CanEverRender())
+			{
+				UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>(Actor);
+				RenderTarget->InitAutoFormat(CaptureSizeX, CaptureSizeY);
+				RenderTarget->UpdateResourceImmediate(true);
+
+				Capture = NewObject<USceneCaptureComponent2D>(Actor);
+				Capture->bCaptureEveryFrame = false;
+				Capture->bCaptureOnMovement = false;
+				Capture->TextureTarget = RenderTarget;
+				Capture->SetupAttachment(Crowd);
+				Capture->RegisterComponent();
+				Capture->SetWorldLocationAndRotation(ViewLocation,
+					(FVector(0.5f * GridExtent, 0.5f * GridExtent, 0.f) - ViewLocation).Rotation());
+			}
+
+			if (!Crowd->GetStaticMesh())
+			{
+				DestroyWorld();
+				return false;
+			}
+
+			FlushRenderingCommands();
+			StartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+			return true;
+		}
+
+		void DestroyWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+			World = NULL;
+			Crowd = NULL;
+			Capture = NULL;
+		}
+
+		// Cross fades a fixed share of random agents to a random clip
+		void CrossFadeAgents()
+		{
+			const int32 NumClips = bBoneClips ? Profile->Anims_Bone.Num() : Profile->Anims_Vert.Num();
+			const int32 NumFades = FMath::Max(1, FMath::RoundToInt(NumAgents * CrossFadeShare));
+
+			TArray <int32> Agents;
+			Agents.SetNumUninitialized(NumFades);
+			for (int32& Agent : Agents) Agent = Random.RandHelper(NumAgents);
+			Crowd->SetAgentsClip(Agents, Random.RandHelper(NumClips), 1.f, true, 0.f, CrossFadeDuration);
+		}
+
+		// One frame, true once the case is done
+		bool Step()
+		{
+			const bool bMeasured = Frame >= NumWarmupFrames;
+
+#if CSV_PROFILER
+			// The capture starts with the next engine frame, the first measured one
+			if ((Frame == NumWarmupFrames - 1) && !FCsvProfiler::Get()->IsCapturing())
+			{
+				CSV_METADATA(TEXT("VATCrowdAgents"), *FString::FromInt(NumAgents));
+				CSV_METADATA(TEXT("VATCrowdProfile"), *Profile->GetPathName());
+				FCsvProfiler::Get()->BeginCapture(-1, FString(), FString::Printf(TEXT("VATCrowdBench_%d"), NumAgents));
+				bCsvCapture = true;
+			}
+#endif
+
+			// Render thread time of the last finished engine frame, the one that rendered the previous step
+			if (bMeasured && (Frame > NumWarmupFrames))
+			{
+				RenderThreadMs.Add(FPlatformTime::ToMilliseconds(GRenderThreadTime));
+			}
+
+			World->ViewLocationsRenderedLastFrame.Reset();
+			World->ViewLocationsRenderedLastFrame.Add(ViewLocation);
+
+			const double StartTime = FPlatformTime::Seconds();
+			{
+				CSV_SCOPED_TIMING_STAT(VATCrowdBench, Step);
+				CrossFadeAgents();
+				World->Tick(LEVELTICK_All, DeltaTime);
+			}
+			const double GameThreadTime = FPlatformTime::Seconds() - StartTime;
+
+			if (Capture)
+			{
+				Capture->CaptureScene();
+			}
+
+			if (bMeasured)
+			{
+				GameThreadMs.Add(GameThreadTime * 1000.0);
+				UploadBytes.Add((double)Crowd->GetLastUploadBytes());
+				CSV_CUSTOM_STAT(VATCrowdBench, CrowdMemoryKB, (float)(Crowd->GetResourceSizeBytes(EResourceSizeMode::Exclusive) / 1024.0), ECsvCustomStatOp::Set);
+			}
+
+			Frame++;
+			if (Frame < NumWarmupFrames + NumFrames) return false;
+
+			Finish();
+			return true;
+		}
+
+		void Finish()
+		{
+			FlushRenderingCommands();
+
+#if CSV_PROFILER
+			if (bCsvCapture)
+			{
+				FCsvProfiler::Get()->EndCapture();
+			}
+#endif
+
+			const double CrowdMemoryBytes = (double)Crowd->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			const double UsedPhysicalDelta = (double)FPlatformMemory::GetStats().UsedPhysical - (double)StartUsedPhysical;
+
+			TArray <TPair <FString, double>> Stats;
+			Stats.Emplace(TEXT("GameThreadMs_Mean"), Mean(GameThreadMs));
+			Stats.Emplace(TEXT("GameThreadMs_P95"), Percentile(GameThreadMs, 0.95f));
+			Stats.Emplace(TEXT("RenderThreadMs_Mean"), Mean(RenderThreadMs));
+			Stats.Emplace(TEXT("RenderThreadMs_P95"), Percentile(RenderThreadMs, 0.95f));
+			Stats.Emplace(TEXT("UploadBytes_Mean"), Mean(UploadBytes));
+			Stats.Emplace(TEXT("UploadBytes_Max"), Percentile(UploadBytes, 1.f));
+			Stats.Emplace(TEXT("CrowdMemoryBytes"), CrowdMemoryBytes);
+			Stats.Emplace(TEXT("UsedPhysicalDeltaBytes"), UsedPhysicalDelta);
+
+			for (const TPair <FString, double>& Stat : Stats)
+			{
+				Test->AddInfo(FString::Printf(TEXT("%s: %s %.3f"), *CaseName(NumAgents), *Stat.Key, Stat.Value));
+			}
+			Test->TestTrue(TEXT("Write CSV"), WriteCSV(Stats));
+
+			// Agents have to have played, or the timings measured nothing
+			float MaxAnimTime = 0.f;
+			for (const float AnimTime : Crowd->GetAgentAnimTimes()) MaxAnimTime = FMath::Max(MaxAnimTime, AnimTime);
+			Test->TestTrue(TEXT("Agents played"), MaxAnimTime > 0.f);
+
+			DestroyWorld();
+		}
+
+		bool WriteCSV(const TArray <TPair <FString, double>>& Stats) const
+		{
+			const FString CSVPath = FPaths::ProjectSavedDir() / TEXT("Automation/VATBench/VATCrowdBench.csv");
+
+			FString Out;
+			if (!IFileManager::Get().FileExists(*CSVPath))
+			{
+				Out += TEXT("Timestamp,BuildVersion,RHI,Profile,Agents,Frames,Stat,Value\n");
+			}
+
+			const FString Timestamp = FDateTime::UtcNow().ToIso8601();
+			const TCHAR* RHIName = GDynamicRHI ? GDynamicRHI->GetName() : TEXT("None");
+			for (const TPair <FString, double>& Stat : Stats)
+			{
+				Out += FString::Printf(TEXT("%s,%s,%s,%s,%d,%d,%s,%.3f\n"),
+					*Timestamp, FApp::GetBuildVersion(), RHIName, *Profile->GetName(), NumAgents, NumFrames, *Stat.Key, Stat.Value);
+			}
+
+			return FFileHelper::SaveStringToFile(Out, *CSVPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+				&IFileManager::Get(), FILEWRITE_Append);
+		}
+	};
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FVATCrowdBenchFrame, TSharedRef<VATCrowdBench::FRun>, Run);
+
+bool FVATCrowdBenchFrame::Update()
+{
+	return Run->Step();
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FVATCrowdBenchmark, "VAT.Bench.Crowd",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FVATCrowdBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (int32 i = 0; i < UE_ARRAY_COUNT(VATCrowdBench::Cases); i++)
+	{
+		OutBeautifiedNames.Add(VATCrowdBench::CaseName(VATCrowdBench::Cases[i]));
+		OutTestCommands.Add(FString::FromInt(i));
+	}
+}
+
+bool FVATCrowdBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace VATCrowdBench;
+
+	const int32 CaseIndex = FCString::Atoi(*Parameters);
+	if ((CaseIndex < 0) || (CaseIndex >= UE_ARRAY_COUNT(Cases)))
+	{
+		AddError(FString::Printf(TEXT("Unknown VAT.Bench.Crowd case %s"), *Parameters));
+		return false;
+	}
+
+	FString ProfilePath = DefaultProfile;
+	FParse::Value(FCommandLine::Get(), TEXT("VATCrowdProfile="), ProfilePath);
+
+	UVertexAnimProfile* Profile = LoadObject<UVertexAnimProfile>(nullptr, *ProfilePath);
+	if (!Profile)
+	{
+		AddError(FString::Printf(TEXT("Failed to load profile %s"), *ProfilePath));
+		return false;
+	}
+	if (!Profile->StaticMesh || (!Profile->Anims_Vert.Num() && !Profile->Anims_Bone.Num()))
+	{
+		AddError(FString::Printf(TEXT("Profile %s is not baked"), *ProfilePath));
+		return false;
+	}
+
+	TSharedRef<FRun> Run = MakeShared<FRun>();
+	Run->Test = this;
+	Run->NumAgents = Cases[CaseIndex];
+	Run->Profile = Profile;
+	Run->bBoneClips = !Profile->Anims_Vert.Num();
+
+	if (!Run->Setup())
+	{
+		AddError(TEXT("Failed to set up the crowd test map"));
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FVATCrowdBenchFrame(Run));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
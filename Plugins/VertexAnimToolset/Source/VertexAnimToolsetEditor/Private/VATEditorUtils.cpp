@@ -66,6 +66,8 @@
 #include "ShaderCore.h"
 
 #include "VertexAnimUtils.h"
+#include "VATBakeStages.h"
+#include "VATFrameSource.h"
 
 #include "Animation/AnimSequence.h"
 
@@ -100,19 +102,23 @@
 #include "AnimationRuntime.h"
 
 #include "Animation/AnimSingleNodeInstance.h"
+#include "Animation/AnimNotifies/AnimNotify.h"
+#include "Animation/AnimNotifies/AnimNotifyState.h"
 
 #include "MeshDescription.h"
+#include "StaticMeshAttributes.h"
 
 #define LOCTEXT_NAMESPACE "VATEditorUtils"
 
 
-static void MapSkinVerts(
-	UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
-	TArray <int32>& UniqueVertsSourceID, TArray <FVector2D>& OutUVSet_Vert)
+// Index of every vert into the unique verts, and the source vert of every unique vert
+static void FindUniqueSkinVerts(
+	const UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
+	TArray <int32>& OutUniqueID, TArray <int32>& OutUniqueVertsSourceID)
 {
 	TArray <FVector> UniqueVerts;
-	TArray <int32> UniqueID;
-	UniqueID.SetNumZeroed(SkinVerts.Num());
+	OutUniqueID.SetNumZeroed(SkinVerts.Num());
+	OutUniqueVertsSourceID.Reset();
 
 	for (int32 i = 0; i < SkinVerts.Num(); i++)
 	{
@@ -122,29 +128,46 @@ static void MapSkinVerts(
 		{
 			if (UniqueVerts.Find(FVector{ FVector{ SkinVerts[i].Position } }, ID))
 			{
-				UniqueID[i] = ID;
+				OutUniqueID[i] = ID;
 			}
 			else
 			{
-				UniqueID[i] = UniqueVerts.Num();
+				OutUniqueID[i] = UniqueVerts.Num();
 				UniqueVerts.Add(FVector{ SkinVerts[i].Position });
-				UniqueVertsSourceID.Add(i);
+				OutUniqueVertsSourceID.Add(i);
 			}
 		}
 		else
 		{
-			UniqueID[i] = UniqueVerts.Num();
+			OutUniqueID[i] = UniqueVerts.Num();
 			UniqueVerts.Add(FVector{ SkinVerts[i].Position });
-			UniqueVertsSourceID.Add(i);
+			OutUniqueVertsSourceID.Add(i);
 		}
 	}
+}
 
+static FVector2D VertGridUV(const UVertexAnimProfile* InProfile, const int32 TexelIndex)
+{
+	// I SWITCHED THESE to have the UVs lined horizontally.
+	const int32 GridX = TexelIndex % InProfile->OverrideSize_Vert.X;
+	const int32 GridY = TexelIndex / InProfile->OverrideSize_Vert.X;
+	return FVector2D(GridX * (1.f / InProfile->OverrideSize_Vert.X), GridY * (1.f / InProfile->OverrideSize_Vert.Y));
+}
+
+void VATBakeStages::MapSkinVerts(
+	UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
+	TArray <int32>& UniqueVertsSourceID, TArray <FVector2D>& OutUVSet_Vert)
+{
+	TArray <int32> UniqueID;
+	FindUniqueSkinVerts(InProfile, SkinVerts, UniqueID, UniqueVertsSourceID);
+	const int32 NumUniqueVerts = UniqueVertsSourceID.Num();
 
+	InProfile->LODRowOffset_Vert.Empty();
 
 	if (InProfile->AutoSize)
 	{
-		int32 XSize = FMath::Min(InProfile->MaxWidth, (int32)FMath::RoundUpToPowerOfTwo(UniqueVerts.Num()));
-		InProfile->RowsPerFrame_Vert = FMath::CeilToInt((float)(UniqueVerts.Num()) / (float)(XSize));
+		int32 XSize = FMath::Min(InProfile->MaxWidth, (int32)FMath::RoundUpToPowerOfTwo(NumUniqueVerts));
+		InProfile->RowsPerFrame_Vert = FMath::CeilToInt((float)(NumUniqueVerts) / (float)(XSize));
 		InProfile->OverrideSize_Vert = FIntPoint(
 			XSize,
 			FMath::RoundUpToPowerOfTwo(InProfile->CalcTotalRequiredHeight_Vert()));
@@ -152,39 +175,535 @@ static void MapSkinVerts(
 	else
 	{
 		InProfile->RowsPerFrame_Vert = //FMath::CeilToInt((float)(UniqueVerts.Num()) / (float)(InProfile->OverrideSize.X));
-			FMath::RoundUpToPowerOfTwo((float)(UniqueVerts.Num()) / (float)(InProfile->OverrideSize_Vert.X));
+			FMath::RoundUpToPowerOfTwo((float)(NumUniqueVerts) / (float)(InProfile->OverrideSize_Vert.X));
+	}
+
+	OutUVSet_Vert.SetNum(SkinVerts.Num());
+	for (int32 i = 0; i < SkinVerts.Num(); i++)
+	{
+		OutUVSet_Vert[i] = VertGridUV(InProfile, UniqueID[i]);
+	}
+};
+
+// PerLODRows_Vert version of MapSkinVerts, every LOD gets its own rows inside the frame, starting at LODRowOffset_Vert[LOD]
+static void MapSkinVertsPerLOD(
+	UVertexAnimProfile* InProfile, const TArray <TArray <FFinalSkinVertex>>& LODSkinVerts,
+	TArray <TArray <int32>>& OutUniqueVertsSourceIDs, TArray <TArray <FVector2D>>& OutUVSets_Vert)
+{
+	const int32 NumLODs = LODSkinVerts.Num();
+
+	TArray <TArray <int32>> UniqueIDs;
+	UniqueIDs.SetNum(NumLODs);
+	OutUniqueVertsSourceIDs.SetNum(NumLODs);
+	for (int32 LOD = 0; LOD < NumLODs; LOD++)
+	{
+		FindUniqueSkinVerts(InProfile, LODSkinVerts[LOD], UniqueIDs[LOD], OutUniqueVertsSourceIDs[LOD]);
 	}
 
-	const float XStep = 1.f / InProfile->OverrideSize_Vert.X;
-	const float YStep = 1.f / InProfile->OverrideSize_Vert.Y;
-	const FVector2D HalfStep = FVector2D(XStep, YStep) / 2;
-	TArray <FVector2D> UniqueMappedUVs;
-	UniqueMappedUVs.SetNum(UniqueVerts.Num());
+	// LOD0 has the most verts, it decides the width
+	const int32 XSize = InProfile->AutoSize ?
+		FMath::Min(InProfile->MaxWidth, (int32)FMath::RoundUpToPowerOfTwo(OutUniqueVertsSourceIDs[0].Num())) :
+		FMath::Max(InProfile->OverrideSize_Vert.X, 1);
 
-	for (int32 i = 0; i < UniqueVerts.Num(); i++)
+	InProfile->LODRowOffset_Vert.SetNum(NumLODs);
+	int32 Rows = 0;
+	for (int32 LOD = 0; LOD < NumLODs; LOD++)
 	{
-		// I SWITCHED THESE to have the UVs lined horizontally.
-		const int32 GridX = i % InProfile->OverrideSize_Vert.X;
-		const int32 GridY = i / InProfile->OverrideSize_Vert.X;
-		const FVector2D GridUV = FVector2D(GridX * XStep, GridY * YStep);
-		UniqueMappedUVs[i] = GridUV;
+		InProfile->LODRowOffset_Vert[LOD] = Rows;
+		Rows += FMath::DivideAndRoundUp(OutUniqueVertsSourceIDs[LOD].Num(), XSize);
 	}
+	InProfile->RowsPerFrame_Vert = Rows;
 
-	TArray <FVector2D> NewUVSet_Vert;
-	NewUVSet_Vert.SetNum(SkinVerts.Num());
-	for (int32 i = 0; i < SkinVerts.Num(); i++)
+	if (InProfile->AutoSize)
 	{
-		NewUVSet_Vert[i] = UniqueMappedUVs[UniqueID[i]];
+		InProfile->OverrideSize_Vert = FIntPoint(
+			XSize,
+			FMath::RoundUpToPowerOfTwo(InProfile->CalcTotalRequiredHeight_Vert()));
 	}
-	OutUVSet_Vert = NewUVSet_Vert;
-};
 
+	OutUVSets_Vert.SetNum(NumLODs);
+	for (int32 LOD = 0; LOD < NumLODs; LOD++)
+	{
+		const int32 FirstTexel = InProfile->LODRowOffset_Vert[LOD] * XSize;
+		OutUVSets_Vert[LOD].SetNum(LODSkinVerts[LOD].Num());
+		for (int32 i = 0; i < LODSkinVerts[LOD].Num(); i++)
+		{
+			OutUVSets_Vert[LOD][i] = VertGridUV(InProfile, FirstTexel + UniqueIDs[LOD][i]);
+		}
+	}
+}
+
+// Reflection across the plane through the origin that MirrorAxis is the normal of
+static FVector3f MirrorPosition(const FVector3f& Position, const EAxis::Type Axis)
+{
+	FVector3f Out = Position;
+	Out[FMath::Clamp((int32)Axis - (int32)EAxis::X, 0, 2)] *= -1.f;
+	return Out;
+}
+
+// Mirror of every unique vert: the unique vert closest to its reflection within MirrorTolerance, or itself if there is none
+static void MirrorUniqueVerts(
+	const UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
+	const TArray <int32>& UniqueVertsSourceID, TArray <int32>& OutMirror)
+{
+	const float Tolerance = FMath::Max(InProfile->MirrorTolerance, KINDA_SMALL_NUMBER);
+	auto Cell = [Tolerance](const FVector3f& P)
+	{
+		return FIntVector(FMath::FloorToInt(P.X / Tolerance), FMath::FloorToInt(P.Y / Tolerance), FMath::FloorToInt(P.Z / Tolerance));
+	};
+
+	TMultiMap <FIntVector, int32> Grid;
+	for (int32 u = 0; u < UniqueVertsSourceID.Num(); u++)
+	{
+		Grid.Add(Cell(SkinVerts[UniqueVertsSourceID[u]].Position), u);
+	}
+
+	OutMirror.SetNumUninitialized(UniqueVertsSourceID.Num());
+	int32 NumUnmatched = 0;
+	TArray <int32> Candidates;
+
+	for (int32 u = 0; u < UniqueVertsSourceID.Num(); u++)
+	{
+		const FVector3f Target = MirrorPosition(SkinVerts[UniqueVertsSourceID[u]].Position, InProfile->MirrorAxis);
+		const FIntVector TargetCell = Cell(Target);
+
+		Candidates.Reset();
+		for (int32 x = -1; x <= 1; x++)
+		for (int32 y = -1; y <= 1; y++)
+		for (int32 z = -1; z <= 1; z++)
+		{
+			Grid.MultiFind(TargetCell + FIntVector(x, y, z), Candidates);
+		}
+
+		float Lowest = Tolerance;
+		int32 WinnerID = INDEX_NONE;
+		for (const int32 Candidate : Candidates)
+		{
+			const float Dist = FVector3f::Dist(Target, SkinVerts[UniqueVertsSourceID[Candidate]].Position);
+			if (Dist <= Lowest)
+			{
+				Lowest = Dist;
+				WinnerID = Candidate;
+			}
+		}
+
+		if (WinnerID == INDEX_NONE) NumUnmatched++;
+		OutMirror[u] = (WinnerID == INDEX_NONE) ? u : WinnerID;
+	}
+
+	if (NumUnmatched)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, %d of %d verts have no mirror vert within MirrorTolerance, they mirror onto themselves"),
+			*InProfile->GetName(), NumUnmatched, UniqueVertsSourceID.Num());
+	}
+}
+
+// Adds the grid UV of every unique vert's mirror, keyed by the unique vert's own grid UV.
+// FirstTexel is the first texel of the verts' block inside the frame (PerLODRows_Vert).
+static void AddMirrorGridUVs(
+	const UVertexAnimProfile* InProfile, const TArray <FFinalSkinVertex>& SkinVerts,
+	const TArray <int32>& UniqueVertsSourceID, const int32 FirstTexel, TMap <FVector2D, FVector2D>& InOutMirrorUVs)
+{
+	TArray <int32> Mirror;
+	MirrorUniqueVerts(InProfile, SkinVerts, UniqueVertsSourceID, Mirror);
+
+	for (int32 u = 0; u < Mirror.Num(); u++)
+	{
+		InOutMirrorUVs.Add(VertGridUV(InProfile, FirstTexel + u), VertGridUV(InProfile, FirstTexel + Mirror[u]));
+	}
+}
+
+// Left / right counterpart of a bone name (hand_l / hand_r, LeftHand / RightHand), the name itself if it has no side
+static FString MirrorBoneName(const FString& Name)
+{
+	static const TPair<const TCHAR*, const TCHAR*> Suffixes[] = {
+		{ TEXT("_l"), TEXT("_r") }, { TEXT("_L"), TEXT("_R") }, { TEXT("Left"), TEXT("Right") }, { TEXT("left"), TEXT("right") } };
+
+	for (const auto& Side : Suffixes)
+	{
+		if (Name.EndsWith(Side.Key, ESearchCase::CaseSensitive)) return Name.LeftChop(FCString::Strlen(Side.Key)) + Side.Value;
+		if (Name.EndsWith(Side.Value, ESearchCase::CaseSensitive)) return Name.LeftChop(FCString::Strlen(Side.Value)) + Side.Key;
+	}
+	if (Name.Contains(TEXT("Left"), ESearchCase::CaseSensitive)) return Name.Replace(TEXT("Left"), TEXT("Right"), ESearchCase::CaseSensitive);
+	if (Name.Contains(TEXT("Right"), ESearchCase::CaseSensitive)) return Name.Replace(TEXT("Right"), TEXT("Left"), ESearchCase::CaseSensitive);
+
+	return Name;
+}
+
+// Mirror of every bone (texture column): its left / right counterpart by name when that one sits at its reflection in the ref pose,
+// else the bone closest to its reflection within MirrorTolerance, else itself
+static void MapMirrorBones(UVertexAnimProfile* InProfile, const FReferenceSkeleton& RefSkeleton)
+{
+	InProfile->MirrorBones.Empty();
+	if (!InProfile->BakeMirrorMaps || !InProfile->Anims_Bone.Num()) return;
+
+	const int32 NumBones = RefSkeleton.GetNum();
+	const float Tolerance = FMath::Max(InProfile->MirrorTolerance, KINDA_SMALL_NUMBER);
+
+	TArray <FVector3f> Positions;
+	Positions.SetNumUninitialized(NumBones);
+	for (int32 b = 0; b < NumBones; b++)
+	{
+		Positions[b] = FVector3f(FAnimationRuntime::GetComponentSpaceTransformRefPose(RefSkeleton, b).GetLocation());
+	}
+
+	InProfile->MirrorBones.SetNumUninitialized(NumBones);
+	int32 NumUnmatched = 0;
+
+	for (int32 b = 0; b < NumBones; b++)
+	{
+		const FVector3f Target = MirrorPosition(Positions[b], InProfile->MirrorAxis);
+
+		const int32 ByName = RefSkeleton.FindBoneIndex(FName(*MirrorBoneName(RefSkeleton.GetBoneName(b).ToString())));
+		if ((ByName != INDEX_NONE) && (FVector3f::Dist(Target, Positions[ByName]) <= Tolerance))
+		{
+			InProfile->MirrorBones[b] = ByName;
+			continue;
+		}
+
+		float Lowest = Tolerance;
+		int32 WinnerID = INDEX_NONE;
+		for (int32 o = 0; o < NumBones; o++)
+		{
+			const float Dist = FVector3f::Dist(Target, Positions[o]);
+			if (Dist <= Lowest)
+			{
+				Lowest = Dist;
+				WinnerID = o;
+			}
+		}
+
+		if (WinnerID == INDEX_NONE) NumUnmatched++;
+		InProfile->MirrorBones[b] = (WinnerID == INDEX_NONE) ? b : WinnerID;
+	}
+
+	if (NumUnmatched)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, %d of %d bones have no mirror bone within MirrorTolerance, they mirror onto themselves"),
+			*InProfile->GetName(), NumUnmatched, NumBones);
+	}
+}
+
+
+
+// Transform of a baked component relative to the root (preview) component, the space the VAT static mesh is generated in
+static FMatrix44f ComponentToRootMatrix(const USceneComponent* Component, const USceneComponent* Root)
+{
+	return FMatrix44f{ Component->GetComponentTransform().GetRelativeTransform(Root->GetComponentTransform()).ToMatrixWithScale() };
+}
+
+static void TransformSkinVerts(const FMatrix44f& ComponentToRoot, TArray <FFinalSkinVertex>& Verts)
+{
+	for (FFinalSkinVertex& Vert : Verts)
+	{
+		Vert.Position = ComponentToRoot.TransformPosition(Vert.Position);
+		Vert.TangentX = FPackedNormal(ComponentToRoot.TransformVector(Vert.TangentX.ToFVector3f()).GetSafeNormal());
+		Vert.TangentZ = FPackedNormal(FVector4f(
+			ComponentToRoot.TransformVector(Vert.TangentZ.ToFVector3f()).GetSafeNormal(), Vert.TangentZ.ToFVector4f().W));
+	}
+}
+
+// Vertices of all baked components for one LOD in root space, concatenated in the same order as ConvertMeshesToStaticMesh.
+// With bCachedCPUSkin the skinned components have to be CPU skinned already, and their current cached vertices are read.
+void VATBakeStages::MergedComponentVerts(
+	const TArray <UMeshComponent*>& Components, const int32 OverallLODIndex, const bool bCachedCPUSkin, TArray <FFinalSkinVertex>& OutVerts)
+{
+	OutVerts.Reset();
+	const USceneComponent* Root = Components[0];
+
+	for (UMeshComponent* Component : Components)
+	{
+		const int32 LODIndexRead = FMath::Min(OverallLODIndex, FVertexAnimUtils::GetNumLODsOfComponent(Component) - 1);
+		const FMatrix44f ComponentToRoot = ComponentToRootMatrix(Component, Root);
+
+		TArray <FFinalSkinVertex> Verts;
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+		{
+			// The cache holds the LOD the component last rendered, only read it when that is the baked LOD
+			if (bCachedCPUSkin && (SkinnedComponent->MeshObject->GetLOD() == LODIndexRead))
+			{
+				Verts = static_cast<FSkeletalMeshObjectCPUSkin*>(SkinnedComponent->MeshObject)->GetCachedFinalVertices();
+			}
+			else
+			{
+				SkinnedComponent->GetCPUSkinnedVertices(Verts, LODIndexRead);
+			}
+
+			if (Component != Root) TransformSkinVerts(ComponentToRoot, Verts);
+		}
+		else if (UStaticMeshComponent* StaticComponent = Cast<UStaticMeshComponent>(Component))
+		{
+			FVertexAnimUtils::StaticMeshComponentVertices(StaticComponent, LODIndexRead, ComponentToRoot, Verts);
+		}
+
+		OutVerts.Append(Verts);
+	}
+}
+
+// Highest num of UV channels over all LODs of all components, VAT UV channels are added after these
+static int32 MergedNumTexCoords(const TArray <UMeshComponent*>& Components)
+{
+	int32 Out = 0;
+	for (UMeshComponent* Component : Components)
+	{
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+		{
+			for (const auto& LODData : SkinnedComponent->MeshObject->GetSkeletalMeshRenderData().LODRenderData)
+			{
+				Out = FMath::Max(Out, (int32)LODData.StaticVertexBuffers.StaticMeshVertexBuffer.GetNumTexCoords());
+			}
+		}
+		else if (UStaticMeshComponent* StaticComponent = Cast<UStaticMeshComponent>(Component))
+		{
+			for (const auto& LODResource : StaticComponent->GetStaticMesh()->GetRenderData()->LODResources)
+			{
+				Out = FMath::Max(Out, (int32)LODResource.VertexBuffers.StaticMeshVertexBuffer.GetNumTexCoords());
+			}
+		}
+	}
+	return FMath::Min(Out, (int32)MAX_MESH_TEXTURE_COORDS);
+}
+
+// Appends bone anim UVs and skin weight colors for the verts of a skinned component's LOD
+static void SkinnedComponentBoneData(
+	USkinnedMeshComponent* InSkinnedMeshComponent, const int32 LODIndexRead,
+	const FReferenceSkeleton& GlobalRefSkeleton, const TArray <FVector2D>& GridUVs_Bone,
+	TArray <FVector2D>& OutUVs_Bone1, TArray <FVector2D>& OutUVs_Bone2, TArray <FColor>& OutSkinWeightColor)
+{
+	const auto& RefSkeleton = InSkinnedMeshComponent->SkeletalMesh->RefSkeleton;
+
+	FSkeletalMeshModel* Resource = InSkinnedMeshComponent->SkeletalMesh->GetImportedModel();
+	FSkeletalMeshLODRenderData& LODData = InSkinnedMeshComponent->MeshObject->GetSkeletalMeshRenderData().LODRenderData[LODIndexRead];
+
+	auto SkinData = LODData.GetSkinWeightVertexBuffer();
+
+	for (int32 s = 0; s < (int32)SkinData->GetNumVertices(); s++)
+	{
+		int32 SectionIndex;
+		int32 VertIndex;
+		LODData.GetSectionFromVertexIndex(s, SectionIndex, VertIndex);
+		check(SectionIndex < LODData.RenderSections.Num());
+		const FSkelMeshRenderSection& Section = LODData.RenderSections[SectionIndex];
+		const auto& SoftVert = Resource->LODModels[LODIndexRead].Sections[SectionIndex].SoftVertices[VertIndex];
+
+		uint32 InfluenceBones[4] = {
+				SoftVert.InfluenceBones[0],
+				SoftVert.InfluenceBones[1],
+				SoftVert.InfluenceBones[2],
+				SoftVert.InfluenceBones[3]
+		};
+
+		uint8 InfluenceWeights[4] = {
+				SoftVert.InfluenceWeights[0],
+				SoftVert.InfluenceWeights[1],
+				SoftVert.InfluenceWeights[2],
+				SoftVert.InfluenceWeights[3]
+		};
+
+		const float Sum =
+			((float)InfluenceWeights[0] / 255.f) + ((float)InfluenceWeights[1] / 255.f)
+			+ ((float)InfluenceWeights[2] / 255.f) + ((float)InfluenceWeights[3] / 255.f);
+		const float Rest = 1.f - Sum;
+
+		FLinearColor W = FLinearColor(
+			((float)InfluenceWeights[0] / 255.f) + Rest,
+			((float)InfluenceWeights[1] / 255.f),
+			((float)InfluenceWeights[2] / 255.f),
+			((float)InfluenceWeights[3] / 255.f));
+
+
+		OutSkinWeightColor.Add(W.ToFColor(false));
+
+		{
+			check(Section.BoneMap.IsValidIndex(InfluenceBones[0]));
+			check(Section.BoneMap.IsValidIndex(InfluenceBones[1]));
+			check(Section.BoneMap.IsValidIndex(InfluenceBones[2]));
+			check(Section.BoneMap.IsValidIndex(InfluenceBones[3]));
+
+			const int32 
+				Bone0 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[0]])),
+				Bone1 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[1]])),
+				Bone2 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[2]])),
+				Bone3 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[3]]));
+
+			
+			checkf(GridUVs_Bone.IsValidIndex(Bone0), TEXT("NUMY %i || %i"),
+				GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
+			checkf(GridUVs_Bone.IsValidIndex(Bone1), TEXT("NUMY %i || %i"),
+				GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
+			checkf(GridUVs_Bone.IsValidIndex(Bone2), TEXT("NUMY %i || %i"),
+				GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
+			checkf(GridUVs_Bone.IsValidIndex(Bone3), TEXT("NUMY %i || %i"),
+				GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
+
+			
+			OutUVs_Bone1.Add(FVector2D(
+				GridUVs_Bone[Bone0].X,
+				GridUVs_Bone[Bone1].X));
+			OutUVs_Bone2.Add(FVector2D(
+				GridUVs_Bone[Bone2].X,
+				GridUVs_Bone[Bone3].X));
+		}
+	}
+}
+
+// Bone a static attachment follows rigidly: the socket bone it (or its first attach parent under a skinned component) is attached to
+static FName StaticComponentBoneName(const UStaticMeshComponent* InStaticMeshComponent)
+{
+	const USceneComponent* Child = InStaticMeshComponent;
+	while (const USceneComponent* Parent = Child->GetAttachParent())
+	{
+		if (const USkinnedMeshComponent* SkinnedParent = Cast<USkinnedMeshComponent>(Parent))
+		{
+			return SkinnedParent->GetSocketBoneName(Child->GetAttachSocketName());
+		}
+		Child = Parent;
+	}
+	return NAME_None;
+}
+
+// Appends bone anim UVs and skin weight colors for the verts of a static attachment, fully weighted to the bone it is attached to
+static void StaticComponentBoneData(
+	UStaticMeshComponent* InStaticMeshComponent, const int32 NumVerts,
+	const FReferenceSkeleton& GlobalRefSkeleton, const TArray <FVector2D>& GridUVs_Bone,
+	TArray <FVector2D>& OutUVs_Bone1, TArray <FVector2D>& OutUVs_Bone2, TArray <FColor>& OutSkinWeightColor)
+{
+	int32 Bone = GlobalRefSkeleton.FindBoneIndex(StaticComponentBoneName(InStaticMeshComponent));
+	if (!GridUVs_Bone.IsValidIndex(Bone)) Bone = 0;
+
+	const FVector2D BoneUVs = FVector2D(GridUVs_Bone[Bone].X, GridUVs_Bone[Bone].X);
+	const FColor Weights = FLinearColor(1.f, 0.f, 0.f, 0.f).ToFColor(false);
+
+	for (int32 s = 0; s < NumVerts; s++)
+	{
+		OutUVs_Bone1.Add(BoneUVs);
+		OutUVs_Bone2.Add(BoneUVs);
+		OutSkinWeightColor.Add(Weights);
+	}
+}
+
+// Texture column of every skeleton bone, INDEX_NONE for the bones without one
+static void MapBoneColumns(const UVertexAnimProfile* InProfile, const int32 NumBones, TArray <int32>& OutColumns)
+{
+	if (!InProfile->ActiveBones.Num())
+	{
+		OutColumns.SetNumUninitialized(NumBones);
+		for (int32 b = 0; b < NumBones; b++) OutColumns[b] = b;
+		return;
+	}
+
+	OutColumns.Init(INDEX_NONE, NumBones);
+	for (int32 c = 0; c < InProfile->ActiveBones.Num(); c++)
+	{
+		if (OutColumns.IsValidIndex(InProfile->ActiveBones[c])) OutColumns[InProfile->ActiveBones[c]] = c;
+	}
+}
+
+// Skeleton bones the merged components need: every bone the skinned components' LODs are bound to, the bones static attachments follow,
+// the parents of those and, with mirror maps, their mirror bones. Sorted, so parents keep coming before their children.
+static void CollectActiveBones(
+	const TArray <UMeshComponent*>& Components, const FReferenceSkeleton& GlobalRefSkeleton, const TArray <int32>& SkeletonMirrorBones,
+	TArray <int32>& OutActiveBones)
+{
+	const int32 NumBones = GlobalRefSkeleton.GetNum();
+	TArray <bool> Used;
+	Used.Init(false, NumBones);
+	// Verts without a bone fall back to the root's column
+	Used[0] = true;
+
+	auto UseBone = [&Used](const int32 Bone) { if (Used.IsValidIndex(Bone)) Used[Bone] = true; };
+
+	for (UMeshComponent* Component : Components)
+	{
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+		{
+			const FReferenceSkeleton& RefSkeleton = SkinnedComponent->SkeletalMesh->GetRefSkeleton();
+			const FSkeletalMeshRenderData* RenderData = SkinnedComponent->SkeletalMesh->GetResourceForRendering();
+			if (!RenderData) continue;
+
+			for (const FSkeletalMeshLODRenderData& LODData : RenderData->LODRenderData)
+			{
+				for (const FBoneIndexType MeshBone : LODData.ActiveBoneIndices)
+				{
+					UseBone(GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(MeshBone)));
+				}
+				// The bone UVs index the sections' bone maps, zero weight slots included
+				for (const FSkelMeshRenderSection& Section : LODData.RenderSections)
+				{
+					for (const FBoneIndexType MeshBone : Section.BoneMap)
+					{
+						UseBone(GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(MeshBone)));
+					}
+				}
+			}
+		}
+		else if (UStaticMeshComponent* StaticComponent = Cast<UStaticMeshComponent>(Component))
+		{
+			UseBone(GlobalRefSkeleton.FindBoneIndex(StaticComponentBoneName(StaticComponent)));
+		}
+	}
+
+	// Parents have lower indices than their children, one pass from the leaves up closes the hierarchy
+	auto UseParents = [&]()
+	{
+		for (int32 b = NumBones - 1; b > 0; b--)
+		{
+			if (Used[b]) UseBone(GlobalRefSkeleton.GetParentIndex(b));
+		}
+	};
+
+	UseParents();
+	if (SkeletonMirrorBones.Num() == NumBones)
+	{
+		for (int32 b = 0; b < NumBones; b++)
+		{
+			if (Used[b]) UseBone(SkeletonMirrorBones[b]);
+		}
+		UseParents();
+	}
+
+	OutActiveBones.Empty();
+	for (int32 b = 0; b < NumBones; b++)
+	{
+		if (Used[b]) OutActiveBones.Add(b);
+	}
+}
+
+// Lays out the bone texture columns, OutUVSet_Bone holds the grid UV of every skeleton bone (the root's for bones without a column).
+// Expects MirrorBones in skeleton space and leaves them in column space.
 static void MapActiveBones(
-	UVertexAnimProfile* InProfile, const int32 NumBones, TArray <FVector2D>& OutUVSet_Bone)
+	UVertexAnimProfile* InProfile, const TArray <UMeshComponent*>& Components, const FReferenceSkeleton& GlobalRefSkeleton,
+	TArray <FVector2D>& OutUVSet_Bone)
 {
+	const int32 NumBones = GlobalRefSkeleton.GetNum();
+
+	InProfile->ActiveBones.Empty();
+	if (InProfile->CompactBones)
+	{
+		CollectActiveBones(Components, GlobalRefSkeleton, InProfile->MirrorBones, InProfile->ActiveBones);
+		UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s, %d of %d skeleton bones are active"), *InProfile->GetName(), InProfile->ActiveBones.Num(), NumBones);
+	}
+
+	TArray <int32> Columns;
+	MapBoneColumns(InProfile, NumBones, Columns);
+	const int32 NumColumns = InProfile->ActiveBones.Num() ? InProfile->ActiveBones.Num() : NumBones;
+
+	if (InProfile->MirrorBones.Num() == NumBones)
+	{
+		TArray <int32> MirrorColumns;
+		MirrorColumns.SetNumUninitialized(NumColumns);
+		for (int32 c = 0; c < NumColumns; c++)
+		{
+			const int32 Bone = InProfile->ActiveBones.Num() ? InProfile->ActiveBones[c] : c;
+			const int32 MirrorColumn = Columns[InProfile->MirrorBones[Bone]];
+			MirrorColumns[c] = (MirrorColumn == INDEX_NONE) ? c : MirrorColumn;
+		}
+		InProfile->MirrorBones = MirrorColumns;
+	}
+
 	if (InProfile->AutoSize)
 	{
-		int32 XSize = FMath::Clamp((int32)FMath::RoundUpToPowerOfTwo(NumBones), 8, InProfile->MaxWidth);
+		int32 XSize = FMath::Clamp((int32)FMath::RoundUpToPowerOfTwo(NumColumns), 8, InProfile->MaxWidth);
 		
 		InProfile->OverrideSize_Bone = FIntPoint(
 			XSize,
@@ -193,52 +712,49 @@ static void MapActiveBones(
 
 	const float XStep = 1.f / InProfile->OverrideSize_Bone.X;
 	const float YStep = 1.f / InProfile->OverrideSize_Bone.Y;
-	TArray <FVector2D> UniqueMappedUVs;
-	UniqueMappedUVs.SetNum(NumBones);
+	OutUVSet_Bone.SetNum(NumBones);
 
 	for (int32 i = 0; i < NumBones; i++)
 	{
-		if (true)
-		{
-			// I SWITCHED THESE to have the UVs lined horizontally.
-			const int32 GridX = i % InProfile->OverrideSize_Bone.X;
-			const int32 GridY = i / InProfile->OverrideSize_Bone.X;
-			const FVector2D GridUV = FVector2D(GridX * XStep, GridY * YStep);
-			UniqueMappedUVs[i] = GridUV;
-		}
-		else
-		{
-			UniqueMappedUVs[i] = FVector2D();
-		}
+		// I SWITCHED THESE to have the UVs lined horizontally.
+		const int32 Column = FMath::Max(Columns[i], 0);
+		const int32 GridX = Column % InProfile->OverrideSize_Bone.X;
+		const int32 GridY = Column / InProfile->OverrideSize_Bone.X;
+		OutUVSet_Bone[i] = FVector2D(GridX * XStep, GridY * YStep);
 	}
+}
 
-	OutUVSet_Bone = UniqueMappedUVs;
-};
-
-
-
-static void SkinnedMeshVATData(
-	USkinnedMeshComponent* InSkinnedMeshComponent,
+// Components is the list of components merged into the VAT mesh, Components[0] is the root skinned (preview) component.
+// UniqueSourceIDs holds the source verts of the vert anim rows, one entry per LOD with PerLODRows_Vert, else only LOD0's.
+void VATBakeStages::SkinnedMeshVATData(
+	const TArray <UMeshComponent*>& Components,
 	UVertexAnimProfile* InProfile,
-	TArray <int32>& UniqueSourceID,
+	TArray <TArray <int32>>& UniqueSourceIDs,
 	TArray <TArray <FVector2D>>& UVs_VertAnim,
+	TArray <TArray <FVector2D>>& UVs_VertMirror,
 	TArray <TArray <FVector2D>>& UVs_BoneAnim1, 
 	TArray <TArray <FVector2D>>& UVs_BoneAnim2,
 	TArray <TArray <FColor>>& Colors_BoneAnim)
 {
-	UniqueSourceID.Empty();
+	UniqueSourceIDs.Empty();
 	UVs_VertAnim.Empty();
+	UVs_VertMirror.Empty();
 	UVs_BoneAnim1.Empty();
 	UVs_BoneAnim2.Empty();
 	Colors_BoneAnim.Empty();
 
-	const int32 NumLODs = InSkinnedMeshComponent->GetNumLODs();
+	USkinnedMeshComponent* InSkinnedMeshComponent = CastChecked<USkinnedMeshComponent>(Components[0]);
+
+	const int32 NumLODs = FVertexAnimUtils::CalcOverallMaxLODs(Components);
 
-	const auto& RefSkeleton = InSkinnedMeshComponent->SkeletalMesh->RefSkeleton;
 	const auto& GlobalRefSkeleton = InSkinnedMeshComponent->SkeletalMesh->Skeleton->GetReferenceSkeleton();
 
 	TArray <FVector2D> GridUVs_Vert;
+	TArray <TArray <FVector2D>> PerLODGridUVs_Vert;
 	TArray <FVector2D> GridUVs_Bone;
+	// Grid UV of every unique vert's mirror, keyed by its own grid UV, only with BakeMirrorMaps
+	TMap <FVector2D, FVector2D> MirrorGridUVs_Vert;
+	const bool bMirrorVerts = InProfile->BakeMirrorMaps && InProfile->Anims_Vert.Num();
 
 	TArray<FFinalSkinVertex> AnimMeshFinalVertices;
 	int32 AnimMeshLOD = 0;
@@ -247,51 +763,74 @@ static void SkinnedMeshVATData(
 	int32 UVVertStart = -1;
 	int32 UVBoneStart = -2;
 	
-	FSkeletalMeshRenderData& SkeletalMeshRenderData = InSkinnedMeshComponent->MeshObject->GetSkeletalMeshRenderData();
-	
 	{
-		FSkeletalMeshLODRenderData& LODData = SkeletalMeshRenderData.LODRenderData[0];
-		MapActiveBones(InProfile, GlobalRefSkeleton.GetNum(), GridUVs_Bone);
+		MapMirrorBones(InProfile, GlobalRefSkeleton);
+		MapActiveBones(InProfile, Components, GlobalRefSkeleton, GridUVs_Bone);
 
-		InSkinnedMeshComponent->GetCPUSkinnedVertices(AnimMeshFinalVertices, AnimMeshLOD);
-		MapSkinVerts(InProfile, AnimMeshFinalVertices, UniqueSourceID, GridUVs_Vert);
+		VATBakeStages::MergedComponentVerts(Components, AnimMeshLOD, false, AnimMeshFinalVertices);
+		if (InProfile->PerLODRows_Vert)
+		{
+			TArray <TArray <FFinalSkinVertex>> LODFinalVertices;
+			LODFinalVertices.SetNum(NumLODs);
+			LODFinalVertices[AnimMeshLOD] = AnimMeshFinalVertices;
+			for (int32 LOD = 1; LOD < NumLODs; LOD++)
+			{
+				VATBakeStages::MergedComponentVerts(Components, LOD, false, LODFinalVertices[LOD]);
+			}
+			MapSkinVertsPerLOD(InProfile, LODFinalVertices, UniqueSourceIDs, PerLODGridUVs_Vert);
 
-		int32 UVChannelStart = LODData.StaticVertexBuffers.StaticMeshVertexBuffer.GetNumTexCoords();
+			for (int32 LOD = 0; bMirrorVerts && (LOD < NumLODs); LOD++)
+			{
+				AddMirrorGridUVs(InProfile, LODFinalVertices[LOD], UniqueSourceIDs[LOD],
+					InProfile->LODRowOffset_Vert[LOD] * InProfile->OverrideSize_Vert.X, MirrorGridUVs_Vert);
+			}
+		}
+		else
+		{
+			VATBakeStages::MapSkinVerts(InProfile, AnimMeshFinalVertices, UniqueSourceIDs.AddDefaulted_GetRef(), GridUVs_Vert);
+
+			if (bMirrorVerts) AddMirrorGridUVs(InProfile, AnimMeshFinalVertices, UniqueSourceIDs[0], 0, MirrorGridUVs_Vert);
+		}
+
+		int32 UVChannelStart = MergedNumTexCoords(Components);
 		UVVertStart = InProfile->Anims_Vert.Num() ? UVChannelStart : -1;
 		InProfile->UVChannel_VertAnim = UVVertStart;
 		UVBoneStart =
 			InProfile->Anims_Bone.Num() ? (InProfile->Anims_Vert.Num() ? UVChannelStart + 1 : UVChannelStart) : -2;
 		InProfile->UVChannel_BoneAnim = UVBoneStart;
 		InProfile->UVChannel_BoneAnim_Full = ((UVBoneStart >= 0) && InProfile->FullBoneSkinning) ? UVBoneStart + 1 : -1;
+		InProfile->UVChannel_VertMirror = bMirrorVerts ?
+			FMath::Max3(UVVertStart, UVBoneStart, InProfile->UVChannel_BoneAnim_Full) + 1 : -1;
 	}
 
 
 	for (int32 OverallLODIndex = 0; OverallLODIndex < NumLODs; OverallLODIndex++)
 	{
-		int32 LODIndexRead = FMath::Min(OverallLODIndex, NumLODs - 1);
-
-		FSkeletalMeshLODInfo& SrcLODInfo = *(InSkinnedMeshComponent->SkeletalMesh->GetLODInfo(LODIndexRead));
-
-		// Get the CPU skinned verts for this LOD, WAIT, if it changes LOD on each loop, does that not mean it changes??
+		// Get the CPU skinned verts of all components for this LOD
 		TArray<FFinalSkinVertex> FinalVertices;
-		InSkinnedMeshComponent->GetCPUSkinnedVertices(FinalVertices, LODIndexRead);
+		VATBakeStages::MergedComponentVerts(Components, OverallLODIndex, false, FinalVertices);
 
 
 		TArray <FColor> thisLODSkinWeightColor;
 		// Here is where we find the correct grid UVs for this LOD
 		TArray <FVector2D> thisLODGridUVs_Vert, thisLODGridUVs_Bone1, thisLODGridUVs_Bone2;
 
-		thisLODGridUVs_Bone1.SetNum(FinalVertices.Num());
-		thisLODGridUVs_Bone2.SetNum(FinalVertices.Num());
-		thisLODSkinWeightColor.SetNum(FinalVertices.Num());
+		thisLODGridUVs_Bone1.Reserve(FinalVertices.Num());
+		thisLODGridUVs_Bone2.Reserve(FinalVertices.Num());
+		thisLODSkinWeightColor.Reserve(FinalVertices.Num());
 
-		if (OverallLODIndex == AnimMeshLOD)
+		if (InProfile->PerLODRows_Vert)
+		{
+			thisLODGridUVs_Vert = PerLODGridUVs_Vert[OverallLODIndex];
+		}
+		else if (OverallLODIndex == AnimMeshLOD)
 		{
 			thisLODGridUVs_Vert = GridUVs_Vert;
 		}
 		else
 		{
 			// Here we search
+			const TArray <int32>& UniqueSourceID = UniqueSourceIDs[AnimMeshLOD];
 			thisLODGridUVs_Vert.SetNum(FinalVertices.Num());
 
 			for (int32 o = 0; o < FinalVertices.Num(); o++)
@@ -304,129 +843,638 @@ static void SkinnedMeshVATData(
 				{
 					const FVector TargetPos = FVector{ AnimMeshFinalVertices[UniqueSourceID[u]].Position };
 
-					const float Dist = FVector::Dist(Pos, TargetPos);
-					if (Dist < Lowest)
-					{
-						Lowest = Dist;
-						WinnerID = UniqueSourceID[u];
-					}
-				}
+					const float Dist = FVector::Dist(Pos, TargetPos);
+					if (Dist < Lowest)
+					{
+						Lowest = Dist;
+						WinnerID = UniqueSourceID[u];
+					}
+				}
+
+				check(WinnerID != INDEX_NONE);
+
+				thisLODGridUVs_Vert[o] = GridUVs_Vert[WinnerID];
+			}
+		}
+
+		for (UMeshComponent* Component : Components)
+		{
+			const int32 LODIndexRead = FMath::Min(OverallLODIndex, FVertexAnimUtils::GetNumLODsOfComponent(Component) - 1);
+
+			if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+			{
+				SkinnedComponentBoneData(SkinnedComponent, LODIndexRead, GlobalRefSkeleton, GridUVs_Bone,
+					thisLODGridUVs_Bone1, thisLODGridUVs_Bone2, thisLODSkinWeightColor);
+			}
+			else if (UStaticMeshComponent* StaticComponent = Cast<UStaticMeshComponent>(Component))
+			{
+				const int32 NumVerts = StaticComponent->GetStaticMesh()->GetRenderData()->LODResources[LODIndexRead].GetNumVertices();
+				StaticComponentBoneData(StaticComponent, NumVerts, GlobalRefSkeleton, GridUVs_Bone,
+					thisLODGridUVs_Bone1, thisLODGridUVs_Bone2, thisLODSkinWeightColor);
+			}
+		}
+
+		check(thisLODSkinWeightColor.Num() == FinalVertices.Num());
+
+		UVs_VertAnim.Add(thisLODGridUVs_Vert);
+		if (bMirrorVerts)
+		{
+			TArray <FVector2D>& thisLODMirrorUVs_Vert = UVs_VertMirror.AddDefaulted_GetRef();
+			thisLODMirrorUVs_Vert.SetNum(thisLODGridUVs_Vert.Num());
+			for (int32 v = 0; v < thisLODGridUVs_Vert.Num(); v++)
+			{
+				const FVector2D* MirrorUV = MirrorGridUVs_Vert.Find(thisLODGridUVs_Vert[v]);
+				thisLODMirrorUVs_Vert[v] = MirrorUV ? *MirrorUV : thisLODGridUVs_Vert[v];
+			}
+		}
+		UVs_BoneAnim1.Add(thisLODGridUVs_Bone1);
+		UVs_BoneAnim2.Add(thisLODGridUVs_Bone2);
+		Colors_BoneAnim.Add(thisLODSkinWeightColor);
+	}
+}
+
+
+static void QuatSave(FQuat& Q)
+{
+	// Make sure we have a non null SquareSum. It shouldn't happen with a quaternion, but better be safe.
+	if (Q.SizeSquared() <= SMALL_NUMBER)
+	{
+		Q = FQuat::Identity;
+	}
+	else
+	{
+		// All transmitted quaternions *MUST BE* unit quaternions, in which case we can deduce the value of W.
+		if (!ensure(Q.IsNormalized()))
+		{
+			Q.Normalize();
+		}
+	}
+}
+
+// Cell of a frame in a 1D grid of cell size Quantum over the mean of all its components. Frames within Tolerance per component
+// have means within Tolerance, less than Quantum apart, so they are in the same or a neighbouring cell whatever side of a cell
+// boundary they fall on
+static int64 FrameCell(const TArray <TArray <FVector4>*>& Channels, const int32 Frame, const int32 FrameSize, const float Quantum)
+{
+	double Sum = 0.0;
+	for (const TArray <FVector4>* Channel : Channels)
+	{
+		for (int32 t = Frame * FrameSize; t < (Frame + 1) * FrameSize; t++)
+		{
+			const FVector4& V = (*Channel)[t];
+			Sum += (double)V.X + (double)V.Y + (double)V.Z + (double)V.W;
+		}
+	}
+	const double Mean = Sum / (double)(Channels.Num() * FrameSize * 4);
+	return (int64)FMath::FloorToDouble(Mean / (double)Quantum);
+}
+
+static bool FramesMatch(const TArray <TArray <FVector4>*>& Channels, const int32 FrameA, const int32 FrameB, const int32 FrameSize, const float Tolerance)
+{
+	for (const TArray <FVector4>* Channel : Channels)
+	{
+		for (int32 t = 0; t < FrameSize; t++)
+		{
+			const FVector4& A = (*Channel)[FrameA * FrameSize + t];
+			const FVector4& B = (*Channel)[FrameB * FrameSize + t];
+			for (int32 c = 0; c < 4; c++)
+			{
+				if (FMath::Abs(A[c] - B[c]) > Tolerance) return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Lets clips share identical (within Tolerance) frames instead of each getting its own rows.
+ * The material reads a clip as a contiguous run of frames from its AnimStart_Generated, so sharing happens per clip:
+ * a clip whose frames already appear as a run reuses that run, else it is appended overlapping the tail of the layout as far as it matches.
+ * @param	Channels		Frame data, all channels are compared and compacted the same way
+ * @param	FrameSize		Texels per frame
+ * @param	FirstFrame		Leading frames kept as they are (the bone ref pose row)
+ * @param	Anims			Clips laid out back to back after FirstFrame, their frames are the input
+ * @param	OutClipStartFrames	Frame each clip starts at after compaction
+ * @return	Num of frames after compaction, including FirstFrame
+ */
+static int32 DeduplicateClipFrames(
+	const TArray <TArray <FVector4>*>& Channels, const int32 FrameSize, const int32 FirstFrame,
+	const TArray <FVASequenceData>& Anims, const float Tolerance, TArray <int32>& OutClipStartFrames)
+{
+	const int32 NumFrames = (*Channels[0]).Num() / FrameSize;
+	const float Quantum = FMath::Max(Tolerance * 2.f, KINDA_SMALL_NUMBER);
+
+	// Canonical frame of every frame, the first frame it matches.
+	// The cells only narrow down the candidates, whether two frames match is always the tolerance compare
+	TArray <int32> Canonical;
+	Canonical.SetNumUninitialized(NumFrames);
+	TMultiMap <int64, int32> FramesByCell;
+	TArray <int32> Candidates;
+	for (int32 f = 0; f < NumFrames; f++)
+	{
+		Canonical[f] = f;
+		if (f < FirstFrame) continue;
+
+		const int64 Cell = FrameCell(Channels, f, FrameSize, Quantum);
+		Candidates.Reset();
+		for (int64 Neighbour = Cell - 1; Neighbour <= Cell + 1; Neighbour++)
+		{
+			FramesByCell.MultiFind(Neighbour, Candidates);
+		}
+		Candidates.Sort();
+		for (const int32 Candidate : Candidates)
+		{
+			if (FramesMatch(Channels, f, Candidate, FrameSize, Tolerance))
+			{
+				Canonical[f] = Candidate;
+				break;
+			}
+		}
+		if (Canonical[f] == f) FramesByCell.Add(Cell, f);
+	}
+
+	// Layout as canonical frames
+	TArray <int32> Layout;
+	for (int32 f = 0; f < FirstFrame; f++) Layout.Add(f);
+
+	OutClipStartFrames.SetNum(Anims.Num());
+	int32 ClipFrame = FirstFrame;
+	for (int32 i = 0; i < Anims.Num(); i++)
+	{
+		const int32 N = Anims[i].NumFrames;
+		TArrayView<const int32> Clip = MakeArrayView(Canonical).Slice(ClipFrame, N);
+		ClipFrame += N;
+
+		auto RunMatches = [&Layout, &Clip](const int32 LayoutStart, const int32 Num)
+		{
+			for (int32 k = 0; k < Num; k++)
+			{
+				if (Layout[LayoutStart + k] != Clip[k]) return false;
+			}
+			return true;
+		};
+
+		int32 Start = INDEX_NONE;
+		for (int32 l = FirstFrame; (l + N <= Layout.Num()) && (Start == INDEX_NONE); l++)
+		{
+			if (RunMatches(l, N)) Start = l;
+		}
+
+		if (Start == INDEX_NONE)
+		{
+			int32 Overlap = FMath::Min(N - 1, Layout.Num() - FirstFrame);
+			while ((Overlap > 0) && !RunMatches(Layout.Num() - Overlap, Overlap)) Overlap--;
+
+			Start = Layout.Num() - Overlap;
+			for (int32 k = Overlap; k < N; k++) Layout.Add(Clip[k]);
+		}
+
+		OutClipStartFrames[i] = Start;
+	}
+
+	for (TArray <FVector4>* Channel : Channels)
+	{
+		TArray <FVector4> Compacted;
+		Compacted.SetNumUninitialized(Layout.Num() * FrameSize);
+		for (int32 f = 0; f < Layout.Num(); f++)
+		{
+			FMemory::Memcpy(&Compacted[f * FrameSize], &(*Channel)[Layout[f] * FrameSize], FrameSize * sizeof(FVector4));
+		}
+		*Channel = MoveTemp(Compacted);
+	}
+
+	return Layout.Num();
+}
+
+static void DeduplicateFrames(UVertexAnimProfile* Profile, TArray <FVector4>& VertPos, TArray <FVector4>& VertNormal, TArray <FVector4>& BonePos, TArray <FVector4>& BoneRot)
+{
+	if (!Profile->DeduplicateFrames) return;
+
+	TArray <int32> ClipStartFrames;
+
+	if (Profile->Anims_Vert.Num())
+	{
+		const int32 FrameSize = Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert;
+		const int32 UsedFrames = DeduplicateClipFrames({ &VertPos, &VertNormal }, FrameSize, 0, Profile->Anims_Vert, Profile->DeduplicateTolerance, ClipStartFrames);
+
+		for (int32 i = 0; i < Profile->Anims_Vert.Num(); i++)
+		{
+			Profile->Anims_Vert[i].AnimStart_Generated = ClipStartFrames[i] * Profile->RowsPerFrame_Vert;
+		}
+		if (Profile->AutoSize)
+		{
+			Profile->OverrideSize_Vert.Y = FMath::RoundUpToPowerOfTwo(UsedFrames * Profile->RowsPerFrame_Vert);
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s vert anim uses %d of %d frames after de-duplication"),
+			*Profile->GetName(), UsedFrames, Profile->CalcTotalNumOfFrames_Vert());
+	}
+
+	if (Profile->Anims_Bone.Num())
+	{
+		// Row 0 is the ref pose
+		const int32 UsedFrames = DeduplicateClipFrames({ &BonePos, &BoneRot }, Profile->OverrideSize_Bone.X, 1, Profile->Anims_Bone, Profile->DeduplicateTolerance, ClipStartFrames);
+
+		for (int32 i = 0; i < Profile->Anims_Bone.Num(); i++)
+		{
+			Profile->Anims_Bone[i].AnimStart_Generated = ClipStartFrames[i];
+		}
+		if (Profile->AutoSize)
+		{
+			Profile->OverrideSize_Bone.Y = FMath::RoundUpToPowerOfTwo(UsedFrames);
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s bone anim uses %d of %d frames after de-duplication"),
+			*Profile->GetName(), UsedFrames - 1, Profile->CalcTotalNumOfFrames_Bone());
+	}
+}
+
+// Root motion curves of one clip list, read from the sequences' root track at the same times the frames are sampled at
+static void BakeRootMotionClips(UVertexAnimProfile* Profile, const TArray <FVASequenceData>& Anims, TArray <FVARootMotionClip>& OutClips)
+{
+	OutClips.Reset();
+
+	for (const FVASequenceData& Anim : Anims)
+	{
+		const UAnimSequence* Sequence = Cast<UAnimSequence>(Anim.SequenceRef);
+
+		FVARootMotionClip& Clip = OutClips.AddDefaulted_GetRef();
+		Clip.FirstFrame = Profile->RootMotionFrames.Num();
+		Clip.NumFrames = Anim.NumFrames;
+		Clip.Length = Sequence ? Sequence->GetPlayLength() : 0.f;
+
+		if (!Sequence)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s is not an anim sequence, it gets no root motion"), *GetNameSafe(Anim.SequenceRef));
+		}
+
+		const FTransform Root0 = Sequence ? Sequence->ExtractRootTrackTransform(0.f, nullptr) : FTransform::Identity;
+		float PrevYaw = 0.f;
+
+		// NumFrames + 1 entries, the last one is the end of the clip. A clip of 0 frames only gets its start.
+		for (int32 j = 0; j <= Anim.NumFrames; j++)
+		{
+			FVector4f Frame(0.f, 0.f, 0.f, 0.f);
+			if (Sequence)
+			{
+				const float Time = (Anim.NumFrames > 0) ? (Clip.Length * j / Anim.NumFrames) : 0.f;
+
+				// In the clip's start frame, the agent applies it in its own heading
+				const FTransform Root = Sequence->ExtractRootTrackTransform(Time, nullptr).GetRelativeTransform(Root0);
+				const float Yaw = FMath::DegreesToRadians(Root.Rotator().Yaw);
+
+				// unwrapped, so frames can be lerped and turning clips keep adding up
+				PrevYaw += FMath::FindDeltaAngleRadians(PrevYaw, Yaw);
+				Frame = FVector4f(FVector3f{ Root.GetLocation() }, PrevYaw);
+			}
+			Profile->RootMotionFrames.Add(Frame);
+		}
+	}
+}
+
+static void BakeRootMotion(UVertexAnimProfile* Profile)
+{
+	Profile->RootMotionFrames.Empty();
+	Profile->RootMotionClips_Vert.Empty();
+	Profile->RootMotionClips_Bone.Empty();
+
+	if (!Profile->ExtractRootMotion) return;
+
+	BakeRootMotionClips(Profile, Profile->Anims_Vert, Profile->RootMotionClips_Vert);
+	BakeRootMotionClips(Profile, Profile->Anims_Bone, Profile->RootMotionClips_Bone);
+}
+
+// Notify times of one clip list, sorted per clip so the runtime can binary search a time window
+static void BakeAnimEventClips(UVertexAnimProfile* Profile, const TArray <FVASequenceData>& Anims, TArray <FVAEventClip>& OutClips)
+{
+	OutClips.Reset();
+
+	for (const FVASequenceData& Anim : Anims)
+	{
+		const UAnimSequenceBase* Sequence = Cast<UAnimSequenceBase>(Anim.SequenceRef);
+
+		FVAEventClip& Clip = OutClips.AddDefaulted_GetRef();
+		Clip.FirstEvent = Profile->AnimEvents.Num();
+		Clip.Length = Sequence ? Sequence->GetPlayLength() : 0.f;
+		if (!Sequence) continue;
+
+		for (const FAnimNotifyEvent& Notify : Sequence->Notifies)
+		{
+			FVAAnimEvent& Event = Profile->AnimEvents.AddDefaulted_GetRef();
+			Event.Time = FMath::Clamp(Notify.GetTriggerTime(), 0.f, Clip.Length);
+			Event.Duration = Notify.GetDuration();
+			if (Notify.NotifyStateClass)
+			{
+				Event.Name = FName(*Notify.NotifyStateClass->GetNotifyName());
+			}
+			else if (Notify.Notify)
+			{
+				Event.Name = FName(*Notify.Notify->GetNotifyName());
+			}
+			else
+			{
+				Event.Name = Notify.NotifyName;
+			}
+		}
+
+		Clip.NumEvents = Profile->AnimEvents.Num() - Clip.FirstEvent;
+		MakeArrayView(Profile->AnimEvents).Slice(Clip.FirstEvent, Clip.NumEvents).StableSort(
+			[](const FVAAnimEvent& A, const FVAAnimEvent& B) { return A.Time < B.Time; });
+	}
+}
+
+static void BakeAnimEvents(UVertexAnimProfile* Profile)
+{
+	Profile->AnimEvents.Empty();
+	Profile->EventClips_Vert.Empty();
+	Profile->EventClips_Bone.Empty();
+
+	if (!Profile->BakeAnimEvents) return;
+
+	BakeAnimEventClips(Profile, Profile->Anims_Vert, Profile->EventClips_Vert);
+	BakeAnimEventClips(Profile, Profile->Anims_Bone, Profile->EventClips_Bone);
+
+	UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s, %d anim events baked"), *Profile->GetName(), Profile->AnimEvents.Num());
+}
+
+// Capsule of one mesh bone, in bone space
+struct FVATCapsuleFit
+{
+	int32 MeshBone = INDEX_NONE;
+	FVector3f Start = FVector3f::ZeroVector;
+	FVector3f End = FVector3f::ZeroVector;
+	float Radius = 0.f;
+};
+
+// Fits a capsule to the LOD0 verts skinned to every bone of the preview mesh (merged attachments have none):
+// along the bone space axis the verts spread furthest on, through the center of their bounds, wide enough to hold them all
+static void FitCollisionCapsules(const UVertexAnimProfile* Profile, const USkeletalMesh* Mesh, TArray <FVATCapsuleFit>& OutFits)
+{
+	OutFits.Reset();
+
+	const FReferenceSkeleton& RefSkeleton = Mesh->RefSkeleton;
+	const FSkeletalMeshLODModel& LODModel = Mesh->GetImportedModel()->LODModels[0];
+
+	TArray <TArray <FVector3f>> BoneVerts;
+	BoneVerts.SetNum(RefSkeleton.GetNum());
+
+	for (const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for (const FSoftSkinVertex& Vert : Section.SoftVertices)
+		{
+			using FWeight = TDecay<decltype(Vert.InfluenceWeights[0])>::Type;
+			for (int32 k = 0; k < MAX_TOTAL_INFLUENCES; k++)
+			{
+				const float Weight = (float)Vert.InfluenceWeights[k] / (float)TNumericLimits<FWeight>::Max();
+				if ((Weight <= 0.f) || (Weight < Profile->CapsuleMinWeight) || !Section.BoneMap.IsValidIndex(Vert.InfluenceBones[k])) continue;
+
+				BoneVerts[Section.BoneMap[Vert.InfluenceBones[k]]].Add(Vert.Position);
+			}
+		}
+	}
+
+	for (int32 Bone = 0; Bone < BoneVerts.Num(); Bone++)
+	{
+		if (BoneVerts[Bone].Num() < FMath::Max(Profile->CapsuleMinVerts, 1)) continue;
+
+		const FTransform3f RefTM = FTransform3f(FAnimationRuntime::GetComponentSpaceTransformRefPose(RefSkeleton, Bone));
+
+		TArray <FVector3f> Local;
+		Local.Reserve(BoneVerts[Bone].Num());
+		FBox3f Bounds(ForceInit);
+		for (const FVector3f& Position : BoneVerts[Bone])
+		{
+			Bounds += Local.Add_GetRef(RefTM.InverseTransformPosition(Position));
+		}
+
+		const FVector3f Center = Bounds.GetCenter();
+		const FVector3f Extent = Bounds.GetExtent();
+		const int32 Axis = (Extent.X >= Extent.Y) ? ((Extent.X >= Extent.Z) ? 0 : 2) : ((Extent.Y >= Extent.Z) ? 1 : 2);
+
+		float RadiusSq = 0.f;
+		for (const FVector3f& Position : Local)
+		{
+			FVector3f Off = Position - Center;
+			Off[Axis] = 0.f;
+			RadiusSq = FMath::Max(RadiusSq, Off.SizeSquared());
+		}
+
+		FVATCapsuleFit& Fit = OutFits.AddDefaulted_GetRef();
+		Fit.MeshBone = Bone;
+		Fit.Radius = FMath::Sqrt(RadiusSq);
+
+		FVector3f HalfSegment = FVector3f::ZeroVector;
+		HalfSegment[Axis] = FMath::Max(Extent[Axis] - Fit.Radius, 0.f);
+		// Bone space, posed by the sampled bone transforms
+		Fit.Start = Center - HalfSegment;
+		Fit.End = Center + HalfSegment;
+	}
+}
+
+// Capsule end points of every frame of one clip list, sampled at the same times as the textures
+static void BakeCollisionClips(
+	UVertexAnimProfile* Profile, UDebugSkelMeshComponent* PreviewComponent, const TArray <FVATCapsuleFit>& Fits,
+	const TArray <FVASequenceData>& Anims, TArray <FVACollisionClip>& OutClips)
+{
+	OutClips.Reset();
+
+	for (const FVASequenceData& Anim : Anims)
+	{
+		PreviewComponent->EnablePreview(true, Anim.SequenceRef);
+		const UAnimSingleNodeInstance* SingleNodeInstance = PreviewComponent->GetSingleNodeInstance();
+
+		FVACollisionClip& Clip = OutClips.AddDefaulted_GetRef();
+		Clip.FirstFrame = Profile->CapsuleFrames.Num() / (Fits.Num() * 2);
+		Clip.NumFrames = Anim.NumFrames;
+		Clip.Length = SingleNodeInstance ? SingleNodeInstance->GetLength() : 0.f;
+
+		FBox3f Bounds(ForceInit);
+		for (int32 j = 0; j < Anim.NumFrames; j++)
+		{
+			PreviewComponent->SetPosition(Clip.Length * j / Anim.NumFrames, false);
+			PreviewComponent->RefreshBoneTransforms(nullptr);
+
+			const TArray <FTransform>& BoneTMs = PreviewComponent->GetComponentSpaceTransforms();
+			for (const FVATCapsuleFit& Fit : Fits)
+			{
+				const FTransform3f BoneTM = BoneTMs.IsValidIndex(Fit.MeshBone) ? FTransform3f(BoneTMs[Fit.MeshBone]) : FTransform3f::Identity;
+				const FVector3f Start = BoneTM.TransformPosition(Fit.Start);
+				const FVector3f End = BoneTM.TransformPosition(Fit.End);
+				Profile->CapsuleFrames.Add(Start);
+				Profile->CapsuleFrames.Add(End);
+
+				Bounds += FBox3f(Start - FVector3f(Fit.Radius), Start + FVector3f(Fit.Radius));
+				Bounds += FBox3f(End - FVector3f(Fit.Radius), End + FVector3f(Fit.Radius));
+			}
+		}
+
+		if (Bounds.IsValid)
+		{
+			Clip.BoundsMin = Bounds.Min;
+			Clip.BoundsMax = Bounds.Max;
+		}
+	}
+}
+
+static void ClearCollisionCapsules(UVertexAnimProfile* Profile)
+{
+	Profile->CollisionCapsules.Empty();
+	Profile->CollisionClips_Vert.Empty();
+	Profile->CollisionClips_Bone.Empty();
+	Profile->CapsuleFrames.Empty();
+}
+
+static void BakeCollisionCapsules(UVertexAnimProfile* Profile, UDebugSkelMeshComponent* PreviewComponent)
+{
+	ClearCollisionCapsules(Profile);
+
+	if (!Profile->BakeCollisionCapsules) return;
+
+	TArray <FVATCapsuleFit> Fits;
+	FitCollisionCapsules(Profile, PreviewComponent->SkeletalMesh, Fits);
+	if (!Fits.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, no bone has %d verts to fit a collision capsule to"), *Profile->GetName(), Profile->CapsuleMinVerts);
+		return;
+	}
+
+	for (const FVATCapsuleFit& Fit : Fits)
+	{
+		FVACollisionCapsule& Capsule = Profile->CollisionCapsules.AddDefaulted_GetRef();
+		Capsule.Bone = PreviewComponent->SkeletalMesh->RefSkeleton.GetBoneName(Fit.MeshBone);
+		Capsule.Radius = Fit.Radius;
+	}
+
+	BakeCollisionClips(Profile, PreviewComponent, Fits, Profile->Anims_Vert, Profile->CollisionClips_Vert);
+	BakeCollisionClips(Profile, PreviewComponent, Fits, Profile->Anims_Bone, Profile->CollisionClips_Bone);
+
+	UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s, %d collision capsules over %d frames"),
+		*Profile->GetName(), Fits.Num(), Profile->CapsuleFrames.Num() / (Fits.Num() * 2));
+}
+
+// Force the LOD the CPU skinned verts are cached for, on the preview (or its master) and the merged skinned attachments
+void VATBakeStages::ForceBakeLOD(UDebugSkelMeshComponent* PreviewComponent, const TArray <UMeshComponent*>& Components, const int32 OverallLODIndex)
+{
+	USkinnedMeshComponent* PoseComponent = PreviewComponent->LeaderPoseComponent.Get();
+	if (!PoseComponent) PoseComponent = PreviewComponent;
+
+	// Followers of the leader pose too, each CPU skins and caches the verts of its own forced LOD
+	TArray <USkinnedMeshComponent*> SkinnedComponents = { PoseComponent };
+	for (UMeshComponent* Component : Components)
+	{
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component)) SkinnedComponents.AddUnique(SkinnedComponent);
+	}
+
+	for (USkinnedMeshComponent* SkinnedComponent : SkinnedComponents)
+	{
+		SkinnedComponent->SetForcedLOD(FMath::Min(OverallLODIndex, FVertexAnimUtils::GetNumLODsOfComponent(SkinnedComponent) - 1) + 1);
+		SkinnedComponent->UpdateLODStatus();
+	}
+
+	PoseComponent->RefreshBoneTransforms(nullptr);
+}
+
+// Frames requested from the source at once, bounds the memory of the skinned frames held at a time
+static constexpr int32 FrameBatchSize = 32;
+
+bool VATBakeStages::SampleVertAnimFrames(
+	UVertexAnimProfile* Profile,
+	FVATFrameSource& Source,
+	const TArray <TArray <int32>>& UniqueSourceIDs,
+	TArray <FVector4>& OutGridVertPos,
+	TArray <FVector4>& OutGridVertNormal,
+	float& OutMaxValueOffset)
+{
+	const int32 PerFrameArrayNum_Vert = Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert;
+
+	// Frames are written in place, the LOD row blocks of one frame are filled in separate passes
+	OutGridVertPos.SetNumZeroed(PerFrameArrayNum_Vert * Profile->CalcTotalNumOfFrames_Vert());
+	OutGridVertNormal.SetNumZeroed(PerFrameArrayNum_Vert * Profile->CalcTotalNumOfFrames_Vert());
+
+	TArray <FFinalSkinVertex> RefPoseFinalVerts;
+	TArray <TArray <FFinalSkinVertex>> BatchFrames;
+
+	Profile->RestPositions_Vert.Empty();
+	Profile->RestNormals_Vert.Empty();
+
+	for (int32 RowBlock = 0; RowBlock < UniqueSourceIDs.Num(); RowBlock++)
+	{
+		const TArray <int32>& BlockSourceIDs = UniqueSourceIDs[RowBlock];
+		const int32 BlockStart = Profile->PerLODRows_Vert ? Profile->LODRowOffset_Vert[RowBlock] * Profile->OverrideSize_Vert.X : 0;
 
-				check(WinnerID != INDEX_NONE);
+		if (!Source.GetRestVerts(RowBlock, RefPoseFinalVerts)) return false;
 
-				thisLODGridUVs_Vert[o] = GridUVs_Vert[WinnerID];
+		// LOD0's block starts every frame, so its verts are the first texels of the frame
+		if (Profile->CPUVertSampling && (RowBlock == 0))
+		{
+			Profile->RestPositions_Vert.SetNumUninitialized(BlockSourceIDs.Num());
+			Profile->RestNormals_Vert.SetNumUninitialized(BlockSourceIDs.Num());
+			for (int32 k = 0; k < BlockSourceIDs.Num(); k++)
+			{
+				Profile->RestPositions_Vert[k] = RefPoseFinalVerts[BlockSourceIDs[k]].Position;
+				Profile->RestNormals_Vert[k] = RefPoseFinalVerts[BlockSourceIDs[k]].TangentZ.ToFVector3f();
 			}
 		}
 
-
-		FSkeletalMeshModel* Resource = InSkinnedMeshComponent->SkeletalMesh->GetImportedModel();
-		FSkeletalMeshLODRenderData& LODData = SkeletalMeshRenderData.LODRenderData[LODIndexRead];
-
+		for (int32 i = 0; i < Profile->Anims_Vert.Num(); i++)
 		{
-			const FSkinWeightVertexBuffer& SkinWeightVertexBuffer = *LODData.GetSkinWeightVertexBuffer();
+			const float Length = Source.GetClipLength(i);
+			const float Step_Vert = Length / Profile->Anims_Vert[i].NumFrames;
 
-			auto SkinData = LODData.GetSkinWeightVertexBuffer();
-			check(SkinData->GetNumVertices() == FinalVertices.Num());
+			Profile->Anims_Vert[i].Speed_Generated = 1.f / Length;
+			Profile->Anims_Vert[i].AnimStart_Generated = Profile->CalcStartHeightOfAnim_Vert(i);
 
-			for (int32 s = 0; s < (int32)SkinData->GetNumVertices(); s++)
+			// Frames are fetched in batches so sources can sample several at once, the skinning kernel runs them in parallel
+			for (int32 BatchStart = 0; BatchStart < Profile->Anims_Vert[i].NumFrames; BatchStart += FrameBatchSize)
 			{
-				int32 SectionIndex;
-				int32 VertIndex;
-				LODData.GetSectionFromVertexIndex(s, SectionIndex, VertIndex);
-				check(SectionIndex < LODData.RenderSections.Num());
-				const FSkelMeshRenderSection& Section = LODData.RenderSections[SectionIndex];
-				const auto& SoftVert = Resource->LODModels[LODIndexRead].Sections[SectionIndex].SoftVertices[VertIndex];
-
-				uint32 InfluenceBones[4] = {
-						SoftVert.InfluenceBones[0],
-						SoftVert.InfluenceBones[1],
-						SoftVert.InfluenceBones[2],
-						SoftVert.InfluenceBones[3]
-				};
-
-				uint8 InfluenceWeights[4] = {
-						SoftVert.InfluenceWeights[0],
-						SoftVert.InfluenceWeights[1],
-						SoftVert.InfluenceWeights[2],
-						SoftVert.InfluenceWeights[3]
-				};
-
-				const float Sum =
-					((float)InfluenceWeights[0] / 255.f) + ((float)InfluenceWeights[1] / 255.f)
-					+ ((float)InfluenceWeights[2] / 255.f) + ((float)InfluenceWeights[3] / 255.f);
-				const float Rest = 1.f - Sum;
-
-				FLinearColor W = FLinearColor(
-					((float)InfluenceWeights[0] / 255.f) + Rest,
-					((float)InfluenceWeights[1] / 255.f),
-					((float)InfluenceWeights[2] / 255.f),
-					((float)InfluenceWeights[3] / 255.f));
-
-
-				thisLODSkinWeightColor[s] = W.ToFColor(false);
+				const int32 BatchNum = FMath::Min(FrameBatchSize, Profile->Anims_Vert[i].NumFrames - BatchStart);
+				TArray <float, TInlineAllocator<FrameBatchSize>> Times;
+				for (int32 j = BatchStart; j < BatchStart + BatchNum; j++) Times.Add(Step_Vert * j);
 
+				if (!Source.GetClipFrames(i, Times, Step_Vert, RowBlock, BatchFrames))
 				{
-					check(Section.BoneMap.IsValidIndex(InfluenceBones[0]));
-					check(Section.BoneMap.IsValidIndex(InfluenceBones[1]));
-					check(Section.BoneMap.IsValidIndex(InfluenceBones[2]));
-					check(Section.BoneMap.IsValidIndex(InfluenceBones[3]));
-
-					const int32 
-						Bone0 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[0]])),
-						Bone1 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[1]])),
-						Bone2 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[2]])),
-						Bone3 = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(Section.BoneMap[InfluenceBones[3]]));
-
-					
-					checkf(GridUVs_Bone.IsValidIndex(Bone0), TEXT("NUMY %i || %i"),
-						GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
-					checkf(GridUVs_Bone.IsValidIndex(Bone1), TEXT("NUMY %i || %i"),
-						GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
-					checkf(GridUVs_Bone.IsValidIndex(Bone2), TEXT("NUMY %i || %i"),
-						GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
-					checkf(GridUVs_Bone.IsValidIndex(Bone3), TEXT("NUMY %i || %i"),
-						GridUVs_Bone.Num(), LODData.ActiveBoneIndices.Num());
-
-					
-					thisLODGridUVs_Bone1[s] = FVector2D(
-						GridUVs_Bone[Bone0].X,
-						GridUVs_Bone[Bone1].X);
-					thisLODGridUVs_Bone2[s] = FVector2D(
-						GridUVs_Bone[Bone2].X,
-						GridUVs_Bone[Bone3].X);
+					UE_LOG(LogTemp, Error, TEXT("VAT Bake: %s, clip %d frames %d to %d could not be sampled"), *Profile->GetName(), i, BatchStart, BatchStart + BatchNum - 1);
+					return false;
 				}
-			}
-		}
 
-		UVs_VertAnim.Add(thisLODGridUVs_Vert);
-		UVs_BoneAnim1.Add(thisLODGridUVs_Bone1);
-		UVs_BoneAnim2.Add(thisLODGridUVs_Bone2);
-		Colors_BoneAnim.Add(thisLODSkinWeightColor);
-	}
-}
+				for (int32 j = BatchStart; j < BatchStart + BatchNum; j++)
+				{
+					const TArray <FFinalSkinVertex>& FinalVerts = BatchFrames[j - BatchStart];
+					if (FinalVerts.Num() != RefPoseFinalVerts.Num())
+					{
+						UE_LOG(LogTemp, Error, TEXT("VAT Bake: %s, clip %d frame %d does not have the rest pose's %d verts, only constant topology can be baked"),
+							*Profile->GetName(), i, j, RefPoseFinalVerts.Num());
+						return false;
+					}
 
+					const int32 FrameStart =
+						(Profile->Anims_Vert[i].AnimStart_Generated + (j * Profile->RowsPerFrame_Vert)) * Profile->OverrideSize_Vert.X;
 
-static void QuatSave(FQuat& Q)
-{
-	// Make sure we have a non null SquareSum. It shouldn't happen with a quaternion, but better be safe.
-	if (Q.SizeSquared() <= SMALL_NUMBER)
-	{
-		Q = FQuat::Identity;
-	}
-	else
-	{
-		// All transmitted quaternions *MUST BE* unit quaternions, in which case we can deduce the value of W.
-		if (!ensure(Q.IsNormalized()))
-		{
-			Q.Normalize();
+					for (int32 k = 0; k < BlockSourceIDs.Num(); k++)
+					{
+						const int32 IndexInGrid = FrameStart + BlockStart + k;
+						const int32 VertID = BlockSourceIDs[k];
+						const FVector Delta = FVector{ FinalVerts[VertID].Position - RefPoseFinalVerts[VertID].Position };
+						OutMaxValueOffset = FMath::Max(Delta.GetAbsMax(), OutMaxValueOffset);
+						OutGridVertPos[IndexInGrid] = Delta;
+
+						const FVector DeltaNormal = FinalVerts[VertID].TangentZ.ToFVector() - RefPoseFinalVerts[VertID].TangentZ.ToFVector();
+						OutGridVertNormal[IndexInGrid] = DeltaNormal;
+					}
+				}
+			}
 		}
 	}
+
+	return true;
 }
 
-void GatherAndBakeAllAnimVertData(
+// UniqueSourceIDs as output by SkinnedMeshVATData, with PerLODRows_Vert every LOD is sampled into its own rows of each frame
+bool VATBakeStages::GatherAndBakeAllAnimVertData(
 	UVertexAnimProfile* Profile,
 	UDebugSkelMeshComponent* PreviewComponent,
-	const TArray <int32>& UniqueSourceIDs,
+	const TArray <UMeshComponent*>& Components,
+	const TArray <TArray <int32>>& UniqueSourceIDs,
 	TArray <FVector4>& OutGridVertPos, 
 	TArray <FVector4>& OutGridVertNormal,
 	TArray <FVector4>& OutGridBonePos,
@@ -438,18 +1486,7 @@ void GatherAndBakeAllAnimVertData(
 	{
 		const int32 InLODIndex = 0;
 		{
-			if (USkinnedMeshComponent* MasterPoseComponentPtr = PreviewComponent->MasterPoseComponent.Get())
-			{
-				MasterPoseComponentPtr->SetForcedLOD(InLODIndex + 1);
-				MasterPoseComponentPtr->UpdateLODStatus();
-				MasterPoseComponentPtr->RefreshBoneTransforms(nullptr);
-			}
-			else
-			{
-				PreviewComponent->SetForcedLOD(InLODIndex + 1);
-				PreviewComponent->UpdateLODStatus();
-				PreviewComponent->RefreshBoneTransforms(nullptr);
-			}
+			VATBakeStages::ForceBakeLOD(PreviewComponent, Components, InLODIndex);
 
 			// switch to CPU skinning
 			bCachedCPUSkinning = PreviewComponent->GetCPUSkinningEnabled();
@@ -461,6 +1498,58 @@ void GatherAndBakeAllAnimVertData(
 		}
 	}
 
+	// merged skinned attachments are made to follow the preview's pose (they would bake their own ref pose otherwise),
+	// and need CPU skinning too
+	USkinnedMeshComponent* LeaderComponent = PreviewComponent->LeaderPoseComponent.Get();
+	if (!LeaderComponent) LeaderComponent = PreviewComponent;
+	TArray <USkinnedMeshComponent*> AttachedSkinnedComponents;
+	TArray <bool> AttachedCachedCPUSkinning;
+	TArray <TWeakObjectPtr<USkinnedMeshComponent>> AttachedCachedLeaders;
+	for (UMeshComponent* Component : Components)
+	{
+		USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component);
+		if (SkinnedComponent && (SkinnedComponent != PreviewComponent))
+		{
+			AttachedSkinnedComponents.Add(SkinnedComponent);
+			AttachedCachedCPUSkinning.Add(SkinnedComponent->GetCPUSkinningEnabled());
+			AttachedCachedLeaders.Add(SkinnedComponent->LeaderPoseComponent);
+			if (SkinnedComponent->LeaderPoseComponent.Get() != LeaderComponent) SkinnedComponent->SetLeaderPoseComponent(LeaderComponent, true);
+			SkinnedComponent->SetCPUSkinningEnabled(true, bRecreateRenderStateImmediately);
+			check(SkinnedComponent->MeshObject && SkinnedComponent->MeshObject->IsCPUSkinned());
+		}
+	}
+	// Again now the attachments follow the leader pose and skin on the CPU
+	VATBakeStages::ForceBakeLOD(PreviewComponent, Components, 0);
+
+	// Back into ref pose with the LOD and skinning mode the components had, also when the bake stops early
+	auto RestoreComponents = [&]()
+	{
+		PreviewComponent->EnablePreview(true, NULL);
+		PreviewComponent->RefreshBoneTransforms(nullptr);
+
+		PreviewComponent->ClearMotionVector();
+
+		// switch back to non CPU skinning
+		{
+			// switch skinning mode, LOD etc. back
+			PreviewComponent->SetForcedLOD(0);
+			if (LeaderComponent != PreviewComponent) LeaderComponent->SetForcedLOD(0);
+			PreviewComponent->SetCPUSkinningEnabled(bCachedCPUSkinning, bRecreateRenderStateImmediately);
+
+			for (int32 i = 0; i < AttachedSkinnedComponents.Num(); i++)
+			{
+				AttachedSkinnedComponents[i]->SetForcedLOD(0);
+				if (AttachedCachedLeaders[i] != AttachedSkinnedComponents[i]->LeaderPoseComponent)
+				{
+					AttachedSkinnedComponents[i]->SetLeaderPoseComponent(AttachedCachedLeaders[i].Get(), true);
+				}
+				AttachedSkinnedComponents[i]->SetCPUSkinningEnabled(AttachedCachedCPUSkinning[i], bRecreateRenderStateImmediately);
+			}
+		}
+
+		FlushRenderingCommands();
+	};
+
 	// 2?Make Sure it in ref pose
 	PreviewComponent->EnablePreview(true, NULL);
 	PreviewComponent->RefreshBoneTransforms(nullptr);
@@ -468,8 +1557,6 @@ void GatherAndBakeAllAnimVertData(
 	FlushRenderingCommands();
 
 
-	TArray <FFinalSkinVertex> RefPoseFinalVerts = static_cast<FSkeletalMeshObjectCPUSkin*>(PreviewComponent->MeshObject)->GetCachedFinalVertices();
-
 	TArray <FVector4> GridVertPos;
 	TArray <FVector4> GridVertNormal;
 
@@ -480,16 +1567,10 @@ void GatherAndBakeAllAnimVertData(
 
 	float MaxValuePosBone = 0.f;
 
-	const int32 PerFrameArrayNum_Vert = Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert;
 	const int32 PerFrameArrayNum_Bone = Profile->OverrideSize_Bone.X;
 
 	
 
-	TArray <FVector4> ZeroedPos;
-	ZeroedPos.SetNumZeroed(PerFrameArrayNum_Vert);
-	TArray <FVector4> ZeroedNorm;
-	ZeroedNorm.SetNumZeroed(PerFrameArrayNum_Vert);
-
 	// YOW, need different sizes for vert and bone textures.
 	TArray <FVector4> ZeroedBonePos;
 	ZeroedBonePos.SetNumZeroed(PerFrameArrayNum_Bone);
@@ -505,53 +1586,15 @@ void GatherAndBakeAllAnimVertData(
 	// Vert Anim
 	if (Profile->Anims_Vert.Num())
 	{
-		for (int32 i = 0; i < Profile->Anims_Vert.Num(); i++)
+		FVATSkeletalFrameSource Source(PreviewComponent, Components, Profile->Anims_Vert);
+		if (!VATBakeStages::SampleVertAnimFrames(Profile, Source, UniqueSourceIDs, GridVertPos, GridVertNormal, MaxValueOffset))
 		{
-			PreviewComponent->EnablePreview(true, Profile->Anims_Vert[i].SequenceRef);
-			UAnimSingleNodeInstance* SingleNodeInstance = PreviewComponent->GetSingleNodeInstance();
-
-			const float Length = SingleNodeInstance->GetLength();
-			const float Step_Vert = Length / Profile->Anims_Vert[i].NumFrames;
-
-			Profile->Anims_Vert[i].Speed_Generated = 1.f / Length;
-			Profile->Anims_Vert[i].AnimStart_Generated = Profile->CalcStartHeightOfAnim_Vert(i);
-
-			{
-
-				for (int32 j = 0; j < Profile->Anims_Vert[i].NumFrames; j++)
-				{
-					const float AnimTime = Step_Vert * j;
-
-					PreviewComponent->SetPosition(AnimTime, false);
-					PreviewComponent->RefreshBoneTransforms(nullptr);
-					PreviewComponent->RecreateClothingActors();
-					// Cloth Ticking
-					for (int32 P = 0; P < 8; P++) PreviewComponent->GetWorld()->Tick(ELevelTick::LEVELTICK_All, Step_Vert);
-
-					PreviewComponent->ClearMotionVector();
-
-					FlushRenderingCommands();
-
-					TArray <FFinalSkinVertex> FinalVerts;
-					FinalVerts = static_cast<FSkeletalMeshObjectCPUSkin*>(PreviewComponent->MeshObject)->GetCachedFinalVertices();
-
-					for (int32 k = 0; k < UniqueSourceIDs.Num(); k++)
-					{
-						const int32 IndexInZeroed = k;
-						const int32 VertID = UniqueSourceIDs[k];
-						const FVector Delta = FVector{ FinalVerts[VertID].Position - RefPoseFinalVerts[VertID].Position };
-						MaxValueOffset = FMath::Max(Delta.GetAbsMax(), MaxValueOffset);
-						ZeroedPos[IndexInZeroed] = Delta;
-
-						const FVector DeltaNormal = FinalVerts[VertID].TangentZ.ToFVector() - RefPoseFinalVerts[VertID].TangentZ.ToFVector();
-						ZeroedNorm[IndexInZeroed] = DeltaNormal;
-					}
-
-					GridVertPos.Append(ZeroedPos);
-					GridVertNormal.Append(ZeroedNorm);
-				}
-			}
+			UE_LOG(LogTemp, Error, TEXT("VAT Bake: %s, a vert anim frame could not be sampled or does not match the rest pose's vert count"), *Profile->GetName());
+			RestoreComponents();
+			return false;
 		}
+
+		if (UniqueSourceIDs.Num() > 1) VATBakeStages::ForceBakeLOD(PreviewComponent, Components, 0);
 	}
 
 
@@ -560,6 +1603,8 @@ void GatherAndBakeAllAnimVertData(
 	{
 		const auto& RefSkeleton = PreviewComponent->SkeletalMesh->RefSkeleton;
 		const auto& GlobalRefSkeleton = PreviewComponent->SkeletalMesh->Skeleton->GetReferenceSkeleton();
+		TArray <int32> BoneColumns;
+		MapBoneColumns(Profile, GlobalRefSkeleton.GetNum(), BoneColumns);
 		// Ref Pose in Row 0
 		{
 			PreviewComponent->EnablePreview(true, NULL);
@@ -574,8 +1619,10 @@ void GatherAndBakeAllAnimVertData(
 				FQuat RefQuat = RefTM.GetRotation();
 				QuatSave(RefQuat);
 				const int32 GlobalID = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(B));
-				ZeroedBonePos[GlobalID] = RefTM.GetLocation();
-				ZeroedBoneRot[GlobalID] = FVector4(RefQuat.X, RefQuat.Y, RefQuat.Z, RefQuat.W);
+				const int32 Column = BoneColumns.IsValidIndex(GlobalID) ? BoneColumns[GlobalID] : INDEX_NONE;
+				if (Column == INDEX_NONE) continue;
+				ZeroedBonePos[Column] = RefTM.GetLocation();
+				ZeroedBoneRot[Column] = FVector4(RefQuat.X, RefQuat.Y, RefQuat.Z, RefQuat.W);
 				//UE_LOG(LogUnrealMath, Warning, TEXT("%s"), *ZeroedBonePos[B].ToString());
 			}
 			GridBonePos.Append(ZeroedBonePos);
@@ -609,15 +1656,17 @@ void GatherAndBakeAllAnimVertData(
 					for (int32 k = 0; k < RefToLocal.Num(); k++)
 					{
 						const int32 GlobalID = GlobalRefSkeleton.FindBoneIndex(RefSkeleton.GetBoneName(k));
+						const int32 Column = BoneColumns.IsValidIndex(GlobalID) ? BoneColumns[GlobalID] : INDEX_NONE;
+						if (Column == INDEX_NONE) continue;
 
 						FVector Pos = FVector{ RefToLocal[k].GetOrigin() };
-						ZeroedBonePos[GlobalID] = Pos;
+						ZeroedBonePos[Column] = Pos;
 
 						MaxValuePosBone = FMath::Max(MaxValuePosBone, Pos.GetAbsMax());
 
 						FQuat Q = FQuat{ RefToLocal[k].ToQuat() };
 						QuatSave(Q);
-						ZeroedBoneRot[GlobalID] = FVector4(Q.X, Q.Y, Q.Z, Q.W);
+						ZeroedBoneRot[Column] = FVector4(Q.X, Q.Y, Q.Z, Q.W);
 					}
 				}
 
@@ -627,36 +1676,30 @@ void GatherAndBakeAllAnimVertData(
 		}
 	}
 
-	// 4?Put Mesh back into ref pose
-	{
-		PreviewComponent->EnablePreview(true, NULL);
-		PreviewComponent->RefreshBoneTransforms(nullptr);
-
-		PreviewComponent->ClearMotionVector();
-		
-		// switch back to non CPU skinning
-		{
-			// switch skinning mode, LOD etc. back
-			PreviewComponent->SetForcedLOD(0);
-			PreviewComponent->SetCPUSkinningEnabled(bCachedCPUSkinning, bRecreateRenderStateImmediately);
-		}
+	BakeCollisionCapsules(Profile, PreviewComponent);
 
-		FlushRenderingCommands();
-	}
+	// 4?Put Mesh back into ref pose
+	RestoreComponents();
 
 	Profile->MaxValueOffset_Vert = MaxValueOffset;
 	Profile->MaxValuePosition_Bone = MaxValuePosBone;
 
+	BakeRootMotion(Profile);
+	BakeAnimEvents(Profile);
+
+	DeduplicateFrames(Profile, GridVertPos, GridVertNormal, GridBonePos, GridBoneRot);
+
 	Profile->MarkPackageDirty();
 
 	OutGridVertPos = GridVertPos;
 	OutGridVertNormal = GridVertNormal;
 	OutGridBonePos = GridBonePos;
 	OutGridBoneRot = GridBoneRot;
+	return true;
 }
 
 
-static void EncodeData_Vec(const TArray <FVector4>& VectorData, const float MaxValue, const bool HDR, TArray <FFloat16Color>& Data)
+void VATBakeStages::EncodeData_Vec(const TArray <FVector4>& VectorData, const float MaxValue, const bool HDR, TArray <FFloat16Color>& Data)
 {
 	for (int32 i = 0; i < VectorData.Num(); i++)
 	{
@@ -685,10 +1728,28 @@ static void EncodeData_Vec(const TArray <FVector4>& VectorData, const float MaxV
 				Data[i] = FLinearColor(VectorValue.X, VectorValue.Y, VectorValue.Z, Mag);
 			}
 		}
+		else
+		{
+			// Data is reused between textures, so zero vectors have to be written too or they keep the previous texel
+			Data[i] = HDR ? FLinearColor(0.f, 0.f, 0.f, -1.f) : FLinearColor(0.5f, 0.5f, 0.5f, 0.f);
+		}
+	}
+}
+
+// Copies the first NumTexels texels as raw half floats, used for the profile's CPU side data
+static void StoreEncodedTexels(const TArray <FFloat16Color>& Data, const int32 NumTexels, TArray <uint16>& Out)
+{
+	Out.SetNumUninitialized(NumTexels * 4);
+	for (int32 i = 0; i < NumTexels; i++)
+	{
+		Out[i * 4 + 0] = Data[i].R.Encoded;
+		Out[i * 4 + 1] = Data[i].G.Encoded;
+		Out[i * 4 + 2] = Data[i].B.Encoded;
+		Out[i * 4 + 3] = Data[i].A.Encoded;
 	}
 }
 
-static void EncodeData_Quat(const bool HD, const TArray <FVector4>& VectorData, TArray <FFloat16Color>& Data)
+void VATBakeStages::EncodeData_Quat(const bool HD, const TArray <FVector4>& VectorData, TArray <FFloat16Color>& Data)
 {
 	for (int32 i = 0; i < VectorData.Num(); i++)
 	{
@@ -763,29 +1824,332 @@ static void EncodeData_Quat(const bool HD, const TArray <FVector4>& VectorData,
 				float R = FMath::Max(0.001f, FVertexAnimUtils::EncodeFloat(WinnerValue.X, MaxDim)) * (Bit0 ? 1.0 : -1.0);
 				//R = FVertexAnimUtils::EncodeFloat(R * (Bit0 ? 1.0 : -1.0), 1.0);
 
-				float G = FMath::Max(0.001f, FVertexAnimUtils::EncodeFloat(WinnerValue.Y, MaxDim)) * (Bit1 ? 1.0 : -1.0);
-				//G = FVertexAnimUtils::EncodeFloat(G * (Bit1 ? 1.0 : -1.0), 1.0);
+				float G = FMath::Max(0.001f, FVertexAnimUtils::EncodeFloat(WinnerValue.Y, MaxDim)) * (Bit1 ? 1.0 : -1.0);
+				//G = FVertexAnimUtils::EncodeFloat(G * (Bit1 ? 1.0 : -1.0), 1.0);
+
+				float B = WinnerValue.Z / MaxDim;// FVertexAnimUtils::EncodeFloat(WinnerValue.Z, MaxDim);
+
+				float A = -1.0 + ((MaxDim / 1.0) * 2.0);// 
+
+				Data[i] = FLinearColor(R, G, B, A);
+			}
+			else
+			{
+				Data[i] = FLinearColor(0, 0, 0, 1);
+			}
+		}
+	}
+}
+
+// Range the normals are normalized against in the UNorm formats, they only ever hold unit vectors
+static const FVAValueRange& NormalValueRange()
+{
+	static FVAValueRange Range = { FVector3f(-1.f), FVector3f(2.f) };
+	return Range;
+}
+
+// Vectors to [0, 1] against the range RangeOfTexel picks per texel, texels without a range are written as 0
+static void EncodeData_VecNormalized(
+	const TArray <FVector4>& VectorData, const TArray <FVAValueRange>& Ranges, TFunctionRef<int32(int32)> RangeOfTexel,
+	TArray <FLinearColor>& Data)
+{
+	for (int32 i = 0; i < VectorData.Num(); i++)
+	{
+		const int32 RangeIndex = RangeOfTexel(i);
+		if (!Ranges.IsValidIndex(RangeIndex))
+		{
+			Data[i] = FLinearColor(0.f, 0.f, 0.f, 1.f);
+			continue;
+		}
+
+		const FVAValueRange& Range = Ranges[RangeIndex];
+		FLinearColor Texel(0.f, 0.f, 0.f, 1.f);
+		for (int32 c = 0; c < 3; c++)
+		{
+			if (Range.Extent[c] > SMALL_NUMBER)
+			{
+				Texel.Component(c) = FMath::Clamp(((float)VectorData[i][c] - Range.Min[c]) / Range.Extent[c], 0.f, 1.f);
+			}
+		}
+		Data[i] = Texel;
+	}
+}
+
+// Quats to [0, 1] as (Q + 1) / 2, canonicalized to W >= 0. Unused (zero) texels become identity.
+static void EncodeData_QuatNormalized(const TArray <FVector4>& VectorData, TArray <FLinearColor>& Data)
+{
+	for (int32 i = 0; i < VectorData.Num(); i++)
+	{
+		FVector4 Q = VectorData[i];
+		if (Q.SizeSquared() <= SMALL_NUMBER) Q = FVector4(0.f, 0.f, 0.f, 1.f);
+		if (Q.W < 0.f) Q *= -1.f;
+
+		Data[i] = FLinearColor((Q.X + 1.f) * 0.5f, (Q.Y + 1.f) * 0.5f, (Q.Z + 1.f) * 0.5f, (Q.W + 1.f) * 0.5f);
+	}
+}
+
+// Quantizes [0, 1] texels to the UNorm8 source data and writes the texture
+static UTexture2D* SetTextureNormalized(
+	UWorld* World, const FString PackagePath, const FString Name,
+	UTexture2D* Texture,
+	const int32 InSizeX, const int32 InSizeY,
+	const TArray <FLinearColor>& Data, const EVATTexelFormat Format,
+	EObjectFlags InObjectFlags)
+{
+	check(Format == EVATTexelFormat::UNorm8);
+
+	// FColor is laid out BGRA, same as TSF_BGRA8
+	TArray <FColor> Raw;
+	Raw.SetNumUninitialized(Data.Num());
+	for (int32 i = 0; i < Data.Num(); i++) Raw[i] = Data[i].QuantizeRound();
+
+	return VATBakeStages::SetTextureRaw(World, PackagePath, Name, Texture, InSizeX, InSizeY, Raw.GetData(), TSF_BGRA8, InObjectFlags);
+}
+
+// Float16 textures keep the compression the stage always used, UNorm8 ones are built as uncompressed BGRA8
+static void SetTexelFormatCompression(UTexture2D* Texture, const EVATTexelFormat Format, const TextureCompressionSettings Float16Compression)
+{
+	if (Format == EVATTexelFormat::UNorm8)
+	{
+		Texture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
+	}
+	else
+	{
+		Texture->CompressionSettings = Float16Compression;
+	}
+	Texture->CompressionNone = false;
+}
+
+// Profiles saved with the dropped UNorm16 format bake as Float16
+static void ResolveTexelFormat(UVertexAnimProfile* Profile, EVATTexelFormat& Format)
+{
+	if (Format == EVATTexelFormat::UNorm16)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, the UNorm16 texel format is no longer supported, baking Float16"), *Profile->GetName());
+		Format = EVATTexelFormat::Float16;
+	}
+}
+
+// Clip covering each frame of a clip list (in frames, AnimStart_Generated / RowsPerFrame), INDEX_NONE for unused frames.
+// With DeduplicateFrames several clips can cover a frame, their ranges are merged so any of them will do.
+static void FrameClips(const TArray <FVASequenceData>& Anims, const int32 RowsPerFrame, const int32 NumFrames, TArray <int32>& OutFrameClips)
+{
+	OutFrameClips.Init(INDEX_NONE, NumFrames);
+	for (int32 i = 0; i < Anims.Num(); i++)
+	{
+		const int32 Start = Anims[i].AnimStart_Generated / RowsPerFrame;
+		for (int32 f = Start; f < FMath::Min(Start + Anims[i].NumFrames, NumFrames); f++)
+		{
+			OutFrameClips[f] = i;
+		}
+	}
+}
+
+// Groups of clips sharing frames after de-duplication, a shared row can only be normalized against one range
+static void SharedFrameGroups(const TArray <FVASequenceData>& Anims, const int32 RowsPerFrame, TArray <int32>& OutGroups)
+{
+	OutGroups.SetNumUninitialized(Anims.Num());
+	for (int32 i = 0; i < Anims.Num(); i++) OutGroups[i] = i;
+
+	for (int32 i = 0; i < Anims.Num(); i++)
+	{
+		const int32 StartA = Anims[i].AnimStart_Generated / RowsPerFrame;
+		for (int32 j = i + 1; j < Anims.Num(); j++)
+		{
+			const int32 StartB = Anims[j].AnimStart_Generated / RowsPerFrame;
+			const bool bOverlap = (StartA < StartB + Anims[j].NumFrames) && (StartB < StartA + Anims[i].NumFrames);
+			if (!bOverlap || (OutGroups[i] == OutGroups[j])) continue;
+
+			const int32 From = OutGroups[j];
+			for (int32& Group : OutGroups)
+			{
+				if (Group == From) Group = OutGroups[i];
+			}
+		}
+	}
+}
+
+// Bounds of Values over NumFrames frames of FrameSize texels, per texel column (Stride) or for all of them (Stride 1)
+static void GrowValueBounds(
+	const TArray <FVector4>& Values, const int32 FirstFrame, const int32 NumFrames, const int32 FrameSize, const int32 Stride,
+	TArray <FVector3f>& InOutMin, TArray <FVector3f>& InOutMax)
+{
+	for (int32 f = FirstFrame; f < FirstFrame + NumFrames; f++)
+	{
+		for (int32 k = 0; k < FrameSize; k++)
+		{
+			const int32 Index = f * FrameSize + k;
+			if (!Values.IsValidIndex(Index)) return;
+
+			const FVector3f Value(Values[Index].X, Values[Index].Y, Values[Index].Z);
+			const int32 Column = k % Stride;
+			InOutMin[Column] = InOutMin[Column].ComponentMin(Value);
+			InOutMax[Column] = InOutMax[Column].ComponentMax(Value);
+		}
+	}
+}
+
+static FVAValueRange MakeValueRange(const FVector3f& Min, const FVector3f& Max)
+{
+	FVAValueRange Range;
+	if (Min.X > Max.X) return Range; // never grown
+
+	Range.Min = Min;
+	Range.Extent = Max - Min;
+	return Range;
+}
+
+// Fills the profile's range tables for the UNorm texel formats, from the final (de-duplicated) layout
+static void CalcValueRanges(UVertexAnimProfile* Profile, const TArray <FVector4>& VertPos, const TArray <FVector4>& BonePos)
+{
+	Profile->ValueRanges_Vert.Empty();
+	Profile->ValueRanges_Bone.Empty();
+
+	TArray <int32> Groups;
+
+	if (Profile->Anims_Vert.Num() && (Profile->TexelFormat_Vert != EVATTexelFormat::Float16))
+	{
+		const int32 RowsPerFrame = Profile->RowsPerFrame_Vert;
+		const int32 FrameSize = Profile->OverrideSize_Vert.X * RowsPerFrame;
+		SharedFrameGroups(Profile->Anims_Vert, RowsPerFrame, Groups);
+
+		for (int32 i = 0; i < Profile->Anims_Vert.Num(); i++)
+		{
+			TArray <FVector3f> Min = { FVector3f(BIG_NUMBER) };
+			TArray <FVector3f> Max = { FVector3f(-BIG_NUMBER) };
+			for (int32 j = 0; j < Profile->Anims_Vert.Num(); j++)
+			{
+				if (Groups[j] != Groups[i]) continue;
+				GrowValueBounds(VertPos, Profile->Anims_Vert[j].AnimStart_Generated / RowsPerFrame, Profile->Anims_Vert[j].NumFrames, FrameSize, 1, Min, Max);
+			}
+			Profile->ValueRanges_Vert.Add(MakeValueRange(Min[0], Max[0]));
+		}
+	}
+
+	if (Profile->Anims_Bone.Num() && (Profile->TexelFormat_Bone != EVATTexelFormat::Float16))
+	{
+		const int32 Width = Profile->OverrideSize_Bone.X;
+		SharedFrameGroups(Profile->Anims_Bone, 1, Groups);
+
+		TArray <FVector3f> Min, Max;
+		auto AddBlock = [&]()
+		{
+			for (int32 b = 0; b < Width; b++) Profile->ValueRanges_Bone.Add(MakeValueRange(Min[b], Max[b]));
+		};
+
+		// Block 0, the ref pose row
+		Min.Init(FVector3f(BIG_NUMBER), Width);
+		Max.Init(FVector3f(-BIG_NUMBER), Width);
+		GrowValueBounds(BonePos, 0, 1, Width, Width, Min, Max);
+		AddBlock();
+
+		for (int32 i = 0; i < Profile->Anims_Bone.Num(); i++)
+		{
+			Min.Init(FVector3f(BIG_NUMBER), Width);
+			Max.Init(FVector3f(-BIG_NUMBER), Width);
+			for (int32 j = 0; j < Profile->Anims_Bone.Num(); j++)
+			{
+				if (Groups[j] != Groups[i]) continue;
+				GrowValueBounds(BonePos, Profile->Anims_Bone[j].AnimStart_Generated, Profile->Anims_Bone[j].NumFrames, Width, Width, Min, Max);
+			}
+			AddBlock();
+		}
+	}
+}
+
+static FLinearColor ToRangeTexel(const FVector3f& Value)
+{
+	return FLinearColor(Value.X, Value.Y, Value.Z, 0.f);
+}
+
+// The range table as a float texture, see UVertexAnimProfile::RangesTexture for the layout
+static void BakeRangesTexture(UVertexAnimProfile* Profile, UWorld* World, const FString& PackagePath)
+{
+	if (!Profile->ValueRanges_Vert.Num() && !Profile->ValueRanges_Bone.Num()) return;
+
+	const int32 Width = FMath::Max(FMath::Max(Profile->ValueRanges_Vert.Num(), Profile->OverrideSize_Bone.X), 1);
+	const int32 NumBlocks_Bone = Profile->ValueRanges_Bone.Num() ? (Profile->ValueRanges_Bone.Num() / Profile->OverrideSize_Bone.X) : 0;
+	const int32 Height = 2 + (NumBlocks_Bone * 2);
 
-				float B = WinnerValue.Z / MaxDim;// FVertexAnimUtils::EncodeFloat(WinnerValue.Z, MaxDim);
+	TArray <FLinearColor> Data;
+	Data.SetNumZeroed(Width * Height);
 
-				float A = -1.0 + ((MaxDim / 1.0) * 2.0);// 
+	for (int32 i = 0; i < Profile->ValueRanges_Vert.Num(); i++)
+	{
+		Data[i] = ToRangeTexel(Profile->ValueRanges_Vert[i].Min);
+		Data[Width + i] = ToRangeTexel(Profile->ValueRanges_Vert[i].Extent);
+	}
+	for (int32 i = 0; i < Profile->ValueRanges_Bone.Num(); i++)
+	{
+		const int32 Block = i / Profile->OverrideSize_Bone.X;
+		const int32 Bone = i % Profile->OverrideSize_Bone.X;
+		Data[(2 + Block * 2) * Width + Bone] = ToRangeTexel(Profile->ValueRanges_Bone[i].Min);
+		Data[(3 + Block * 2) * Width + Bone] = ToRangeTexel(Profile->ValueRanges_Bone[i].Extent);
+	}
 
-				Data[i] = FLinearColor(R, G, B, A);
-			}
-			else
-			{
-				Data[i] = FLinearColor(0, 0, 0, 1);
-			}
-		}
+	Profile->RangesTexture = VATBakeStages::SetTextureRaw(World, PackagePath,
+		Profile->GetName() + "_Ranges", Profile->RangesTexture,
+		Width, Height,
+		Data.GetData(), TSF_RGBA32F,
+		Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+
+	Profile->RangesTexture->Filter = TextureFilter::TF_Nearest;
+	Profile->RangesTexture->NeverStream = true;
+	Profile->RangesTexture->CompressionSettings = TextureCompressionSettings::TC_HDR_F32;
+	Profile->RangesTexture->SRGB = false;
+	Profile->RangesTexture->Modify();
+	Profile->RangesTexture->MarkPackageDirty();
+	Profile->RangesTexture->PostEditChange();
+	Profile->RangesTexture->UpdateResource();
+}
+
+// MirrorBones as one row of float texels, R holds the U of the mirror bone's column
+static void BakeBoneMirrorTexture(UVertexAnimProfile* Profile, UWorld* World, const FString& PackagePath)
+{
+	if (!Profile->MirrorBones.Num()) return;
+
+	const int32 Width = Profile->OverrideSize_Bone.X;
+
+	TArray <FLinearColor> Data;
+	Data.SetNumZeroed(Width);
+	for (int32 b = 0; b < Width; b++)
+	{
+		const int32 Mirror = Profile->MirrorBones.IsValidIndex(b) ? Profile->MirrorBones[b] : b;
+		Data[b] = FLinearColor(Mirror * (1.f / Width), 0.f, 0.f, 0.f);
 	}
+
+	Profile->BoneMirrorTexture = VATBakeStages::SetTextureRaw(World, PackagePath,
+		Profile->GetName() + "_BoneMirror", Profile->BoneMirrorTexture,
+		Width, 1,
+		Data.GetData(), TSF_RGBA32F,
+		Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+
+	Profile->BoneMirrorTexture->Filter = TextureFilter::TF_Nearest;
+	Profile->BoneMirrorTexture->NeverStream = true;
+	Profile->BoneMirrorTexture->CompressionSettings = TextureCompressionSettings::TC_HDR_F32;
+	Profile->BoneMirrorTexture->SRGB = false;
+	Profile->BoneMirrorTexture->Modify();
+	Profile->BoneMirrorTexture->MarkPackageDirty();
+	Profile->BoneMirrorTexture->PostEditChange();
+	Profile->BoneMirrorTexture->UpdateResource();
 }
 
-static UTexture2D* SetTexture2(
+UTexture2D* VATBakeStages::SetTexture2(
 	UWorld* World, const FString PackagePath, const FString Name, 
 	UTexture2D* Texture, 
 	const int32 InSizeX, const int32 InSizeY,
 	const TArray <FFloat16Color>& Data, //const TArray <FVector>& VectorData,
 	EObjectFlags InObjectFlags)
+{
+	return VATBakeStages::SetTextureRaw(World, PackagePath, Name, Texture, InSizeX, InSizeY, Data.GetData(), TSF_RGBA16F, InObjectFlags);
+}
+
+UTexture2D* VATBakeStages::SetTextureRaw(
+	UWorld* World, const FString PackagePath, const FString Name,
+	UTexture2D* Texture,
+	const int32 InSizeX, const int32 InSizeY,
+	const void* RawData, const ETextureSourceFormat SourceFormat,
+	EObjectFlags InObjectFlags)
 {
 	UTexture2D* NewTexture;
 
@@ -809,11 +2173,11 @@ static UTexture2D* SetTexture2(
 
 		checkf(NewTexture, TEXT("%s"), *Name);
 
-		NewTexture->Source.Init(InSizeX, InSizeY, /*NumSlices=*/ 1, /*NumMips=*/ 1, TSF_RGBA16F);
+		NewTexture->Source.Init(InSizeX, InSizeY, /*NumSlices=*/ 1, /*NumMips=*/ 1, SourceFormat);
 		uint32* TextureData = (uint32*)NewTexture->Source.LockMip(0);
 		const int32 TextureDataSize = NewTexture->Source.CalcMipSize(0);
 		
-		FMemory::Memcpy(TextureData, Data.GetData(), TextureDataSize); // this did not blow up 
+		FMemory::Memcpy(TextureData, RawData, TextureDataSize); // this did not blow up 
 		
 		NewTexture->Source.UnlockMip(0);
 
@@ -862,10 +2226,37 @@ int FVATEditorUtils::UnPackBits(const float N)
 	return float(result);
 }
 
+// The preview component plus, with MergeAttachedMeshes, every attached skinned component sharing its skeleton
+// and every attached static mesh component, so modular characters bake into one mesh and one set of textures
+static void GatherBakeComponents(UDebugSkelMeshComponent* PreviewComponent, const UVertexAnimProfile* Profile, TArray <UMeshComponent*>& OutComponents)
+{
+	OutComponents = { PreviewComponent };
+
+	if (!Profile->MergeAttachedMeshes) return;
+
+	TArray <USceneComponent*> Children;
+	PreviewComponent->GetChildrenComponents(true, Children);
+
+	for (USceneComponent* Child : Children)
+	{
+		UMeshComponent* MeshComponent = Cast<UMeshComponent>(Child);
+		if (!FVertexAnimUtils::IsConvertibleMeshComponent(MeshComponent)) continue;
+
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(MeshComponent))
+		{
+			if (!SkinnedComponent->SkeletalMesh || (SkinnedComponent->SkeletalMesh->Skeleton != PreviewComponent->SkeletalMesh->Skeleton))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("VAT Bake: skipping %s, it does not share the preview mesh's skeleton"), *SkinnedComponent->GetName());
+				continue;
+			}
+		}
+
+		OutComponents.Add(MeshComponent);
+	}
+}
+
 void FVATEditorUtils::DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent)
 {
-	PreviewComponent->GlobalAnimRateScale = 0.f;
-	
 	UVertexAnimProfile* Profile = NULL;
 
 	FString MeshName;
@@ -905,24 +2296,308 @@ void FVATEditorUtils::DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent)
 	}
 
 
-	bool DoAnimBake = (Profile != NULL) && !bOnlyCreateStaticMesh;
-	bool DoStaticMesh = (Profile != NULL);
+	if (Profile == NULL) return;
+
+	FText Error;
+	if (!BakeProfile(PreviewComponent, Profile, bOnlyCreateStaticMesh, Error))
+	{
+		FMessageDialog::Open(EAppMsgType::Ok, Error);
+	}
+}
+
+// Moves the texels of NumFrames frames of a vert texture, sampled in the FrameRows layout, to the profile's Layout_Vert
+template <typename TexelType>
+static void ToVertLayout(const UVertexAnimProfile* Profile, const int32 NumFrames, TArray <TexelType>& InOutTexels)
+{
+	if (Profile->Layout_Vert == EVATVertLayout::FrameRows) return;
+
+	const int32 Width = Profile->OverrideSize_Vert.X;
+	const int32 RowsPerFrame = Profile->RowsPerFrame_Vert;
+
+	// Whole rows move, frames only swap rows with each other
+	const TArray <TexelType> Sampled(InOutTexels.GetData(), NumFrames * RowsPerFrame * Width);
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (int32 RowInFrame = 0; RowInFrame < RowsPerFrame; RowInFrame++)
+		{
+			const FIntPoint Texel = UVertexAnimProfile::CalcVertTexel(Profile->Layout_Vert, Width, RowsPerFrame, NumFrames, RowInFrame * Width, Frame);
+			FMemory::Memcpy(&InOutTexels[Texel.Y * Width], &Sampled[(Frame * RowsPerFrame + RowInFrame) * Width], Width * sizeof(TexelType));
+		}
+	}
+}
+
+// Moves vert anim UVs mapped against a frame rows texture SampledHeight rows high to the final texture:
+// its height after frame de-duplication and the profile's Layout_Vert for NumFrames stored frames
+static void ApplyVertLayout(UVertexAnimProfile* Profile, const int32 SampledHeight, const int32 NumFrames, const TArray <TArray <TArray <FVector2D>>*>& InOutUVSets)
+{
+	const bool bInterleaved = (Profile->Layout_Vert == EVATVertLayout::FrameInterleaved);
+	Profile->FrameRowStep_Vert = bInterleaved ? 1 : Profile->RowsPerFrame_Vert;
+	if (!bInterleaved && (SampledHeight == Profile->OverrideSize_Vert.Y)) return;
+
+	const int32 Width = Profile->OverrideSize_Vert.X;
+	for (TArray <TArray <FVector2D>>* UVSet : InOutUVSets)
+	{
+		for (TArray <FVector2D>& LODUVs : *UVSet)
+		{
+			for (FVector2D& UV : LODUVs)
+			{
+				// Frame 0 row of the vert, the texel column stays
+				const int32 RowInFrame = FMath::RoundToInt(UV.Y * SampledHeight);
+				const FIntPoint Texel = UVertexAnimProfile::CalcVertTexel(Profile->Layout_Vert, Width, Profile->RowsPerFrame_Vert, NumFrames, RowInFrame * Width, 0);
+				UV.Y = (float)Texel.Y / (float)Profile->OverrideSize_Vert.Y;
+			}
+		}
+	}
+}
+
+// Encodes the sampled grids into the profile's textures, the range table and the mirror texture
+static void BakeProfileTextures(
+	UVertexAnimProfile* Profile, UWorld* World,
+	const TArray <FVector4>& VertPos, const TArray <FVector4>& VertNormal, const TArray <FVector4>& BonePos, const TArray <FVector4>& BoneRot)
+{
+	int32 TextureWidth_Vert = Profile->OverrideSize_Vert.X;
+	int32 TextureHeight_Vert = Profile->OverrideSize_Vert.Y;
+	int32 TextureWidth_Bone = Profile->OverrideSize_Bone.X;
+	int32 TextureHeight_Bone = Profile->OverrideSize_Bone.Y;
+
+	FString AssetName = Profile->GetOutermost()->GetName();
+	const FString SanitizedBasePackageName = UPackageTools::SanitizePackageName(AssetName);
+	const FString PackagePath = FPackageName::GetLongPackagePath(SanitizedBasePackageName) + TEXT("/");
+
+	ResolveTexelFormat(Profile, Profile->TexelFormat_Vert);
+	ResolveTexelFormat(Profile, Profile->TexelFormat_Bone);
+
+	CalcValueRanges(Profile, VertPos, BonePos);
+	BakeRangesTexture(Profile, World, PackagePath);
+	BakeBoneMirrorTexture(Profile, World, PackagePath);
+
+	// Vert Textures
+	if(Profile->Anims_Vert.Num())
+	{
+		const EVATTexelFormat Format = Profile->TexelFormat_Vert;
+
+		// The half float data is also needed for the CPU copy, FVertexAnimVertSampler decodes that one
+		TArray <FFloat16Color> Data;
+		TArray <FLinearColor> NormalizedData;
+		if ((Format == EVATTexelFormat::Float16) || Profile->CPUVertSampling) Data.SetNumZeroed(TextureWidth_Vert * TextureHeight_Vert);
+		if (Format != EVATTexelFormat::Float16) NormalizedData.SetNumZeroed(TextureWidth_Vert * TextureHeight_Vert);
+
+		// Range of each texel for the UNorm formats, the clip covering its frame
+		const int32 FrameSize = TextureWidth_Vert * Profile->RowsPerFrame_Vert;
+		const int32 NumFrames = VertPos.Num() / FrameSize;
+		TArray <int32> FrameClipIndices;
+		if (Format != EVATTexelFormat::Float16) FrameClips(Profile->Anims_Vert, Profile->RowsPerFrame_Vert, NumFrames, FrameClipIndices);
+
+		{
+			if ((Format == EVATTexelFormat::Float16) || Profile->CPUVertSampling)
+			{
+				VATBakeStages::EncodeData_Vec(VertNormal, 2.f, false, Data); // decided on fixed 2.0 for simplicity
+			}
+
+			if (Profile->CPUVertSampling) StoreEncodedTexels(Data, VertNormal.Num(), Profile->NormalsTextureData);
+			else Profile->NormalsTextureData.Empty();
+
+			if (Format == EVATTexelFormat::Float16)
+			{
+				ToVertLayout(Profile, NumFrames, Data);
+
+				Profile->NormalsTexture = VATBakeStages::SetTexture2(World, PackagePath,
+					Profile->GetName() + "_Normals", Profile->NormalsTexture,
+					TextureWidth_Vert, TextureHeight_Vert,
+					Data,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+			else
+			{
+				EncodeData_VecNormalized(VertNormal, { NormalValueRange() }, [](int32) { return 0; }, NormalizedData);
+				ToVertLayout(Profile, NumFrames, NormalizedData);
+
+				Profile->NormalsTexture = SetTextureNormalized(World, PackagePath,
+					Profile->GetName() + "_Normals", Profile->NormalsTexture,
+					TextureWidth_Vert, TextureHeight_Vert,
+					NormalizedData, Format,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+
+			Profile->NormalsTexture->Filter = TextureFilter::TF_Nearest;
+			Profile->NormalsTexture->NeverStream = true;
+			SetTexelFormatCompression(Profile->NormalsTexture, Format, TextureCompressionSettings::TC_VectorDisplacementmap);
+			Profile->NormalsTexture->SRGB = false;
+			Profile->NormalsTexture->Modify();
+			Profile->NormalsTexture->MarkPackageDirty();
+			Profile->NormalsTexture->PostEditChange();
+			Profile->NormalsTexture->UpdateResource();
+		}
+
+
+		{
+			if ((Format == EVATTexelFormat::Float16) || Profile->CPUVertSampling)
+			{
+				VATBakeStages::EncodeData_Vec(VertPos, Profile->MaxValueOffset_Vert, true, Data);
+			}
+
+			if (Profile->CPUVertSampling) StoreEncodedTexels(Data, VertPos.Num(), Profile->OffsetsTextureData);
+			else Profile->OffsetsTextureData.Empty();
+
+			if (Format == EVATTexelFormat::Float16)
+			{
+				ToVertLayout(Profile, NumFrames, Data);
+
+				Profile->OffsetsTexture = VATBakeStages::SetTexture2(World, PackagePath,
+					Profile->GetName() + "_Offsets", Profile->OffsetsTexture,
+					TextureWidth_Vert, TextureHeight_Vert,
+					Data,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+			else
+			{
+				EncodeData_VecNormalized(VertPos, Profile->ValueRanges_Vert,
+					[&](int32 Texel) { return FrameClipIndices.IsValidIndex(Texel / FrameSize) ? FrameClipIndices[Texel / FrameSize] : INDEX_NONE; },
+					NormalizedData);
+				ToVertLayout(Profile, NumFrames, NormalizedData);
+
+				Profile->OffsetsTexture = SetTextureNormalized(World, PackagePath,
+					Profile->GetName() + "_Offsets", Profile->OffsetsTexture,
+					TextureWidth_Vert, TextureHeight_Vert,
+					NormalizedData, Format,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+
+			Profile->OffsetsTexture->Filter = TextureFilter::TF_Nearest;
+			Profile->OffsetsTexture->NeverStream = true;
+			SetTexelFormatCompression(Profile->OffsetsTexture, Format, TextureCompressionSettings::TC_HDR);
+			Profile->OffsetsTexture->SRGB = false;
+			Profile->OffsetsTexture->Modify();
+			Profile->OffsetsTexture->MarkPackageDirty();
+			Profile->OffsetsTexture->PostEditChange();
+			Profile->OffsetsTexture->UpdateResource();
+		}
+	
+	}
+
+	// Bone Textures
+	if (Profile->Anims_Bone.Num())
+	{
+		const EVATTexelFormat Format = Profile->TexelFormat_Bone;
+
+		// The half float data is still needed for the CPU copy, FVertexAnimBoneSampler decodes that one
+		TArray <FFloat16Color> Data;
+		Data.SetNumZeroed(TextureWidth_Bone*TextureHeight_Bone);
+		TArray <FLinearColor> NormalizedData;
+		if (Format != EVATTexelFormat::Float16) NormalizedData.SetNumZeroed(TextureWidth_Bone * TextureHeight_Bone);
+
+		// Range of each texel for the UNorm formats, the clip block covering its row and its bone column
+		TArray <int32> RowClipIndices;
+		if (Format != EVATTexelFormat::Float16) FrameClips(Profile->Anims_Bone, 1, BonePos.Num() / TextureWidth_Bone, RowClipIndices);
+		auto BoneRangeOfTexel = [&](int32 Texel)
+		{
+			const int32 Row = Texel / TextureWidth_Bone;
+			const int32 Block = (Row == 0) ? 0 : (RowClipIndices.IsValidIndex(Row) && (RowClipIndices[Row] != INDEX_NONE)) ? RowClipIndices[Row] + 1 : INDEX_NONE;
+			return (Block == INDEX_NONE) ? INDEX_NONE : Block * TextureWidth_Bone + (Texel % TextureWidth_Bone);
+		};
+
+		{
+			VATBakeStages::EncodeData_Quat(true, BoneRot, Data);
+
+			if (Profile->CPUBoneSampling) StoreEncodedTexels(Data, BoneRot.Num(), Profile->BoneRotTextureData);
+			else Profile->BoneRotTextureData.Empty();
+
+			if (Format == EVATTexelFormat::Float16)
+			{
+				Profile->BoneRotTexture = VATBakeStages::SetTexture2(World, PackagePath, 
+					Profile->GetName() + "_BoneRot", Profile->BoneRotTexture,
+					TextureWidth_Bone, TextureHeight_Bone, 
+					Data,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+			else
+			{
+				EncodeData_QuatNormalized(BoneRot, NormalizedData);
+
+				Profile->BoneRotTexture = SetTextureNormalized(World, PackagePath,
+					Profile->GetName() + "_BoneRot", Profile->BoneRotTexture,
+					TextureWidth_Bone, TextureHeight_Bone,
+					NormalizedData, Format,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+
+			Profile->BoneRotTexture->Filter = TextureFilter::TF_Nearest;
+			Profile->BoneRotTexture->NeverStream = true;
+			SetTexelFormatCompression(Profile->BoneRotTexture, Format, TextureCompressionSettings::TC_HDR);
+			Profile->BoneRotTexture->SRGB = false;
+			Profile->BoneRotTexture->Modify();
+			Profile->BoneRotTexture->MarkPackageDirty();
+			Profile->BoneRotTexture->PostEditChange();
+			Profile->BoneRotTexture->UpdateResource();
+		}
+
+		{
+			VATBakeStages::EncodeData_Vec(BonePos, Profile->MaxValuePosition_Bone, true, Data);
+
+			if (Profile->CPUBoneSampling) StoreEncodedTexels(Data, BonePos.Num(), Profile->BonePosTextureData);
+			else Profile->BonePosTextureData.Empty();
+
+			if (Format == EVATTexelFormat::Float16)
+			{
+				Profile->BonePosTexture = VATBakeStages::SetTexture2(World, PackagePath,
+					Profile->GetName() + "_BonePos", Profile->BonePosTexture,
+					TextureWidth_Bone, TextureHeight_Bone, 
+					Data,//BonePos,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+			else
+			{
+				EncodeData_VecNormalized(BonePos, Profile->ValueRanges_Bone, BoneRangeOfTexel, NormalizedData);
+
+				Profile->BonePosTexture = SetTextureNormalized(World, PackagePath,
+					Profile->GetName() + "_BonePos", Profile->BonePosTexture,
+					TextureWidth_Bone, TextureHeight_Bone,
+					NormalizedData, Format,
+					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+			}
+
+			Profile->BonePosTexture->Filter = TextureFilter::TF_Nearest;
+			Profile->BonePosTexture->NeverStream = true;
+			SetTexelFormatCompression(Profile->BonePosTexture, Format, TextureCompressionSettings::TC_HDR);
+			Profile->BonePosTexture->SRGB = false;
+
+			Profile->BonePosTexture->Modify();
+			Profile->BonePosTexture->MarkPackageDirty();
+			Profile->BonePosTexture->PostEditChange();
+			Profile->BonePosTexture->UpdateResource();
+		}
+
+	}
+}
+
+bool FVATEditorUtils::BakeProfile(UDebugSkelMeshComponent* PreviewComponent, UVertexAnimProfile* Profile, const bool bOnlyCreateStaticMesh, FText& OutError)
+{
+	PreviewComponent->GlobalAnimRateScale = 0.f;
+
+	bool DoAnimBake = !bOnlyCreateStaticMesh;
+	bool DoStaticMesh = true;
+
+	FString PackageName;
 
-	if ((!DoAnimBake) && (!DoStaticMesh)) return;
+	// Components merged into the one VAT mesh, the preview component first
+	TArray <UMeshComponent*> Components;
+	GatherBakeComponents(PreviewComponent, Profile, Components);
 
-	TArray <int32> UniqueSourceIDs;
+	TArray <TArray <int32>> UniqueSourceIDs;
 	TArray <TArray <FVector2D>> UVs_VertAnim;
+	TArray <TArray <FVector2D>> UVs_VertMirror;
 	TArray <TArray <FVector2D>> UVs_BoneAnim1;
 	TArray <TArray <FVector2D>> UVs_BoneAnim2;
 	TArray <TArray <FColor>> Colors_BoneAnim;
 
 	{
 		{
-			SkinnedMeshVATData(
-				PreviewComponent,
+			VATBakeStages::SkinnedMeshVATData(
+				Components,
 				Profile,
 				UniqueSourceIDs,
 				UVs_VertAnim,
+				UVs_VertMirror,
 				UVs_BoneAnim1,
 				UVs_BoneAnim2,
 				Colors_BoneAnim);
@@ -931,20 +2606,57 @@ void FVATEditorUtils::DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent)
 		if ((Profile->CalcTotalRequiredHeight_Vert() > Profile->OverrideSize_Vert.Y) ||
 			(Profile->CalcTotalRequiredHeight_Bone() > Profile->OverrideSize_Bone.Y))
 		{
-			FMessageDialog::Open(EAppMsgType::Ok, LOCTEXT("SelectedProfileRequiresMoreHeight", "Selected Profile Requires More Texture Height"));
-			return;
+			// Without AutoSize the per-LOD blocks are laid out in OverrideSize_Vert as given, say how much they need
+			if (Profile->PerLODRows_Vert && (Profile->CalcTotalRequiredHeight_Vert() > Profile->OverrideSize_Vert.Y))
+			{
+				UE_LOG(LogTemp, Error, TEXT("VAT Bake: %s, the %d per-LOD row blocks need %d rows per frame, %d in total, OverrideSize_Vert is %s"),
+					*Profile->GetName(), Profile->LODRowOffset_Vert.Num(), Profile->RowsPerFrame_Vert,
+					Profile->CalcTotalRequiredHeight_Vert(), *Profile->OverrideSize_Vert.ToString());
+			}
+			OutError = LOCTEXT("SelectedProfileRequiresMoreHeight", "Selected Profile Requires More Texture Height");
+			return false;
 		}
 
 		if ((Profile->OverrideSize_Vert.GetMax() > 4096) ||
 			(Profile->OverrideSize_Bone.GetMax() > 4096))
 		{
-			FMessageDialog::Open(EAppMsgType::Ok,
-				LOCTEXT("TooMuch", "Warning: required texture size exceeds UE texture resolution limit, Mesh has too many vertices and/or Profile has too many animation frames"));
-			return;
+			OutError = LOCTEXT("TooMuch", "Warning: required texture size exceeds UE texture resolution limit, Mesh has too many vertices and/or Profile has too many animation frames");
+			return false;
+		}
+
+		// The VAT channels go after the mesh's own UV channels, BakeMirrorMaps adds one more
+		const int32 MaxVATChannel = FMath::Max(
+			FMath::Max3(Profile->UVChannel_VertAnim, Profile->UVChannel_BoneAnim, Profile->UVChannel_BoneAnim_Full),
+			Profile->UVChannel_VertMirror);
+		if (MaxVATChannel >= MAX_MESH_TEXTURE_COORDS_MD)
+		{
+			UE_LOG(LogTemp, Error, TEXT("VAT Bake: %s, the VAT UV channels need %d channels, meshes have at most %d"),
+				*Profile->GetName(), MaxVATChannel + 1, MAX_MESH_TEXTURE_COORDS_MD);
+			OutError = LOCTEXT("TooManyUVChannels", "The mesh has too many UV channels left for the VAT UVs, remove some of its UV channels or turn off BakeMirrorMaps / FullBoneSkinning");
+			return false;
 		}
 	}
 
 
+	// Sampled before the static mesh is made, frame de-duplication can still shrink the vert texture its UVs point into
+	TArray <FVector4> VertPos, VertNormal, BonePos, BoneRot;
+	if (DoAnimBake)
+	{
+		const int32 SampledHeight_Vert = Profile->OverrideSize_Vert.Y;
+
+		if (!VATBakeStages::GatherAndBakeAllAnimVertData(Profile, PreviewComponent, Components, UniqueSourceIDs, VertPos, VertNormal, BonePos, BoneRot))
+		{
+			OutError = LOCTEXT("VertAnimSampling", "Could not sample the vert anim frames, the skinned vert count changed between frames");
+			return false;
+		}
+
+		if (Profile->Anims_Vert.Num())
+		{
+			const int32 NumFrames_Vert = VertPos.Num() / (Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert);
+			ApplyVertLayout(Profile, SampledHeight_Vert, NumFrames_Vert, { &UVs_VertAnim, &UVs_VertMirror });
+		}
+	}
+
 	if (DoStaticMesh)
 	{
 		if (Profile->StaticMesh && (!bOnlyCreateStaticMesh))
@@ -962,17 +2674,25 @@ void FVATEditorUtils::DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent)
 			PackageName = PackagePath;
 		}
 
-		UStaticMesh* StaticMesh = FVertexAnimUtils::ConvertMeshesToStaticMesh( { PreviewComponent }, FTransform::Identity, PackageName);
+		// Built once, after all the VAT attributes are written
+		UStaticMesh* StaticMesh = FVertexAnimUtils::ConvertMeshesToStaticMesh(Components, PreviewComponent->GetComponentTransform(), PackageName, false);
 
-		if (Profile->UVChannel_VertAnim != -1) FVertexAnimUtils::VATUVsToStaticMeshLODs(StaticMesh, Profile->UVChannel_VertAnim, UVs_VertAnim);
-		if (Profile->UVChannel_BoneAnim != -1) FVertexAnimUtils::VATUVsToStaticMeshLODs(StaticMesh, Profile->UVChannel_BoneAnim, UVs_BoneAnim1);
+		FVATMeshAttributes VATAttributes;
+		if (Profile->UVChannel_VertAnim != -1) VATAttributes.AddUVChannel(Profile->UVChannel_VertAnim, UVs_VertAnim);
+		if (Profile->UVChannel_VertMirror != -1) VATAttributes.AddUVChannel(Profile->UVChannel_VertMirror, UVs_VertMirror);
+		if (Profile->UVChannel_BoneAnim != -1) VATAttributes.AddUVChannel(Profile->UVChannel_BoneAnim, UVs_BoneAnim1);
 		if (Profile->UVChannel_BoneAnim_Full != -1)
 		{
-			FVertexAnimUtils::VATUVsToStaticMeshLODs(StaticMesh, Profile->UVChannel_BoneAnim_Full, UVs_BoneAnim2);
-			FVertexAnimUtils::VATColorsToStaticMeshLODs(StaticMesh, Colors_BoneAnim);
+			VATAttributes.AddUVChannel(Profile->UVChannel_BoneAnim_Full, UVs_BoneAnim2);
+			VATAttributes.Colors = Colors_BoneAnim;
 		}
 
+		FVertexAnimUtils::VATAttributesToStaticMeshLODs(StaticMesh, VATAttributes);
+
 		Profile->StaticMesh = StaticMesh;
+#if WITH_EDITORONLY_DATA
+		Profile->SourceMesh = PreviewComponent->SkeletalMesh;
+#endif
 		Profile->MarkPackageDirty();
 	}
 
@@ -980,116 +2700,144 @@ void FVATEditorUtils::DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent)
 
 	if (DoAnimBake)
 	{
-		int32 TextureWidth_Vert = Profile->OverrideSize_Vert.X;
-		int32 TextureHeight_Vert = Profile->OverrideSize_Vert.Y;
-		int32 TextureWidth_Bone = Profile->OverrideSize_Bone.X;
-		int32 TextureHeight_Bone = Profile->OverrideSize_Bone.Y;
-
-		
-		TArray <FVector4> VertPos, VertNormal, BonePos, BoneRot;
-		GatherAndBakeAllAnimVertData(Profile, PreviewComponent, UniqueSourceIDs, VertPos, VertNormal, BonePos, BoneRot);
-
-		FString AssetName = Profile->GetOutermost()->GetName();
-		const FString SanitizedBasePackageName = UPackageTools::SanitizePackageName(AssetName);
-		const FString PackagePath = FPackageName::GetLongPackagePath(SanitizedBasePackageName) + TEXT("/");
+		BakeProfileTextures(Profile, PreviewComponent->GetWorld(), VertPos, VertNormal, BonePos, BoneRot);
+	}
 
-		// Vert Textures
-		if(Profile->Anims_Vert.Num())
-		{
-			TArray <FFloat16Color> Data;
-			Data.SetNumZeroed(TextureWidth_Vert * TextureHeight_Vert);
+	return true;
+}
 
+bool FVATEditorUtils::BakeFrameSource(FVATFrameSource& Source, UVertexAnimProfile* Profile, const FString& MeshPackageName, FText& OutError)
+{
+	if (Profile->Anims_Bone.Num())
+	{
+		OutError = LOCTEXT("FrameSourceNoBoneAnim", "Bone anim needs a skeletal mesh, clear Anims_Bone to bake this source");
+		return false;
+	}
+	if (!Source.GetNumClips() || !Source.GetNumLODs())
+	{
+		OutError = LOCTEXT("FrameSourceEmpty", "The frame source has no clips or no mesh");
+		return false;
+	}
 
-			{
-				EncodeData_Vec(VertNormal, 2.f, false, Data); // decided on fixed 2.0 for simplicity
+	// One clip per source clip, frame counts set on the profile are kept
+	const int32 NumProfileClips = Profile->Anims_Vert.Num();
+	Profile->Anims_Vert.SetNum(Source.GetNumClips());
+	for (int32 i = 0; i < Profile->Anims_Vert.Num(); i++)
+	{
+		Profile->Anims_Vert[i].SequenceRef = NULL;
+		if (i >= NumProfileClips) Profile->Anims_Vert[i].NumFrames = Source.GetDefaultNumFrames(i);
+	}
 
-				Profile->NormalsTexture = SetTexture2(PreviewComponent->GetWorld(), PackagePath,
-					Profile->GetName() + "_Normals", Profile->NormalsTexture,
-					TextureWidth_Vert, TextureHeight_Vert,
-					Data,
-					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+	// Verts of every LOD, LOD0 gets the rows and the other LODs use the closest LOD0 vert
+	TArray <TArray <FFinalSkinVertex>> LODRestVerts;
+	LODRestVerts.SetNum(Source.GetNumLODs());
+	for (int32 LOD = 0; LOD < LODRestVerts.Num(); LOD++)
+	{
+		if (!Source.GetRestVerts(LOD, LODRestVerts[LOD]))
+		{
+			OutError = LOCTEXT("FrameSourceNoRestVerts", "Could not read the frame source's rest verts");
+			return false;
+		}
+	}
 
-				Profile->NormalsTexture->Filter = TextureFilter::TF_Nearest;
-				Profile->NormalsTexture->NeverStream = true;
-				Profile->NormalsTexture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
-				Profile->NormalsTexture->SRGB = false;
-				Profile->NormalsTexture->Modify();
-				Profile->NormalsTexture->MarkPackageDirty();
-				Profile->NormalsTexture->PostEditChange();
-				Profile->NormalsTexture->UpdateResource();
-			}
+	if (Profile->PerLODRows_Vert)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, PerLODRows_Vert is only supported for skeletal sources"), *Profile->GetName());
+	}
 
+	TArray <TArray <int32>> UniqueSourceIDs;
+	TArray <TArray <FVector2D>> UVs_VertAnim;
+	UVs_VertAnim.SetNum(LODRestVerts.Num());
+	VATBakeStages::MapSkinVerts(Profile, LODRestVerts[0], UniqueSourceIDs.AddDefaulted_GetRef(), UVs_VertAnim[0]);
 
+	for (int32 LOD = 1; LOD < LODRestVerts.Num(); LOD++)
+	{
+		UVs_VertAnim[LOD].SetNum(LODRestVerts[LOD].Num());
+		for (int32 o = 0; o < LODRestVerts[LOD].Num(); o++)
+		{
+			float Lowest = MAX_FLT;
+			int32 WinnerID = 0;
+			for (const int32 SourceID : UniqueSourceIDs[0])
 			{
-				EncodeData_Vec(VertPos, Profile->MaxValueOffset_Vert, true, Data);
-
-				Profile->OffsetsTexture = SetTexture2(PreviewComponent->GetWorld(), PackagePath,
-					Profile->GetName() + "_Offsets", Profile->OffsetsTexture,
-					TextureWidth_Vert, TextureHeight_Vert,
-					Data,
-					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
-
-				Profile->OffsetsTexture->Filter = TextureFilter::TF_Nearest;
-				Profile->OffsetsTexture->NeverStream = true;
-				Profile->OffsetsTexture->CompressionSettings = TextureCompressionSettings::TC_HDR;
-				Profile->OffsetsTexture->SRGB = false;
-				Profile->OffsetsTexture->Modify();
-				Profile->OffsetsTexture->MarkPackageDirty();
-				Profile->OffsetsTexture->PostEditChange();
-				Profile->OffsetsTexture->UpdateResource();
+				const float Dist = FVector3f::DistSquared(LODRestVerts[LOD][o].Position, LODRestVerts[0][SourceID].Position);
+				if (Dist < Lowest)
+				{
+					Lowest = Dist;
+					WinnerID = SourceID;
+				}
 			}
-		
+			UVs_VertAnim[LOD][o] = UVs_VertAnim[0][WinnerID];
 		}
+	}
 
-		// Bone Textures
-		if (Profile->Anims_Bone.Num())
-		{
-			TArray <FFloat16Color> Data;
-			Data.SetNumZeroed(TextureWidth_Bone*TextureHeight_Bone);
+	if (Profile->CalcTotalRequiredHeight_Vert() > Profile->OverrideSize_Vert.Y)
+	{
+		OutError = LOCTEXT("SelectedProfileRequiresMoreHeight", "Selected Profile Requires More Texture Height");
+		return false;
+	}
+	if (Profile->OverrideSize_Vert.GetMax() > 4096)
+	{
+		OutError = LOCTEXT("TooMuch", "Warning: required texture size exceeds UE texture resolution limit, Mesh has too many vertices and/or Profile has too many animation frames");
+		return false;
+	}
 
-			
-			{
-				EncodeData_Quat(true, BoneRot, Data);
+	TArray <FVector4> VertPos, VertNormal, BonePos, BoneRot;
+	float MaxValueOffset = 0.f;
+	if (!VATBakeStages::SampleVertAnimFrames(Profile, Source, UniqueSourceIDs, VertPos, VertNormal, MaxValueOffset))
+	{
+		OutError = LOCTEXT("FrameSourceTopology", "The frame source changes topology between frames, only constant topology can be baked");
+		return false;
+	}
 
-				Profile->BoneRotTexture = SetTexture2(PreviewComponent->GetWorld(), PackagePath, 
-					Profile->GetName() + "_BoneRot", Profile->BoneRotTexture,
-					TextureWidth_Bone, TextureHeight_Bone, 
-					Data,
-					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+	// Nothing skeletal to go with a generic source
+	Profile->MaxValueOffset_Vert = MaxValueOffset;
+	Profile->MaxValuePosition_Bone = 0.f;
+	Profile->UVChannel_BoneAnim = -1;
+	Profile->UVChannel_BoneAnim_Full = -1;
+	Profile->UVChannel_VertMirror = -1;
+	Profile->MirrorBones.Empty();
+	Profile->ActiveBones.Empty();
+	Profile->RootMotionFrames.Empty();
+	Profile->RootMotionClips_Vert.Empty();
+	Profile->RootMotionClips_Bone.Empty();
+	Profile->AnimEvents.Empty();
+	Profile->EventClips_Vert.Empty();
+	Profile->EventClips_Bone.Empty();
+	ClearCollisionCapsules(Profile);
+	if (Profile->ExtractRootMotion || Profile->BakeMirrorMaps || Profile->BakeCollisionCapsules)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("VAT Bake: %s, root motion, mirror maps and collision capsules are only baked from skeletal sources"), *Profile->GetName());
+	}
 
-				Profile->BoneRotTexture->Filter = TextureFilter::TF_Nearest;
-				Profile->BoneRotTexture->NeverStream = true;
-				Profile->BoneRotTexture->CompressionSettings = TextureCompressionSettings::TC_HDR;
-				Profile->BoneRotTexture->SRGB = false;
-				Profile->BoneRotTexture->Modify();
-				Profile->BoneRotTexture->MarkPackageDirty();
-				Profile->BoneRotTexture->PostEditChange();
-				Profile->BoneRotTexture->UpdateResource();
-			}
+	const int32 SampledHeight_Vert = Profile->OverrideSize_Vert.Y;
+	DeduplicateFrames(Profile, VertPos, VertNormal, BonePos, BoneRot);
+	ApplyVertLayout(Profile, SampledHeight_Vert, VertPos.Num() / (Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert), { &UVs_VertAnim });
 
-			{
-				EncodeData_Vec(BonePos, Profile->MaxValuePosition_Bone, true, Data);
+	UStaticMesh* StaticMesh = Source.CreateStaticMesh(MeshPackageName);
+	if (!StaticMesh)
+	{
+		OutError = LOCTEXT("FrameSourceNoMesh", "Could not create a static mesh from the frame source");
+		return false;
+	}
 
-				Profile->BonePosTexture = SetTexture2(PreviewComponent->GetWorld(), PackagePath,
-					Profile->GetName() + "_BonePos", Profile->BonePosTexture,
-					TextureWidth_Bone, TextureHeight_Bone, 
-					Data,//BonePos,
-					Profile->GetMaskedFlags() | RF_Public | RF_Standalone);
+	// VAT UVs go after the source's own channels
+	const FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(0);
+	Profile->UVChannel_VertAnim = MeshDescription ?
+		FMath::Min(FStaticMeshConstAttributes(*MeshDescription).GetVertexInstanceUVs().GetNumChannels(), MAX_MESH_TEXTURE_COORDS_MD - 1) : 1;
 
-				Profile->BonePosTexture->Filter = TextureFilter::TF_Nearest;
-				Profile->BonePosTexture->NeverStream = true;
-				Profile->BonePosTexture->CompressionSettings = TextureCompressionSettings::TC_HDR;
-				Profile->BonePosTexture->SRGB = false;
+	FVATMeshAttributes VATAttributes;
+	VATAttributes.AddUVChannel(Profile->UVChannel_VertAnim, UVs_VertAnim);
+	FVertexAnimUtils::VATAttributesToStaticMeshLODs(StaticMesh, VATAttributes);
 
-				Profile->BonePosTexture->Modify();
-				Profile->BonePosTexture->MarkPackageDirty();
-				Profile->BonePosTexture->PostEditChange();
-				Profile->BonePosTexture->UpdateResource();
-			}
+	Profile->StaticMesh = StaticMesh;
+#if WITH_EDITORONLY_DATA
+	Profile->SourceMesh = NULL;
+#endif
 
-		}
+	BakeProfileTextures(Profile, NULL, VertPos, VertNormal, BonePos, BoneRot);
 
-	}
+	Profile->MarkPackageDirty();
+	return true;
 }
 
 void FVATEditorUtils::UVChannelsToSkeletalMesh(USkeletalMesh* Skel, const int32 LODIndex, const int32 UVChannelStart, TArray<TArray<FVector2D>>& UVChannels)
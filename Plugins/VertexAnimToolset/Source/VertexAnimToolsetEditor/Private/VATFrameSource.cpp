@@ -0,0 +1,347 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATFrameSource.h"
+
+#include "Animation/DebugSkelMeshComponent.h"
+#include "Animation/AnimationAsset.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/SkeletalMesh.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "StaticMeshResources.h"
+#include "RenderingThread.h"
+#include "RawMesh.h"
+#include "AssetRegistryModule.h"
+
+#include "GeometryCache.h"
+#include "GeometryCacheTrack.h"
+#include "GeometryCacheMeshData.h"
+
+#include "VertexAnimProfile.h"
+#include "VertexAnimUtils.h"
+#include "VATBakeStages.h"
+#include "VATSkinningKernel.h"
+
+bool FVATFrameSource::GetClipFrames(
+	const int32 ClipIndex, TArrayView<const float> Times, const float DeltaTime, const int32 LODIndex, TArray <TArray <FFinalSkinVertex>>& OutFrames)
+{
+	OutFrames.SetNum(Times.Num());
+	for (int32 i = 0; i < Times.Num(); i++)
+	{
+		if (!GetFrameVerts(ClipIndex, Times[i], DeltaTime, LODIndex, OutFrames[i])) return false;
+	}
+	return true;
+}
+
+// Skeletal
+
+FVATSkeletalFrameSource::FVATSkeletalFrameSource(
+	UDebugSkelMeshComponent* InPreviewComponent, const TArray <UMeshComponent*>& InComponents, const TArray <FVASequenceData>& InAnims)
+	: PreviewComponent(InPreviewComponent)
+	, Components(InComponents)
+{
+	for (const FVASequenceData& Anim : InAnims)
+	{
+		Sequences.Add(Anim.SequenceRef);
+	}
+}
+
+int32 FVATSkeletalFrameSource::GetNumLODs() const
+{
+	return FVertexAnimUtils::CalcOverallMaxLODs(Components);
+}
+
+float FVATSkeletalFrameSource::GetClipLength(const int32 ClipIndex) const
+{
+	return Sequences[ClipIndex] ? Sequences[ClipIndex]->GetPlayLength() : 0.f;
+}
+
+void FVATSkeletalFrameSource::SetLOD(const int32 LODIndex)
+{
+	if (LODIndex == ActiveLOD) return;
+
+	VATBakeStages::ForceBakeLOD(PreviewComponent, Components, LODIndex);
+	ActiveLOD = LODIndex;
+}
+
+bool FVATSkeletalFrameSource::GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	SetLOD(LODIndex);
+
+	PreviewComponent->EnablePreview(true, NULL);
+	ActiveClip = INDEX_NONE;
+	PreviewComponent->RefreshBoneTransforms(nullptr);
+	PreviewComponent->ClearMotionVector();
+
+	// Offsets are the frame verts minus these, so they come from the same skinning as the frames or the difference ends up in every offset
+	if (const FVATSkinBinding* Binding = GetKernelBinding(LODIndex))
+	{
+		TArray <FMatrix44f> RefToLocals;
+		PreviewComponent->CacheRefToLocalMatrices(RefToLocals);
+		FVATSkinningKernel::SkinVerts(*Binding, RefToLocals, OutVerts);
+		return true;
+	}
+
+	FlushRenderingCommands();
+
+	VATBakeStages::MergedComponentVerts(Components, LODIndex, true, OutVerts);
+	return true;
+}
+
+void FVATSkeletalFrameSource::SetClip(const int32 ClipIndex)
+{
+	if (ClipIndex == ActiveClip) return;
+
+	PreviewComponent->EnablePreview(true, Sequences[ClipIndex]);
+	ActiveClip = ClipIndex;
+}
+
+const FVATSkinBinding* FVATSkeletalFrameSource::GetKernelBinding(const int32 LODIndex)
+{
+	// Attachments, morph targets and cloth need the engine's skinning
+	const USkeletalMesh* Mesh = PreviewComponent->SkeletalMesh;
+	if ((Components.Num() != 1) || !Mesh || Mesh->GetMorphTargets().Num() || Mesh->HasActiveClothingAssets()) return nullptr;
+
+	if (LODIndex >= KernelBindings.Num()) KernelBindings.SetNum(LODIndex + 1);
+	if (!KernelBindings[LODIndex].IsValid())
+	{
+		KernelBindings[LODIndex] = MakeShared<FVATSkinBinding>();
+
+		// The binding has to match the vert order of the LOD the static mesh and the rest verts come from
+		const FSkeletalMeshRenderData* RenderData = Mesh->GetResourceForRendering();
+		const int32 NumRenderVerts = (RenderData && RenderData->LODRenderData.IsValidIndex(LODIndex)) ? RenderData->LODRenderData[LODIndex].GetNumVertices() : 0;
+		if (!KernelBindings[LODIndex]->Initialize(Mesh, LODIndex) || (KernelBindings[LODIndex]->NumVerts != NumRenderVerts))
+		{
+			UE_LOG(LogTemp, Log, TEXT("VAT Bake: %s LOD %d, imported model does not match the render data, using engine skinning"), *Mesh->GetName(), LODIndex);
+			*KernelBindings[LODIndex] = FVATSkinBinding();
+		}
+	}
+
+	return KernelBindings[LODIndex]->IsValid() ? KernelBindings[LODIndex].Get() : nullptr;
+}
+
+bool FVATSkeletalFrameSource::GetClipFrames(
+	const int32 ClipIndex, TArrayView<const float> Times, const float DeltaTime, const int32 LODIndex, TArray <TArray <FFinalSkinVertex>>& OutFrames)
+{
+	const FVATSkinBinding* Binding = GetKernelBinding(LODIndex);
+	if (!Binding) return FVATFrameSource::GetClipFrames(ClipIndex, Times, DeltaTime, LODIndex, OutFrames);
+
+	SetLOD(LODIndex);
+	SetClip(ClipIndex);
+
+	// Poses are evaluated on the game thread one by one, the skinning runs on all of them at once
+	TArray <TArray <FMatrix44f>> FrameRefToLocals;
+	FrameRefToLocals.SetNum(Times.Num());
+	for (int32 i = 0; i < Times.Num(); i++)
+	{
+		PreviewComponent->SetPosition(Times[i], false);
+		PreviewComponent->RefreshBoneTransforms(nullptr);
+		PreviewComponent->CacheRefToLocalMatrices(FrameRefToLocals[i]);
+	}
+
+	FVATSkinningKernel::SkinFrames(*Binding, FrameRefToLocals, OutFrames);
+	return true;
+}
+
+bool FVATSkeletalFrameSource::GetFrameVerts(
+	const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	SetLOD(LODIndex);
+	SetClip(ClipIndex);
+
+	PreviewComponent->SetPosition(Time, false);
+	PreviewComponent->RefreshBoneTransforms(nullptr);
+	PreviewComponent->RecreateClothingActors();
+	// Cloth Ticking
+	for (int32 P = 0; P < 8; P++) PreviewComponent->GetWorld()->Tick(ELevelTick::LEVELTICK_All, DeltaTime);
+
+	PreviewComponent->ClearMotionVector();
+
+	FlushRenderingCommands();
+
+	VATBakeStages::MergedComponentVerts(Components, LODIndex, true, OutVerts);
+	return true;
+}
+
+UStaticMesh* FVATSkeletalFrameSource::CreateStaticMesh(const FString& PackageName)
+{
+	return FVertexAnimUtils::ConvertMeshesToStaticMesh(Components, PreviewComponent->GetComponentTransform(), PackageName, false);
+}
+
+// Geometry Cache
+
+// All tracks of a cache at a time merged into one vertex list, optionally with the triangles as a raw mesh
+static bool GeometryCacheVerts(UGeometryCache* Cache, const float Time, TArray <FFinalSkinVertex>& OutVerts, FRawMesh* OutRawMesh = nullptr)
+{
+	OutVerts.Reset();
+
+	for (UGeometryCacheTrack* Track : Cache->Tracks)
+	{
+		FGeometryCacheMeshData MeshData;
+		if (!Track || !Track->GetMeshDataAtTime(Time, MeshData)) continue;
+
+		int32 MatrixSampleIndex = INDEX_NONE;
+		FMatrix TrackMatrix = FMatrix::Identity;
+		Track->UpdateMatrixData(Time, false, MatrixSampleIndex, TrackMatrix);
+		const FMatrix44f TrackToRoot = FMatrix44f{ TrackMatrix };
+
+		const int32 FirstVert = OutVerts.Num();
+		for (int32 v = 0; v < MeshData.Positions.Num(); v++)
+		{
+			FFinalSkinVertex& Vertex = OutVerts.AddDefaulted_GetRef();
+			Vertex.Position = TrackToRoot.TransformPosition(MeshData.Positions[v]);
+
+			const FVector3f TangentZ = MeshData.TangentsZ.IsValidIndex(v) ? MeshData.TangentsZ[v].ToFVector3f() : FVector3f::UpVector;
+			const FVector3f TangentX = MeshData.TangentsX.IsValidIndex(v) ? MeshData.TangentsX[v].ToFVector3f() : FVector3f::ForwardVector;
+			Vertex.TangentX = FPackedNormal(TrackToRoot.TransformVector(TangentX).GetSafeNormal());
+			Vertex.TangentZ = FPackedNormal(FVector4f(TrackToRoot.TransformVector(TangentZ).GetSafeNormal(), 1.f));
+
+			const FVector2f UV = MeshData.TextureCoordinates.IsValidIndex(v) ? MeshData.TextureCoordinates[v] : FVector2f::ZeroVector;
+			Vertex.U = UV.X;
+			Vertex.V = UV.Y;
+		}
+
+		if (!OutRawMesh) continue;
+
+		for (int32 v = FirstVert; v < OutVerts.Num(); v++)
+		{
+			OutRawMesh->VertexPositions.Add(OutVerts[v].Position);
+		}
+
+		for (const FGeometryCacheMeshBatchInfo& Batch : MeshData.BatchesInfo)
+		{
+			for (uint32 t = 0; t < Batch.NumTriangles; t++)
+			{
+				for (uint32 c = 0; c < 3; c++)
+				{
+					const uint32 Index = MeshData.Indices[Batch.StartIndex + (t * 3) + c];
+					const FFinalSkinVertex& Vertex = OutVerts[FirstVert + Index];
+
+					OutRawMesh->WedgeIndices.Add(FirstVert + Index);
+					OutRawMesh->WedgeTangentX.Add(Vertex.TangentX.ToFVector3f());
+					OutRawMesh->WedgeTangentY.Add(FVector3f::ZeroVector);
+					OutRawMesh->WedgeTangentZ.Add(Vertex.TangentZ.ToFVector3f());
+					OutRawMesh->WedgeTexCoords[0].Add(FVector2f(Vertex.U, Vertex.V));
+					OutRawMesh->WedgeColors.Add(MeshData.Colors.IsValidIndex(Index) ? MeshData.Colors[Index] : FColor::White);
+				}
+				OutRawMesh->FaceMaterialIndices.Add(Batch.MaterialIndex);
+				OutRawMesh->FaceSmoothingMasks.Add(1);
+			}
+		}
+	}
+
+	return OutVerts.Num() > 0;
+}
+
+FVATGeometryCacheFrameSource::FVATGeometryCacheFrameSource(const TArray <UGeometryCache*>& InCaches)
+	: Caches(InCaches)
+{
+}
+
+float FVATGeometryCacheFrameSource::GetClipLength(const int32 ClipIndex) const
+{
+	return Caches[ClipIndex]->CalculateDuration();
+}
+
+int32 FVATGeometryCacheFrameSource::GetDefaultNumFrames(const int32 ClipIndex) const
+{
+	return FMath::Max(1, Caches[ClipIndex]->GetEndFrame() - Caches[ClipIndex]->GetStartFrame());
+}
+
+bool FVATGeometryCacheFrameSource::GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	return GeometryCacheVerts(Caches[0], 0.f, OutVerts);
+}
+
+bool FVATGeometryCacheFrameSource::GetFrameVerts(
+	const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	return GeometryCacheVerts(Caches[ClipIndex], Time, OutVerts);
+}
+
+UStaticMesh* FVATGeometryCacheFrameSource::CreateStaticMesh(const FString& PackageName)
+{
+	TArray <FFinalSkinVertex> Verts;
+	FRawMesh RawMesh;
+	if (!GeometryCacheVerts(Caches[0], 0.f, Verts, &RawMesh) || !RawMesh.IsValidOrFixable()) return nullptr;
+
+	UPackage* Package = CreatePackage(NULL, *PackageName);
+	check(Package);
+
+	UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Package, *FPackageName::GetLongPackageAssetName(PackageName), RF_Public | RF_Standalone);
+	StaticMesh->InitResources();
+	StaticMesh->SetLightingGuid(FGuid::NewGuid());
+
+	FStaticMeshSourceModel& SrcModel = StaticMesh->AddSourceModel();
+	SrcModel.BuildSettings.bRecomputeNormals = false;
+	SrcModel.BuildSettings.bRecomputeTangents = true;
+	SrcModel.BuildSettings.bRemoveDegenerates = true;
+	SrcModel.BuildSettings.bUseHighPrecisionTangentBasis = false;
+	SrcModel.BuildSettings.bUseFullPrecisionUVs = false;
+	SrcModel.BuildSettings.bGenerateLightmapUVs = true;
+	SrcModel.BuildSettings.SrcLightmapIndex = 0;
+	SrcModel.BuildSettings.DstLightmapIndex = 1;
+	SrcModel.SaveRawMesh(RawMesh);
+
+	for (UMaterialInterface* Material : Caches[0]->Materials)
+	{
+		StaticMesh->GetStaticMaterials().Add(FStaticMaterial(Material));
+	}
+
+	StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+	StaticMesh->MarkPackageDirty();
+	FAssetRegistryModule::AssetCreated(StaticMesh);
+
+	return StaticMesh;
+}
+
+// Static Mesh
+
+FVATStaticMeshFrameSource::FVATStaticMeshFrameSource(UStaticMesh* InRestMesh, const TArray <TArray <UStaticMesh*>>& InClipFrames, const float InFramesPerSecond)
+	: RestMesh(InRestMesh)
+	, ClipFrames(InClipFrames)
+	, FramesPerSecond(FMath::Max(InFramesPerSecond, KINDA_SMALL_NUMBER))
+	, Component(NewObject<UStaticMeshComponent>(GetTransientPackage()))
+{
+}
+
+int32 FVATStaticMeshFrameSource::GetNumLODs() const
+{
+	return (RestMesh && RestMesh->GetRenderData()) ? RestMesh->GetRenderData()->LODResources.Num() : 0;
+}
+
+float FVATStaticMeshFrameSource::GetClipLength(const int32 ClipIndex) const
+{
+	return ClipFrames[ClipIndex].Num() / FramesPerSecond;
+}
+
+bool FVATStaticMeshFrameSource::MeshVerts(UStaticMesh* Mesh, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	if (!Mesh || !Mesh->GetRenderData() || !Mesh->GetRenderData()->LODResources.IsValidIndex(LODIndex)) return false;
+
+	Component->SetStaticMesh(Mesh);
+	FVertexAnimUtils::StaticMeshComponentVertices(Component.Get(), LODIndex, FMatrix44f::Identity, OutVerts);
+	return true;
+}
+
+bool FVATStaticMeshFrameSource::GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	return MeshVerts(RestMesh, LODIndex, OutVerts);
+}
+
+bool FVATStaticMeshFrameSource::GetFrameVerts(
+	const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts)
+{
+	const TArray <UStaticMesh*>& Frames = ClipFrames[ClipIndex];
+	if (!Frames.Num()) return false;
+
+	// Sample times land on frame boundaries, float error must not step back a frame
+	const int32 Frame = FMath::Clamp(FMath::FloorToInt(Time * FramesPerSecond + KINDA_SMALL_NUMBER), 0, Frames.Num() - 1);
+	return MeshVerts(Frames[Frame], LODIndex, OutVerts);
+}
+
+UStaticMesh* FVATStaticMeshFrameSource::CreateStaticMesh(const FString& PackageName)
+{
+	Component->SetStaticMesh(RestMesh);
+	return FVertexAnimUtils::ConvertMeshesToStaticMesh({ Component.Get() }, FTransform::Identity, PackageName, false);
+}
@@ -0,0 +1,142 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATLayoutSimulator.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+// Set associative cache of line ids, every set keeps its ways most recently used first
+class FVATCacheSim
+{
+public:
+	FVATCacheSim(const int32 InNumSets, const int32 InNumWays)
+		: NumSets(FMath::Max(1, InNumSets)), NumWays(FMath::Max(1, InNumWays))
+	{
+		Ways.Init(INDEX_NONE, NumSets * NumWays);
+	}
+
+	// True on a hit
+	bool Access(const int64 Line)
+	{
+		int64* Set = &Ways[(int32)(Line % NumSets) * NumWays];
+
+		int32 Found = NumWays - 1;
+		bool bHit = false;
+		for (int32 w = 0; w < NumWays; w++)
+		{
+			if (Set[w] == Line)
+			{
+				Found = w;
+				bHit = true;
+				break;
+			}
+		}
+
+		// Move to the front, a miss evicts the least recently used way
+		for (int32 w = Found; w > 0; w--) Set[w] = Set[w - 1];
+		Set[0] = Line;
+		return bHit;
+	}
+
+private:
+	int32 NumSets;
+	int32 NumWays;
+	TArray <int64> Ways;
+};
+
+FVATCacheSimResult FVATLayoutSimulator::Simulate(
+	const EVATVertLayout Layout, const int32 Width, const int32 RowsPerFrame, const int32 NumVerts, const TArray <FIntPoint>& Clips,
+	const FVATCacheSimSettings& Settings)
+{
+	FVATCacheSimResult Result;
+	if ((Width <= 0) || (RowsPerFrame <= 0) || (NumVerts <= 0) || !Clips.Num()) return Result;
+
+	int32 NumFrames = 0;
+	for (const FIntPoint& Clip : Clips) NumFrames = FMath::Max(NumFrames, Clip.X + Clip.Y);
+
+	const int32 TileWidth = FMath::Max(1, Settings.TileWidth);
+	const int32 TileHeight = FMath::Max(1, Settings.TileHeight);
+	const int64 TilesPerRow = FMath::DivideAndRoundUp(Width, TileWidth);
+	const int32 WaveSize = FMath::Max(1, Settings.WaveSize);
+
+	auto LineOf = [&](const int32 TexelInFrame, const int32 Frame)
+	{
+		const FIntPoint Texel = UVertexAnimProfile::CalcVertTexel(Layout, Width, RowsPerFrame, NumFrames, TexelInFrame, Frame);
+		return (int64)(Texel.Y / TileHeight) * TilesPerRow + (Texel.X / TileWidth);
+	};
+
+	FVATCacheSim Cache(Settings.NumSets, Settings.NumWays);
+	TSet <int64> Lines;
+	FRandomStream Random(Settings.Seed);
+
+	for (int32 Instance = 0; Instance < Settings.NumInstances; Instance++)
+	{
+		const FIntPoint& Clip = Clips[Random.RandRange(0, Clips.Num() - 1)];
+		const int32 LocalFrame = Random.RandRange(0, FMath::Max(Clip.Y, 1) - 1);
+		const int32 Frame0 = Clip.X + LocalFrame;
+		const int32 Frame1 = Clip.X + ((LocalFrame + 1) % FMath::Max(Clip.Y, 1));
+
+		for (int32 WaveStart = 0; WaveStart < NumVerts; WaveStart += WaveSize)
+		{
+			const int32 WaveEnd = FMath::Min(WaveStart + WaveSize, NumVerts);
+			for (const int32 Frame : { Frame0, Frame1 })
+			{
+				for (int32 v = WaveStart; v < WaveEnd; v++)
+				{
+					const int64 Line = LineOf(v, Frame);
+					Result.Reads++;
+					if (!Cache.Access(Line))
+					{
+						Result.Misses++;
+						Lines.Add(Line);
+					}
+				}
+			}
+		}
+	}
+
+	Result.UniqueLines = Lines.Num();
+	return Result;
+}
+
+FVATCacheSimResult FVATLayoutSimulator::Simulate(const UVertexAnimProfile* Profile, const EVATVertLayout Layout, const FVATCacheSimSettings& Settings)
+{
+	if (!Profile || (Profile->RowsPerFrame_Vert <= 0)) return FVATCacheSimResult();
+
+	TArray <FIntPoint> Clips;
+	for (const FVASequenceData& Anim : Profile->Anims_Vert)
+	{
+		Clips.Add(FIntPoint(Anim.AnimStart_Generated / Profile->RowsPerFrame_Vert, Anim.NumFrames));
+	}
+
+	// LOD0's unique verts fill the first texels of the frame, all of them unless PerLODRows_Vert put other LODs after
+	int32 NumVerts = Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert;
+	if (Profile->LODRowOffset_Vert.Num() > 1) NumVerts = Profile->OverrideSize_Vert.X * Profile->LODRowOffset_Vert[1];
+	if (Profile->RestPositions_Vert.Num()) NumVerts = Profile->RestPositions_Vert.Num();
+
+	return Simulate(Layout, Profile->OverrideSize_Vert.X, Profile->RowsPerFrame_Vert, NumVerts, Clips, Settings);
+}
+
+static FAutoConsoleCommand VATSimulateLayoutCommand(
+	TEXT("VAT.SimulateLayout"),
+	TEXT("Estimates the texture cache hit rate of the FrameRows and FrameInterleaved vert layouts for a baked profile: VAT.SimulateLayout <ProfilePath> [Instances]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray <FString>& Args)
+	{
+		const UVertexAnimProfile* Profile = Args.Num() ? LoadObject<UVertexAnimProfile>(nullptr, *Args[0]) : nullptr;
+		if (!Profile || !Profile->Anims_Vert.Num())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VAT.SimulateLayout needs the path of a profile with baked vert anim"));
+			return;
+		}
+
+		FVATCacheSimSettings Settings;
+		if (Args.Num() > 1) Settings.NumInstances = FMath::Max(1, FCString::Atoi(*Args[1]));
+
+		for (const EVATVertLayout Layout : { EVATVertLayout::FrameRows, EVATVertLayout::FrameInterleaved })
+		{
+			const FVATCacheSimResult Result = FVATLayoutSimulator::Simulate(Profile, Layout, Settings);
+			UE_LOG(LogTemp, Display, TEXT("VAT Layout: %s %s, %lld reads, %.1f%% hits, %lld line fetches, %.1f%% refetched"),
+				*Profile->GetName(), *StaticEnum<EVATVertLayout>()->GetNameStringByValue((int64)Layout),
+				Result.Reads, Result.HitRate() * 100.f, Result.Misses, Result.RefetchRate() * 100.f);
+		}
+	}));
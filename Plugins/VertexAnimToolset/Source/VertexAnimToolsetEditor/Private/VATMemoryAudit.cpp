@@ -0,0 +1,291 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATMemoryAudit.h"
+
+#include "VertexAnimProfile.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderUtils.h"
+
+static const TCHAR* AuditSection = TEXT("VATAudit");
+
+static double BytesToMB(const int64 Bytes)
+{
+	return (double)Bytes / (1024.0 * 1024.0);
+}
+
+// Share of a texture's rows not covered by the required height
+static float UnusedFraction(const int32 RequiredHeight, const FIntPoint& OverrideSize, const UTexture2D* Texture)
+{
+	int32 Height = OverrideSize.Y;
+	if ((Height <= 0) && Texture) Height = Texture->GetSizeY();
+	if (Height <= 0) return 0.f;
+
+	return FMath::Clamp(1.f - (float)RequiredHeight / (float)Height, 0.f, 1.f);
+}
+
+FVATTextureAudit FVATMemoryAudit::AuditTexture(const TCHAR* Slot, const UTexture2D* Texture)
+{
+	FVATTextureAudit Out;
+	Out.Slot = Slot;
+	if (!Texture) return Out;
+
+	Out.Path = Texture->GetPathName();
+
+	if (const FTexturePlatformData* PlatformData = Texture->GetPlatformData())
+	{
+		Out.Size = FIntPoint(PlatformData->SizeX, PlatformData->SizeY);
+		Out.Format = GPixelFormats[PlatformData->PixelFormat].Name;
+		Out.NumMips = PlatformData->Mips.Num();
+		for (const FTexture2DMipMap& Mip : PlatformData->Mips)
+		{
+			Out.Bytes += CalculateImageBytes(Mip.SizeX, Mip.SizeY, 0, PlatformData->PixelFormat);
+		}
+	}
+	else
+	{
+		// Not built for this platform yet, the source is what the bake wrote and the VAT textures are uncompressed
+		Out.Size = FIntPoint(Texture->Source.GetSizeX(), Texture->Source.GetSizeY());
+		Out.Format = StaticEnum<ETextureSourceFormat>()->GetNameStringByValue(Texture->Source.GetFormat());
+		Out.NumMips = Texture->Source.GetNumMips();
+		for (int32 Mip = 0; Mip < Out.NumMips; Mip++)
+		{
+			Out.Bytes += Texture->Source.CalcMipSize(Mip);
+		}
+	}
+
+	return Out;
+}
+
+FVATProfileAudit FVATMemoryAudit::AuditProfile(const UVertexAnimProfile* Profile)
+{
+	FVATProfileAudit Out;
+	if (!Profile) return Out;
+
+	Out.Profile = Profile->GetPathName();
+	Out.Packages.Add(Profile->GetOutermost()->GetFName());
+	if (Profile->StaticMesh)
+	{
+		Out.Packages.AddUnique(Profile->StaticMesh->GetOutermost()->GetFName());
+		Out.NumVerts = Profile->StaticMesh->GetNumVertices(0);
+	}
+
+	const TPair <const TCHAR*, const UTexture2D*> Textures[] =
+	{
+		{ TEXT("Offsets"), Profile->OffsetsTexture },
+		{ TEXT("Normals"), Profile->NormalsTexture },
+		{ TEXT("BonePos"), Profile->BonePosTexture },
+		{ TEXT("BoneRot"), Profile->BoneRotTexture },
+		{ TEXT("Ranges"), Profile->RangesTexture },
+		{ TEXT("BoneMirror"), Profile->BoneMirrorTexture },
+	};
+
+	for (const TPair <const TCHAR*, const UTexture2D*>& Texture : Textures)
+	{
+		if (!Texture.Value) continue;
+		FVATTextureAudit& TextureAudit = Out.Textures.Add_GetRef(AuditTexture(Texture.Key, Texture.Value));
+		Out.TextureBytes += TextureAudit.Bytes;
+		Out.Packages.AddUnique(Texture.Value->GetOutermost()->GetFName());
+	}
+
+	Out.CPUBytes =
+		(Profile->OffsetsTextureData.Num() + Profile->NormalsTextureData.Num() +
+		Profile->BonePosTextureData.Num() + Profile->BoneRotTextureData.Num()) * sizeof(uint16) +
+		(Profile->RestPositions_Vert.Num() + Profile->RestNormals_Vert.Num()) * sizeof(FVector3f) +
+		Profile->RootMotionFrames.Num() * sizeof(FVector4f) +
+		Profile->AnimEvents.Num() * sizeof(FVAAnimEvent) +
+		Profile->CapsuleFrames.Num() * sizeof(FVector3f);
+
+	// Bone textures hold the ref pose row on top of the frames
+	Out.UnusedFraction_Vert = UnusedFraction(Profile->CalcTotalRequiredHeight_Vert(), Profile->OverrideSize_Vert, Profile->OffsetsTexture);
+	Out.UnusedFraction_Bone = UnusedFraction(Profile->CalcTotalRequiredHeight_Bone() + 1, Profile->OverrideSize_Bone, Profile->BonePosTexture);
+
+	Out.NumClips_Vert = Profile->Anims_Vert.Num();
+	Out.NumClips_Bone = Profile->Anims_Bone.Num();
+
+	return Out;
+}
+
+void FVATMemoryAudit::AuditProfiles(const FString& ProfilePath, TArray <FVATProfileAudit>& OutProfiles)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UVertexAnimProfile::StaticClass()->GetClassPathName());
+	Filter.PackagePaths.Add(FName(*ProfilePath));
+	Filter.bRecursivePaths = true;
+
+	TArray <FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+
+	for (int32 i = 0; i < Assets.Num(); i++)
+	{
+		if (const UVertexAnimProfile* Profile = Cast<UVertexAnimProfile>(Assets[i].GetAsset()))
+		{
+			OutProfiles.Add(AuditProfile(Profile));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VAT Audit: failed to load %s"), *Assets[i].GetObjectPathString());
+		}
+
+		// Baked textures are big, don't keep every profile's loaded at once
+		if ((i % 32) == 31) CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+}
+
+void FVATMemoryAudit::AuditMaps(const FString& MapPath, const TArray <FVATProfileAudit>& Profiles, TArray <FVATMapAudit>& OutMaps)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+
+	// Maps usually reference the VAT meshes and materials rather than the profiles, so any package of a profile counts
+	TMap <FName, TArray <int32>> PackageToProfiles;
+	for (int32 p = 0; p < Profiles.Num(); p++)
+	{
+		for (const FName& Package : Profiles[p].Packages) PackageToProfiles.FindOrAdd(Package).Add(p);
+	}
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UWorld::StaticClass()->GetClassPathName());
+	Filter.PackagePaths.Add(FName(*MapPath));
+	Filter.bRecursivePaths = true;
+
+	TArray <FAssetData> Maps;
+	AssetRegistry.GetAssets(Filter, Maps);
+	Maps.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+
+	for (const FAssetData& Map : Maps)
+	{
+		// Hard package dependency closure of the map, from the registry so nothing gets loaded
+		TSet <FName> Visited;
+		TArray <FName> Stack = { Map.PackageName };
+		TSet <int32> UsedProfiles;
+		while (Stack.Num())
+		{
+			const FName Package = Stack.Pop(false);
+			if (Visited.Contains(Package)) continue;
+			Visited.Add(Package);
+
+			if (const TArray <int32>* Found = PackageToProfiles.Find(Package)) UsedProfiles.Append(*Found);
+
+			TArray <FName> Dependencies;
+			AssetRegistry.GetDependencies(Package, Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+			for (const FName& Dependency : Dependencies)
+			{
+				if (!Visited.Contains(Dependency) && !Dependency.ToString().StartsWith(TEXT("/Script/"))) Stack.Add(Dependency);
+			}
+		}
+
+		if (!UsedProfiles.Num()) continue;
+
+		FVATMapAudit& Out = OutMaps.AddDefaulted_GetRef();
+		Out.Map = Map.PackageName.ToString();
+
+		TSet <FString> CountedTextures;
+		TArray <int32> SortedProfiles = UsedProfiles.Array();
+		SortedProfiles.Sort();
+		for (const int32 p : SortedProfiles)
+		{
+			const FVATProfileAudit& Profile = Profiles[p];
+			Out.Profiles.Add(Profile.Profile);
+			Out.Bytes += Profile.CPUBytes;
+			for (const FVATTextureAudit& Texture : Profile.Textures)
+			{
+				if (CountedTextures.Contains(Texture.Path)) continue;
+				CountedTextures.Add(Texture.Path);
+				Out.Bytes += Texture.Bytes;
+			}
+		}
+	}
+}
+
+void FVATMemoryAudit::GetBudgets(double& OutProfileBudgetMB, double& OutMapBudgetMB)
+{
+	OutProfileBudgetMB = 0.0;
+	OutMapBudgetMB = 0.0;
+	GConfig->GetDouble(AuditSection, TEXT("ProfileBudgetMB"), OutProfileBudgetMB, GEditorIni);
+	GConfig->GetDouble(AuditSection, TEXT("MapBudgetMB"), OutMapBudgetMB, GEditorIni);
+}
+
+FString FVATMemoryAudit::ProfileCSV(const TArray <FVATProfileAudit>& Profiles, const double ProfileBudgetMB)
+{
+	// One row per profile, its textures as Slot Width x Height Format MB separated by |
+	FString CSV = TEXT("Profile,TotalMB,TextureMB,CPUMB,OverBudget,UnusedVert,UnusedBone,Verts,VertClips,BoneClips,Textures\n");
+	for (const FVATProfileAudit& Profile : Profiles)
+	{
+		TArray <FString> Textures;
+		for (const FVATTextureAudit& Texture : Profile.Textures)
+		{
+			Textures.Add(FString::Printf(TEXT("%s %dx%d %s %d mips %.3fMB"),
+				*Texture.Slot, Texture.Size.X, Texture.Size.Y, *Texture.Format, Texture.NumMips, BytesToMB(Texture.Bytes)));
+		}
+
+		CSV += FString::Printf(TEXT("%s,%.3f,%.3f,%.3f,%s,%.3f,%.3f,%d,%d,%d,\"%s\"\n"), *Profile.Profile,
+			BytesToMB(Profile.TotalBytes()), BytesToMB(Profile.TextureBytes), BytesToMB(Profile.CPUBytes),
+			IsOverBudget(Profile.TotalBytes(), ProfileBudgetMB) ? TEXT("YES") : TEXT("NO"),
+			Profile.UnusedFraction_Vert, Profile.UnusedFraction_Bone,
+			Profile.NumVerts, Profile.NumClips_Vert, Profile.NumClips_Bone, *FString::Join(Textures, TEXT(" | ")));
+	}
+	return CSV;
+}
+
+FString FVATMemoryAudit::MapCSV(const TArray <FVATMapAudit>& Maps, const double MapBudgetMB)
+{
+	FString CSV = TEXT("Map,MB,OverBudget,Profiles\n");
+	for (const FVATMapAudit& Map : Maps)
+	{
+		CSV += FString::Printf(TEXT("%s,%.3f,%s,\"%s\"\n"), *Map.Map, BytesToMB(Map.Bytes),
+			IsOverBudget(Map.Bytes, MapBudgetMB) ? TEXT("YES") : TEXT("NO"), *FString::Join(Map.Profiles, TEXT(" | ")));
+	}
+	return CSV;
+}
+
+// In editor version of the commandlet, logs the over budget entries and writes the reports to Saved/VATAudit
+static FAutoConsoleCommand VATAuditCommand(
+	TEXT("VAT.Audit"),
+	TEXT("Reports the memory of every Vertex Anim Profile under a path (default /Game) and of the maps using them, against the [VATAudit] budgets of the editor ini"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray <FString>& Args)
+	{
+		const FString Path = Args.Num() ? Args[0] : TEXT("/Game");
+
+		double ProfileBudgetMB, MapBudgetMB;
+		FVATMemoryAudit::GetBudgets(ProfileBudgetMB, MapBudgetMB);
+
+		TArray <FVATProfileAudit> Profiles;
+		TArray <FVATMapAudit> Maps;
+		FVATMemoryAudit::AuditProfiles(Path, Profiles);
+		FVATMemoryAudit::AuditMaps(TEXT("/Game"), Profiles, Maps);
+
+		int64 TotalBytes = 0;
+		for (const FVATProfileAudit& Profile : Profiles)
+		{
+			TotalBytes += Profile.TotalBytes();
+			if (FVATMemoryAudit::IsOverBudget(Profile.TotalBytes(), ProfileBudgetMB))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("VAT Audit: %s is %.2fMB, over the %.2fMB profile budget"), *Profile.Profile, BytesToMB(Profile.TotalBytes()), ProfileBudgetMB);
+			}
+		}
+		for (const FVATMapAudit& Map : Maps)
+		{
+			if (FVATMemoryAudit::IsOverBudget(Map.Bytes, MapBudgetMB))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("VAT Audit: %s uses %.2fMB of VAT data, over the %.2fMB map budget"), *Map.Map, BytesToMB(Map.Bytes), MapBudgetMB);
+			}
+		}
+
+		const FString ReportBase = FPaths::ProjectSavedDir() / TEXT("VATAudit") / FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S"));
+		FFileHelper::SaveStringToFile(FVATMemoryAudit::ProfileCSV(Profiles, ProfileBudgetMB), *(ReportBase + TEXT("_Profiles.csv")));
+		FFileHelper::SaveStringToFile(FVATMemoryAudit::MapCSV(Maps, MapBudgetMB), *(ReportBase + TEXT("_Maps.csv")));
+
+		UE_LOG(LogTemp, Display, TEXT("VAT Audit: %d profiles, %.2fMB, %d maps, reports: %s_*.csv"), Profiles.Num(), BytesToMB(TotalBytes), Maps.Num(), *ReportBase);
+	}));
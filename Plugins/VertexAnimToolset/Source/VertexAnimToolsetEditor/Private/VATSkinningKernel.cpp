@@ -0,0 +1,166 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "VATSkinningKernel.h"
+
+#include "Engine/SkeletalMesh.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Async/ParallelFor.h"
+
+// The 12 used components of a ref to local matrix, row r column c at r * 3 + c
+static constexpr int32 NumMatrixComps = 12;
+
+bool FVATSkinBinding::Initialize(const USkeletalMesh* Mesh, const int32 LODIndex)
+{
+	*this = FVATSkinBinding();
+
+	const FSkeletalMeshModel* Model = Mesh ? Mesh->GetImportedModel() : nullptr;
+	if (!Model || !Model->LODModels.IsValidIndex(LODIndex)) return false;
+
+	const FSkeletalMeshLODModel& LODModel = Model->LODModels[LODIndex];
+
+	int32 InNumVerts = 0;
+	for (const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		InNumVerts += Section.SoftVertices.Num();
+		NumInfluences = FMath::Max(NumInfluences, Section.MaxBoneInfluences);
+	}
+	NumInfluences = FMath::Clamp(NumInfluences, 1, MAX_TOTAL_INFLUENCES);
+	if (!InNumVerts) return false;
+
+	NumVerts = InNumVerts;
+	NumPaddedVerts = Align(NumVerts, 4);
+	NumBones = Mesh->GetRefSkeleton().GetNum();
+
+	PosX.SetNumZeroed(NumPaddedVerts); PosY.SetNumZeroed(NumPaddedVerts); PosZ.SetNumZeroed(NumPaddedVerts);
+	NormalX.SetNumZeroed(NumPaddedVerts); NormalY.SetNumZeroed(NumPaddedVerts); NormalZ.SetNumZeroed(NumPaddedVerts);
+	// Padding verts are fully weighted to bone 0
+	InfluenceBones.SetNumZeroed(NumInfluences * NumPaddedVerts);
+	InfluenceWeights.SetNumZeroed(NumInfluences * NumPaddedVerts);
+	RestVerts.SetNumUninitialized(NumVerts);
+
+	int32 v = 0;
+	for (const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for (const FSoftSkinVertex& SoftVert : Section.SoftVertices)
+		{
+			PosX[v] = SoftVert.Position.X; PosY[v] = SoftVert.Position.Y; PosZ[v] = SoftVert.Position.Z;
+			NormalX[v] = SoftVert.TangentZ.X; NormalY[v] = SoftVert.TangentZ.Y; NormalZ[v] = SoftVert.TangentZ.Z;
+
+			FFinalSkinVertex& Rest = RestVerts[v];
+			Rest.Position = SoftVert.Position;
+			Rest.TangentX = FPackedNormal(SoftVert.TangentX);
+			Rest.TangentZ = FPackedNormal(SoftVert.TangentZ);
+			Rest.U = SoftVert.UVs[0].X;
+			Rest.V = SoftVert.UVs[0].Y;
+
+			// Weights are renormalized, so the weight precision of the imported model does not matter
+			float WeightSum = 0.f;
+			for (int32 s = 0; s < NumInfluences; s++) WeightSum += (float)SoftVert.InfluenceWeights[s];
+
+			for (int32 s = 0; s < NumInfluences; s++)
+			{
+				const int32 SectionBone = SoftVert.InfluenceBones[s];
+				const int32 Bone = Section.BoneMap.IsValidIndex(SectionBone) ? (int32)Section.BoneMap[SectionBone] : 0;
+				InfluenceBones[s * NumPaddedVerts + v] = (Bone < NumBones) ? Bone : 0;
+				InfluenceWeights[s * NumPaddedVerts + v] = (WeightSum > 0.f) ? (float)SoftVert.InfluenceWeights[s] / WeightSum : (s == 0 ? 1.f : 0.f);
+			}
+
+			v++;
+		}
+	}
+
+	for (int32 p = NumVerts; p < NumPaddedVerts; p++)
+	{
+		InfluenceWeights[p] = 1.f;
+	}
+
+	return true;
+}
+
+void FVATSkinningKernel::SkinVerts(const FVATSkinBinding& Binding, const TArray <FMatrix44f>& RefToLocals, TArray <FFinalSkinVertex>& OutVerts)
+{
+	OutVerts = Binding.RestVerts;
+	if (!Binding.IsValid() || (RefToLocals.Num() < Binding.NumBones)) return;
+
+	const int32 NumBones = Binding.NumBones;
+
+	// Matrices to SoA, component c of bone b at [c * NumBones + b], so lanes gather single floats
+	TArray <float> Comps;
+	Comps.SetNumUninitialized(NumMatrixComps * NumBones);
+	for (int32 b = 0; b < NumBones; b++)
+	{
+		for (int32 r = 0; r < 4; r++)
+		{
+			for (int32 c = 0; c < 3; c++)
+			{
+				Comps[(r * 3 + c) * NumBones + b] = RefToLocals[b].M[r][c];
+			}
+		}
+	}
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float MinLengthSquared = VectorSetFloat1(SMALL_NUMBER);
+
+	alignas(16) float OutPos[3][4];
+	alignas(16) float OutNormal[3][4];
+
+	for (int32 v0 = 0; v0 < Binding.NumPaddedVerts; v0 += 4)
+	{
+		// Blend the influence matrices of 4 verts at once
+		VectorRegister4Float Blend[NumMatrixComps];
+		for (int32 c = 0; c < NumMatrixComps; c++) Blend[c] = Zero;
+
+		for (int32 s = 0; s < Binding.NumInfluences; s++)
+		{
+			const int32 SlotStart = s * Binding.NumPaddedVerts + v0;
+			const int32* Bones = &Binding.InfluenceBones[SlotStart];
+			const VectorRegister4Float Weights = VectorLoad(&Binding.InfluenceWeights[SlotStart]);
+
+			for (int32 c = 0; c < NumMatrixComps; c++)
+			{
+				const float* Comp = &Comps[c * NumBones];
+				Blend[c] = VectorMultiplyAdd(Weights, VectorSet(Comp[Bones[0]], Comp[Bones[1]], Comp[Bones[2]], Comp[Bones[3]]), Blend[c]);
+			}
+		}
+
+		// Row vectors times the blended matrix, like FMatrix44f::TransformPosition / TransformVector
+		const VectorRegister4Float X = VectorLoad(&Binding.PosX[v0]);
+		const VectorRegister4Float Y = VectorLoad(&Binding.PosY[v0]);
+		const VectorRegister4Float Z = VectorLoad(&Binding.PosZ[v0]);
+		VectorStore(VectorMultiplyAdd(X, Blend[0], VectorMultiplyAdd(Y, Blend[3], VectorMultiplyAdd(Z, Blend[6], Blend[9]))), OutPos[0]);
+		VectorStore(VectorMultiplyAdd(X, Blend[1], VectorMultiplyAdd(Y, Blend[4], VectorMultiplyAdd(Z, Blend[7], Blend[10]))), OutPos[1]);
+		VectorStore(VectorMultiplyAdd(X, Blend[2], VectorMultiplyAdd(Y, Blend[5], VectorMultiplyAdd(Z, Blend[8], Blend[11]))), OutPos[2]);
+
+		const VectorRegister4Float NX = VectorLoad(&Binding.NormalX[v0]);
+		const VectorRegister4Float NY = VectorLoad(&Binding.NormalY[v0]);
+		const VectorRegister4Float NZ = VectorLoad(&Binding.NormalZ[v0]);
+		const VectorRegister4Float SkinnedNX = VectorMultiplyAdd(NX, Blend[0], VectorMultiplyAdd(NY, Blend[3], VectorMultiply(NZ, Blend[6])));
+		const VectorRegister4Float SkinnedNY = VectorMultiplyAdd(NX, Blend[1], VectorMultiplyAdd(NY, Blend[4], VectorMultiply(NZ, Blend[7])));
+		const VectorRegister4Float SkinnedNZ = VectorMultiplyAdd(NX, Blend[2], VectorMultiplyAdd(NY, Blend[5], VectorMultiply(NZ, Blend[8])));
+
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(SkinnedNX, SkinnedNX, VectorMultiplyAdd(SkinnedNY, SkinnedNY, VectorMultiply(SkinnedNZ, SkinnedNZ)));
+		const VectorRegister4Float InvLength = VectorReciprocalSqrt(VectorMax(LengthSquared, MinLengthSquared));
+		VectorStore(VectorMultiply(SkinnedNX, InvLength), OutNormal[0]);
+		VectorStore(VectorMultiply(SkinnedNY, InvLength), OutNormal[1]);
+		VectorStore(VectorMultiply(SkinnedNZ, InvLength), OutNormal[2]);
+
+		const int32 NumLanes = FMath::Min(4, Binding.NumVerts - v0);
+		for (int32 l = 0; l < NumLanes; l++)
+		{
+			FFinalSkinVertex& Vert = OutVerts[v0 + l];
+			Vert.Position = FVector3f(OutPos[0][l], OutPos[1][l], OutPos[2][l]);
+			Vert.TangentZ = FPackedNormal(FVector4f(OutNormal[0][l], OutNormal[1][l], OutNormal[2][l], Vert.TangentZ.ToFVector4f().W));
+		}
+	}
+}
+
+void FVATSkinningKernel::SkinFrames(const FVATSkinBinding& Binding, const TArray <TArray <FMatrix44f>>& FrameRefToLocals, TArray <TArray <FFinalSkinVertex>>& OutFrames)
+{
+	OutFrames.SetNum(FrameRefToLocals.Num());
+
+	ParallelFor(FrameRefToLocals.Num(), [&](int32 Frame)
+	{
+		SkinVerts(Binding, FrameRefToLocals[Frame], OutFrames[Frame]);
+	});
+}
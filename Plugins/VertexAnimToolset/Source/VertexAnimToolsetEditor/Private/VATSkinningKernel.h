@@ -0,0 +1,49 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GPUSkinPublicDefs.h"
+#include "SkeletalMeshTypes.h"
+
+class USkeletalMesh;
+
+// Bind pose and skin influences of one LOD of a skeletal mesh, read from the imported model's soft vertices,
+// in SoA arrays padded to a multiple of 4 verts so the kernel can run on whole SIMD batches.
+// Vert order is the LOD's render vertex order, the order the engine's CPU skinning outputs.
+struct FVATSkinBinding
+{
+	int32 NumVerts = 0;
+	int32 NumPaddedVerts = 0;
+	// Most influences any vert of the LOD uses, the kernel loops over this many slots
+	int32 NumInfluences = 0;
+	int32 NumBones = 0;
+
+	TArray <float> PosX, PosY, PosZ;
+	TArray <float> NormalX, NormalY, NormalZ;
+	// Influence slot s of vert v at [s * NumPaddedVerts + v], mesh bone indices and weights summing to 1
+	TArray <int32> InfluenceBones;
+	TArray <float> InfluenceWeights;
+
+	// Everything of the bind pose that is not skinned, copied to the output as is
+	TArray <FFinalSkinVertex> RestVerts;
+
+	bool Initialize(const USkeletalMesh* Mesh, const int32 LODIndex);
+	bool IsValid() const { return NumVerts > 0; }
+};
+
+// Linear blend skinning of a binding's positions and normals, the bake's replacement for engine CPU skinning.
+// Needs no render state, so frames can be skinned in parallel. Morph targets and cloth are not applied.
+class FVATSkinningKernel
+{
+public:
+	/**
+	 * Skins one frame.
+	 * @param	RefToLocals		Ref to local matrices of the mesh's bones, as USkinnedMeshComponent::CacheRefToLocalMatrices outputs them
+	 * @param	OutVerts		Component space verts, only Position and TangentZ are skinned, the rest is the bind pose's
+	 */
+	static void SkinVerts(const FVATSkinBinding& Binding, const TArray <FMatrix44f>& RefToLocals, TArray <FFinalSkinVertex>& OutVerts);
+
+	// Skins a batch of frames in parallel, OutFrames[i] gets the verts of FrameRefToLocals[i]
+	static void SkinFrames(const FVATSkinBinding& Binding, const TArray <TArray <FMatrix44f>>& FrameRefToLocals, TArray <TArray <FFinalSkinVertex>>& OutFrames);
+};
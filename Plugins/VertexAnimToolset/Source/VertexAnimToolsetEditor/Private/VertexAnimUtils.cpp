@@ -39,6 +39,7 @@
 #include "MeshAttributeArray.h"
 #include "MeshDescription.h"
 #include "MeshAttributes.h"
+#include "StaticMeshAttributes.h"
 
 
 #include "Animation/AnimSequence.h"
@@ -277,14 +278,26 @@ static void AddOrDuplicateMaterial(UMaterialInterface* InMaterialInterface, cons
 }
 
 // Helper function for ConvertMeshesToStaticMesh
+// Materials already used by a previous component are shared, so merged components don't add sections (draw calls) for the same material.
+// OutMaterialRemap maps the component's material indices to indices in OutMaterials.
 template <typename ComponentType>
-static void ProcessMaterials(ComponentType* InComponent, const FString& InPackageName, TArray<UMaterialInterface*>& OutMaterials)
+static void ProcessMaterials(ComponentType* InComponent, const FString& InPackageName, TArray<UMaterialInterface*>& OutMaterials, TArray<int32>& OutMaterialRemap)
 {
 	const int32 NumMaterials = InComponent->GetNumMaterials();
+	OutMaterialRemap.SetNum(NumMaterials);
 	for (int32 MaterialIndex = 0; MaterialIndex < NumMaterials; MaterialIndex++)
 	{
 		UMaterialInterface* MaterialInterface = InComponent->GetMaterial(MaterialIndex);
-		AddOrDuplicateMaterial(MaterialInterface, InPackageName, OutMaterials);
+		const int32 ExistingIndex = MaterialInterface ? OutMaterials.Find(MaterialInterface) : INDEX_NONE;
+		if (ExistingIndex != INDEX_NONE)
+		{
+			OutMaterialRemap[MaterialIndex] = ExistingIndex;
+		}
+		else
+		{
+			OutMaterialRemap[MaterialIndex] = OutMaterials.Num();
+			AddOrDuplicateMaterial(MaterialInterface, InPackageName, OutMaterials);
+		}
 	}
 }
 
@@ -294,6 +307,66 @@ static bool IsValidSkinnedMeshComponent(USkinnedMeshComponent* InComponent)
 	return InComponent && InComponent->MeshObject && InComponent->IsVisible();
 }
 
+// Helper function for ConvertMeshesToStaticMesh
+static bool IsValidStaticMeshComponent(UStaticMeshComponent* InComponent)
+{
+	return InComponent && InComponent->GetStaticMesh() && InComponent->GetStaticMesh()->GetRenderData() && InComponent->IsVisible();
+}
+
+bool FVertexAnimUtils::IsConvertibleMeshComponent(UMeshComponent* InMeshComponent)
+{
+	return IsValidSkinnedMeshComponent(Cast<USkinnedMeshComponent>(InMeshComponent))
+		|| IsValidStaticMeshComponent(Cast<UStaticMeshComponent>(InMeshComponent));
+}
+
+int32 FVertexAnimUtils::GetNumLODsOfComponent(UMeshComponent* InMeshComponent)
+{
+	USkinnedMeshComponent* SkinnedMeshComponent = Cast<USkinnedMeshComponent>(InMeshComponent);
+	UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(InMeshComponent);
+
+	if (IsValidSkinnedMeshComponent(SkinnedMeshComponent))
+	{
+		return SkinnedMeshComponent->MeshObject->GetSkeletalMeshRenderData().LODRenderData.Num();
+	}
+	else if (IsValidStaticMeshComponent(StaticMeshComponent))
+	{
+		return StaticMeshComponent->GetStaticMesh()->GetRenderData()->LODResources.Num();
+	}
+
+	return 0;
+}
+
+int32 FVertexAnimUtils::CalcOverallMaxLODs(const TArray<UMeshComponent*>& InMeshComponents)
+{
+	int32 OverallMaxLODs = 0;
+	for (UMeshComponent* MeshComponent : InMeshComponents)
+	{
+		OverallMaxLODs = FMath::Max(GetNumLODsOfComponent(MeshComponent), OverallMaxLODs);
+	}
+	return OverallMaxLODs;
+}
+
+void FVertexAnimUtils::StaticMeshComponentVertices(
+	UStaticMeshComponent* InStaticMeshComponent, const int32 LODIndex, const FMatrix44f& InComponentToRoot, TArray<FFinalSkinVertex>& OutVertices)
+{
+	const FStaticMeshLODResources& LODResource = InStaticMeshComponent->GetStaticMesh()->GetRenderData()->LODResources[LODIndex];
+	const FStaticMeshVertexBuffer& StaticMeshVertexBuffer = LODResource.VertexBuffers.StaticMeshVertexBuffer;
+
+	OutVertices.SetNum(LODResource.GetNumVertices());
+	for (int32 VertIndex = 0; VertIndex < OutVertices.Num(); VertIndex++)
+	{
+		FFinalSkinVertex& Vertex = OutVertices[VertIndex];
+		Vertex.Position = InComponentToRoot.TransformPosition(LODResource.VertexBuffers.PositionVertexBuffer.VertexPosition((uint32)VertIndex));
+		Vertex.TangentX = FPackedNormal(InComponentToRoot.TransformVector(StaticMeshVertexBuffer.VertexTangentX(VertIndex)).GetSafeNormal());
+		Vertex.TangentZ = FPackedNormal(FVector4f(
+			InComponentToRoot.TransformVector(StaticMeshVertexBuffer.VertexTangentZ(VertIndex)).GetSafeNormal(),
+			StaticMeshVertexBuffer.VertexTangentZ(VertIndex).W));
+		const FVector2f UV = StaticMeshVertexBuffer.GetVertexUV(VertIndex, 0);
+		Vertex.U = UV.X;
+		Vertex.V = UV.Y;
+	}
+}
+
 /** Helper struct for tracking validity of optional buffers */
 struct FRawMeshTracker
 {
@@ -311,7 +384,8 @@ struct FRawMeshTracker
 // Helper function for ConvertMeshesToStaticMesh
 static void SkinnedMeshToRawMeshes(USkinnedMeshComponent* InSkinnedMeshComponent, int32 InOverallMaxLODs, const FMatrix44f& InComponentToWorld, const FString& InPackageName, TArray<FRawMeshTracker>& OutRawMeshTrackers, TArray<FRawMesh>& OutRawMeshes, TArray<UMaterialInterface*>& OutMaterials)
 {
-	const int32 BaseMaterialIndex = OutMaterials.Num();
+	TArray<int32> MaterialRemap;
+	ProcessMaterials<USkinnedMeshComponent>(InSkinnedMeshComponent, InPackageName, OutMaterials, MaterialRemap);
 
 	// Export all LODs to raw meshes
 	const int32 NumLODs = InSkinnedMeshComponent->GetNumLODs();
@@ -396,22 +470,101 @@ static void SkinnedMeshToRawMeshes(USkinnedMeshComponent* InSkinnedMeshComponent
 				{
 					MaterialIndex = FMath::Clamp<int32>(SrcLODInfo.LODMaterialMap[SectionIndex], 0, InSkinnedMeshComponent->SkeletalMesh->Materials.Num());
 				}
+				MaterialIndex = MaterialRemap[FMath::Clamp<int32>(MaterialIndex, 0, MaterialRemap.Num() - 1)];
 
 				// copy face info
 				for (uint32 TriIndex = 0; TriIndex < SkelMeshSection.NumTriangles; TriIndex++)
 				{
-					RawMesh.FaceMaterialIndices.Add(BaseMaterialIndex + MaterialIndex);
+					RawMesh.FaceMaterialIndices.Add(MaterialIndex);
 					RawMesh.FaceSmoothingMasks.Add(0); // Assume this is ignored as bRecomputeNormals is false
 				}
 			}
 		}
 	}
+}
+
+// Helper function for ConvertMeshesToStaticMesh
+static void StaticMeshToRawMeshes(UStaticMeshComponent* InStaticMeshComponent, int32 InOverallMaxLODs, const FMatrix44f& InComponentToWorld, const FString& InPackageName, TArray<FRawMeshTracker>& OutRawMeshTrackers, TArray<FRawMesh>& OutRawMeshes, TArray<UMaterialInterface*>& OutMaterials)
+{
+	TArray<int32> MaterialRemap;
+	ProcessMaterials<UStaticMeshComponent>(InStaticMeshComponent, InPackageName, OutMaterials, MaterialRemap);
+
+	const int32 NumLODs = InStaticMeshComponent->GetStaticMesh()->GetRenderData()->LODResources.Num();
+
+	for (int32 OverallLODIndex = 0; OverallLODIndex < InOverallMaxLODs; OverallLODIndex++)
+	{
+		int32 LODIndexRead = FMath::Min(OverallLODIndex, NumLODs - 1);
+
+		FRawMesh& RawMesh = OutRawMeshes[OverallLODIndex];
+		FRawMeshTracker& RawMeshTracker = OutRawMeshTrackers[OverallLODIndex];
+		const FStaticMeshLODResources& LODResource = InStaticMeshComponent->GetStaticMesh()->GetRenderData()->LODResources[LODIndexRead];
+		const int32 BaseVertexIndex = RawMesh.VertexPositions.Num();
+
+		// Copy vertex positions, same order as StaticMeshComponentVertices
+		TArray<FFinalSkinVertex> FinalVertices;
+		FVertexAnimUtils::StaticMeshComponentVertices(InStaticMeshComponent, LODIndexRead, InComponentToWorld, FinalVertices);
+		for (int32 VertIndex = 0; VertIndex < FinalVertices.Num(); ++VertIndex)
+		{
+			RawMesh.VertexPositions.Add(FinalVertices[VertIndex].Position);
+		}
+
+		const FIndexArrayView IndexArrayView = LODResource.IndexBuffer.GetArrayView();
+		const FStaticMeshVertexBuffer& StaticMeshVertexBuffer = LODResource.VertexBuffers.StaticMeshVertexBuffer;
+		const uint32 NumTexCoords = FMath::Min(StaticMeshVertexBuffer.GetNumTexCoords(), (uint32)MAX_MESH_TEXTURE_COORDS);
+		const int32 NumSections = LODResource.Sections.Num();
+
+		for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+		{
+			const FStaticMeshSection& StaticMeshSection = LODResource.Sections[SectionIndex];
+
+			const int32 NumIndices = StaticMeshSection.NumTriangles * 3;
+			for (int32 IndexIndex = 0; IndexIndex < NumIndices; IndexIndex++)
+			{
+				const int32 Index = IndexArrayView[StaticMeshSection.FirstIndex + IndexIndex];
+				RawMesh.WedgeIndices.Add(BaseVertexIndex + Index);
+
+				RawMesh.WedgeTangentX.Add(InComponentToWorld.TransformVector(StaticMeshVertexBuffer.VertexTangentX(Index)));
+				RawMesh.WedgeTangentY.Add(InComponentToWorld.TransformVector(StaticMeshVertexBuffer.VertexTangentY(Index)));
+				RawMesh.WedgeTangentZ.Add(InComponentToWorld.TransformVector(StaticMeshVertexBuffer.VertexTangentZ(Index)));
+
+				for (uint32 TexCoordIndex = 0; TexCoordIndex < MAX_MESH_TEXTURE_COORDS; TexCoordIndex++)
+				{
+					if (TexCoordIndex >= NumTexCoords)
+					{
+						RawMesh.WedgeTexCoords[TexCoordIndex].AddDefaulted();
+					}
+					else
+					{
+						RawMesh.WedgeTexCoords[TexCoordIndex].Add(StaticMeshVertexBuffer.GetVertexUV(Index, TexCoordIndex));
+						RawMeshTracker.bValidTexCoords[TexCoordIndex] = true;
+					}
+				}
+
+				if (LODResource.VertexBuffers.ColorVertexBuffer.IsInitialized())
+				{
+					RawMesh.WedgeColors.Add(LODResource.VertexBuffers.ColorVertexBuffer.VertexColor(Index));
+					RawMeshTracker.bValidColors = true;
+				}
+				else
+				{
+					RawMesh.WedgeColors.Add(FColor::White);
+				}
+			}
 
-	ProcessMaterials<USkinnedMeshComponent>(InSkinnedMeshComponent, InPackageName, OutMaterials);
+			const int32 MaterialIndex = MaterialRemap[FMath::Clamp<int32>(StaticMeshSection.MaterialIndex, 0, MaterialRemap.Num() - 1)];
+
+			// copy face info
+			for (uint32 TriIndex = 0; TriIndex < StaticMeshSection.NumTriangles; TriIndex++)
+			{
+				RawMesh.FaceMaterialIndices.Add(MaterialIndex);
+				RawMesh.FaceSmoothingMasks.Add(0); // Assume this is ignored as bRecomputeNormals is false
+			}
+		}
+	}
 }
 
 
-UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshComponent*>& InMeshComponents, const FTransform& InRootTransform, const FString& InPackageName)
+UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshComponent*>& InMeshComponents, const FTransform& InRootTransform, const FString& InPackageName, const bool bBuild)
 {
 	UStaticMesh* StaticMesh = nullptr;
 
@@ -462,21 +615,7 @@ UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshCompo
 		FMatrix WorldToRoot = InRootTransform.ToMatrixWithScale().Inverse();
 
 		// first do a pass to determine the max LOD level we will be combining meshes into
-		int32 OverallMaxLODs = 0;
-		for (UMeshComponent* MeshComponent : InMeshComponents)
-		{
-			USkinnedMeshComponent* SkinnedMeshComponent = Cast<USkinnedMeshComponent>(MeshComponent);
-			UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(MeshComponent);
-
-			if (IsValidSkinnedMeshComponent(SkinnedMeshComponent))
-			{
-				OverallMaxLODs = FMath::Max(SkinnedMeshComponent->MeshObject->GetSkeletalMeshRenderData().LODRenderData.Num(), OverallMaxLODs);
-			}
-			else if (false)//(IsValidStaticMeshComponent(StaticMeshComponent))
-			{
-				OverallMaxLODs = FMath::Max(StaticMeshComponent->GetStaticMesh()->RenderData->LODResources.Num(), OverallMaxLODs);
-			}
-		}
+		const int32 OverallMaxLODs = CalcOverallMaxLODs(InMeshComponents);
 
 		// Resize raw meshes to accommodate the number of LODs we will need
 		RawMeshes.SetNum(OverallMaxLODs);
@@ -494,9 +633,9 @@ UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshCompo
 			{
 				SkinnedMeshToRawMeshes(SkinnedMeshComponent, OverallMaxLODs, ComponentToWorld, PackageName, RawMeshTrackers, RawMeshes, Materials);
 			}
-			else if (false)//(IsValidStaticMeshComponent(StaticMeshComponent))
+			else if (IsValidStaticMeshComponent(StaticMeshComponent))
 			{
-				//StaticMeshToRawMeshes(StaticMeshComponent, OverallMaxLODs, ComponentToWorld, PackageName, RawMeshTrackers, RawMeshes, Materials);
+				StaticMeshToRawMeshes(StaticMeshComponent, OverallMaxLODs, ComponentToWorld, PackageName, RawMeshTrackers, RawMeshes, Materials);
 			}
 		}
 
@@ -601,8 +740,11 @@ UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshCompo
 			StaticMesh->GetOriginalSectionInfoMap().CopyFrom(StaticMesh->GetSectionInfoMap());
 
 			// Build mesh from source
-			StaticMesh->Build(false);
-			StaticMesh->PostEditChange();
+			if (bBuild)
+			{
+				StaticMesh->Build(false);
+				StaticMesh->PostEditChange();
+			}
 
 			StaticMesh->MarkPackageDirty();
 
@@ -631,111 +773,60 @@ UStaticMesh* FVertexAnimUtils::ConvertMeshesToStaticMesh(const TArray<UMeshCompo
 
 
 
-void FVertexAnimUtils::VATUVsToStaticMeshLODs(UStaticMesh* StaticMesh, const int32 UVChannel, const TArray<TArray<FVector2D>>& UVs)
+void FVertexAnimUtils::VATAttributesToStaticMeshLODs(UStaticMesh* StaticMesh, const FVATMeshAttributes& Attributes)
 {
-	for (int32 LOD = 0; LOD < StaticMesh->GetNumLODs(); LOD++)
-	{
-		const uint32 PaintingMeshLODIndex = LOD;
-
-		if (StaticMesh->IsSourceModelValid(PaintingMeshLODIndex))
-		{
-			if (StaticMesh->GetSourceModel(PaintingMeshLODIndex).IsRawMeshEmpty() == false)
-			{
-				const uint32 NumUVChannels = StaticMesh->GetNumUVChannels(PaintingMeshLODIndex);
-				// Extract the raw mesh.
-				FRawMesh Mesh;
-				StaticMesh->GetSourceModel(PaintingMeshLODIndex).LoadRawMesh(Mesh);
+	check(Attributes.UVChannels.Num() == Attributes.UVs.Num());
 
-				// Build a mapping of vertex positions to vertex colors.
-				for (int32 WedgeIndex = 0; WedgeIndex < Mesh.WedgeIndices.Num(); ++WedgeIndex)
-				{
-					int32 VertID = Mesh.WedgeIndices[WedgeIndex];
-					auto Position = Mesh.VertexPositions[VertID];
+	int32 MaxVATChannel = INDEX_NONE;
+	for (const int32 UVChannel : Attributes.UVChannels)
+	{
+		check(UVChannel >= 0 && UVChannel < MAX_MESH_TEXTURE_COORDS_MD);
+		MaxVATChannel = FMath::Max(MaxVATChannel, UVChannel);
+	}
 
-					for (uint32 TexCoordIndex = 0; TexCoordIndex < MAX_MESH_TEXTURE_COORDS; TexCoordIndex++)
-					{
-						if (TexCoordIndex <= NumUVChannels)//(!RawMeshTrackers[RawMeshIndex].bValidTexCoords[TexCoordIndex])
-						{
-							if ((TexCoordIndex == UVChannel))
-							{
-								// Mesh.WedgeTexCoords[TexCoordIndex].Empty();
-								if (Mesh.WedgeTexCoords[TexCoordIndex].Num() != Mesh.WedgeIndices.Num())
-									Mesh.WedgeTexCoords[TexCoordIndex].SetNum(Mesh.WedgeIndices.Num());
-
-								Mesh.WedgeTexCoords[TexCoordIndex][WedgeIndex] = FVector2f{ UVs[PaintingMeshLODIndex][VertID] };
-							}
-							else if(TexCoordIndex >= NumUVChannels)
-							{
-								Mesh.WedgeTexCoords[TexCoordIndex].Empty();
-							}
-						}
-						else
-						{
-							Mesh.WedgeTexCoords[TexCoordIndex].Empty();
-						}
-					}
-				}
+	// Not using GetNumLODs(), the mesh might not be built yet
+	for (int32 LOD = 0; LOD < StaticMesh->GetNumSourceModels(); LOD++)
+	{
+		FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(LOD);
+		if (!MeshDescription) continue;
 
-				// Determine which texture coordinate map should be used for storing/generating the lightmap UVs
-				const uint32 LightMapIndex = FMath::Min(UVChannel == NumUVChannels ? NumUVChannels + 1 : NumUVChannels, (uint32)MAX_MESH_TEXTURE_COORDS - 1);
-				StaticMesh->GetSourceModel(PaintingMeshLODIndex).BuildSettings.DstLightmapIndex = LightMapIndex;
+		FStaticMeshAttributes MeshAttributes(*MeshDescription);
+		TVertexInstanceAttributesRef<FVector2f> VertexInstanceUVs = MeshAttributes.GetVertexInstanceUVs();
+		TVertexInstanceAttributesRef<FVector4f> VertexInstanceColors = MeshAttributes.GetVertexInstanceColors();
 
-				// Save the new raw mesh.
-				StaticMesh->GetSourceModel(PaintingMeshLODIndex).SaveRawMesh(Mesh);
+		const int32 NumUVChannels = FMath::Max(VertexInstanceUVs.GetNumChannels(), MaxVATChannel + 1);
+		VertexInstanceUVs.SetNumChannels(NumUVChannels);
 
+		const bool bWriteColors = Attributes.Colors.IsValidIndex(LOD);
 
-				StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
-				// Set light map coordinate index to match DstLightmapIndex
-				StaticMesh->LightMapCoordinateIndex = LightMapIndex;
-			
+		// Vertex IDs match the source vertices the VAT data was generated from
+		for (const FVertexInstanceID VertexInstanceID : MeshDescription->VertexInstances().GetElementIDs())
+		{
+			const int32 VertID = MeshDescription->GetVertexInstanceVertex(VertexInstanceID).GetValue();
 
+			for (int32 c = 0; c < Attributes.UVChannels.Num(); c++)
+			{
+				VertexInstanceUVs.Set(VertexInstanceID, Attributes.UVChannels[c], FVector2f{ Attributes.UVs[c][LOD][VertID] });
 			}
-		}
-	}
-
-	// Build mesh from source
-	StaticMesh->Build(false);
-	StaticMesh->PostEditChange();
-	StaticMesh->MarkPackageDirty();
-}
 
-void FVertexAnimUtils::VATColorsToStaticMeshLODs(UStaticMesh* StaticMesh, const TArray<TArray<FColor>>& Colors)
-{
-	for (int32 LOD = 0; LOD < StaticMesh->GetNumLODs(); LOD++)
-	{
-		const uint32 PaintingMeshLODIndex = LOD;
-
-		if (StaticMesh->IsSourceModelValid(PaintingMeshLODIndex))
-		{
-			if (StaticMesh->GetSourceModel(PaintingMeshLODIndex).IsRawMeshEmpty() == false)
+			if (bWriteColors)
 			{
-				const uint32 NumUVChannels = StaticMesh->GetNumUVChannels(PaintingMeshLODIndex);
-				// Extract the raw mesh.
-				FRawMesh Mesh;
-				StaticMesh->GetSourceModel(PaintingMeshLODIndex).LoadRawMesh(Mesh);
-
-				// Reserve space for the new vertex colors.
-				if (Mesh.WedgeColors.Num() == 0 || Mesh.WedgeColors.Num() != Mesh.WedgeIndices.Num())
-				{
-					Mesh.WedgeColors.Empty(Mesh.WedgeIndices.Num());
-					Mesh.WedgeColors.AddUninitialized(Mesh.WedgeIndices.Num());
-				}
-
-				// Build a mapping of vertex positions to vertex colors.
-				for (int32 WedgeIndex = 0; WedgeIndex < Mesh.WedgeIndices.Num(); ++WedgeIndex)
-				{
-					int32 VertID = Mesh.WedgeIndices[WedgeIndex];
-					auto Position = Mesh.VertexPositions[VertID];
-					Mesh.WedgeColors[WedgeIndex] = Colors[PaintingMeshLODIndex][VertID];
-				}
-
-				// Save the new raw mesh.
-				StaticMesh->GetSourceModel(PaintingMeshLODIndex).SaveRawMesh(Mesh);
-				StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+				// Same conversion FRawMesh colors go through, so the built FColors match exactly
+				VertexInstanceColors[VertexInstanceID] = FVector4f(FLinearColor::FromSRGBColor(Attributes.Colors[LOD][VertID]));
 			}
 		}
+
+		StaticMesh->CommitMeshDescription(LOD);
+
+		// Determine which texture coordinate map should be used for storing/generating the lightmap UVs
+		const int32 LightMapIndex = FMath::Min(NumUVChannels, MAX_MESH_TEXTURE_COORDS_MD - 1);
+		StaticMesh->GetSourceModel(LOD).BuildSettings.DstLightmapIndex = LightMapIndex;
+		// Set light map coordinate index to match DstLightmapIndex
+		StaticMesh->LightMapCoordinateIndex = LightMapIndex;
 	}
 
+	StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+
 	// Build mesh from source
 	StaticMesh->Build(false);
 	StaticMesh->PostEditChange();
@@ -744,8 +835,6 @@ void FVertexAnimUtils::VATColorsToStaticMeshLODs(UStaticMesh* StaticMesh, const
 
 
 
-
-
 void SPickAssetDialog::Construct(const FArguments& InArgs)
 {
 
@@ -0,0 +1,23 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VATAuditCommandlet.generated.h"
+
+/**
+ * Audits the memory of every UVertexAnimProfile and of the maps using them, see FVATMemoryAudit.
+ * Returns 1 when a profile or map is over budget, so builds can fail on it.
+ *   -run=VATAudit [-Path=/Game] [-MapPath=/Game] [-ProfileBudgetMB=16] [-MapBudgetMB=256] [-Report=File.csv]
+ * Budgets not given fall back to [VATAudit] of the editor ini. The map report is written next to the profile report, with a _Maps suffix.
+ */
+UCLASS()
+class UVATAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UVATAuditCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,36 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VATBakeCommandlet.generated.h"
+
+/**
+ * Rebakes UVertexAnimProfile assets without the editor UI, from the skeletal mesh each profile was last baked from.
+ *
+ * Coordinator (default): shards the profiles across worker editor processes through a file queue, retries failed shards and merges a report.
+ *   -run=VATBake [-Profiles=/Game/A.A+/Game/B.B] [-Path=/Game/Crowd] [-Workers=4] [-ShardSize=4] [-Retries=1] [-ShardTimeout=1800] [-Report=File.csv]
+ *   -Workers=0 bakes everything in the coordinator process.
+ *
+ * Worker: bakes the profiles listed in a shard file, one per line, and appends one result line per profile to the result file.
+ *   -run=VATBake -Worker -Shard=File.txt -Result=File.tsv
+ *
+ * Geometry caches: vert anim bake of one profile from geometry caches (Alembic imports), one clip per cache, in this process.
+ * The static mesh goes next to the profile, named after the first cache, unless -Mesh= gives its package.
+ *   -run=VATBake -Profiles=/Game/A.A -GeometryCaches=/Game/Walk.Walk+/Game/Run.Run [-Mesh=/Game/Crowd/SM_Crowd_VAT]
+ */
+UCLASS()
+class UVATBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UVATBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	int32 RunWorker(const TMap<FString, FString>& ParamVals);
+	int32 RunCoordinator(const TMap<FString, FString>& ParamVals);
+	int32 RunGeometryCaches(const TMap<FString, FString>& ParamVals);
+};
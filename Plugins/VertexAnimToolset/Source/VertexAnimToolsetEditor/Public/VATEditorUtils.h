@@ -15,6 +15,8 @@
 class UDebugSkelMeshComponent;
 class UTextureRenderTarget2D;
 class UAnimSequence;
+class UVertexAnimProfile;
+class FVATFrameSource;
 
 class FPrimitiveSceneProxy;
 class FColorVertexBuffer;
@@ -31,6 +33,11 @@ public:
     static int UnPackBits(const float bit);
 
     static void DoBakeProcess(UDebugSkelMeshComponent* PreviewComponent);
+    // DoBakeProcess without the dialog, for commandlets. Returns false and sets OutError if the profile does not fit
+    static bool BakeProfile(UDebugSkelMeshComponent* PreviewComponent, UVertexAnimProfile* Profile, const bool bOnlyCreateStaticMesh, FText& OutError);
+    // Vert anim bake from any frame source (geometry caches, static mesh flipbooks) into the profile and a static mesh at MeshPackageName.
+    // The profile's Anims_Vert are matched to the source's clips, bone anim needs a skeletal source (BakeProfile).
+    static bool BakeFrameSource(FVATFrameSource& Source, UVertexAnimProfile* Profile, const FString& MeshPackageName, FText& OutError);
     
     static void SkelPivotPos(USkeletalMesh* Skel, TArray <FVector>& VectorData);
     static void SkelOrigin(USkeletalMesh* Skel, TArray <FVector>& VectorData);
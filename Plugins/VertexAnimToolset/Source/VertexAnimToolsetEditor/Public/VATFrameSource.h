@@ -0,0 +1,127 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GPUSkinPublicDefs.h"
+#include "SkeletalMeshTypes.h"
+#include "UObject/StrongObjectPtr.h"
+
+class UDebugSkelMeshComponent;
+class UMeshComponent;
+class UStaticMesh;
+class UStaticMeshComponent;
+class UGeometryCache;
+class UAnimationAsset;
+struct FVASequenceData;
+struct FVATSkinBinding;
+
+// Source of the vertex frames the vert anim textures are sampled from, so baking is not tied to the skeletal mesh editor.
+// Verts come in the vertex order of the static mesh CreateStaticMesh makes, with the same count every frame (constant topology).
+class VERTEXANIMTOOLSETEDITOR_API FVATFrameSource
+{
+public:
+	virtual ~FVATFrameSource() {}
+
+	virtual int32 GetNumLODs() const { return 1; }
+	virtual int32 GetNumClips() const = 0;
+	// Seconds
+	virtual float GetClipLength(const int32 ClipIndex) const = 0;
+	// Frames to bake for a clip the profile has no entry for yet
+	virtual int32 GetDefaultNumFrames(const int32 ClipIndex) const { return 8; }
+
+	// Verts of a LOD in the pose the offsets are relative to, the pose the static mesh is made in
+	virtual bool GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) = 0;
+	// Verts of a LOD at a time of a clip, DeltaTime is the time step between the sampled frames (for simulated sources)
+	virtual bool GetFrameVerts(const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) = 0;
+	// Verts of a batch of times of a clip, OutFrames[i] gets the verts at Times[i]. Calls GetFrameVerts per time unless a source can do better.
+	virtual bool GetClipFrames(const int32 ClipIndex, TArrayView<const float> Times, const float DeltaTime, const int32 LODIndex, TArray <TArray <FFinalSkinVertex>>& OutFrames);
+
+	// Static mesh of the rest verts, not built yet, VATAttributesToStaticMeshLODs writes the VAT attributes and builds it
+	virtual UStaticMesh* CreateStaticMesh(const FString& PackageName) = 0;
+};
+
+// The skeletal mesh editor's preview component plus its merged attachments, playing the profile's sequences.
+// Sampling needs the components switched to CPU skinning and the skinned attachments following the preview's leader pose,
+// GatherAndBakeAllAnimVertData takes care of that.
+// A lone preview mesh without morph targets or cloth is skinned by FVATSkinningKernel in GetRestVerts and GetClipFrames instead,
+// only the bone pose is evaluated per frame and the frames are skinned in parallel, without going through the render thread.
+class VERTEXANIMTOOLSETEDITOR_API FVATSkeletalFrameSource : public FVATFrameSource
+{
+public:
+	FVATSkeletalFrameSource(UDebugSkelMeshComponent* InPreviewComponent, const TArray <UMeshComponent*>& InComponents, const TArray <FVASequenceData>& InAnims);
+
+	virtual int32 GetNumLODs() const override;
+	virtual int32 GetNumClips() const override { return Sequences.Num(); }
+	virtual float GetClipLength(const int32 ClipIndex) const override;
+
+	virtual bool GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+	virtual bool GetFrameVerts(const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+	virtual bool GetClipFrames(const int32 ClipIndex, TArrayView<const float> Times, const float DeltaTime, const int32 LODIndex, TArray <TArray <FFinalSkinVertex>>& OutFrames) override;
+
+	virtual UStaticMesh* CreateStaticMesh(const FString& PackageName) override;
+
+private:
+	void SetLOD(const int32 LODIndex);
+	void SetClip(const int32 ClipIndex);
+	// Skin binding of a LOD if the kernel can stand in for engine skinning, else null
+	const FVATSkinBinding* GetKernelBinding(const int32 LODIndex);
+
+	UDebugSkelMeshComponent* PreviewComponent;
+	TArray <UMeshComponent*> Components;
+	TArray <UAnimationAsset*> Sequences;
+
+	int32 ActiveClip = INDEX_NONE;
+	int32 ActiveLOD = INDEX_NONE;
+
+	// Per LOD, built on first use
+	TArray <TSharedPtr<FVATSkinBinding>> KernelBindings;
+};
+
+// Geometry caches (Alembic imports) with constant topology, every cache is one clip and all of them share the topology of the first.
+// Tracks are merged into one mesh, with their track transforms applied.
+class VERTEXANIMTOOLSETEDITOR_API FVATGeometryCacheFrameSource : public FVATFrameSource
+{
+public:
+	explicit FVATGeometryCacheFrameSource(const TArray <UGeometryCache*>& InCaches);
+
+	virtual int32 GetNumClips() const override { return Caches.Num(); }
+	virtual float GetClipLength(const int32 ClipIndex) const override;
+	virtual int32 GetDefaultNumFrames(const int32 ClipIndex) const override;
+
+	virtual bool GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+	virtual bool GetFrameVerts(const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+
+	virtual UStaticMesh* CreateStaticMesh(const FString& PackageName) override;
+
+private:
+	TArray <UGeometryCache*> Caches;
+};
+
+// Flipbooks of static meshes sharing the rest mesh's topology (sim frames exported as separate meshes), every mesh list is one clip.
+// Frames are not interpolated, a time samples the mesh shown at that time at FramesPerSecond.
+class VERTEXANIMTOOLSETEDITOR_API FVATStaticMeshFrameSource : public FVATFrameSource
+{
+public:
+	FVATStaticMeshFrameSource(UStaticMesh* InRestMesh, const TArray <TArray <UStaticMesh*>>& InClipFrames, const float InFramesPerSecond = 30.f);
+
+	virtual int32 GetNumLODs() const override;
+	virtual int32 GetNumClips() const override { return ClipFrames.Num(); }
+	virtual float GetClipLength(const int32 ClipIndex) const override;
+	virtual int32 GetDefaultNumFrames(const int32 ClipIndex) const override { return ClipFrames[ClipIndex].Num(); }
+
+	virtual bool GetRestVerts(const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+	virtual bool GetFrameVerts(const int32 ClipIndex, const float Time, const float DeltaTime, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts) override;
+
+	virtual UStaticMesh* CreateStaticMesh(const FString& PackageName) override;
+
+private:
+	bool MeshVerts(UStaticMesh* Mesh, const int32 LODIndex, TArray <FFinalSkinVertex>& OutVerts);
+
+	UStaticMesh* RestMesh;
+	TArray <TArray <UStaticMesh*>> ClipFrames;
+	float FramesPerSecond;
+
+	// Transient component the meshes are read through, the same way merged static attachments are
+	TStrongObjectPtr<UStaticMeshComponent> Component;
+};
@@ -0,0 +1,50 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VertexAnimProfile.h"
+
+// Simulated texture cache and workload, the defaults are a 64KB 8 way cache of 4x4 texel tiles (128 bytes of half float RGBA)
+struct FVATCacheSimSettings
+{
+	int32 TileWidth = 4;
+	int32 TileHeight = 4;
+	int32 NumSets = 64;
+	int32 NumWays = 8;
+	// Verts shaded in lockstep, a wave reads frame 0 for all its verts, then frame 1
+	int32 WaveSize = 64;
+	// Instances drawn one after the other, each at a random frame of a random clip
+	int32 NumInstances = 16;
+	int32 Seed = 0;
+};
+
+struct FVATCacheSimResult
+{
+	int64 Reads = 0;
+	int64 Misses = 0;
+	// Distinct cache lines touched over the whole run
+	int64 UniqueLines = 0;
+
+	float HitRate() const { return Reads ? 1.f - (float)Misses / (float)Reads : 0.f; }
+	// Of the lines fetched, the share that was a refetch of a line already fetched once, lower is better
+	float RefetchRate() const { return Misses ? 1.f - (float)UniqueLines / (float)Misses : 0.f; }
+};
+
+/**
+ * GPU independent estimate of how well a vert texture layout uses the texture cache: plays back the reads of the vert anim
+ * decode, two frames per vert, against a set associative LRU cache of square texel tiles. Verts are taken in texel order.
+ * Only the offsets texture is simulated, the normals texture is read at the same texels.
+ * Run on a baked profile with VAT.SimulateLayout <ProfilePath> [Instances].
+ */
+class VERTEXANIMTOOLSETEDITOR_API FVATLayoutSimulator
+{
+public:
+	// Clips as first stored frame and frame count
+	static FVATCacheSimResult Simulate(
+		const EVATVertLayout Layout, const int32 Width, const int32 RowsPerFrame, const int32 NumVerts, const TArray <FIntPoint>& Clips,
+		const FVATCacheSimSettings& Settings);
+
+	// The profile's LOD0 verts and clips, in either layout whatever the profile was baked with
+	static FVATCacheSimResult Simulate(const UVertexAnimProfile* Profile, const EVATVertLayout Layout, const FVATCacheSimSettings& Settings);
+};
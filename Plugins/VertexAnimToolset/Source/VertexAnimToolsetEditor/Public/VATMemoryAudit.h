@@ -0,0 +1,78 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UTexture2D;
+class UVertexAnimProfile;
+
+// One baked texture of a profile
+struct FVATTextureAudit
+{
+	// Which texture of the profile, "Offsets", "BoneRot"...
+	FString Slot;
+	FString Path;
+	FIntPoint Size = FIntPoint::ZeroValue;
+	FString Format;
+	int32 NumMips = 0;
+	// Platform data of all mips, what the texture costs in memory when fully streamed in
+	int64 Bytes = 0;
+};
+
+struct FVATProfileAudit
+{
+	FString Profile;
+	// Packages of the profile, its static mesh and textures, matched against what maps depend on
+	TArray <FName> Packages;
+	TArray <FVATTextureAudit> Textures;
+	int64 TextureBytes = 0;
+	// Texel and rest pose copies kept on the profile for CPU sampling, root motion, anim events, collision capsules
+	int64 CPUBytes = 0;
+	// Share of the texels of the vert / bone textures past CalcTotalRequiredHeight_*, 0 to 1
+	float UnusedFraction_Vert = 0.f;
+	float UnusedFraction_Bone = 0.f;
+	int32 NumVerts = 0;
+	int32 NumClips_Vert = 0;
+	int32 NumClips_Bone = 0;
+
+	int64 TotalBytes() const { return TextureBytes + CPUBytes; }
+};
+
+// VAT memory of everything a map depends on
+struct FVATMapAudit
+{
+	FString Map;
+	TArray <FString> Profiles;
+	// Textures shared between profiles count once
+	int64 Bytes = 0;
+};
+
+/**
+ * Reports what baked VAT profiles cost: texture sizes, formats and bytes, unused rows, vert and clip counts,
+ * per profile and per map, against the budgets in the editor ini:
+ *
+ *   [VATAudit]
+ *   ProfileBudgetMB=16
+ *   MapBudgetMB=256
+ *
+ * 0 or no entry is no budget. Run from the console with VAT.Audit [/Game/Path], or headless with the VATAudit commandlet.
+ */
+class VERTEXANIMTOOLSETEDITOR_API FVATMemoryAudit
+{
+public:
+	static FVATTextureAudit AuditTexture(const TCHAR* Slot, const UTexture2D* Texture);
+	static FVATProfileAudit AuditProfile(const UVertexAnimProfile* Profile);
+
+	// Loads and audits every profile under ProfilePath
+	static void AuditProfiles(const FString& ProfilePath, TArray <FVATProfileAudit>& OutProfiles);
+	// Audits every map under MapPath that depends, directly or not, on any of the audited profiles
+	static void AuditMaps(const FString& MapPath, const TArray <FVATProfileAudit>& Profiles, TArray <FVATMapAudit>& OutMaps);
+
+	static void GetBudgets(double& OutProfileBudgetMB, double& OutMapBudgetMB);
+
+	static FString ProfileCSV(const TArray <FVATProfileAudit>& Profiles, const double ProfileBudgetMB);
+	static FString MapCSV(const TArray <FVATMapAudit>& Maps, const double MapBudgetMB);
+
+	static bool IsOverBudget(const int64 Bytes, const double BudgetMB) { return (BudgetMB > 0.0) && (Bytes > BudgetMB * 1024.0 * 1024.0); }
+};
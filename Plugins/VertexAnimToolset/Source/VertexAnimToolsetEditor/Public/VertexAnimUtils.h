@@ -27,8 +27,25 @@ class UTextureRenderTarget2D;
 class FSkeletalMeshLODRenderData;
 class FSkinWeightVertexBuffer;
 struct FActiveMorphTarget;
+struct FFinalSkinVertex;
 class UVertexAnimProfile;
 
+// VAT attributes to write onto every LOD of the generated static mesh, indexed per LOD and per source vertex
+struct FVATMeshAttributes
+{
+	TArray <int32> UVChannels;
+	// [UVChannels index][LOD][Vertex]
+	TArray <TArray <TArray <FVector2D>>> UVs;
+	// [LOD][Vertex], leave empty to keep the mesh colors
+	TArray <TArray <FColor>> Colors;
+
+	void AddUVChannel(const int32 UVChannel, const TArray <TArray <FVector2D>>& InUVs)
+	{
+		UVChannels.Add(UVChannel);
+		UVs.Add(InUVs);
+	}
+};
+
 // Abstract class holding helper functions to be used in the baking process
 class FVertexAnimUtils
 {
@@ -47,18 +64,31 @@ public:
 	static int32 Grid2D_Y(const int32& Index, const int32& Height);
 
 
-	
+	// Skinned components with a mesh object and static mesh components with render data, if visible
+	static bool IsConvertibleMeshComponent(UMeshComponent* InMeshComponent);
+	// Max num of LODs of the components, the static mesh generated by ConvertMeshesToStaticMesh has this many LODs
+	static int32 CalcOverallMaxLODs(const TArray<UMeshComponent*>& InMeshComponents);
+	// Num of LODs of a single convertible component
+	static int32 GetNumLODsOfComponent(UMeshComponent* InMeshComponent);
+
+	/**
+	 * Vertices of a static mesh component's LOD transformed into root space,
+	 * in the same order ConvertMeshesToStaticMesh adds them to the raw mesh.
+	 */
+	static void StaticMeshComponentVertices(UStaticMeshComponent* InStaticMeshComponent, const int32 LODIndex, const FMatrix44f& InComponentToRoot, TArray<FFinalSkinVertex>& OutVertices);
+
 	/**
 	 * Convert a set of mesh components in their current pose to a static mesh.
 	 * @param	InMeshComponents		The mesh components we want to convert
 	 * @param	InRootTransform			The transform of the root of the mesh we want to output
 	 * @param	InPackageName			The package name to create the static mesh in. If this is empty then a dialog will be displayed to pick the mesh.
+	 * @param	bBuild					Build the mesh right away, pass false when more source data is written before building (VATAttributesToStaticMeshLODs)
 	 * @return a new static mesh (specified by the user)
 	 */
-	static UStaticMesh* ConvertMeshesToStaticMesh(const TArray<UMeshComponent*>& InMeshComponents, const FTransform& InRootTransform = FTransform::Identity, const FString& InPackageName = FString());
+	static UStaticMesh* ConvertMeshesToStaticMesh(const TArray<UMeshComponent*>& InMeshComponents, const FTransform& InRootTransform = FTransform::Identity, const FString& InPackageName = FString(), const bool bBuild = true);
 
-	static void VATUVsToStaticMeshLODs(UStaticMesh* StaticMesh, const int32 UVChannel, const TArray <TArray <FVector2D>>& UVs);
-	static void VATColorsToStaticMeshLODs(UStaticMesh* StaticMesh, const TArray <TArray <FColor>>& Colors);
+	// Writes all VAT UV channels and colors into the mesh description of every LOD in one pass, then builds the mesh once
+	static void VATAttributesToStaticMeshLODs(UStaticMesh* StaticMesh, const FVATMeshAttributes& Attributes);
 
 };
 
@@ -44,6 +44,7 @@ public class VertexAnimToolsetEditor : ModuleRules
                 "TargetPlatform",
                 "MeshDescription",
                 "MeshDescriptionOperations",
+                "StaticMeshDescription",
 
                 "CoreUObject",
 				"Engine",
@@ -61,6 +62,9 @@ public class VertexAnimToolsetEditor : ModuleRules
                 "AnimationEditor",
                 "SkeletalMeshEditor",
 				"MeshUtilities",
+				"MeshBuilder",
+				"AssetRegistry",
+				"GeometryCache",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
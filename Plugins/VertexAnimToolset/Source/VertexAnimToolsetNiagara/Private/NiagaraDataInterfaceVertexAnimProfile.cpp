@@ -0,0 +1,531 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "NiagaraDataInterfaceVertexAnimProfile.h"
+
+#include "VertexAnimProfile.h"
+
+#include "NiagaraTypes.h"
+#include "NiagaraRenderer.h"
+#include "NiagaraShaderParametersBuilder.h"
+#include "NiagaraCompileHashVisitor.h"
+#include "ShaderCore.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+#include "Engine/Texture2D.h"
+
+#define LOCTEXT_NAMESPACE "NiagaraDataInterfaceVertexAnimProfile"
+
+namespace NDIVertexAnimProfileLocal
+{
+	static const TCHAR* DecodeShaderFile = TEXT("/Plugin/VertexAnimToolset/Private/VertexAnimDecode.ush");
+	static const TCHAR* TemplateShaderFile = TEXT("/Plugin/VertexAnimToolset/Private/NiagaraDataInterfaceVertexAnimProfileTemplate.ush");
+
+	static const FName GetNumVerticesName(TEXT("GetNumVertices"));
+	static const FName GetNumBonesName(TEXT("GetNumBones"));
+	static const FName GetNumClipsName(TEXT("GetNumClips"));
+	static const FName GetClipInfoName(TEXT("GetClipInfo"));
+	static const FName SampleVertexName(TEXT("SampleVertex"));
+	static const FName SampleBoneTransformName(TEXT("SampleBoneTransform"));
+
+	// Profile data on its way to the render thread, the buffer and texture layouts are described in the template shader
+	struct FGPUData
+	{
+		int32 NumVertices = 0;
+		int32 NumBones = 0;
+		int32 NumVertClips = 0;
+		int32 NumBoneClips = 0;
+		int32 VertTextureWidth = 1;
+		int32 VertFrameRowStep = 0;
+		int32 VertRowStep = 0;
+		bool bVertUNorm8 = false;
+		bool bBoneUNorm8 = false;
+		float MaxValueOffset = 0.f;
+		float MaxValuePosition = 0.f;
+		TArray <FVector4f> Clips;
+		TArray <FVector4f> VertRest;
+		FTextureReferenceRHIRef OffsetsTexture;
+		FTextureReferenceRHIRef NormalsTexture;
+		FTextureReferenceRHIRef BonePosTexture;
+		FTextureReferenceRHIRef BoneRotTexture;
+		FTextureReferenceRHIRef RangesTexture;
+	};
+
+	static FTextureReferenceRHIRef GetTextureReference(const UTexture2D* Texture)
+	{
+		return Texture ? Texture->TextureReference.TextureReferenceRHI : nullptr;
+	}
+
+	// Start frame (vert) or row (bone), frame count, frames per second and length of every clip.
+	// Clips reaching past NumRows get 0 frames, the shader treats them as invalid
+	static void AddClips(const TArray <FVASequenceData>& Anims, const int32 RowsPerFrame, const int32 NumRows, TArray <FVector4f>& OutClips)
+	{
+		for (const FVASequenceData& Anim : Anims)
+		{
+			const int32 Start = Anim.AnimStart_Generated / RowsPerFrame;
+			const float FrameRate = Anim.Speed_Generated * Anim.NumFrames;
+			const bool bValid = (Anim.NumFrames > 0) && ((Start + Anim.NumFrames) * RowsPerFrame <= NumRows) && (FrameRate > 0.f);
+			OutClips.Add(bValid ? FVector4f(Start, Anim.NumFrames, FrameRate, Anim.NumFrames / FrameRate) : FVector4f(0.f, 0.f, 0.f, 0.f));
+		}
+	}
+
+	// Empty arrays still get one element so the SRV is always valid
+	static void UploadFloat4s(FReadBuffer& Buffer, const TCHAR* DebugName, const TArray <FVector4f>& Data)
+	{
+		Buffer.Release();
+
+		const uint32 NumElements = FMath::Max(Data.Num(), 1);
+		Buffer.Initialize(DebugName, sizeof(FVector4f), NumElements, PF_A32B32G32R32F, BUF_Static);
+
+		const uint32 BufferSize = NumElements * sizeof(FVector4f);
+		void* BufferData = RHILockBuffer(Buffer.Buffer, 0, BufferSize, RLM_WriteOnly);
+		if (Data.Num()) FMemory::Memcpy(BufferData, Data.GetData(), BufferSize);
+		else FMemory::Memzero(BufferData, BufferSize);
+		RHIUnlockBuffer(Buffer.Buffer);
+	}
+}
+
+struct FNDIVertexAnimProfileProxy : public FNiagaraDataInterfaceProxy
+{
+	virtual ~FNDIVertexAnimProfileProxy()
+	{
+		Clips.Release();
+		VertRest.Release();
+	}
+
+	virtual int32 PerInstanceDataPassedToRenderThreadSize() const override { return 0; }
+
+	void UpdateData(NDIVertexAnimProfileLocal::FGPUData&& InData)
+	{
+		check(IsInRenderingThread());
+
+		NDIVertexAnimProfileLocal::UploadFloat4s(Clips, TEXT("NDIVertexAnimProfile_Clips"), InData.Clips);
+		NDIVertexAnimProfileLocal::UploadFloat4s(VertRest, TEXT("NDIVertexAnimProfile_VertRest"), InData.VertRest);
+
+		Data = MoveTemp(InData);
+		Data.Clips.Empty();
+		Data.VertRest.Empty();
+	}
+
+	// Counts, layout and textures, the float4 arrays only live in the buffers
+	NDIVertexAnimProfileLocal::FGPUData Data;
+
+	FReadBuffer Clips;
+	FReadBuffer VertRest;
+};
+
+UNiagaraDataInterfaceVertexAnimProfile::UNiagaraDataInterfaceVertexAnimProfile(FObjectInitializer const& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Proxy.Reset(new FNDIVertexAnimProfileProxy());
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		ENiagaraTypeRegistryFlags Flags = ENiagaraTypeRegistryFlags::AllowAnyVariable | ENiagaraTypeRegistryFlags::AllowParameter;
+		FNiagaraTypeRegistry::Register(FNiagaraTypeDefinition(GetClass()), Flags);
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::PostLoad()
+{
+	Super::PostLoad();
+
+	if (Profile) Profile->ConditionalPostLoad();
+	RefreshSamplers();
+	MarkRenderDataDirty();
+}
+
+#if WITH_EDITOR
+void UNiagaraDataInterfaceVertexAnimProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	RefreshSamplers();
+	MarkRenderDataDirty();
+}
+#endif
+
+void UNiagaraDataInterfaceVertexAnimProfile::RefreshSamplers()
+{
+	VertSampler.Reset();
+	BoneSampler.Reset();
+
+	if (!Profile) return;
+
+	if (Profile->CPUVertSampling) VertSampler.Initialize(Profile);
+	else if (Profile->Anims_Vert.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s was baked without CPUVertSampling, its vertices sample as 0 on CPU and GPU emitters"),
+			*GetPathName(), *Profile->GetName());
+	}
+
+	if (Profile->CPUBoneSampling) BoneSampler.Initialize(Profile);
+	else if (Profile->Anims_Bone.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s was baked without CPUBoneSampling, its bones sample as 0 on CPU emitters"),
+			*GetPathName(), *Profile->GetName());
+	}
+}
+
+bool UNiagaraDataInterfaceVertexAnimProfile::CopyToInternal(UNiagaraDataInterface* Destination) const
+{
+	if (!Super::CopyToInternal(Destination)) return false;
+
+	UNiagaraDataInterfaceVertexAnimProfile* DestinationTyped = CastChecked<UNiagaraDataInterfaceVertexAnimProfile>(Destination);
+	DestinationTyped->Profile = Profile;
+	DestinationTyped->RefreshSamplers();
+	DestinationTyped->MarkRenderDataDirty();
+	return true;
+}
+
+bool UNiagaraDataInterfaceVertexAnimProfile::Equals(const UNiagaraDataInterface* Other) const
+{
+	if (!Super::Equals(Other)) return false;
+
+	return CastChecked<const UNiagaraDataInterfaceVertexAnimProfile>(Other)->Profile == Profile;
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions)
+{
+	using namespace NDIVertexAnimProfileLocal;
+
+	FNiagaraFunctionSignature DefaultSig;
+	DefaultSig.bMemberFunction = true;
+	DefaultSig.bRequiresContext = false;
+	DefaultSig.bSupportsCPU = true;
+	DefaultSig.bSupportsGPU = true;
+	DefaultSig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition(GetClass()), TEXT("VertexAnimProfile")));
+
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = GetNumVerticesName;
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumVertices")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("GetNumVerticesDesc", "Number of vertices that can be sampled, the verts of the profile's LOD0 rows. 0 without CPUVertSampling.");
+#endif
+	}
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = GetNumBonesName;
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumBones")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("GetNumBonesDesc", "Number of bones that can be sampled. 0 on CPU emitters without CPUBoneSampling.");
+#endif
+	}
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = GetNumClipsName;
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumVertClips")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumBoneClips")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("GetNumClipsDesc", "Number of sampleable clips, indexed like the profile's Anims_Vert and Anims_Bone.");
+#endif
+	}
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = GetClipInfoName;
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Clip")));
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetBoolDef(), TEXT("BoneClip")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetBoolDef(), TEXT("Valid")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Length")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumFrames")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("GetClipInfoDesc", "Length in seconds and baked frame count of a vert (or bone) clip.");
+#endif
+	}
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = SampleVertexName;
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Clip")));
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Time")));
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Vertex")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec3Def(), TEXT("Position")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec3Def(), TEXT("Normal")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("SampleVertexDesc", "Component space position and normal of a vertex at a time of a vert clip, time wraps around the clip like the material does.");
+#endif
+	}
+	{
+		FNiagaraFunctionSignature& Sig = OutFunctions.Add_GetRef(DefaultSig);
+		Sig.Name = SampleBoneTransformName;
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Clip")));
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Time")));
+		Sig.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Bone")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec3Def(), TEXT("Position")));
+		Sig.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetQuatDef(), TEXT("Rotation")));
+#if WITH_EDITORONLY_DATA
+		Sig.Description = LOCTEXT("SampleBoneTransformDesc", "Component space transform of a bone (texture column) at a time of a bone clip, time wraps around the clip like the material does.");
+#endif
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc)
+{
+	using namespace NDIVertexAnimProfileLocal;
+
+	if (BindingInfo.Name == GetNumVerticesName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMGetNumVertices);
+	}
+	else if (BindingInfo.Name == GetNumBonesName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMGetNumBones);
+	}
+	else if (BindingInfo.Name == GetNumClipsName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMGetNumClips);
+	}
+	else if (BindingInfo.Name == GetClipInfoName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMGetClipInfo);
+	}
+	else if (BindingInfo.Name == SampleVertexName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMSampleVertex);
+	}
+	else if (BindingInfo.Name == SampleBoneTransformName)
+	{
+		OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceVertexAnimProfile::VMSampleBoneTransform);
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMGetNumVertices(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIOutputParam<int32> OutNumVertices(Context);
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		OutNumVertices.SetAndAdvance(VertSampler.GetNumVerts());
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMGetNumBones(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIOutputParam<int32> OutNumBones(Context);
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		OutNumBones.SetAndAdvance(BoneSampler.GetNumBones());
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMGetNumClips(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIOutputParam<int32> OutNumVertClips(Context);
+	FNDIOutputParam<int32> OutNumBoneClips(Context);
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		OutNumVertClips.SetAndAdvance(VertSampler.GetNumClips());
+		OutNumBoneClips.SetAndAdvance(BoneSampler.GetNumClips());
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMGetClipInfo(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIInputParam<int32> InClip(Context);
+	FNDIInputParam<bool> InBoneClip(Context);
+	FNDIOutputParam<bool> OutValid(Context);
+	FNDIOutputParam<float> OutLength(Context);
+	FNDIOutputParam<int32> OutNumFrames(Context);
+
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		const int32 Clip = InClip.GetAndAdvance();
+		const bool bBoneClip = InBoneClip.GetAndAdvance();
+
+		int32 Start = 0;
+		int32 NumFrames = 0;
+		float FrameRate = 0.f;
+		const bool bValid = bBoneClip ? BoneSampler.GetClip(Clip, Start, NumFrames, FrameRate) : VertSampler.GetClip(Clip, Start, NumFrames, FrameRate);
+
+		OutValid.SetAndAdvance(bValid);
+		OutLength.SetAndAdvance(bBoneClip ? BoneSampler.GetClipLength(Clip) : VertSampler.GetClipLength(Clip));
+		OutNumFrames.SetAndAdvance(NumFrames);
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMSampleVertex(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIInputParam<int32> InClip(Context);
+	FNDIInputParam<float> InTime(Context);
+	FNDIInputParam<int32> InVertex(Context);
+	FNDIOutputParam<FVector3f> OutPosition(Context);
+	FNDIOutputParam<FVector3f> OutNormal(Context);
+
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		const int32 Clip = InClip.GetAndAdvance();
+		const float Time = InTime.GetAndAdvance();
+		const int32 Vertex = InVertex.GetAndAdvance();
+
+		FVector3f Position, Normal;
+		VertSampler.SampleVerts(Clip, Time, MakeArrayView(&Vertex, 1), MakeArrayView(&Position, 1), MakeArrayView(&Normal, 1));
+
+		OutPosition.SetAndAdvance(Position);
+		OutNormal.SetAndAdvance(Normal);
+	}
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::VMSampleBoneTransform(FVectorVMExternalFunctionContext& Context)
+{
+	FNDIInputParam<int32> InClip(Context);
+	FNDIInputParam<float> InTime(Context);
+	FNDIInputParam<int32> InBone(Context);
+	FNDIOutputParam<FVector3f> OutPosition(Context);
+	FNDIOutputParam<FQuat4f> OutRotation(Context);
+
+	for (int32 i = 0; i < Context.GetNumInstances(); i++)
+	{
+		const int32 Clip = InClip.GetAndAdvance();
+		const float Time = InTime.GetAndAdvance();
+		const int32 Bone = InBone.GetAndAdvance();
+
+		FTransform Transform;
+		BoneSampler.SampleBoneTransforms(Clip, Time, MakeArrayView(&Bone, 1), MakeArrayView(&Transform, 1));
+
+		OutPosition.SetAndAdvance(FVector3f(Transform.GetTranslation()));
+		OutRotation.SetAndAdvance(FQuat4f(Transform.GetRotation()));
+	}
+}
+
+#if WITH_EDITORONLY_DATA
+bool UNiagaraDataInterfaceVertexAnimProfile::AppendCompileHash(FNiagaraCompileHashVisitor* InVisitor) const
+{
+	bool bSuccess = Super::AppendCompileHash(InVisitor);
+	bSuccess &= InVisitor->UpdateString(TEXT("NDIVertexAnimProfileDecode"), GetShaderFileHash(NDIVertexAnimProfileLocal::DecodeShaderFile, EShaderPlatform::SP_PCD3D_SM5).ToString());
+	bSuccess &= InVisitor->UpdateString(TEXT("NDIVertexAnimProfileTemplate"), GetShaderFileHash(NDIVertexAnimProfileLocal::TemplateShaderFile, EShaderPlatform::SP_PCD3D_SM5).ToString());
+	bSuccess &= InVisitor->UpdateShaderParameters<FShaderParameters>();
+	return bSuccess;
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::GetCommonHLSL(FString& OutHLSL)
+{
+	OutHLSL.Appendf(TEXT("#include \"%s\"\n"), NDIVertexAnimProfileLocal::DecodeShaderFile);
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::GetParameterDefinitionHLSL(const FNiagaraDataInterfaceGPUParamInfo& ParamInfo, FString& OutHLSL)
+{
+	const TMap<FString, FStringFormatArg> TemplateArgs =
+	{
+		{TEXT("ParameterName"), ParamInfo.DataInterfaceHLSLSymbol},
+	};
+	AppendTemplateHLSL(OutHLSL, NDIVertexAnimProfileLocal::TemplateShaderFile, TemplateArgs);
+}
+
+bool UNiagaraDataInterfaceVertexAnimProfile::GetFunctionHLSL(const FNiagaraDataInterfaceGPUParamInfo& ParamInfo, const FNiagaraDataInterfaceGeneratedFunction& FunctionInfo, int FunctionInstanceIndex, FString& OutHLSL)
+{
+	using namespace NDIVertexAnimProfileLocal;
+
+	// All functions are in the template
+	return (FunctionInfo.DefinitionName == GetNumVerticesName)
+		|| (FunctionInfo.DefinitionName == GetNumBonesName)
+		|| (FunctionInfo.DefinitionName == GetNumClipsName)
+		|| (FunctionInfo.DefinitionName == GetClipInfoName)
+		|| (FunctionInfo.DefinitionName == SampleVertexName)
+		|| (FunctionInfo.DefinitionName == SampleBoneTransformName);
+}
+#endif
+
+void UNiagaraDataInterfaceVertexAnimProfile::BuildShaderParameters(FNiagaraShaderParametersBuilder& ShaderParametersBuilder) const
+{
+	ShaderParametersBuilder.AddNestedStruct<FShaderParameters>();
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::SetShaderParameters(const FNiagaraDataInterfaceSetShaderParametersContext& Context) const
+{
+	const FNDIVertexAnimProfileProxy& DIProxy = Context.GetProxy<FNDIVertexAnimProfileProxy>();
+	FShaderParameters* Parameters = Context.GetParameterNestedStruct<FShaderParameters>();
+
+	// Buffers are only there once the data was pushed, the counts stay 0 until then so nothing is read
+	auto SRVOrDummy = [](const FReadBuffer& Buffer) -> FRHIShaderResourceView*
+	{
+		return Buffer.SRV.IsValid() ? Buffer.SRV.GetReference() : FNiagaraRenderer::GetDummyFloat4Buffer();
+	};
+	auto TextureOrBlack = [](const FTextureReferenceRHIRef& Texture) -> FRHITexture*
+	{
+		return Texture.IsValid() ? Texture.GetReference() : GBlackTexture->TextureRHI.GetReference();
+	};
+
+	const NDIVertexAnimProfileLocal::FGPUData& Data = DIProxy.Data;
+	Parameters->NumVertices = Data.NumVertices;
+	Parameters->NumBones = Data.NumBones;
+	Parameters->NumVertClips = Data.NumVertClips;
+	Parameters->NumBoneClips = Data.NumBoneClips;
+	Parameters->VertTextureWidth = Data.VertTextureWidth;
+	Parameters->VertFrameRowStep = Data.VertFrameRowStep;
+	Parameters->VertRowStep = Data.VertRowStep;
+	Parameters->VertUNorm8 = Data.bVertUNorm8 ? 1 : 0;
+	Parameters->BoneUNorm8 = Data.bBoneUNorm8 ? 1 : 0;
+	Parameters->MaxValueOffset = Data.MaxValueOffset;
+	Parameters->MaxValuePosition = Data.MaxValuePosition;
+	Parameters->Clips = SRVOrDummy(DIProxy.Clips);
+	Parameters->VertRest = SRVOrDummy(DIProxy.VertRest);
+	Parameters->OffsetsTexture = TextureOrBlack(Data.OffsetsTexture);
+	Parameters->NormalsTexture = TextureOrBlack(Data.NormalsTexture);
+	Parameters->BonePosTexture = TextureOrBlack(Data.BonePosTexture);
+	Parameters->BoneRotTexture = TextureOrBlack(Data.BoneRotTexture);
+	Parameters->RangesTexture = TextureOrBlack(Data.RangesTexture);
+}
+
+void UNiagaraDataInterfaceVertexAnimProfile::PushToRenderThreadImpl()
+{
+	using namespace NDIVertexAnimProfileLocal;
+
+	FGPUData Data;
+
+	// The textures are sampled directly, only the rest pose of the verts comes from the profile's CPU data
+	if (Profile && Profile->OffsetsTexture && Profile->NormalsTexture && (Profile->OverrideSize_Vert.X > 0) && (Profile->RowsPerFrame_Vert > 0))
+	{
+		const int32 NumRest = Profile->RestPositions_Vert.Num();
+		if ((NumRest > 0) && (Profile->RestNormals_Vert.Num() == NumRest) && (NumRest <= Profile->OverrideSize_Vert.X * Profile->RowsPerFrame_Vert))
+		{
+			Data.NumVertices = NumRest;
+			Data.VertRest.SetNumUninitialized(NumRest * 2);
+			for (int32 v = 0; v < NumRest; v++)
+			{
+				Data.VertRest[v * 2 + 0] = FVector4f(Profile->RestPositions_Vert[v], 0.f);
+				Data.VertRest[v * 2 + 1] = FVector4f(Profile->RestNormals_Vert[v], 0.f);
+			}
+		}
+
+		AddClips(Profile->Anims_Vert, Profile->RowsPerFrame_Vert, Profile->OverrideSize_Vert.Y, Data.Clips);
+		Data.NumVertClips = Data.Clips.Num();
+
+		// Frames actually stored, the FrameInterleaved layout interleaves that many rows
+		int32 NumStoredFrames = 0;
+		for (const FVector4f& Clip : Data.Clips) NumStoredFrames = FMath::Max(NumStoredFrames, (int32)(Clip.X + Clip.Y));
+
+		const bool bInterleaved = (Profile->Layout_Vert == EVATVertLayout::FrameInterleaved);
+		Data.VertTextureWidth = Profile->OverrideSize_Vert.X;
+		Data.VertFrameRowStep = bInterleaved ? 1 : Profile->RowsPerFrame_Vert;
+		Data.VertRowStep = bInterleaved ? NumStoredFrames : 1;
+		Data.bVertUNorm8 = (Profile->TexelFormat_Vert == EVATTexelFormat::UNorm8);
+		Data.MaxValueOffset = Profile->MaxValueOffset_Vert;
+		Data.OffsetsTexture = GetTextureReference(Profile->OffsetsTexture);
+		Data.NormalsTexture = GetTextureReference(Profile->NormalsTexture);
+	}
+
+	if (Profile && Profile->BonePosTexture && Profile->BoneRotTexture && (Profile->OverrideSize_Bone.X > 0))
+	{
+		AddClips(Profile->Anims_Bone, 1, Profile->OverrideSize_Bone.Y, Data.Clips);
+		Data.NumBoneClips = Data.Clips.Num() - Data.NumVertClips;
+		Data.NumBones = Profile->OverrideSize_Bone.X;
+		Data.bBoneUNorm8 = (Profile->TexelFormat_Bone == EVATTexelFormat::UNorm8);
+		Data.MaxValuePosition = Profile->MaxValuePosition_Bone;
+		Data.BonePosTexture = GetTextureReference(Profile->BonePosTexture);
+		Data.BoneRotTexture = GetTextureReference(Profile->BoneRotTexture);
+	}
+
+	if (Profile) Data.RangesTexture = GetTextureReference(Profile->RangesTexture);
+
+	FNDIVertexAnimProfileProxy* DIProxy = GetProxyAs<FNDIVertexAnimProfileProxy>();
+	ENQUEUE_RENDER_COMMAND(FNDIVertexAnimProfileUpdate)(
+		[DIProxy, Data = MoveTemp(Data)](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			DIProxy->UpdateData(MoveTemp(Data));
+		});
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,6 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+// Niagara integration lives in its own module so the runtime module can keep loading before Niagara (PostConfigInit, shader mapping)
+IMPLEMENT_MODULE(FDefaultModuleImpl, VertexAnimToolsetNiagara)
@@ -0,0 +1,89 @@
+// Copyright 2019-2021 Rexocrates. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NiagaraDataInterface.h"
+#include "VertexAnimBoneSampler.h"
+#include "VertexAnimVertSampler.h"
+#include "NiagaraDataInterfaceVertexAnimProfile.generated.h"
+
+class UVertexAnimProfile;
+
+// Lets emitters read the baked animation of a Vertex Anim Profile: clip lookup, vertex positions and bone transforms,
+// for spawn locations, attachment or collision against VAT meshes. Everything is in the VAT mesh's component space.
+// CPU emitters sample the texels the CPU samplers decode, which needs CPUVertSampling (vertices) and / or CPUBoneSampling (bones).
+// GPU emitters read the profile's textures and decode them like the material does (VertexAnimDecode.ush), vertices still need
+// CPUVertSampling for the rest pose.
+UCLASS(EditInlineNew, Category = "Mesh", meta = (DisplayName = "Vertex Anim Profile"))
+class VERTEXANIMTOOLSETNIAGARA_API UNiagaraDataInterfaceVertexAnimProfile : public UNiagaraDataInterface
+{
+	GENERATED_UCLASS_BODY()
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FShaderParameters, )
+		SHADER_PARAMETER(int32, NumVertices)
+		SHADER_PARAMETER(int32, NumBones)
+		SHADER_PARAMETER(int32, NumVertClips)
+		SHADER_PARAMETER(int32, NumBoneClips)
+		SHADER_PARAMETER(int32, VertTextureWidth)
+		SHADER_PARAMETER(int32, VertFrameRowStep)
+		SHADER_PARAMETER(int32, VertRowStep)
+		SHADER_PARAMETER(int32, VertUNorm8)
+		SHADER_PARAMETER(int32, BoneUNorm8)
+		SHADER_PARAMETER(float, MaxValueOffset)
+		SHADER_PARAMETER(float, MaxValuePosition)
+		SHADER_PARAMETER_SRV(Buffer<float4>, Clips)
+		SHADER_PARAMETER_SRV(Buffer<float4>, VertRest)
+		SHADER_PARAMETER_TEXTURE(Texture2D, OffsetsTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D, NormalsTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D, BonePosTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D, BoneRotTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D, RangesTexture)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Vertex Anim")
+		UVertexAnimProfile* Profile = NULL;
+
+	//UObject Interface
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//UObject Interface End
+
+	//UNiagaraDataInterface Interface
+	virtual void GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions) override;
+	virtual void GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc) override;
+	virtual bool CanExecuteOnTarget(ENiagaraSimTarget Target) const override { return true; }
+	virtual bool Equals(const UNiagaraDataInterface* Other) const override;
+
+#if WITH_EDITORONLY_DATA
+	virtual bool AppendCompileHash(FNiagaraCompileHashVisitor* InVisitor) const override;
+	virtual void GetCommonHLSL(FString& OutHLSL) override;
+	virtual void GetParameterDefinitionHLSL(const FNiagaraDataInterfaceGPUParamInfo& ParamInfo, FString& OutHLSL) override;
+	virtual bool GetFunctionHLSL(const FNiagaraDataInterfaceGPUParamInfo& ParamInfo, const FNiagaraDataInterfaceGeneratedFunction& FunctionInfo, int FunctionInstanceIndex, FString& OutHLSL) override;
+#endif
+	virtual void BuildShaderParameters(FNiagaraShaderParametersBuilder& ShaderParametersBuilder) const override;
+	virtual void SetShaderParameters(const FNiagaraDataInterfaceSetShaderParametersContext& Context) const override;
+	//UNiagaraDataInterface Interface End
+
+	void VMGetNumVertices(FVectorVMExternalFunctionContext& Context);
+	void VMGetNumBones(FVectorVMExternalFunctionContext& Context);
+	void VMGetNumClips(FVectorVMExternalFunctionContext& Context);
+	void VMGetClipInfo(FVectorVMExternalFunctionContext& Context);
+	void VMSampleVertex(FVectorVMExternalFunctionContext& Context);
+	void VMSampleBoneTransform(FVectorVMExternalFunctionContext& Context);
+
+protected:
+	virtual bool CopyToInternal(UNiagaraDataInterface* Destination) const override;
+	virtual void PushToRenderThreadImpl() override;
+
+private:
+	// Decodes the profile's CPU data for the CPU VM, whenever the profile is set or changes
+	void RefreshSamplers();
+
+	FVertexAnimVertSampler VertSampler;
+	FVertexAnimBoneSampler BoneSampler;
+};
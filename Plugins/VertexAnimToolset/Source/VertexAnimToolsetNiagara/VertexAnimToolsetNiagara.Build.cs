@@ -0,0 +1,35 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class VertexAnimToolsetNiagara : ModuleRules
+{
+	public VertexAnimToolsetNiagara(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"VertexAnimToolset",
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"Niagara",
+				"NiagaraCore",
+			}
+			);
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"NiagaraShader",
+				"VectorVM",
+				"RHI",
+				"RenderCore",
+			}
+			);
+
+		PrecompileForTargets = PrecompileTargetsType.Any;
+	}
+}